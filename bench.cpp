@@ -0,0 +1,100 @@
+#include "jog.h"
+#include <chrono>
+
+// Per-call cost of a native handler written by hand against the glue that
+// bind<>() generates for it.  Build and run with "make bench".
+
+static int bench_min( int a, int b ) { return (a < b) ? a : b; }
+
+static void Math__min__int_int( JogVM* vm )
+{
+  // Leaf handler written the way handlers were before bind<>().
+  int m = vm->pop_int();
+  int n = vm->pop_int();
+  vm->push( min(n,m) );
+}
+
+static double seconds_since( std::chrono::steady_clock::time_point start )
+{
+  return std::chrono::duration<double>( std::chrono::steady_clock::now() - start ).count();
+}
+
+static void time_handler( JogVM* vm, const char* name, JogNativeMethodHandler handler )
+{
+  // Called through a volatile pointer like the interpreter's dispatch, so
+  // the handler can't be inlined into the loop.
+  const int iterations = 100000000;
+  JogNativeMethodHandler volatile call = handler;
+  JogInt64 sum = 0;
+
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  for (int i=0; i<iterations; ++i)
+  {
+    vm->push( i );
+    vm->push( iterations - i );
+    call( vm );
+    sum += vm->pop_int();
+  }
+  double elapsed = seconds_since( start );
+
+  printf( "  %-26s %6.2f ns/call  (checksum %lld)\n", name, elapsed * 1e9 / iterations,
+      (long long) sum );
+}
+
+static const char* bench_program =
+  "class Bench\n"
+  "{\n"
+  "  static int total;\n"
+  "\n"
+  "  Bench()\n"
+  "  {\n"
+  "    for (int i=0; i<5000000; ++i) total += Math.min( i, 2500000 );\n"
+  "  }\n"
+  "}\n";
+
+static void time_program( const char* name, bool handwritten, int mode )
+{
+  Ref<JogVM> vm = new JogVM();
+  if (handwritten) vm->add_leaf_native_handler( "Math::min(int,int)", Math__min__int_int );
+  vm->execution_mode = mode;
+  vm->constant_folding_enabled = false;  // keep the calls
+
+  vm->parse( "libraries/jog/jog_stdlib.java" );
+  vm->parse( "bench.java", bench_program );
+  vm->compile();
+
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  vm->run( "Bench" );
+  printf( "  %-26s mode %d  %6.1f ms\n", name, mode, seconds_since(start) * 1e3 );
+}
+
+int main()
+{
+  try
+  {
+    {
+      Ref<JogVM> vm = new JogVM();
+
+      printf( "Math.min(int,int) handler, 1e8 calls:\n" );
+      time_handler( *vm, "handwritten", Math__min__int_int );
+      time_handler( *vm, "bind<Sig,fn>()", JogNativeGlue<int(int,int)>::handler<bench_min> );
+
+      vm->native_function = (JogNativeFunction) bench_min;
+      time_handler( *vm, "bind<Sig>(fn) (pointer)", JogNativeGlue<int(int,int)>::bound_handler );
+    }
+
+    printf( "\n5M calls to Math.min(int,int) from Jog:\n" );
+    for (int mode=0; mode<=2; ++mode)
+    {
+      time_program( "handwritten", true, mode );
+      time_program( "bind<Sig,fn>()", false, mode );
+    }
+  }
+  catch (Ref<JogError> error)
+  {
+    error->print();
+    return 1;
+  }
+
+  return 0;
+}
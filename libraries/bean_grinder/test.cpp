@@ -29,30 +29,26 @@ void append_string(char**A, char*b) {
   *A = r;
 }
 
+char* to_string( JogStringView str );
+
 char* to_string( JogRef ref ) {
-  JogObject* str = *ref;
-  
-  if (str == NULL)
+  return to_string( jog_string_view(*ref) );
+}
+
+char* to_string( JogStringView str )
+{
+  if (str.is_null())
   {
     return strdup("null");
   }
   else
   {
-    JogObject* array = *((JogObject**)&(str->data[0]));
-    if (array)
-    {
-      unichar* chars = (unichar*) array->data;
-      char * r = (char*)malloc(array->count+1);
-      for (int i=0; i<array->count; i++) {
-	r[i] = chars[i];
-      }
-      r[array->count] = 0;
-      return r;
-    }
-    else
-    {
-      return strdup("[Error]");
+    char* r = (char*)malloc(str.count+1);
+    for (int i=0; i<str.count; i++) {
+      r[i] = (char) str[i];
     }
+    r[str.count] = 0;
+    return r;
   }
 }
 
@@ -80,28 +76,28 @@ char* to_string( Ref<ASCIIString> str )
 //  Native Method Implementations
 //=============================================================================
 
-static void BeanGrinder__configureTest__String( JogVM* vm)
+static void BeanGrinder__configureTest__String( JogStringView name )
 {
   free(current_test_name);
   free(current_reference_result);
   free(current_user_result);
-  current_test_name = to_string( vm->pop_ref() );
+  current_test_name = to_string( name );
   current_reference_result = strdup("");
   current_user_result = strdup("");
 }
 
-static void BeanGrinder__startReferenceTest( JogVM* vm )
+static void BeanGrinder__startReferenceTest()
 {
   is_reference_test = true;
 }
 
-static void BeanGrinder__setReferenceOutput__String( JogVM* vm )
+static void BeanGrinder__setReferenceOutput__String( JogStringView output )
 {
   free(current_reference_result);
-  current_reference_result = to_string(vm->pop_ref());
+  current_reference_result = to_string(output);
 }
 
-static void BeanGrinder__startUserTest( JogVM* vm )
+static void BeanGrinder__startUserTest()
 {
   is_reference_test = false;
 }
@@ -121,7 +117,7 @@ void fprint_field(FILE*fp, const char* property, char*s, int comma=0) {
   fputc('\n', fp);
 }
 
-static void BeanGrinder__endTest( JogVM* vm ) {
+static void BeanGrinder__endTest() {
   size_t buffer_size = 
     2*(strlen(current_test_name) + 
        strlen(current_reference_result) + 
@@ -164,69 +160,49 @@ static void BeanGrinder__endTest( JogVM* vm ) {
   free(buffer);
 }
 
-static void BeanGrinder__printSound__Array_of_float( JogVM* vm )
+static void BeanGrinder__printSound__Array_of_float( JogArrayView<float> sound )
 {
 /*
-  JogInterpreter* jog = ((JogInterpreter*) vm->user_context);
-
-  JogObject* array = *(vm->pop_ref());
-
-  if ( !array )
+  if ( !sound.data )
   {
     printf( "[Internal] null pointer exception in native BeanGrinder::printSound(float[])." );
     return;
   }
 
-  int count = array->count;
-  [jog printSound:((float*) array->data) withCount:count];
+  [jog printSound:sound.data withCount:sound.count];
 */
 }
 
-static void BeanGrinder__playSound__Array_of_float( JogVM* vm )
+static void BeanGrinder__playSound__Array_of_float( JogArrayView<float> sound )
 {
 /*
-  JogInterpreter* jog = ((JogInterpreter*) vm->user_context);
-
-  JogObject* array = *(vm->pop_ref());
-
-  if ( !array )
+  if ( !sound.data )
   {
     printf( "[Internal] null pointer exception in native BeanGrinder::playSound(float[])." );
     return;
   }
 
-  int count = array->count;
-  [jog playSound:((float*) array->data) withCount:count];
+  [jog playSound:sound.data withCount:sound.count];
 */
 }
 
-static void BeanGrinder__printImage__Array_of_byte_int( JogVM* vm )
+static void BeanGrinder__printImage__Array_of_byte_int( JogArrayView<JogInt8> image, int width )
 {
 /*
-  JogInterpreter* jog = ((JogInterpreter*) vm->user_context);
-
-  int width = (int) vm->pop_data();
-  JogObject* array = *(vm->pop_ref());
-
-  if ( !array )
+  if ( !image.data )
   {
     printf( "[Internal] null pointer exception in native BeanGrinder::printImage(byte[],int)." );
     return;
   }
 
-  int count = array->count;
-  [jog printImage:((char*) array->data) withCount:count withWidth:width];
+  [jog printImage:image.data withCount:image.count withWidth:width];
 */
 }
 
 //-----------------------------------------------------------------------------
 
-static void PrintWriter__print__char( JogVM* vm )
+static void PrintWriter__print__char( JogObject* writer, JogChar ch )
 {
-  //JogInterpreter* jog = ((JogInterpreter*) vm->user_context);
-  //bool is_reference_test = jog->is_reference_test;
-
-  int ch = vm->pop_int();
   char chars[2];
   chars[0] = (char) ch;
   chars[1] = 0;
@@ -240,10 +216,8 @@ static void PrintWriter__print__char( JogVM* vm )
   }
 }
 
-static void PrintWriter__print__String( JogVM* vm )
+static void PrintWriter__print__String( JogObject* writer, JogStringView str )
 {
-  JogObject* str = *(vm->pop_ref());
-
   if (is_reference_test)
   {
     char* tmp = to_string(str);
@@ -273,25 +247,25 @@ void init ()
   // vm_object = vm;
   vm->retain();
   
-  vm->add_native_handler( "BeanGrinder::configureTest(String)", 
-			  BeanGrinder__configureTest__String );
-  vm->add_native_handler( "BeanGrinder::startReferenceTest()", 
-			  BeanGrinder__startReferenceTest );
-  vm->add_native_handler( "BeanGrinder::setReferenceOutput(String)", 
-			  BeanGrinder__setReferenceOutput__String );
-  vm->add_native_handler( "BeanGrinder::startUserTest()", 
-			  BeanGrinder__startUserTest );
-  vm->add_native_handler( "BeanGrinder::endTest()", 
-			  BeanGrinder__endTest );
-  vm->add_native_handler( "BeanGrinder::printSound(float[])", 
-			  BeanGrinder__printSound__Array_of_float );
-  vm->add_native_handler( "BeanGrinder::playSound(float[])", 
-			  BeanGrinder__playSound__Array_of_float );
-  vm->add_native_handler( "BeanGrinder::printImage(byte[],int)", 
-			  BeanGrinder__printImage__Array_of_byte_int );
+  vm->bind<void(JogStringView),BeanGrinder__configureTest__String>(
+      "BeanGrinder::configureTest(String)" );
+  vm->bind<void(),BeanGrinder__startReferenceTest>(
+      "BeanGrinder::startReferenceTest()" );
+  vm->bind<void(JogStringView),BeanGrinder__setReferenceOutput__String>(
+      "BeanGrinder::setReferenceOutput(String)" );
+  vm->bind<void(),BeanGrinder__startUserTest>(
+      "BeanGrinder::startUserTest()" );
+  vm->bind<void(),BeanGrinder__endTest>(
+      "BeanGrinder::endTest()" );
+  vm->bind<void(JogArrayView<float>),BeanGrinder__printSound__Array_of_float>(
+      "BeanGrinder::printSound(float[])" );
+  vm->bind<void(JogArrayView<float>),BeanGrinder__playSound__Array_of_float>(
+      "BeanGrinder::playSound(float[])" );
+  vm->bind<void(JogArrayView<JogInt8>,int),BeanGrinder__printImage__Array_of_byte_int>(
+      "BeanGrinder::printImage(byte[],int)" );
     
-  vm->add_native_handler( "PrintWriter::print(char)", PrintWriter__print__char );
-  vm->add_native_handler( "PrintWriter::print(String)", PrintWriter__print__String );
+  vm->bind<void(JogObject*,JogChar),PrintWriter__print__char>( "PrintWriter::print(char)" );
+  vm->bind<void(JogObject*,JogStringView),PrintWriter__print__String>( "PrintWriter::print(String)" );
 
   is_reference_test = true;
   test_results = strdup("");
@@ -46,6 +46,24 @@ void JogObject::release_refs()
   }
 }
 
+JogObject* jog_released_objects = NULL;
+
+// Flags kept in the high bits of JogObject::reference_count.  JOG_QUEUED
+// is set while an object is on jog_released_objects so that it is only
+// queued once; JOG_GC_MARK marks objects on the ref stack and objects
+// reached during cycle collection.  JOG_IMMORTAL keeps the count of an
+// interned String and its char[] from ever reaching zero.
+#define JOG_GC_MARK  0x40000000
+#define JOG_QUEUED   0x20000000
+#define JOG_IMMORTAL 0x10000000
+
+void JogObject::retire()
+{
+  reference_count = JOG_QUEUED;
+  next_object = jog_released_objects;
+  jog_released_objects = this;
+}
+
 int JogObject::total_object_bytes()
 {
   if (type->is_array())
@@ -58,6 +76,268 @@ int JogObject::total_object_bytes()
   }
 }
 
+//=============================================================================
+//  JogObjectAllocator
+//=============================================================================
+JogObjectAllocator::JogObjectAllocator() : large_blocks(NULL), nursery(NULL),
+    nursery_chunks(NULL), nursery_chunk_count(0), free_chunks(NULL), nursery_chunk(NULL),
+    nursery_ptr(NULL), nursery_limit(NULL), young_chunk_count(0), nursery_full(false)
+{
+}
+
+JogObjectAllocator::~JogObjectAllocator()
+{
+  release_all();
+  ::free( nursery );
+  delete[] nursery_chunks;
+}
+
+void JogObjectAllocator::init_nursery( int size )
+{
+  int count = size / JOG_ALLOCATOR_CHUNK_SIZE;
+  if (count <= 0) return;
+
+  nursery = (char*) malloc( count * JOG_ALLOCATOR_CHUNK_SIZE );
+  if ( !nursery ) return;
+
+  nursery_chunks = new JogNurseryChunk[count];
+  nursery_chunk_count = count;
+  for (int i=count-1; i>=0; --i)
+  {
+    nursery_chunks[i].data = nursery + i * JOG_ALLOCATOR_CHUNK_SIZE;
+    release_chunk( nursery_chunks + i );
+  }
+}
+
+bool JogObjectAllocator::start_nursery_chunk()
+{
+  JogNurseryChunk* chunk = free_chunks;
+  if ( !chunk )
+  {
+    nursery_chunk = NULL;
+    nursery_ptr = nursery_limit = NULL;
+    if (young_chunk_count) nursery_full = true;
+    return false;
+  }
+
+  free_chunks = chunk->next_free;
+  chunk->state = JOG_CHUNK_YOUNG;
+  ++young_chunk_count;
+
+  nursery_chunk = chunk;
+  nursery_ptr = chunk->data;
+  nursery_limit = chunk->data + JOG_ALLOCATOR_CHUNK_SIZE;
+  return true;
+}
+
+void JogObjectAllocator::release_chunk( JogNurseryChunk* chunk )
+{
+  chunk->state = JOG_CHUNK_FREE;
+  chunk->live_count = 0;
+  chunk->live_bytes = 0;
+  memset( chunk->starts, 0, sizeof(chunk->starts) );
+  chunk->next_free = free_chunks;
+  free_chunks = chunk;
+}
+
+void JogObjectAllocator::collect_nursery()
+{
+  for (int i=0; i<nursery_chunk_count; ++i)
+  {
+    JogNurseryChunk* chunk = nursery_chunks + i;
+    if (chunk->state != JOG_CHUNK_YOUNG) continue;
+
+    if (chunk->live_count)
+    {
+      chunk->state = JOG_CHUNK_OLD;
+      nursery_stats.promoted_count += chunk->live_count;
+      nursery_stats.promoted_bytes += chunk->live_bytes;
+    }
+    else
+    {
+      release_chunk( chunk );
+    }
+  }
+
+  young_chunk_count = 0;
+  nursery_chunk = NULL;
+  nursery_ptr = nursery_limit = NULL;
+  nursery_full = false;
+  ++nursery_stats.minor_collection_count;
+}
+
+void* JogObjectAllocator::allocate( int size )
+{
+  if (size > JOG_ALLOCATOR_MAX_SMALL_SIZE)
+  {
+    JogLargeBlock* block = (JogLargeBlock*) calloc( 1, JOG_ALLOCATOR_GRANULARITY + size );
+    if ( !block )
+    {
+      Ref<JogError> err = new JogError("Out of allotted memory.");
+      throw err;
+    }
+    block->previous = NULL;
+    block->next = large_blocks;
+    if (large_blocks) large_blocks->previous = block;
+    large_blocks = block;
+    large_stats.on_allocate( size );
+    return ((char*) block) + JOG_ALLOCATOR_GRANULARITY;
+  }
+
+  int index = size_class( size );
+  int class_size = (index + 1) * JOG_ALLOCATOR_GRANULARITY;
+
+  if (nursery_ptr + class_size <= nursery_limit
+      || ((nursery_chunk || free_chunks) && start_nursery_chunk()))
+  {
+    char* result = nursery_ptr;
+    nursery_ptr += class_size;
+
+    JogNurseryChunk* chunk = nursery_chunk;
+    int granule = (int) (result - chunk->data) / JOG_ALLOCATOR_GRANULARITY;
+    chunk->starts[granule >> 3] |= (1 << (granule & 7));
+    ++chunk->live_count;
+    chunk->live_bytes += class_size;
+
+    ++nursery_stats.allocation_count;
+    nursery_stats.allocated_bytes += class_size;
+
+    memset( result, 0, class_size );
+    return result;
+  }
+
+  JogSizeClass& size_class = classes[index];
+  size_class.stats.on_allocate( class_size );
+
+  void* result = size_class.free_list;
+  if (result)
+  {
+    size_class.free_list = *((void**) result);
+  }
+  else
+  {
+    if (size_class.chunk_ptr + class_size > size_class.chunk_limit)
+    {
+      char* chunk = (char*) malloc( JOG_ALLOCATOR_CHUNK_SIZE );
+      if ( !chunk )
+      {
+        Ref<JogError> err = new JogError("Out of allotted memory.");
+        throw err;
+      }
+      *((char**) chunk) = size_class.chunks;
+      size_class.chunks = chunk;
+      size_class.chunk_ptr = chunk + JOG_ALLOCATOR_GRANULARITY;
+      size_class.chunk_limit = chunk + JOG_ALLOCATOR_CHUNK_SIZE;
+      ++size_class.chunk_count;
+    }
+    result = size_class.chunk_ptr;
+    size_class.chunk_ptr += class_size;
+  }
+
+  memset( result, 0, class_size );
+  return result;
+}
+
+void JogObjectAllocator::free( void* ptr, int size )
+{
+  if (size > JOG_ALLOCATOR_MAX_SMALL_SIZE)
+  {
+    JogLargeBlock* block = (JogLargeBlock*) (((char*) ptr) - JOG_ALLOCATOR_GRANULARITY);
+    if (block->previous) block->previous->next = block->next;
+    else                 large_blocks = block->next;
+    if (block->next) block->next->previous = block->previous;
+    large_stats.on_free( size );
+    ::free( block );
+    return;
+  }
+
+  int index = size_class( size );
+  int class_size = (index + 1) * JOG_ALLOCATOR_GRANULARITY;
+
+  JogNurseryChunk* chunk = nursery_chunk_of( ptr );
+  if (chunk)
+  {
+    --chunk->live_count;
+    chunk->live_bytes -= class_size;
+    if ( !chunk->live_count && chunk->state == JOG_CHUNK_OLD ) release_chunk( chunk );
+    return;
+  }
+
+  JogSizeClass& size_class = classes[index];
+  size_class.stats.on_free( class_size );
+  *((void**) ptr) = size_class.free_list;
+  size_class.free_list = ptr;
+}
+
+void JogObjectAllocator::release_all()
+{
+  for (int i=0; i<JOG_ALLOCATOR_CLASS_COUNT; ++i)
+  {
+    JogSizeClass& size_class = classes[i];
+    while (size_class.chunks)
+    {
+      char* next = *((char**) size_class.chunks);
+      ::free( size_class.chunks );
+      size_class.chunks = next;
+    }
+    size_class.free_list = NULL;
+    size_class.chunk_ptr = size_class.chunk_limit = NULL;
+    size_class.chunk_count = 0;
+    size_class.stats.live_count = 0;
+    size_class.stats.live_bytes = 0;
+  }
+
+  while (large_blocks)
+  {
+    JogLargeBlock* next = large_blocks->next;
+    ::free( large_blocks );
+    large_blocks = next;
+  }
+  large_stats.live_count = 0;
+  large_stats.live_bytes = 0;
+
+  free_chunks = NULL;
+  for (int i=nursery_chunk_count-1; i>=0; --i) release_chunk( nursery_chunks + i );
+  young_chunk_count = 0;
+  nursery_chunk = NULL;
+  nursery_ptr = nursery_limit = NULL;
+  nursery_full = false;
+}
+
+void JogObjectAllocator::print_stats()
+{
+  printf( "Size class   Allocations      Live  Live bytes  Peak bytes  Chunks\n" );
+  for (int i=0; i<JOG_ALLOCATOR_CLASS_COUNT; ++i)
+  {
+    JogAllocatorStats& stats = classes[i].stats;
+    if ( !stats.allocation_count ) continue;
+    printf( "%10d  %12lld  %8d  %10lld  %10lld  %6d\n", (i+1) * JOG_ALLOCATOR_GRANULARITY,
+        stats.allocation_count, stats.live_count, stats.live_bytes, stats.peak_bytes,
+        classes[i].chunk_count );
+  }
+  if (large_stats.allocation_count)
+  {
+    printf( "%10s  %12lld  %8d  %10lld  %10lld\n", "large",
+        large_stats.allocation_count, large_stats.live_count, 
+        large_stats.live_bytes, large_stats.peak_bytes );
+  }
+
+  if (nursery_stats.allocation_count)
+  {
+    int old_count = 0;
+    for (int i=0; i<nursery_chunk_count; ++i)
+    {
+      if (nursery_chunks[i].state == JOG_CHUNK_OLD) ++old_count;
+    }
+
+    printf( "Nursery: %lld allocations (%lld bytes), %d minor collections, "
+        "%lld promoted (%.1f%% of bytes), %d of %d chunks old\n",
+        nursery_stats.allocation_count, nursery_stats.allocated_bytes,
+        nursery_stats.minor_collection_count, nursery_stats.promoted_count,
+        100.0 * nursery_stats.promoted_bytes / nursery_stats.allocated_bytes,
+        old_count, nursery_chunk_count );
+  }
+}
 
 //=============================================================================
 //  JogError
@@ -326,269 +606,1161 @@ Ref<JogCmd> JogCmd::box( JogTypeInfo* as_type )
       && (wrapper_type == as_type || as_type == jog_type_manager.type_object
         || as_type->instance_of(jog_type_manager.type_number)))
   {
-    Ref<JogCmdList> args = new JogCmdList(t);
-    args->add( this );
-    return (new JogCmdNewObject( t, wrapper_type, args ))->resolve();
+    Ref<JogCmdList> args = new JogCmdList(t);
+    args->add( this );
+    return (new JogCmdNewObject( t, wrapper_type, args ))->resolve();
+  }
+  return this;
+}
+
+
+//=============================================================================
+//  JogVM
+//=============================================================================
+JogVM::JogVM( const JogVMOptions& options ) : max_object_bytes(1024*1024), 
+          heap_histogram_size(8), cur_object_bytes(0), class_data_bytes(0),
+          next_cycle_collection_bytes(0), options(options),
+          native_function(NULL), weak_interned_count(0), user_context(NULL), timeout_seconds(0),
+          instruction_budget(0), interrupted(0),
+          execution_mode(JOG_EXECUTION_BYTECODE), fusion_enabled(true),
+          devirtualization_enabled(true), inline_threshold(16), 
+          scalar_replacement_enabled(true),
+          constant_folding_enabled(true), compact_strings(true),
+          report_optimizations(false), report_gc(false),
+          cycle_collection_count(0), cyclic_objects_collected(0),
+          poll_countdown(0), poll_slice(0), budget_remaining(0), timeout_target(0)
+{
+  random_seed = (int) time(0);
+  ostringstream buffer;
+  buffer << random_seed;
+  JogReader::random_seed = buffer.str();
+
+  jog_type_manager.init();
+  JogMethodInfo::next_method_id = 1;
+
+  jog_context = NULL;
+  instruction_stack       = new JogInstruction[options.instruction_stack_capacity];
+  instruction_stack_limit = instruction_stack + options.instruction_stack_capacity;
+  instruction_stack_ptr   = instruction_stack_limit;
+  data_stack              = new JogInt64[options.data_stack_capacity];
+  data_stack_limit        = data_stack + options.data_stack_capacity;
+  data_stack_ptr          = data_stack_limit;
+  ref_stack               = new JogStackRef[options.ref_stack_capacity];
+  ref_stack_limit         = ref_stack + options.ref_stack_capacity;
+  ref_stack_ptr           = ref_stack_limit;
+  frames                  = new JogStackFrame[options.frame_stack_capacity];
+  frame_stack_limit       = frames + options.frame_stack_capacity;
+  frame_ptr               = frame_stack_limit;
+  exact_stack_checks      = false;
+  exact_check_depth       = 0;
+  stack_slack             = 0;
+  allocator.init_nursery( options.nursery_size );
+  add_native_handlers();
+}
+
+JogVM::~JogVM()
+{
+  reset();
+  delete[] (instruction_stack - stack_slack);
+  delete[] (data_stack - stack_slack);
+  delete[] (ref_stack - stack_slack);
+  delete[] frames;
+}
+
+void JogVM::reset()
+{
+  jog_type_manager.clear();
+  parsed_types.clear();
+  delete_all_objects();
+}
+
+void JogVM::parse( string filename )
+{
+  //printf( "Parsing %s\n", filename.c_str() );
+  Ref<JogParser> parser = new JogParser(filename.c_str());
+  parse(parser);
+}
+
+void JogVM::parse( string filename, string content )
+{
+  //printf( "Parsing %s\n", filename.c_str() );
+  Ref<JogParser> parser = new JogParser( new JogScanner( 
+        new JogReader( filename.c_str(), content.c_str(), content.length() )
+      ) );
+  parse(parser);
+}
+
+void JogVM::parse( Ref<JogParser> parser )
+{
+  JogTypeInfo* type = parser->parse_type_def();
+  while (type)
+  {
+    type = parser->parse_type_def();
+  }
+  parser->scanner->must_consume( TOKEN_EOF, "Unrecognized code." );
+
+  for (int i=0; i<parser->parsed_types.count; ++i)
+  {
+    JogTypeInfo* type = parser->parsed_types[i];
+    if (type->is_template()) continue;
+
+    parsed_types.add( parser->parsed_types[i] );
+  }
+}
+
+void JogVM::compile()
+{
+  jog_type_manager.type_object = jog_type_manager.must_find_type("Object");
+  jog_type_manager.type_string = jog_type_manager.must_find_type("String");
+  jog_type_manager.type_char_array = jog_type_manager.must_find_type("char[]");
+  jog_type_manager.type_byte_array = jog_type_manager.must_find_type("byte[]");
+
+  jog_type_manager.type_number = jog_type_manager.must_find_type("Number");
+  jog_type_manager.type_real64_wrapper = jog_type_manager.must_find_type("Double");
+  jog_type_manager.type_real32_wrapper = jog_type_manager.must_find_type("Float");
+  jog_type_manager.type_int64_wrapper = jog_type_manager.must_find_type("Long");
+  jog_type_manager.type_int32_wrapper = jog_type_manager.must_find_type("Integer");
+  jog_type_manager.type_int16_wrapper = jog_type_manager.must_find_type("Short");
+  jog_type_manager.type_int8_wrapper = jog_type_manager.must_find_type("Byte");
+  jog_type_manager.type_char_wrapper = jog_type_manager.must_find_type("Character");
+  jog_type_manager.type_boolean_wrapper = jog_type_manager.must_find_type("Boolean");
+  jog_type_manager.type_real64_wrapper->prep();
+  jog_type_manager.type_real32_wrapper->prep();
+  jog_type_manager.type_int64_wrapper->prep();
+  jog_type_manager.type_int32_wrapper->prep();
+  jog_type_manager.type_int16_wrapper->prep();
+  jog_type_manager.type_int8_wrapper->prep();
+  jog_type_manager.type_char_wrapper->prep();
+  jog_type_manager.type_boolean_wrapper->prep();
+
+  for (int i=0; i<parsed_types.count; ++i)
+  {
+    parsed_types[i]->resolve();
+  }
+
+  // Class properties are charged to the object budget once, up front.
+  cur_object_bytes -= class_data_bytes;
+  class_data_bytes = 0;
+  for (JogTypeLookup::iterator cur=jog_type_manager.type_lookup.begin();
+      cur != jog_type_manager.type_lookup.end(); ++cur)
+  {
+    JogTypeInfo* type = *(cur->second);
+    if (type->class_data) class_data_bytes += type->class_data_count * sizeof(JogInt64);
+  }
+  cur_object_bytes += class_data_bytes;
+
+  bind_natives();
+  if (devirtualization_enabled) devirtualize_calls();
+  if (inline_threshold > 0) inline_calls();
+  if (scalar_replacement_enabled) replace_scalars();
+  if (constant_folding_enabled) fold_constants();
+  if (fusion_enabled) fuse_instructions();
+  intern_literals();
+  compile_bytecode();
+}
+
+void JogVM::run( const char* main_class_name )
+{
+  interrupted.store( 0, std::memory_order_relaxed );
+  start_limits();  // shared by static initializers, init_object() and main
+
+  JogTypeInfo* main_class = JogTypeInfo::find(main_class_name);
+  if (main_class == NULL)
+  {
+    StringBuilder buffer;
+    buffer.print( "Main class '" );
+    buffer.print( main_class_name );
+    buffer.print( "' not found." );
+    Ref<JogError> err = new JogError( (const char*) buffer.to_string() );
+    throw err;
+  }
+
+//JogTypeInfo* debug_type = JogTypeInfo::find("Test");
+//if (debug_type) debug_type->print_members();  //DEBUG
+
+  // Call static initializer blocks
+  for (int i=0; i<parsed_types.count; ++i)
+  {
+    JogTypeInfo* type = parsed_types[i];
+
+    for (int j=0; j<type->static_initializers.count; ++j)
+    {
+      JogMethodInfo* m = *(type->static_initializers[j]);
+      Ref<JogToken>  t = m->t;
+      Ref<JogCmd> cmd = new JogCmdClassCall( t, m, NULL, NULL );
+      push(*cmd);
+      execute();
+    }
+  }
+
+  JogRef main_object = main_class->create_instance(this);
+  if ( *(main_class->call_init_object) )
+  {
+    push( main_object );
+    push( *(main_class->call_init_object) );
+    execute();
+    /*
+    Ref<JogToken>  t = main_class->m_init_object->t;
+    Ref<JogCmd> cmd = new JogCmdStaticCall( t,
+        *(main_class->m_init_object), new JogCmdObjectRef(t,main_object), NULL );
+    push(*cmd);
+    execute();
+    */
+  }
+
+  call_void_method( main_object, "<init>()" );
+}
+
+void JogVM::add_native_handler( Ref<JogString> signature, JogNativeMethodHandler handler )
+{
+  // Replaces any earlier handler, including a leaf or bound one.
+  native_methods[signature] = handler;
+  leaf_native_methods.erase( signature );
+  pure_native_methods.erase( signature );
+  native_bindings.erase( signature );
+}
+
+void JogVM::add_leaf_native_handler( const char* signature, JogNativeMethodHandler handler )
+{
+  Ref<JogString> sig = new JogString(signature);
+  add_native_handler( sig, handler );
+  leaf_native_methods[sig] = handler;
+}
+
+void JogVM::add_pure_native_handler( const char* signature, JogNativeMethodHandler handler )
+{
+  add_leaf_native_handler( signature, handler );
+  pure_native_methods[new JogString(signature)] = handler;
+}
+
+static bool jog_native_type_matches( string native_type, string jog_type )
+{
+  // An empty native type name stands for any reference type.
+  while (native_type.size() >= 2 && jog_type.size() >= 2
+      && native_type.compare( native_type.size()-2, 2, "[]" ) == 0
+      && jog_type.compare( jog_type.size()-2, 2, "[]" ) == 0)
+  {
+    native_type.resize( native_type.size() - 2 );
+    jog_type.resize( jog_type.size() - 2 );
+  }
+
+  if (native_type.size()) return native_type == jog_type;
+
+  const char* primitives[] =
+    { "boolean", "byte", "short", "char", "int", "long", "float", "double", "void", NULL };
+  for (int i=0; primitives[i]; ++i)
+  {
+    if (jog_type == primitives[i]) return false;
+  }
+  return true;
+}
+
+static int jog_list_count( const string& list )
+{
+  if (list.size() == 0) return 0;
+  int count = 1;
+  for (size_t i=0; i<list.size(); ++i) if (list[i] == ',') ++count;
+  return count;
+}
+
+static string jog_list_next( const string& list, size_t& pos )
+{
+  size_t comma = list.find( ',', pos );
+  string result = list.substr( pos, comma-pos );
+  pos = (comma == string::npos) ? list.size() : comma + 1;
+  return result;
+}
+
+void JogVM::add_bound_native( const char* signature, JogNativeMethodHandler handler,
+    JogNativeFunction function, int parameter_count, string parameter_types,
+    string return_type, bool pure )
+{
+  string sig = signature;
+  size_t open = sig.find( '(' );
+  if (open == string::npos || sig[sig.size()-1] != ')')
+  {
+    Ref<JogError> err = new JogError( ("Malformed native signature \"" + sig + "\".").c_str() );
+    throw err;
+  }
+
+  string params = sig.substr( open+1, sig.size()-open-2 );
+  int jog_count = jog_list_count( params );
+  // parameter_count tells a lone reference parameter, whose type name is
+  // empty, from no parameters.
+  int native_count = parameter_count;
+
+  JogNativeBinding binding;
+  binding.function = function;
+  binding.context = (native_count == jog_count + 1);
+  binding.return_type = return_type;
+
+  size_t jog_pos = 0;
+  size_t native_pos = 0;
+  bool matches = binding.context || native_count == jog_count;
+  if (binding.context && jog_list_next(parameter_types,native_pos).size()) matches = false;
+  for (int i=0; matches && i<jog_count; ++i)
+  {
+    string native_type = jog_list_next( parameter_types, native_pos );
+    matches = jog_native_type_matches( native_type, jog_list_next(params,jog_pos) );
+  }
+  if ( !matches )
+  {
+    Ref<JogError> err = new JogError( ("Native binding (" + parameter_types 
+          + ") does not match \"" + sig + "\".").c_str() );
+    throw err;
+  }
+
+  Ref<JogString> key = new JogString(signature);
+  add_native_handler( key, handler );
+  leaf_native_methods[key] = handler;
+  if (pure) pure_native_methods[key] = handler;
+  native_bindings[key] = binding;
+}
+
+JogRef JogVM::create_object( JogTypeInfo* of_type )
+{
+  return of_type->create_instance(this);
+}
+
+JogRef JogVM::create_array( JogTypeInfo* of_type, int count )
+{
+  return of_type->create_array( this, count );
+}
+
+template <typename CharType>
+static unsigned int jog_hash_chars( CharType* data, int count )
+{
+  // Four independent FNV-1a style lanes, which compilers vectorize, then a
+  // MurmurHash3 finalizer so that every input bit reaches every hash bit.
+  unsigned int lanes[4] = { 0x811c9dc5, 0x01000193, 0x9e3779b9, 0x85ebca6b };
+  int i = 0;
+  for (int last=count-4; i<=last; i+=4)
+  {
+    for (int k=0; k<4; ++k) lanes[k] = (lanes[k] ^ data[i+k]) * 0x01000193;
+  }
+  for (int k=0; i<count; ++i, ++k) lanes[k] = (lanes[k] ^ data[i]) * 0x01000193;
+
+  unsigned int hash = (unsigned int) count;
+  for (int k=0; k<4; ++k) hash = (hash ^ lanes[k]) * 0x9e3779b1;
+
+  hash ^= hash >> 16;
+  hash *= 0x85ebca6b;
+  hash ^= hash >> 13;
+  hash *= 0xc2b2ae35;
+  hash ^= hash >> 16;
+  return hash;
+}
+
+int jog_string_hash( JogStringView chars )
+{
+  unsigned int hash;
+  if (chars.latin1) hash = jog_hash_chars( chars.latin1, chars.count );
+  else              hash = jog_hash_chars( chars.data, chars.count );
+
+  // A String's hash_code is 0 until it has been computed.
+  if (hash == 0) hash = 1;
+  return (int) hash;
+}
+
+int jog_string_hash_code( JogObject* st )
+{
+  int hash = (int) st->data[1];
+  if ( !hash )
+  {
+    hash = jog_string_hash( jog_string_view(st) );
+    st->data[1] = hash;
+  }
+  return hash;
+}
+
+static bool jog_fits_latin1( JogChar* data, int count )
+{
+  for (int i=0; i<count; ++i)
+  {
+    if (data[i] > 0xff) return false;
+  }
+  return true;
+}
+
+static void jog_set_string_array( JogObject* st, JogObject* array )
+{
+  int slot = (array->type == jog_type_manager.type_byte_array) ? 2 : 0;
+  *((JogObject**)&(st->data[slot])) = array;
+  array->retain();
+}
+
+JogRef JogVM::create_string( JogChar* data, int count )
+{
+  JogRef obj = jog_type_manager.type_string->create_instance(this);
+  set_string_chars( *obj, data, count );
+  return obj;
+}
+
+JogRef JogVM::create_string( JogRef array )
+{
+  JogRef obj = jog_type_manager.type_string->create_instance(this);
+  if (compact_strings && array->type == jog_type_manager.type_char_array
+      && jog_fits_latin1((JogChar*)array->data,array->count))
+  {
+    set_string_chars( *obj, (JogChar*) array->data, array->count );
+  }
+  else
+  {
+    jog_set_string_array( *obj, *array );
+  }
+  return obj;
+}
+
+void JogVM::set_string_chars( JogObject* st, JogChar* data, int count )
+{
+  JogRef array;
+  if (compact_strings && jog_fits_latin1(data,count))
+  {
+    array = jog_type_manager.type_byte_array->create_array( this, count );
+    JogUInt8* dest = (JogUInt8*) array->data;
+    for (int i=0; i<count; ++i) dest[i] = (JogUInt8) data[i];
+  }
+  else
+  {
+    array = jog_type_manager.type_char_array->create_array( this, count );
+    memcpy( array->data, data, count*sizeof(JogChar) );
+  }
+  jog_set_string_array( st, *array );
+}
+
+//=============================================================================
+//  Interned Strings
+//=============================================================================
+JogObject* JogVM::create_immortal_object( JogTypeInfo* type, JogInt64 size )
+{
+  // Immortal objects live outside the collected heap until the VM resets.
+  JogObject* obj = (JogObject*) calloc( 1, (size_t) size );
+  if ( !obj )
+  {
+    Ref<JogError> err = new JogError("Out of allotted memory.");
+    throw err;
+  }
+  obj->type = type;
+  obj->reference_count = JOG_IMMORTAL;
+  immortal_objects.add( obj );
+  return obj;
+}
+
+JogObject* JogVM::intern_string( JogChar* data, int count )
+{
+  JogStringView chars = { data, NULL, count };
+  return intern_string( chars );
+}
+
+JogObject* JogVM::intern_string( JogStringView chars )
+{
+  int hash = jog_string_hash( chars );
+
+  typedef unordered_multimap<int,JogObject*>::iterator Iterator;
+  pair<Iterator,Iterator> matches = interned_strings.equal_range( hash );
+  for (Iterator cur=matches.first; cur!=matches.second; ++cur)
+  {
+    JogStringView view = jog_string_view( cur->second );
+    if (view.count == chars.count && jog_chars_match(view,0,chars,0,chars.count))
+    {
+      if (cur->second->reference_count & JOG_IMMORTAL) return cur->second;
+
+      // A heap String from String.intern() can't back a literal; the
+      // immortal copy made below takes its place.
+      interned_strings.erase( cur );
+      --weak_interned_count;
+      break;
+    }
+  }
+
+  bool compact = chars.latin1 || (compact_strings && jog_fits_latin1(chars.data,chars.count));
+  JogTypeInfo* array_type = compact ? jog_type_manager.type_byte_array
+                                    : jog_type_manager.type_char_array;
+  int element_size = compact ? 1 : sizeof(JogChar);
+  JogObject* array = create_immortal_object( array_type,
+      (JogInt64) (sizeof(JogObject) - 8) + (JogInt64) chars.count * element_size );
+  array->count = chars.count;
+  if ( !compact )
+  {
+    jog_copy_chars( (JogChar*) array->data, chars, 0, chars.count );
+  }
+  else if (chars.latin1)
+  {
+    memcpy( array->data, chars.latin1, chars.count );
+  }
+  else
+  {
+    JogUInt8* dest = (JogUInt8*) array->data;
+    for (int i=0; i<chars.count; ++i) dest[i] = (JogUInt8) chars.data[i];
+  }
+
+  JogObject* obj = create_immortal_object( jog_type_manager.type_string, 
+      jog_type_manager.type_string->object_size );
+  *((JogObject**)&(obj->data[compact ? 2 : 0])) = array;
+  obj->data[1] = hash;
+
+  interned_strings.insert( pair<int,JogObject*>(hash,obj) );
+  return obj;
+}
+
+JogObject* JogVM::intern_string( JogObject* st )
+{
+  int hash = jog_string_hash_code( st );
+  JogStringView chars = jog_string_view( st );
+
+  typedef unordered_multimap<int,JogObject*>::iterator Iterator;
+  pair<Iterator,Iterator> matches = interned_strings.equal_range( hash );
+  for (Iterator cur=matches.first; cur!=matches.second; ++cur)
+  {
+    JogStringView view = jog_string_view( cur->second );
+    if (view.count == chars.count && jog_chars_match(view,0,chars,0,chars.count))
+    {
+      return cur->second;
+    }
+  }
+
+  interned_strings.insert( pair<int,JogObject*>(hash,st) );
+  ++weak_interned_count;
+  return st;
+}
+
+void JogVM::forget_interned_string( JogObject* st )
+{
+  // An interned String has its hash_code.
+  int hash = (int) st->data[1];
+  if ( !hash ) return;
+
+  typedef unordered_multimap<int,JogObject*>::iterator Iterator;
+  pair<Iterator,Iterator> matches = interned_strings.equal_range( hash );
+  for (Iterator cur=matches.first; cur!=matches.second; ++cur)
+  {
+    if (cur->second == st)
+    {
+      interned_strings.erase( cur );
+      --weak_interned_count;
+      return;
+    }
+  }
+}
+
+void JogVM::delete_immortal_objects()
+{
+  interned_strings.clear();
+  weak_interned_count = 0;
+  for (int i=0; i<immortal_objects.count; ++i) ::free( immortal_objects[i] );
+  immortal_objects.clear();
+}
+
+static JogStringView jog_concat_operand( JogObject* st )
+{
+  static JogUInt8 null_chars[] = { 'n', 'u', 'l', 'l' };
+
+  JogStringView view = jog_string_view( st );
+  if (view.is_null())
+  {
+    view.latin1 = null_chars;
+    view.count = 4;
+  }
+  return view;
+}
+
+JogRef JogVM::concat_strings( JogStackRef* operands, int count, JogObject** first )
+{
+  // The operands stay on the ref stack while the result is allocated.  The
+  // result is compact when every operand is.
+  JogInt64 total = 0;
+  bool compact = compact_strings;
+  if (first)
+  {
+    JogStringView view = jog_concat_operand( *first );
+    total = view.count;
+    if ( !view.latin1 ) compact = false;
+  }
+  for (int i=count-1; i>=0; --i)
+  {
+    JogStringView view = jog_concat_operand( operands[i].object );
+    total += view.count;
+    if (view.count && !view.latin1) compact = false;
+  }
+
+  if (total > 0x7fffffff)
+  {
+    Ref<JogError> err = new JogError("Out of allotted memory.");
+    throw err;
+  }
+
+  if (compact)
+  {
+    JogRef bytes = create_array( jog_type_manager.type_byte_array, (int) total );
+    JogUInt8* dest = (JogUInt8*) bytes->data;
+    if (first)
+    {
+      JogStringView view = jog_concat_operand( *first );
+      memcpy( dest, view.latin1, view.count );
+      dest += view.count;
+    }
+    for (int i=count-1; i>=0; --i)
+    {
+      JogStringView view = jog_concat_operand( operands[i].object );
+      if (view.count) memcpy( dest, view.latin1, view.count );
+      dest += view.count;
+    }
+    return create_string( bytes );
+  }
+
+  JogRef chars = create_array( jog_type_manager.type_char_array, (int) total );
+  JogChar* dest = (JogChar*) chars->data;
+  if (first)
+  {
+    JogStringView view = jog_concat_operand( *first );
+    jog_copy_chars( dest, view, 0, view.count );
+    dest += view.count;
+  }
+  for (int i=count-1; i>=0; --i)
+  {
+    JogStringView view = jog_concat_operand( operands[i].object );
+    jog_copy_chars( dest, view, 0, view.count );
+    dest += view.count;
+  }
+
+  JogRef result = jog_type_manager.type_string->create_instance(this);
+  jog_set_string_array( *result, *chars );
+  return result;
+}
+
+void JogVM::force_garbage_collection()
+{
+printf("GC\n");
+  free_released_objects();
+}
+
+void JogVM::collect_nursery()
+{
+  JogInt64 promoted_bytes = allocator.nursery_stats.promoted_bytes;
+  free_released_objects();
+  allocator.collect_nursery();
+
+  if (report_gc)
+  {
+    printf( "Minor collection promoted %d bytes.\n", 
+        (int) (allocator.nursery_stats.promoted_bytes - promoted_bytes) );
+  }
+}
+
+void JogVM::free_released_objects()
+{
+  if ( !jog_released_objects ) return;
+
+  // Objects on the ref stack aren't counted, so queued objects found
+  // there stay queued.
+  for (JogStackRef* cur=ref_stack_ptr; cur<ref_stack_limit; ++cur)
+  {
+    if (cur->object) cur->object->reference_count |= JOG_GC_MARK;
+  }
+
+  JogObject* on_stack = NULL;
+  while (jog_released_objects)
+  {
+    JogObject* obj = jog_released_objects;
+    jog_released_objects = obj->next_object;
+
+    if (obj->reference_count & ~(JOG_QUEUED|JOG_GC_MARK))
+    {
+      // Retained again after its count reached zero.
+      obj->reference_count &= ~JOG_QUEUED;
+    }
+    else if (obj->reference_count & JOG_GC_MARK)
+    {
+      obj->next_object = on_stack;
+      on_stack = obj;
+    }
+    else
+    {
+      // May queue the objects it refers to.
+      obj->release_refs();
+      free_object( obj );
+    }
+  }
+  jog_released_objects = on_stack;
+
+  // Objects on the stack whose count reached zero while marked weren't
+  // queued by release().
+  for (JogStackRef* cur=ref_stack_ptr; cur<ref_stack_limit; ++cur)
+  {
+    JogObject* obj = cur->object;
+    if (obj && (obj->reference_count & JOG_GC_MARK))
+    {
+      obj->reference_count &= ~JOG_GC_MARK;
+      if ( !obj->reference_count ) obj->retire();
+    }
+  }
+}
+
+//=============================================================================
+//  Cycle Collection
+//=============================================================================
+// Trial deletion over the whole heap: subtracting the references objects
+// hold to each other leaves each object's count of references from
+// outside the heap (class properties, literal strings and JogRefs held by
+// the host).  Anything not reachable from the ref stack or from an object
+// with outside references is cyclic garbage.
+
+template <typename Visitor>
+static void jog_visit_refs( JogObject* obj, Visitor& visitor )
+{
+  if (obj->type->is_array())
+  {
+    if ( !obj->type->element_type->is_reference() ) return;
+
+    JogObject** cur = ((JogObject**) obj->data) - 1;
+    int c = obj->count + 1;
+    while (--c)
+    {
+      JogObject* child = *(++cur);
+      if (child) visitor.visit( child );
+    }
+  }
+  else
+  {
+    Ref<JogPropertyInfo>* cur = obj->type->properties.data - 1;
+    int c = obj->type->properties.count + 1;
+    while (--c)
+    {
+      JogPropertyInfo* p = **(++cur);
+      if (p->type->is_reference())
+      {
+        JogObject* child = *((JogObject**)&obj->data[p->index]);
+        if (child) visitor.visit( child );
+      }
+    }
+  }
+}
+
+struct JogCountAdjuster
+{
+  int delta;
+  JogCountAdjuster( int delta ) : delta(delta) { }
+  void visit( JogObject* child ) { child->reference_count += delta; }
+};
+
+struct JogLiveReleaser
+{
+  void visit( JogObject* child )
+  {
+    if ( !(child->reference_count & JOG_GC_MARK) ) return;
+    if (--child->reference_count == JOG_GC_MARK)
+    {
+      // Only the ref stack refers to it now.
+      child->retire();
+      child->reference_count |= JOG_GC_MARK;
+    }
+  }
+};
+
+struct JogMarker
+{
+  ArrayList<JogObject*> pending;
+
+  void visit( JogObject* child )
+  {
+    if (child->reference_count & (JOG_GC_MARK|JOG_IMMORTAL)) return;
+    child->reference_count |= JOG_GC_MARK;
+    pending.add( child );
+  }
+};
+
+struct JogHeapCollector
+{
+  ArrayList<JogObject*> objects;
+
+  void visit( void* block )
+  {
+    JogObject* obj = (JogObject*) block;
+    if (obj->type) objects.add( obj );
+  }
+};
+
+int JogVM::collect_cycles()
+{
+  free_released_objects();
+
+  JogHeapCollector heap;
+  allocator.visit_blocks( heap );
+  JogObject** objects = heap.objects.data;
+  int count = heap.objects.count;
+
+  JogCountAdjuster remove_internal(-1);
+  for (int i=0; i<count; ++i) jog_visit_refs( objects[i], remove_internal );
+
+  JogMarker marker;
+  for (JogStackRef* cur=ref_stack_ptr; cur<ref_stack_limit; ++cur)
+  {
+    if (cur->object) marker.visit( cur->object );
+  }
+  while (marker.pending.count) jog_visit_refs( marker.pending.remove_last(), marker );
+
+  for (int i=0; i<count; ++i)
+  {
+    JogObject* cur = objects[i];
+    if (cur->reference_count > 0 && !(cur->reference_count & JOG_GC_MARK))
+    {
+      cur->reference_count |= JOG_GC_MARK;
+      marker.pending.add( cur );
+      while (marker.pending.count) jog_visit_refs( marker.pending.remove_last(), marker );
+    }
+  }
+
+  JogCountAdjuster restore_internal(1);
+  for (int i=0; i<count; ++i) jog_visit_refs( objects[i], restore_internal );
+
+  // Garbage lets go of the live objects it refers to, then is freed
+  // without release_refs() since its own referents are freed with it.
+  JogLiveReleaser release_live;
+  for (int i=0; i<count; ++i)
+  {
+    if ( !(objects[i]->reference_count & JOG_GC_MARK) ) jog_visit_refs( objects[i], release_live );
+  }
+
+  int freed_count = 0;
+  JogInt64 freed_bytes = 0;
+  for (int i=0; i<count; ++i)
+  {
+    JogObject* cur = objects[i];
+    if (cur->reference_count & JOG_GC_MARK)
+    {
+      cur->reference_count &= ~JOG_GC_MARK;
+    }
+    else
+    {
+      freed_bytes += free_object( cur );
+      ++freed_count;
+    }
+  }
+
+  if (freed_count)
+  {
+    ++cycle_collection_count;
+    cyclic_objects_collected += freed_count;
+    if (report_gc)
+    {
+      printf( "Collected %d cyclic objects (%lld bytes).\n", freed_count, freed_bytes );
+    }
   }
-  return this;
+  return freed_count;
 }
 
-
-//=============================================================================
-//  JogVM
-//=============================================================================
-JogVM::JogVM() : max_object_bytes(1024*1024), cur_object_bytes(0), 
-          all_objects(NULL), user_context(NULL), timeout_seconds(0)
+void JogVM::delete_all_objects()
 {
-  random_seed = (int) time(0);
-  ostringstream buffer;
-  buffer << random_seed;
-  JogReader::random_seed = buffer.str();
+  ref_stack_ptr = ref_stack_limit;
 
-  jog_type_manager.init();
-  JogMethodInfo::next_method_id = 1;
+  jog_released_objects = NULL;
+  cur_object_bytes = class_data_bytes;
+  allocator.release_all();
+  delete_immortal_objects();
 
-  jog_context = NULL;
-  instruction_stack_limit = instruction_stack + JOG_INSTRUCTION_STACK_CAPACITY;
-  instruction_stack_ptr   = instruction_stack_limit;
-  data_stack_limit        = data_stack + JOG_DATA_STACK_CAPACITY;
-  data_stack_ptr          = data_stack_limit;
-  ref_stack_limit         = ref_stack + JOG_REF_STACK_CAPACITY;
-  ref_stack_ptr           = ref_stack_limit;
-  frame_stack_limit       = frames + JOG_FRAME_STACK_CAPACITY;
-  frame_ptr               = frame_stack_limit;
-  add_native_handlers();
+  for (JogTypeLookup::iterator cur=jog_type_manager.type_lookup.begin();
+      cur != jog_type_manager.type_lookup.end(); ++cur)
+  {
+    JogHeapStats& stats = cur->second->heap_stats;
+    stats.live_count = 0;
+    stats.live_bytes = 0;
+  }
 }
 
-void JogVM::reset()
+JogObject* JogVM::allocate_object( JogTypeInfo* type, JogInt64 size )
 {
-  jog_type_manager.clear();
-  parsed_types.clear();
-  delete_all_objects();
+  if (allocator.nursery_full) collect_nursery();
+
+  // The allocator takes an int size.
+  JogInt64 bytes = JogObjectAllocator::reserved_bytes( size );
+  if (cur_object_bytes + bytes > max_object_bytes || size > 0x7fff0000)
+  {
+    force_garbage_collection();
+
+    // Look for cycles once objects freed by reference counting no longer
+    // leave a quarter of the budget free, but not again until the heap has
+    // grown by another eighth of the budget so that a large live heap isn't
+    // traced on every overflow.
+    JogInt64 needed = cur_object_bytes + bytes;
+    if (needed > max_object_bytes
+        || (needed > max_object_bytes - max_object_bytes/4
+          && needed >= next_cycle_collection_bytes))
+    {
+      collect_cycles();
+      next_cycle_collection_bytes = cur_object_bytes + bytes + max_object_bytes/8;
+    }
+
+    if (cur_object_bytes + bytes > max_object_bytes || size > 0x7fff0000)
+    {
+      StringBuilder buffer;
+      buffer.print( "Out of allotted memory.\n" );
+      char st[200];
+      snprintf( st, sizeof(st), "%lld bytes requested for %.60s with %lld of %lld bytes in use.\n",
+          bytes, type->name->to_ascii()->data, cur_object_bytes, max_object_bytes );
+      buffer.print( st );
+      print_heap_histogram( buffer, heap_histogram_size );
+      buffer.print( (char) 0 );
+      Ref<JogError> err = new JogError( buffer.data );
+      throw err;
+    }
+  }
+
+  JogObject* obj = (JogObject*) allocator.allocate( (int) size );
+  obj->type = type;
+  cur_object_bytes += bytes;
+  type->heap_stats.on_allocate( bytes );
+  return obj;
 }
 
-void JogVM::parse( string filename )
+JogInt64 JogVM::free_object( JogObject* obj )
 {
-  //printf( "Parsing %s\n", filename.c_str() );
-  Ref<JogParser> parser = new JogParser(filename.c_str());
-  parse(parser);
+  if (weak_interned_count && obj->type == jog_type_manager.type_string)
+  {
+    forget_interned_string( obj );
+  }
+
+  int size = obj->total_object_bytes();
+  JogInt64 bytes = JogObjectAllocator::reserved_bytes( size );
+  cur_object_bytes -= bytes;
+  obj->type->heap_stats.on_free( bytes );
+  obj->type = NULL;
+  allocator.free( obj, size );
+  return bytes;
 }
 
-void JogVM::parse( string filename, string content )
+JogHeapStats JogVM::heap_stats( const char* type_name )
 {
-  //printf( "Parsing %s\n", filename.c_str() );
-  Ref<JogParser> parser = new JogParser( new JogScanner( 
-        new JogReader( filename.c_str(), content.c_str(), content.length() )
-      ) );
-  parse(parser);
+  JogTypeInfo* type = JogTypeInfo::find( type_name );
+  if (type) return type->heap_stats;
+  return JogHeapStats();
 }
 
-void JogVM::parse( Ref<JogParser> parser )
+void JogVM::largest_heap_types( ArrayList<JogTypeInfo*>& types, int max_count )
 {
-  JogTypeInfo* type = parser->parse_type_def();
-  while (type)
-  {
-    type = parser->parse_type_def();
-  }
-  parser->scanner->must_consume( TOKEN_EOF, "Unrecognized code." );
+  types.clear();
+  if (max_count <= 0) return;
 
-  for (int i=0; i<parser->parsed_types.count; ++i)
+  for (JogTypeLookup::iterator cur=jog_type_manager.type_lookup.begin();
+      cur != jog_type_manager.type_lookup.end(); ++cur)
   {
-    JogTypeInfo* type = parser->parsed_types[i];
-    if (type->is_template()) continue;
+    JogTypeInfo* type = *(cur->second);
+    JogInt64 live_bytes = type->heap_stats.live_bytes;
+    if ( !live_bytes ) continue;
+    if (types.count == max_count && types.last()->heap_stats.live_bytes >= live_bytes) continue;
 
-    parsed_types.add( parser->parsed_types[i] );
+    if (types.count == max_count) types.remove_last();
+    types.add( type );
+    for (int i=types.count-1; i>0 && types[i-1]->heap_stats.live_bytes < live_bytes; --i)
+    {
+      types[i] = types[i-1];
+      types[i-1] = type;
+    }
   }
 }
 
-void JogVM::compile()
+void JogVM::print_heap_histogram( StringBuilder& buffer, int max_count )
 {
-  jog_type_manager.type_object = jog_type_manager.must_find_type("Object");
-  jog_type_manager.type_string = jog_type_manager.must_find_type("String");
-  jog_type_manager.type_char_array = jog_type_manager.must_find_type("char[]");
-
-  jog_type_manager.type_number = jog_type_manager.must_find_type("Number");
-  jog_type_manager.type_real64_wrapper = jog_type_manager.must_find_type("Double");
-  jog_type_manager.type_real32_wrapper = jog_type_manager.must_find_type("Float");
-  jog_type_manager.type_int64_wrapper = jog_type_manager.must_find_type("Long");
-  jog_type_manager.type_int32_wrapper = jog_type_manager.must_find_type("Integer");
-  jog_type_manager.type_int16_wrapper = jog_type_manager.must_find_type("Short");
-  jog_type_manager.type_int8_wrapper = jog_type_manager.must_find_type("Byte");
-  jog_type_manager.type_char_wrapper = jog_type_manager.must_find_type("Character");
-  jog_type_manager.type_boolean_wrapper = jog_type_manager.must_find_type("Boolean");
-  jog_type_manager.type_real64_wrapper->prep();
-  jog_type_manager.type_real32_wrapper->prep();
-  jog_type_manager.type_int64_wrapper->prep();
-  jog_type_manager.type_int32_wrapper->prep();
-  jog_type_manager.type_int16_wrapper->prep();
-  jog_type_manager.type_int8_wrapper->prep();
-  jog_type_manager.type_char_wrapper->prep();
-  jog_type_manager.type_boolean_wrapper->prep();
+  ArrayList<JogTypeInfo*> types;
+  largest_heap_types( types, max_count );
 
-  for (int i=0; i<parsed_types.count; ++i)
+  char st[160];
+  snprintf( st, sizeof(st), "%12s  %10s  %s\n", "Live bytes", "Objects", "Type" );
+  buffer.print( st );
+  for (int i=0; i<types.count; ++i)
   {
-    parsed_types[i]->resolve();
+    JogHeapStats& stats = types[i]->heap_stats;
+    snprintf( st, sizeof(st), "%12lld  %10lld  %.100s\n", stats.live_bytes, stats.live_count,
+        types[i]->name->to_ascii()->data );
+    buffer.print( st );
+  }
+  if (class_data_bytes)
+  {
+    snprintf( st, sizeof(st), "%12lld  %10s  %s\n", class_data_bytes, "", "(class properties)" );
+    buffer.print( st );
   }
 }
 
-void JogVM::run( const char* main_class_name )
+static int jog_grown_capacity( int capacity, int used, int required, int max_capacity )
 {
-  JogTypeInfo* main_class = JogTypeInfo::find(main_class_name);
-  if (main_class == NULL)
+  // Grows to 'max_capacity' at most, even if 'required' free entries
+  // still don't fit.
+  int new_capacity = capacity;
+  while (new_capacity - used < required && new_capacity < max_capacity)
   {
-    StringBuilder buffer;
-    buffer.print( "Main class '" );
-    buffer.print( main_class_name );
-    buffer.print( "' not found." );
-    Ref<JogError> err = new JogError( (const char*) buffer.to_string() );
-    throw err;
+    new_capacity *= 2;
   }
+  if (new_capacity > max_capacity) new_capacity = max_capacity;
+  if (new_capacity < capacity) new_capacity = capacity;
+  return new_capacity;
+}
 
-//JogTypeInfo* debug_type = JogTypeInfo::find("Test");
-//if (debug_type) debug_type->print_members();  //DEBUG
+template <typename DataType>
+static void jog_relocate_stack( JogVM* vm, DataType*& stack, DataType*& ptr, 
+    DataType*& limit, int new_capacity, DataType* JogStackFrame::*saved_ptr,
+    int slack=0, int new_slack=0 )
+{
+  // Stacks grow downward, so the live entries move to the top of the new
+  // block and every pointer into the stack keeps its distance from the top.
+  // 'slack' entries below the base belong to the block as well.
+  DataType* new_stack = new DataType[new_slack + new_capacity] + new_slack;
+  DataType* new_limit = new_stack + new_capacity;
+  DataType* dest = new_limit - (limit - ptr);
+  for (DataType* cur=ptr; cur<limit; ++cur) *(dest++) = *cur;
 
-  // Call static initializer blocks
-  for (int i=0; i<parsed_types.count; ++i)
+  if (saved_ptr)
   {
-    JogTypeInfo* type = parsed_types[i];
-
-    for (int j=0; j<type->static_initializers.count; ++j)
+    for (JogStackFrame* frame=vm->frame_ptr; frame<vm->frame_stack_limit; ++frame)
     {
-      JogMethodInfo* m = *(type->static_initializers[j]);
-      Ref<JogToken>  t = m->t;
-      Ref<JogCmd> cmd = new JogCmdClassCall( t, m, NULL, NULL );
-      push(*cmd);
-      execute();
+      frame->*saved_ptr = new_limit - (limit - frame->*saved_ptr);
     }
   }
 
-  JogRef main_object = main_class->create_instance(this);
-  if ( *(main_class->call_init_object) )
-  {
-    push( main_object );
-    push( *(main_class->call_init_object) );
-    execute();
-    /*
-    Ref<JogToken>  t = main_class->m_init_object->t;
-    Ref<JogCmd> cmd = new JogCmdStaticCall( t,
-        *(main_class->m_init_object), new JogCmdObjectRef(t,main_object), NULL );
-    push(*cmd);
-    execute();
-    */
-  }
-
-  call_void_method( main_object, "<init>()" );
+  ptr = new_limit - (limit - ptr);
+  delete[] (stack - slack);
+  stack = new_stack;
+  limit = new_limit;
 }
 
-void JogVM::add_native_handler( Ref<JogString> signature, JogNativeMethodHandler handler )
+bool JogVM::grow_instruction_stack( int required )
 {
-  native_methods[signature] = handler;
-}
+  // The calling command was just popped but execution_state() and
+  // run_this_again() still use its slot, so that slot moves too.
+  int popped = (instruction_stack_ptr > instruction_stack) ? 1 : 0;
 
-JogRef JogVM::create_object( JogTypeInfo* of_type )
-{
-  return of_type->create_instance(this);
+  int capacity = (int)(instruction_stack_limit - instruction_stack);
+  int used = (int)(instruction_stack_limit - instruction_stack_ptr) + popped;
+  int new_capacity = jog_grown_capacity( capacity, used, required + popped,
+      options.max_instruction_stack_capacity );
+  if (new_capacity > capacity)
+  {
+    instruction_stack_ptr -= popped;
+    jog_relocate_stack( this, instruction_stack, instruction_stack_ptr, 
+        instruction_stack_limit, new_capacity, &JogStackFrame::instruction_stack_ptr,
+        stack_slack, stack_slack );
+    instruction_stack_ptr += popped;
+  }
+  return new_capacity - used >= required + popped;
 }
 
-JogRef JogVM::create_array( JogTypeInfo* of_type, int count )
+bool JogVM::grow_data_stack( int required )
 {
-  return of_type->create_array( this, count );
+  int capacity = (int)(data_stack_limit - data_stack);
+  int used = (int)(data_stack_limit - data_stack_ptr);
+  int new_capacity = jog_grown_capacity( capacity, used, required,
+      options.max_data_stack_capacity );
+  if (new_capacity > capacity)
+  {
+    jog_relocate_stack( this, data_stack, data_stack_ptr, data_stack_limit,
+        new_capacity, &JogStackFrame::data_stack_ptr, stack_slack, stack_slack );
+  }
+  return new_capacity - used >= required;
 }
 
-JogRef JogVM::create_string( JogChar* data, int count )
+bool JogVM::grow_ref_stack( int required )
 {
-  JogRef chars = jog_type_manager.type_char_array->create_array(this,count);
-  memcpy( (JogChar*)(chars->data), data, count*2 );
-  return create_string( chars );
+  int capacity = (int)(ref_stack_limit - ref_stack);
+  int used = (int)(ref_stack_limit - ref_stack_ptr);
+  int new_capacity = jog_grown_capacity( capacity, used, required,
+      options.max_ref_stack_capacity );
+  if (new_capacity > capacity)
+  {
+    jog_relocate_stack( this, ref_stack, ref_stack_ptr, ref_stack_limit,
+        new_capacity, &JogStackFrame::ref_stack_ptr, stack_slack, stack_slack );
+  }
+  return new_capacity - used >= required;
 }
 
-JogRef JogVM::create_string( JogRef array )
+bool JogVM::grow_frame_stack()
 {
-  JogChar* data = (JogChar*) array->data;
-  int count = array->count;
+  int capacity = (int)(frame_stack_limit - frames);
+  int new_capacity = jog_grown_capacity( capacity, (int)(frame_stack_limit - frame_ptr), 1,
+      options.max_frame_stack_capacity );
+  if (new_capacity == capacity) return false;
 
-  int hash = 0;
-  JogChar* cur = (JogChar*) (data - 1);
-  int c = count + 1;
-  while (--c) hash = (hash << 1) + *(++cur);
+  jog_relocate_stack<JogStackFrame>( this, frames, frame_ptr, frame_stack_limit,
+      new_capacity, NULL );
+  return true;
+}
 
-  JogTypeInfo* type_string = jog_type_manager.type_string;
-  JogRef obj = type_string->create_instance(this);
+void JogVM::reserve_stack_slack( int slack )
+{
+  if (slack <= stack_slack) return;
 
-  *((JogObject**)&(obj->data[0])) = *array;
-  array->retain();
-  obj->data[1] = hash;
+  // As in grow_instruction_stack(), the calling command's slot moves too.
+  int popped = (instruction_stack_ptr > instruction_stack) ? 1 : 0;
+  instruction_stack_ptr -= popped;
+  jog_relocate_stack( this, instruction_stack, instruction_stack_ptr, 
+      instruction_stack_limit, (int)(instruction_stack_limit - instruction_stack),
+      &JogStackFrame::instruction_stack_ptr, stack_slack, slack );
+  instruction_stack_ptr += popped;
 
-  return obj;
+  jog_relocate_stack( this, data_stack, data_stack_ptr, data_stack_limit,
+      (int)(data_stack_limit - data_stack), &JogStackFrame::data_stack_ptr,
+      stack_slack, slack );
+  jog_relocate_stack( this, ref_stack, ref_stack_ptr, ref_stack_limit,
+      (int)(ref_stack_limit - ref_stack), &JogStackFrame::ref_stack_ptr,
+      stack_slack, slack );
+  stack_slack = slack;
 }
 
-void JogVM::force_garbage_collection()
+void JogVM::push_frame( JogMethodInfo* method_info, JogCmd* cmd )
 {
-printf("GC\n");
-  // Delete unused objects at head of list.
-  while (all_objects && !all_objects->reference_count)
+  if (frame_ptr == frames && !grow_frame_stack())
+  {
+    throw cmd->error( "Frame stack limit reached during recursion." );
+  }
+
+  // If a stack can't hold the method's maximum depth, the method may
+  // still fit, so it runs with exact stack checks instead.  'shortfall' is
+  // the slack its pushes may need below the base of a stack.
+  int shortfall = 0;
+  int required = method_info->max_instruction_depth;
+  int available = (int)(instruction_stack_ptr - instruction_stack);
+  if (available < required && !grow_instruction_stack(required))
   {
-    JogObject* next = all_objects->next_object;
-    cur_object_bytes -= all_objects->total_object_bytes();
-    delete all_objects;
-    all_objects = next;
+    shortfall = required - available;
   }
 
-  // Delete unused objects in body of list.
-  if (all_objects)
+  required = method_info->local_data_count + method_info->max_data_depth;
+  available = (int)(data_stack_ptr - data_stack);
+  if (available < required && !grow_data_stack(required))
   {
-    JogObject* prev = all_objects;
-    JogObject* cur = all_objects->next_object;
-    while (cur)
+    if (available < method_info->local_data_count)
     {
-      if (cur->reference_count)
-      {
-        prev = cur;
-        cur = cur->next_object;
-      }
-      else
-      {
-        JogObject* next = cur->next_object;
-        cur_object_bytes -= cur->total_object_bytes();
-        delete cur;
-        prev->next_object = next;
-        cur = next;
-      }
+      Ref<JogError> err = new JogError("Data stack limit reached during recursion.");
+      throw err;
     }
+    if (required - available > shortfall) shortfall = required - available;
   }
-}
 
-void JogVM::delete_all_objects()
-{
-  // Release any objects on reference stack
-  while (ref_stack_ptr != ref_stack_limit) *(ref_stack_ptr++) = NULL;
+  required = method_info->local_ref_count + method_info->max_ref_depth;
+  available = (int)(ref_stack_ptr - ref_stack);
+  if (available < required && !grow_ref_stack(required))
+  {
+    if (available < method_info->local_ref_count)
+    {
+      Ref<JogError> err = new JogError("Reference stack limit reached during recursion.");
+      throw err;
+    }
+    if (required - available > shortfall) shortfall = required - available;
+  }
 
-  while (all_objects)
+  if (exact_stack_checks && frame_stack_limit - frame_ptr < exact_check_depth)
   {
-    JogObject* next = all_objects->next_object;
-    delete all_objects;
-    all_objects = next;
+    // The frame that turned them on was unwound by an error.
+    exact_stack_checks = false;
   }
-}
 
-void JogVM::register_object( JogObject* obj, int byte_size )
-{
-  obj->next_object = all_objects;
-  all_objects = obj;
-  cur_object_bytes += byte_size;
-  if (cur_object_bytes > max_object_bytes)
+  if (shortfall)
   {
-    force_garbage_collection();
-    if (cur_object_bytes > max_object_bytes)
+    reserve_stack_slack( shortfall );
+    if ( !exact_stack_checks )
     {
-      Ref<JogError> err = new JogError("Out of allotted memory.");
-      throw err;
+      exact_stack_checks = true;
+      exact_check_depth = (int)(frame_stack_limit - frame_ptr) + 1;
     }
   }
-}
 
-void JogVM::push_frame( JogMethodInfo* method_info )
-{
   // Set frame registers to point just before start of object
   // context and parameters.
   (--frame_ptr)->init( instruction_stack_ptr, 
@@ -596,19 +1768,87 @@ void JogVM::push_frame( JogMethodInfo* method_info )
       ref_stack_ptr + method_info->param_ref_count,
       method_info );
 
+#if defined(JOG_CHECK_STACKS)
+  frame_ptr->max_instruction_depth = (int)(instruction_stack_limit - instruction_stack_ptr)
+      + method_info->max_instruction_depth;
+  frame_ptr->max_data_depth = (int)(data_stack_limit - data_stack_ptr)
+      + method_info->local_data_count + method_info->max_data_depth;
+  frame_ptr->max_ref_depth = (int)(ref_stack_limit - ref_stack_ptr)
+      + method_info->local_ref_count + method_info->max_ref_depth;
+#endif
+
   data_stack_ptr -= method_info->local_data_count;
-  ref_stack_ptr  -= method_info->local_ref_count;
+
+  // Stale entries left by popped frames aren't counted references and
+  // may point to freed objects.
+  JogStackRef* locals = ref_stack_ptr;
+  ref_stack_ptr -= method_info->local_ref_count;
+  while (locals != ref_stack_ptr) (--locals)->object = NULL;
 
 }
 
-void JogVM::push( JogRef object )
+void JogVM::check_stack_limits()
 {
-  if (ref_stack_ptr == ref_stack)
+  // The first entry past a stack's base is the push that overflowed.  The
+  // entries in the slack are dropped so the stacks are within their limits
+  // again.
+  if (instruction_stack_ptr < instruction_stack)
+  {
+    JogCmd* cmd = instruction_stack[-1].command;
+    instruction_stack_ptr = instruction_stack;
+    throw cmd->error( "Instruction stack limit reached during recursion." );
+  }
+
+  if (data_stack_ptr < data_stack)
+  {
+    data_stack_ptr = data_stack;
+    Ref<JogError> err = new JogError("Data stack limit reached during recursion.");
+    throw err;
+  }
+
+  if (ref_stack_ptr < ref_stack)
   {
+    ref_stack_ptr = ref_stack;
     Ref<JogError> err = new JogError("Reference stack limit reached during recursion.");
     throw err;
   }
-  *(--ref_stack_ptr) = object;
+}
+
+void JogVM::execute_checked_until( JogInstruction* target_pos )
+{
+  int target_depth = (int)(instruction_stack_limit - target_pos);
+  for (;;)
+  {
+    check_stack_limits();
+    if (instruction_stack_limit - instruction_stack_ptr <= target_depth) return;
+
+    JogCmd* cmd = (instruction_stack_ptr++)->command;
+    cmd->execute(this);
+  }
+}
+
+void JogVM::execute_frame_checked( JogMethodInfo* m )
+{
+  // Same steps as the calling command's, which then runs again to push
+  // each further statement and to pop the frame.  A native that calls
+  // back into Jog can relocate the instruction stack.
+  int return_depth = (int)(instruction_stack_limit - instruction_stack_ptr);
+  if (m->is_native())
+  {
+    run_this_again();
+    call_native( m );
+  }
+  else if (*(m->code))
+  {
+    execute_code( *(m->code) );
+    return;
+  }
+  else
+  {
+    run_this_again();
+    if (m->statements->commands.count) push( *(m->statements->commands[0]) );
+  }
+  execute_checked_until( instruction_stack_limit - return_depth );
 }
 
 //=============================================================================
@@ -718,16 +1958,12 @@ JogTypeInfo* JogTypeInfo::find( Ref<JogString> name )
 
 JogRef JogTypeInfo::create_array( JogVM* vm, int count )
 {
-  int obj_size = (sizeof(JogObject) - 8) + count * element_type->element_size;
+  JogInt64 obj_size = (JogInt64) (sizeof(JogObject) - 8) + (JogInt64) count * element_type->element_size;
 
-  JogObject* obj = (JogObject*) new char[obj_size];
-  memset( obj, 0, obj_size );
-  obj->type = this;
+  JogObject* obj = vm->allocate_object( this, obj_size );
   obj->count = count;
 
   JogRef result((JogObject*)obj);
-  vm->register_object(obj,obj_size);
-
   return result;
 }
 
@@ -1261,17 +2497,130 @@ JogTypeInfo* JogCmd::require_integer_or_boolean()
 //=============================================================================
 //  JogVM
 //=============================================================================
-void JogVM::call_native( JogMethodInfo* m )
+void JogVM::bind_native( JogMethodInfo* m )
 {
+  m->native_handler = native_methods.find( m->full_signature );
   if (m->native_handler == NULL)
   {
-    m->native_handler = native_methods[m->full_signature];
-    if (m->native_handler == NULL)
+    throw m->t->error( "Native method not implemented in virtual machine." );
+  }
+  m->leaf_native = leaf_native_methods.contains( m->full_signature );
+
+  JogNativeBinding* binding = native_bindings.find( m->full_signature );
+  if (binding)
+  {
+    if (binding->context == m->is_static())
+    {
+      if (binding->context) throw m->t->error( "Native binding of a static method takes an object context." );
+      else                  throw m->t->error( "Native binding of an instance method must take the object context." );
+    }
+
+    string return_type = "void";
+    if (m->return_type) return_type = m->return_type->name->to_ascii()->data;
+    if ( !jog_native_type_matches(binding->return_type,return_type) )
+    {
+      throw m->t->error( "Native binding has the wrong return type." );
+    }
+    m->native_function = binding->function;
+  }
+}
+
+static void jog_bind_natives( JogVM* vm, JogTypeInfo* type, RefList<JogMethodInfo>& methods,
+    StringBuilder& missing, Ref<JogToken>& first_t, int& missing_count )
+{
+  for (int i=0; i<methods.count; ++i)
+  {
+    JogMethodInfo* m = *(methods[i]);
+    if (m->type_context != type || !m->is_native() || m->native_handler) continue;
+
+    if (vm->native_methods.contains(m->full_signature))
+    {
+      vm->bind_native( m );
+    }
+    else
     {
-      throw m->t->error( "Native method not implemented in virtual machine." );
+      if (missing_count++ == 0) first_t = m->t;
+      missing.print( "\n  " );
+      m->full_signature->print( missing );
     }
   }
+}
+
+void JogVM::bind_natives()
+{
+  // Binds every native method before anything runs so that a host's native
+  // set is checked up front and calls never look up their handler.
+  StringBuilder missing;
+  Ref<JogToken> first_t;
+  int missing_count = 0;
+  for (JogTypeLookup::iterator cur=jog_type_manager.type_lookup.begin();
+      cur != jog_type_manager.type_lookup.end(); ++cur)
+  {
+    JogTypeInfo* type = *(cur->second);
+    if ( !type->resolved ) continue;
+
+    jog_bind_natives( this, type, type->class_methods, missing, first_t, missing_count );
+    jog_bind_natives( this, type, type->methods, missing, first_t, missing_count );
+  }
+
+  if (missing_count == 1)
+  {
+    throw first_t->error( "Native method not implemented in virtual machine." );
+  }
+  else if (missing_count > 1)
+  {
+    StringBuilder buffer;
+    buffer.print( missing_count );
+    buffer.print( " native methods not implemented in virtual machine:" );
+    buffer.print( missing.to_string() );
+    throw first_t->error( buffer.to_string() );
+  }
+}
+
+void JogVM::call_native( JogMethodInfo* m )
+{
+  if (m->native_handler == NULL) bind_native( m );
+  native_function = m->native_function;
+  m->native_handler(this);
+}
+
+bool JogVM::call_leaf_native( JogMethodInfo* m )
+{
+  // Called before pushing a frame for native 'm'; returns false if 'm'
+  // needs one.
+  if (m->native_handler == NULL) bind_native( m );
+  if ( !m->leaf_native ) return false;
+  native_function = m->native_function;
   m->native_handler(this);
+  return true;
+}
+
+void JogVM::start_limits()
+{
+  budget_remaining = instruction_budget;
+  timeout_target = timeout_seconds;
+  if (timeout_target) timeout_target += cur_time();
+  poll_slice = poll_countdown = 0;
+}
+
+void JogVM::poll( JogCmd* next_cmd )
+{
+  // Called by charge() when poll_countdown runs out.  The budget is
+  // charged exactly for the loop iterations and calls since the last poll.
+  if (instruction_budget) budget_remaining -= poll_slice - (poll_countdown + 1);
+
+  if (interrupted.load(std::memory_order_relaxed) || (instruction_budget && budget_remaining <= 0)
+      || (timeout_target && timeout_target <= cur_time()))
+  {
+    interrupted.store( 0, std::memory_order_relaxed );
+    poll_countdown = poll_slice = 0;
+    throw next_cmd->t->error(
+        "Timeout - your program is taking too long.  Do you have an infinite loop?" );
+  }
+
+  poll_slice = JOG_POLL_INTERVAL;
+  if (instruction_budget && budget_remaining < poll_slice) poll_slice = budget_remaining;
+  poll_countdown = poll_slice;
 }
 
 void JogVM::call_void_method( JogRef context, const char* signature )
@@ -1335,7 +2684,9 @@ JogMethodInfo::JogMethodInfo( Ref<JogToken> t, int qualifiers, JogTypeInfo* type
     JogTypeInfo* return_type, Ref<JogString> name )
   : t(t), qualifiers(qualifiers), type_context(type_context), return_type(return_type), 
     calls_super_constructor(false),
-    name(name), native_handler(NULL), organized(false), resolved(false)
+    name(name), native_handler(NULL), native_function(NULL), leaf_native(false), inlinable(true), 
+    inlining_state(JOG_INLINING_PENDING), max_data_depth(0), max_ref_depth(0),
+    max_instruction_depth(0), organized(false), resolved(false)
 {
   statements = new JogStatementList(t);
   method_id = next_method_id++;
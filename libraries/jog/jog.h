@@ -12,6 +12,9 @@
 #include <string.h>
 #include <string>
 #include <map>
+#include <unordered_map>
+#include <utility>
+#include <atomic>
 #include <ctime>
 using namespace std;
 
@@ -23,6 +26,7 @@ typedef long long int JogInt64;
 typedef int           JogInt32;
 typedef short int     JogInt16;
 typedef char          JogInt8;
+typedef unsigned char JogUInt8;
 typedef unsigned short int JogChar;
 
 struct JogMethodInfo;
@@ -342,12 +346,30 @@ struct JogString : RefCounted
 
 struct JogStringComparator
 {
-  bool operator()( Ref<JogString> a, Ref<JogString> b )
+  bool operator()( Ref<JogString> a, Ref<JogString> b ) const
   {
     return a->compare_to(b) < 0;
   }
 };
 
+struct JogStringHasher
+{
+  size_t operator()( Ref<JogString> st ) const
+  {
+    size_t code = 0;
+    for (int i=0; i<st->count; ++i) code = code * 31 + (JogChar) st->data[i];
+    return code;
+  }
+};
+
+struct JogStringEquality
+{
+  bool operator()( Ref<JogString> a, Ref<JogString> b ) const
+  {
+    return a->compare_to(b) == 0;
+  }
+};
+
 
 struct JogError : RefCounted
 {
@@ -528,7 +550,7 @@ struct JogReader : RefCounted
 
 struct StringComparator
 {
-  bool operator()( const char* a, const char* b )
+  bool operator()( const char* a, const char* b ) const
   {
     return strcmp(a,b) < 0;
   }
@@ -632,6 +654,43 @@ struct JogScanner : RefCounted
 //=============================================================================
 struct JogTypeInfo;
 struct JogVM;
+struct JogCodeBuilder;
+struct JogCmdVisitor;
+struct JogLocalVarInfo;
+struct JogPropertyInfo;
+struct JogInliner;
+struct JogConstantFolder;
+struct JogStringView;
+
+// Node shapes recognized by JogFusionPass and the other analyzer passes.
+enum JogFusionShape
+{
+  JOG_SHAPE_NONE,
+  JOG_SHAPE_ANY,
+  JOG_SHAPE_LOCAL_INT32,
+  JOG_SHAPE_LOCAL_REF,
+  JOG_SHAPE_LITERAL_INT32,
+  JOG_SHAPE_LT_INTEGER,
+  JOG_SHAPE_LE_INTEGER,
+  JOG_SHAPE_GT_INTEGER,
+  JOG_SHAPE_GE_INTEGER,
+  JOG_SHAPE_ARRAY_READ_INT32,
+  JOG_SHAPE_ADD_ASSIGN_LOCAL_INT32,
+  JOG_SHAPE_SUB_ASSIGN_LOCAL_INT32,
+  JOG_SHAPE_PRE_STEP_LOCAL_INT32,
+  JOG_SHAPE_POST_STEP_LOCAL_INT32,
+  JOG_SHAPE_ARRAY_SIZE,
+  JOG_SHAPE_DISCARD_DATA,
+  JOG_SHAPE_DISCARD_REF,
+  JOG_SHAPE_WRITE_LOCAL_REF,
+  JOG_SHAPE_READ_PROPERTY,
+  JOG_SHAPE_WRITE_PROPERTY,
+  JOG_SHAPE_NEW_OBJECT,
+  JOG_SHAPE_NULL_CHECK,
+  JOG_SHAPE_LITERAL_STRING,
+  JOG_SHAPE_CONCAT,
+  JOG_SHAPE_INLINE_CALL
+};
 
 struct JogCmd : RefCounted
 {
@@ -648,6 +707,12 @@ struct JogCmd : RefCounted
   virtual bool is_literal() { return false; }
   virtual bool is_literal_int() { return false; }
   virtual bool is_loop() { return false; }
+  virtual bool is_dynamic_call() { return false; }
+  virtual bool is_this() { return false; }
+  virtual bool is_block() { return false; }
+  virtual bool is_jump() { return false; }  // return, break or continue
+  virtual JogCmd* jump_condition() { return NULL; }  // 'c' of 'if (c) jump'
+  virtual bool calls_or_allocates() { return false; }  // not counting operands
   virtual void on_continue( JogVM* vm ) { }
 
   virtual JogTypeInfo* reinterpret_as_type() { return NULL; }
@@ -713,6 +778,29 @@ struct JogCmd : RefCounted
 
   virtual void execute( JogVM* vm );
 
+  virtual void compile( JogCodeBuilder* code );
+  virtual int  compile_register( JogCodeBuilder* code, int target );
+  virtual bool is_pure() { return false; }
+
+  virtual void visit_operands( JogCmdVisitor* visitor ) { }
+  virtual int  fusion_shape() { return JOG_SHAPE_NONE; }
+  virtual JogCmd* fusion_operand( int index ) { return NULL; }
+  virtual JogLocalVarInfo* written_local() { return NULL; }
+  virtual JogLocalVarInfo* read_local() { return NULL; }
+  virtual JogMethodInfo*   bound_method() { return NULL; }
+  virtual Ref<JogCmd>      inline_copy( JogInliner* inliner );
+  virtual JogCmd*          accessed_object() { return NULL; }  // whose property localize() maps
+  virtual Ref<JogCmd>      localize( ArrayList<JogLocalVarInfo*>* property_locals );
+  virtual JogPropertyInfo* written_class_property() { return NULL; }
+  virtual Ref<JogCmd>      fold( JogConstantFolder* folder ) { return this; }
+
+  // Stack slots a command uses besides its operands' (see JogStackDepth),
+  // and whether it pushes its operands one at a time rather than all at once.
+  virtual int  own_instruction_slots() { return 1; }
+  virtual int  own_data_slots() { return 1; }
+  virtual int  own_ref_slots() { return 1; }
+  virtual bool pushes_operands_in_turn() { return false; }
+
   void require_boolean();
   JogTypeInfo* require_integer();
   JogTypeInfo* require_integer_or_boolean();
@@ -759,6 +847,22 @@ struct JogCmd : RefCounted
       Ref<JogString> name, Ref<JogCmd> args, bool allow_object_methods=true );
 };
 
+// Bottom-up tree rewriter: each node's operands are visited and replaced
+// before the node itself is passed to rewrite().
+struct JogCmdVisitor
+{
+  virtual ~JogCmdVisitor() { }
+
+  virtual Ref<JogCmd> visit( Ref<JogCmd> cmd )
+  {
+    if ( !*cmd ) return cmd;
+    cmd->visit_operands( this );
+    return rewrite( cmd );
+  }
+
+  virtual Ref<JogCmd> rewrite( Ref<JogCmd> cmd ) { return cmd; }
+};
+
 //=============================================================================
 //  JogInstruction
 //=============================================================================
@@ -788,8 +892,8 @@ struct JogObject
 {
   int          reference_count;
   int          count;     // number of elements for an array, unused for other objects
-  JogObject*   next_object;
-  JogTypeInfo* type;
+  JogObject*   next_object;  // links jog_released_objects
+  JogTypeInfo* type;         // NULL once freed
   JogInt64     data[1];  // may actually be any size
 
   // Note: all object data is externally memset to 0 when it is declared.
@@ -803,9 +907,14 @@ struct JogObject
 
   inline void release()
   {
-    if ( !--reference_count ) release_refs();
+    if ( !--reference_count ) retire();
   }
 
+  void retire();
+    // Queues this object on jog_released_objects.  It keeps its own
+    // references until JogVM::free_released_objects() finds that it isn't
+    // on the ref stack either and frees it.
+
   void release_refs();
   int  total_object_bytes();
 
@@ -819,12 +928,55 @@ struct JogObject
 };
 
 
+struct JogStackRef
+{
+  // A ref stack entry.  Objects referenced only from the ref stack aren't
+  // counted; when their count drops to zero they wait on
+  // jog_released_objects and JogVM::free_released_objects() scans the
+  // stack before freeing them.
+  JogObject* object;
+
+  JogStackRef() : object(NULL) { }
+  JogStackRef( JogObject* object ) : object(object) { }
+
+  JogObject* null_check( Ref<JogToken> t )
+  {
+    if (object == NULL) throw t->error( "Null Pointer Exception." );
+    return object;
+  }
+
+  JogObject* operator*()
+  {
+    return object;
+  }
+
+  JogObject* operator->()
+  {
+    return object;
+  }
+
+  bool operator==( JogStackRef other )
+  {
+    return object == other.object;
+  }
+
+  bool operator!=( JogStackRef other )
+  {
+    return object != other.object;
+  }
+};
+
 struct JogRef
 {
   JogObject* object;
 
   JogRef() : object(NULL) { }
 
+  JogRef( JogStackRef ref ) : object(ref.object)
+  {
+    if (object) object->retain();
+  }
+
   JogRef( JogObject* object ) : object(object)
   {
     if (object) object->retain();
@@ -905,24 +1057,34 @@ struct JogRef
 //=============================================================================
 //  JogStackFrame
 //=============================================================================
+struct JogOp;
+struct JogCode;
+
 struct JogStackFrame
 {
   JogInstruction* instruction_stack_ptr;
   JogInt64*       data_stack_ptr;
-  JogRef*         ref_stack_ptr;
+  JogStackRef*    ref_stack_ptr;
   JogMethodInfo*  called_method;
+  JogOp*          return_ip;  // bytecode execution only
+#if defined(JOG_CHECK_STACKS)
+  int             max_instruction_depth;  // measured from the stack tops
+  int             max_data_depth;
+  int             max_ref_depth;
+#endif
 
   JogStackFrame()
   {
   }
 
-  void init( JogInstruction* instruction, JogInt64* data, JogRef* ref, 
+  void init( JogInstruction* instruction, JogInt64* data, JogStackRef* ref, 
       JogMethodInfo* called_method )
   {
     instruction_stack_ptr = instruction;
     data_stack_ptr = data;
     ref_stack_ptr = ref;
     this->called_method = called_method;
+    return_ip = NULL;
   }
 };
 
@@ -933,62 +1095,405 @@ struct JogStackFrame
 #define JOG_DATA_STACK_CAPACITY        8192
 #define JOG_REF_STACK_CAPACITY         8192
 #define JOG_FRAME_STACK_CAPACITY       1024
+#define JOG_NURSERY_SIZE               (256*1024)
+
+struct JogVMOptions
+{
+  // Initial stack capacities, in entries.
+  int instruction_stack_capacity;
+  int data_stack_capacity;
+  int ref_stack_capacity;
+  int frame_stack_capacity;
+
+  // A call that runs out of headroom doubles the stack it needs, up to
+  // these capacities.  Leaving them equal to the initial capacities gives
+  // fixed-size stacks.
+  int max_instruction_stack_capacity;
+  int max_data_stack_capacity;
+  int max_ref_stack_capacity;
+  int max_frame_stack_capacity;
+
+  // Bytes set aside for bump allocating new objects; 0 allocates every
+  // object from the size classes.
+  int nursery_size;
+
+  JogVMOptions() :
+    instruction_stack_capacity(JOG_INSTRUCTION_STACK_CAPACITY),
+    data_stack_capacity(JOG_DATA_STACK_CAPACITY),
+    ref_stack_capacity(JOG_REF_STACK_CAPACITY),
+    frame_stack_capacity(JOG_FRAME_STACK_CAPACITY),
+    max_instruction_stack_capacity(JOG_INSTRUCTION_STACK_CAPACITY),
+    max_data_stack_capacity(JOG_DATA_STACK_CAPACITY),
+    max_ref_stack_capacity(JOG_REF_STACK_CAPACITY),
+    max_frame_stack_capacity(JOG_FRAME_STACK_CAPACITY),
+    nursery_size(JOG_NURSERY_SIZE)
+  {
+  }
+};
+
+// push() and pop_*() don't check the stacks: JogVM::push_frame() reserves
+// each method's maximum stack depth.  When a stack can't grow that far,
+// push_frame() turns on exact_stack_checks and the frame runs in
+// execute_checked_until() or run_code<true>(), which check the stacks
+// after every command or op.  Stacks have stack_slack spare entries below
+// their base for the pushes of that one command, so a recursion limit
+// still fires at the command that overflows.
+//
+// Define JOG_CHECK_STACKS to check every push and pop, and that no frame
+// goes deeper than its method's computed maximum ("make check_stacks").
+#if defined(JOG_CHECK_STACKS)
+#  define JOG_STACK_CHECK(condition,mesg) \
+     if (condition) { Ref<JogError> err = new JogError(mesg); throw err; }
+#  define JOG_DEPTH_CHECK(stack,max_depth) \
+     JOG_STACK_CHECK( frame_ptr < frame_stack_limit \
+         && stack##_limit - stack##_ptr >= frame_ptr->max_depth, \
+         "[Internal] Stack depth exceeds the method's maximum." )
+#else
+#  define JOG_STACK_CHECK(condition,mesg)
+#  define JOG_DEPTH_CHECK(stack,max_depth)
+#endif
+
+// Instructions between checks of the timeout, budget and interrupt flag.
+#define JOG_POLL_INTERVAL              1024
+
+#define JOG_EXECUTION_TREE     0
+#define JOG_EXECUTION_BYTECODE 1
+#define JOG_EXECUTION_REGISTER 2
 
 typedef void (*JogNativeMethodHandler)(JogVM*);
+typedef void (*JogNativeFunction)();  // any C++ function bound with JogVM::bind()
 
-class JogNativeMethodLookup : public map<Ref<JogString>,JogNativeMethodHandler,JogStringComparator>
+template <typename Signature> struct JogNativeGlue;
+
+struct JogNativeBinding
+{
+  JogNativeFunction function;  // NULL when bound at compile time
+  bool              context;   // first C++ parameter is the object context
+  string            return_type;
+};
+
+class JogNativeMethodLookup : public unordered_map<Ref<JogString>,JogNativeMethodHandler,JogStringHasher,JogStringEquality>
 {
   public:
     bool contains( Ref<JogString> sig )
     {
-      return (map<Ref<JogString>,JogNativeMethodHandler,JogStringComparator>::find(sig) != end());
+      return (unordered_map<Ref<JogString>,JogNativeMethodHandler,JogStringHasher,JogStringEquality>::find(sig) != end());
     }
 
     JogNativeMethodHandler find( Ref<JogString> sig )
     {
-      JogNativeMethodLookup::iterator entry = map<Ref<JogString>,JogNativeMethodHandler,JogStringComparator>::find(sig);
+      JogNativeMethodLookup::iterator entry = unordered_map<Ref<JogString>,JogNativeMethodHandler,JogStringHasher,JogStringEquality>::find(sig);
       if (entry == end()) return NULL;
       return entry->second;
     }
 };
 
+class JogNativeBindingLookup : public unordered_map<Ref<JogString>,JogNativeBinding,JogStringHasher,JogStringEquality>
+{
+  public:
+    JogNativeBinding* find( Ref<JogString> sig )
+    {
+      JogNativeBindingLookup::iterator entry = unordered_map<Ref<JogString>,JogNativeBinding,JogStringHasher,JogStringEquality>::find(sig);
+      if (entry == end()) return NULL;
+      return &entry->second;
+    }
+};
+
+//=============================================================================
+//  JogObjectAllocator
+//=============================================================================
+// Serves object memory from size-class free lists.  Each size class carves
+// its blocks out of its own chunks, so the heap can be walked block by
+// block with visit_blocks().  Blocks bigger than
+// JOG_ALLOCATOR_MAX_SMALL_SIZE (large arrays) are calloc'd individually
+// and kept on their own list.  release_all() frees everything at once
+// without visiting objects.
+//
+// Small objects are bump allocated from the nursery first, a fixed block
+// of chunks set up by init_nursery().  Once the nursery runs out of free
+// chunks 'nursery_full' is set and the VM makes a minor collection: it
+// frees the objects that have died and calls collect_nursery(), which
+// reuses the chunks left empty.  Objects can't move, so survivors are
+// promoted by leaving their chunk to the old generation until its last
+// object is freed.
+#define JOG_ALLOCATOR_GRANULARITY    16
+#define JOG_ALLOCATOR_MAX_SMALL_SIZE 512
+#define JOG_ALLOCATOR_CLASS_COUNT    (JOG_ALLOCATOR_MAX_SMALL_SIZE / JOG_ALLOCATOR_GRANULARITY)
+#define JOG_ALLOCATOR_CHUNK_SIZE     (16*1024)
+#define JOG_ALLOCATOR_CHUNK_GRANULES (JOG_ALLOCATOR_CHUNK_SIZE / JOG_ALLOCATOR_GRANULARITY)
+
+struct JogAllocatorStats
+{
+  JogInt64 allocation_count;  // total
+  int      live_count;
+  JogInt64 live_bytes;
+  JogInt64 peak_bytes;
+
+  JogAllocatorStats() : allocation_count(0), live_count(0), live_bytes(0), peak_bytes(0) { }
+
+  void on_allocate( int size )
+  {
+    ++allocation_count;
+    ++live_count;
+    live_bytes += size;
+    if (live_bytes > peak_bytes) peak_bytes = live_bytes;
+  }
+
+  void on_free( int size )
+  {
+    --live_count;
+    live_bytes -= size;
+  }
+};
+
+struct JogHeapStats
+{
+  JogInt64 live_count;
+  JogInt64 live_bytes;
+  JogInt64 allocation_count;  // total
+  JogInt64 allocated_bytes;   // total
+
+  JogHeapStats() : live_count(0), live_bytes(0), allocation_count(0), allocated_bytes(0) { }
+
+  void on_allocate( JogInt64 bytes )
+  {
+    ++live_count;
+    live_bytes += bytes;
+    ++allocation_count;
+    allocated_bytes += bytes;
+  }
+
+  void on_free( JogInt64 bytes )
+  {
+    --live_count;
+    live_bytes -= bytes;
+  }
+};
+
+struct JogSizeClass
+{
+  void* free_list;
+  char* chunks;       // linked through each chunk's first word
+  char* chunk_ptr;    // unused remainder of the newest chunk
+  char* chunk_limit;
+  int   chunk_count;
+
+  JogAllocatorStats stats;
+
+  JogSizeClass() : free_list(NULL), chunks(NULL), chunk_ptr(NULL), chunk_limit(NULL),
+      chunk_count(0) { }
+};
+
+#define JOG_CHUNK_FREE  0
+#define JOG_CHUNK_YOUNG 1
+#define JOG_CHUNK_OLD   2
+
+struct JogNurseryChunk
+{
+  char*            data;
+  JogNurseryChunk* next_free;
+  int              state;
+  int              live_count;
+  int              live_bytes;
+  unsigned char    starts[JOG_ALLOCATOR_CHUNK_GRANULES / 8];  // a bit per block
+};
+
+struct JogNurseryStats
+{
+  JogInt64 allocation_count;
+  JogInt64 allocated_bytes;
+  JogInt64 promoted_count;  // survivors of a minor collection
+  JogInt64 promoted_bytes;
+  int      minor_collection_count;
+
+  JogNurseryStats() : allocation_count(0), allocated_bytes(0), promoted_count(0),
+      promoted_bytes(0), minor_collection_count(0) { }
+};
+
+struct JogLargeBlock
+{
+  JogLargeBlock* previous;
+  JogLargeBlock* next;
+  // followed by JOG_ALLOCATOR_GRANULARITY-aligned data
+};
+
+struct JogObjectAllocator
+{
+  JogSizeClass   classes[JOG_ALLOCATOR_CLASS_COUNT];
+  JogLargeBlock* large_blocks;
+
+  JogAllocatorStats large_stats;
+
+  char*            nursery;
+  JogNurseryChunk* nursery_chunks;
+  int              nursery_chunk_count;
+  JogNurseryChunk* free_chunks;
+  JogNurseryChunk* nursery_chunk;  // being bump allocated
+  char*            nursery_ptr;
+  char*            nursery_limit;
+  int              young_chunk_count;
+  bool             nursery_full;
+  JogNurseryStats  nursery_stats;
+
+  JogObjectAllocator();
+  ~JogObjectAllocator();
+
+  void  init_nursery( int size );
+
+  void* allocate( int size );
+    // Returns zero-filled memory.
+
+  void  free( void* ptr, int size );
+    // 'size' must be the size passed to allocate().
+
+  void  collect_nursery();
+    // Promotes the young chunks that still hold objects and reuses the
+    // rest.  Dead objects must have been freed first.
+
+  void  release_all();
+  void  print_stats();
+
+  bool  start_nursery_chunk();
+  void  release_chunk( JogNurseryChunk* chunk );
+
+  JogNurseryChunk* nursery_chunk_of( void* ptr )
+  {
+    size_t offset = (size_t) ((char*) ptr - nursery);
+    if (offset >= (size_t) nursery_chunk_count * JOG_ALLOCATOR_CHUNK_SIZE) return NULL;
+    return nursery_chunks + offset / JOG_ALLOCATOR_CHUNK_SIZE;
+  }
+
+  template <typename Visitor>
+  void visit_blocks( Visitor& visitor )
+  {
+    // Calls visitor.visit(ptr) for every block handed out so far,
+    // including ones that have since been freed.
+    for (int i=0; i<JOG_ALLOCATOR_CLASS_COUNT; ++i)
+    {
+      JogSizeClass& size_class = classes[i];
+      int size = (i + 1) * JOG_ALLOCATOR_GRANULARITY;
+      int per_chunk = (JOG_ALLOCATOR_CHUNK_SIZE - JOG_ALLOCATOR_GRANULARITY) / size;
+      for (char* chunk=size_class.chunks; chunk; chunk=*((char**)chunk))
+      {
+        char* cur = chunk + JOG_ALLOCATOR_GRANULARITY;
+        char* limit = cur + per_chunk * size;
+        if (chunk == size_class.chunks) limit = size_class.chunk_ptr;
+        for ( ; cur < limit; cur += size) visitor.visit( cur );
+      }
+    }
+
+    for (JogLargeBlock* block=large_blocks; block; block=block->next)
+    {
+      visitor.visit( ((char*) block) + JOG_ALLOCATOR_GRANULARITY );
+    }
+
+    for (int i=0; i<nursery_chunk_count; ++i)
+    {
+      JogNurseryChunk& chunk = nursery_chunks[i];
+      if (chunk.state == JOG_CHUNK_FREE) continue;
+      for (int b=0; b<(int)sizeof(chunk.starts); ++b)
+      {
+        int bits = chunk.starts[b];
+        for (int granule=b*8; bits; ++granule, bits >>= 1)
+        {
+          if (bits & 1) visitor.visit( chunk.data + granule * JOG_ALLOCATOR_GRANULARITY );
+        }
+      }
+    }
+  }
+
+  static int size_class( int size ) { return (size - 1) / JOG_ALLOCATOR_GRANULARITY; }
+
+  static JogInt64 reserved_bytes( JogInt64 size )
+  {
+    // Memory actually set aside by allocate(size).
+    if (size > JOG_ALLOCATOR_MAX_SMALL_SIZE) return JOG_ALLOCATOR_GRANULARITY + size;
+    return (size_class((int) size) + 1) * JOG_ALLOCATOR_GRANULARITY;
+  }
+};
+
+extern JogObject* jog_released_objects;  // zero-count objects awaiting free
+
 struct JogParser;
 
 struct JogVM : RefCounted
 {
-  int max_object_bytes;  // set as desired
+  JogInt64 max_object_bytes;  // set as desired
+  int      heap_histogram_size;  // types listed when out of memory
+
+  JogInt64 cur_object_bytes;  // internal
+  JogInt64 class_data_bytes;  // internal
+  JogInt64 next_cycle_collection_bytes;  // internal
 
-  int cur_object_bytes;  // internal
+  JogObjectAllocator allocator;
 
-  JogObject* all_objects;
+  JogVMOptions       options;
 
-  JogInstruction     instruction_stack[JOG_INSTRUCTION_STACK_CAPACITY];
+  JogInstruction*    instruction_stack;
   JogInstruction*    instruction_stack_ptr;
   JogInstruction*    instruction_stack_limit;
 
-  JogInt64           data_stack[JOG_DATA_STACK_CAPACITY];
+  JogInt64*          data_stack;
   JogInt64*          data_stack_ptr;
   JogInt64*          data_stack_limit;
 
-  JogRef             ref_stack[JOG_REF_STACK_CAPACITY];
-  JogRef*            ref_stack_ptr;
-  JogRef*            ref_stack_limit;
+  JogStackRef*       ref_stack;
+  JogStackRef*       ref_stack_ptr;
+  JogStackRef*       ref_stack_limit;
 
-  JogStackFrame      frames[JOG_FRAME_STACK_CAPACITY];
+  JogStackFrame*     frames;
   JogStackFrame*     frame_ptr;
   JogStackFrame*     frame_stack_limit;
 
+  bool               exact_stack_checks;   // see JOG_STACK_CHECK
+  int                exact_check_depth;    // frame depth that turned them on
+  int                stack_slack;          // entries below each stack's base
+
   JogNativeMethodLookup native_methods;
+  JogNativeMethodLookup leaf_native_methods;
+  JogNativeMethodLookup pure_native_methods;  // safe to call at compile time
+  JogNativeBindingLookup native_bindings;     // natives added with bind()
+  JogNativeFunction     native_function;      // bound function of the running native
+  RefList<JogString>    inlining_opt_outs;
 
   ArrayList<JogTypeInfo*> parsed_types;
 
+  // Immortal literals and String.intern() results, keyed by hash code.
+  // Interned heap Strings aren't retained by the table; free_object()
+  // removes them.
+  unordered_multimap<int,JogObject*> interned_strings;
+  ArrayList<JogObject*>              immortal_objects;
+  int                                weak_interned_count;
+
   void*  user_context;
   int    timeout_seconds;  // default 0 (no timeout)
+  JogInt64 instruction_budget;  // loop iterations and calls per run(), default 0 (unlimited)
+  std::atomic<int> interrupted; // set by interrupt(), read by poll()
+  int    execution_mode;   // JOG_EXECUTION_X, default JOG_EXECUTION_BYTECODE
+  bool   fusion_enabled;   // peephole superinstructions, default true
+  bool   devirtualization_enabled;  // default true
+  int    inline_threshold;          // max nodes in an inlined method, 0 disables, default 16
+  bool   scalar_replacement_enabled;  // default true
+  bool   constant_folding_enabled;  // default true
+  bool   compact_strings;           // Latin-1 Strings use byte arrays, default true
+  bool   report_optimizations;      // print optimizer statistics, default false
+  bool   report_gc;                 // print cycle collections, default false
+
+  int      cycle_collection_count;    // cycle collections that freed objects
+  JogInt64 cyclic_objects_collected;
 
   int    random_seed;
 
-  JogVM();
-  ~JogVM() { reset(); }
+  // Execution limits, armed once per run().  Loop back-edges and calls
+  // only decrement and test poll_countdown; poll() does the rest.  Only
+  // the thread running the program touches these.
+  JogInt64 poll_countdown;
+  JogInt64 poll_slice;
+  JogInt64 budget_remaining;
+  JogInt64 timeout_target;
+
+  JogVM( const JogVMOptions& options=JogVMOptions() );
+  ~JogVM();
 
   void reset();
 
@@ -997,6 +1502,17 @@ struct JogVM : RefCounted
   void parse( Ref<JogParser> parser );
 
   void compile();
+  void bind_natives();
+  void fuse_instructions();
+  void devirtualize_calls();
+  void inline_calls();
+  void replace_scalars();
+  void fold_constants();
+  void intern_literals();
+
+  void prevent_inlining( const char* full_signature );
+    // E.g. "Test::log(String)"; call before compile().
+  void compile_bytecode();
   void run( const char* main_class_name );
   void add_native_handlers();
 
@@ -1007,6 +1523,61 @@ struct JogVM : RefCounted
 
   void add_native_handler( Ref<JogString> signature, JogNativeMethodHandler handler );
 
+  void add_leaf_native_handler( const char* signature, JogNativeMethodHandler handler );
+    // For natives that never call back into Jog.  Leaf handlers are called
+    // without a stack frame: they pop their arguments (and the object
+    // context of an instance method) and push their result.
+
+  void add_pure_native_handler( const char* signature, JogNativeMethodHandler handler );
+    // For leaf natives whose result depends only on their arguments; calls
+    // with constant arguments are evaluated by fold_constants().
+
+  template <typename Signature>
+  void bind( const char* signature, Signature* function )
+  {
+    // E.g. bind<double(double,double)>( "Math::pow(double,double)", pow ).
+    // Binds a C++ function as a leaf native; the argument and result glue
+    // is generated by JogNativeGlue.  Throws a JogError if the parameter
+    // types don't match 'signature'.
+    add_bound_native( signature, JogNativeGlue<Signature>::bound_handler,
+        (JogNativeFunction) function, JogNativeGlue<Signature>::arg_count,
+        JogNativeGlue<Signature>::parameter_types(),
+        JogNativeGlue<Signature>::return_type(), false );
+  }
+
+  template <typename Signature, Signature* function>
+  void bind( const char* signature )
+  {
+    // E.g. bind<double(double),sqrt>( "Math::sqrt(double)" ).  Calls
+    // 'function' directly instead of through a pointer.
+    add_bound_native( signature, JogNativeGlue<Signature>::template handler<function>,
+        NULL, JogNativeGlue<Signature>::arg_count,
+        JogNativeGlue<Signature>::parameter_types(),
+        JogNativeGlue<Signature>::return_type(), false );
+  }
+
+  template <typename Signature>
+  void bind_pure( const char* signature, Signature* function )
+  {
+    add_bound_native( signature, JogNativeGlue<Signature>::bound_handler,
+        (JogNativeFunction) function, JogNativeGlue<Signature>::arg_count,
+        JogNativeGlue<Signature>::parameter_types(),
+        JogNativeGlue<Signature>::return_type(), true );
+  }
+
+  template <typename Signature, Signature* function>
+  void bind_pure( const char* signature )
+  {
+    add_bound_native( signature, JogNativeGlue<Signature>::template handler<function>,
+        NULL, JogNativeGlue<Signature>::arg_count,
+        JogNativeGlue<Signature>::parameter_types(),
+        JogNativeGlue<Signature>::return_type(), true );
+  }
+
+  void add_bound_native( const char* signature, JogNativeMethodHandler handler,
+      JogNativeFunction function, int parameter_count, string parameter_types,
+      string return_type, bool pure );
+
   JogRef create_object( JogTypeInfo* of_type );
   JogRef create_array( JogTypeInfo* of_type, int count );
 
@@ -1014,12 +1585,69 @@ struct JogVM : RefCounted
     // Note: makes a copy of 'data'.
 
   JogRef create_string( JogRef array );
+    // Adopts a char[] or byte[] array, except that with compact_strings a
+    // char[] that fits in Latin-1 is copied to a byte[].
+
+  void set_string_chars( JogObject* st, JogChar* data, int count );
+    // Gives a new String a copy of 'data'.
+
+  JogObject* intern_string( JogChar* data, int count );
+  JogObject* intern_string( JogStringView chars );
+    // Returns the one immortal String with this content.
+  JogObject* intern_string( JogObject* st );
+    // String.intern(): returns the interned String equal to 'st', making
+    // 'st' itself the interned one if there is none.  'st' stays an
+    // ordinary heap object.
+  void forget_interned_string( JogObject* st );
+  JogObject* create_immortal_object( JogTypeInfo* type, JogInt64 size );
+  void delete_immortal_objects();
+
+  JogRef concat_strings( JogStackRef* operands, int count, JogObject** first=NULL );
+    // Joins the top 'count' strings of the ref stack, deepest first, after
+    // '*first' if given.  Null strings join as "null".
 
   void force_garbage_collection();
+  void collect_nursery();
+    // Minor collection, made when the allocator's nursery fills up.
+  void free_released_objects();
+    // Frees the objects queued on jog_released_objects that aren't on the
+    // ref stack; takes time in proportion to their number and the depth of
+    // the ref stack, not to the size of the heap.
+  int  collect_cycles();
+    // Frees unreachable cycles that reference counting can't; returns the
+    // number of objects freed.  allocate_object() calls it when the
+    // budget runs low.
   void delete_all_objects();
-  void register_object( JogObject* obj, int byte_size );
-
-  void push_frame( JogMethodInfo* method_info );
+    // Releases the whole object heap at once; objects must no longer be
+    // referenced.
+
+  JogObject* allocate_object( JogTypeInfo* type, JogInt64 size );
+    // Charges the memory set aside for the object to 'max_object_bytes'
+    // and to its type, collecting garbage first if it wouldn't fit.
+  JogInt64 free_object( JogObject* obj );
+    // Returns the bytes given back to 'max_object_bytes'.
+
+  JogHeapStats heap_stats( const char* type_name );
+    // Zeroed if there's no such type.
+  void largest_heap_types( ArrayList<JogTypeInfo*>& types, int max_count );
+    // Fills 'types' with up to 'max_count' types that have live objects,
+    // most live bytes first.
+  void print_heap_histogram( StringBuilder& buffer, int max_count );
+
+  void push_frame( JogMethodInfo* method_info, JogCmd* cmd );
+    // Reserves the stack headroom 'method_info' needs, so pushes made
+    // while it runs don't have to check.  'cmd' is the calling command.
+
+  bool grow_instruction_stack( int required );
+  bool grow_data_stack( int required );
+  bool grow_ref_stack( int required );
+  bool grow_frame_stack();
+    // Relocate a stack so that 'required' more entries fit, growing it
+    // no further than the limits in 'options'.  Returns false if they
+    // still don't fit.
+  void reserve_stack_slack( int slack );
+    // Relocates the stacks so that each has at least 'slack' spare
+    // entries below its base.
 
   void pop_frame() 
   {
@@ -1032,127 +1660,121 @@ struct JogVM : RefCounted
     instruction_stack_ptr = frame_ptr->instruction_stack_ptr;
     data_stack_ptr = frame_ptr->data_stack_ptr;
 
-    JogRef* target_ptr = frame_ptr->ref_stack_ptr;
-    JogRef* cur_ptr    = ref_stack_ptr;
-    while (cur_ptr != target_ptr) *(cur_ptr++) = NULL;
-    ref_stack_ptr = cur_ptr;
+    ref_stack_ptr = frame_ptr->ref_stack_ptr;
+
+    if (exact_stack_checks && frame_stack_limit - frame_ptr == exact_check_depth)
+    {
+      exact_stack_checks = false;
+    }
 
     ++frame_ptr; 
   }
 
   void push( JogCmd* cmd )
   {
+#if defined(JOG_CHECK_STACKS)
     if (instruction_stack_ptr == instruction_stack)
     {
-      throw cmd->error("Instruction stack limit reached during recursion.");
+      throw cmd->error( "Instruction stack limit reached during recursion." );
     }
+    JOG_DEPTH_CHECK( instruction_stack, max_instruction_depth );
+#endif
     *(--instruction_stack_ptr) = JogInstruction(cmd);
     cmd->on_push(this);
   }
 
   void push( JogCmd* cmd, int execution_state )
   {
+#if defined(JOG_CHECK_STACKS)
     if (instruction_stack_ptr == instruction_stack)
     {
-      throw cmd->error("Instruction stack limit reached during recursion.");
+      throw cmd->error( "Instruction stack limit reached during recursion." );
     }
+    JOG_DEPTH_CHECK( instruction_stack, max_instruction_depth );
+#endif
     *(--instruction_stack_ptr) = JogInstruction(cmd,execution_state);
   }
 
   void push( JogInt64 value )
   {
-    if (data_stack_ptr == data_stack)
-    {
-      Ref<JogError> err = new JogError("Data stack limit reached during recursion.");
-      throw err;
-    }
+    JOG_STACK_CHECK( data_stack_ptr == data_stack, "Data stack limit reached during recursion." );
+    JOG_DEPTH_CHECK( data_stack, max_data_depth );
     *(--data_stack_ptr) = value;
   }
 
   void push( int value )
   {
-    if (data_stack_ptr == data_stack)
-    {
-      Ref<JogError> err = new JogError("Data stack limit reached during recursion.");
-      throw err;
-    }
+    JOG_STACK_CHECK( data_stack_ptr == data_stack, "Data stack limit reached during recursion." );
+    JOG_DEPTH_CHECK( data_stack, max_data_depth );
     *(--data_stack_ptr) = value;
   }
 
   void push( double value )
   {
-    if (data_stack_ptr == data_stack)
-    {
-      Ref<JogError> err = new JogError("Data stack limit reached during recursion.");
-      throw err;
-    }
+    JOG_STACK_CHECK( data_stack_ptr == data_stack, "Data stack limit reached during recursion." );
+    JOG_DEPTH_CHECK( data_stack, max_data_depth );
     *(--data_stack_ptr) = *((JogInt64*)&value);
   }
 
-  void push( JogRef object );
+  void push( JogObject* object )
+  {
+    JOG_STACK_CHECK( ref_stack_ptr == ref_stack, "Reference stack limit reached during recursion." );
+    JOG_DEPTH_CHECK( ref_stack, max_ref_depth );
+    (--ref_stack_ptr)->object = object;
+  }
+
+  void push( JogStackRef object )
+  {
+    push( object.object );
+  }
+
+  void push( const JogRef& object )
+  {
+    push( object.object );
+  }
 
   JogInt64 pop_data()
   {
-    if (data_stack_ptr == data_stack_limit)
-    {
-      Ref<JogError> err = new JogError("[Internal] Data stack underflow.");
-      throw err;
-    }
+    JOG_STACK_CHECK( data_stack_ptr == data_stack_limit, "[Internal] Data stack underflow." );
     return *(data_stack_ptr++);
   }
 
   double pop_data_as_Real64()
   {
-    if (data_stack_ptr == data_stack_limit)
-    {
-      Ref<JogError> err = new JogError("[Internal] Data stack underflow.");
-      throw err;
-    }
+    JOG_STACK_CHECK( data_stack_ptr == data_stack_limit, "[Internal] Data stack underflow." );
     JogInt64 result = *(data_stack_ptr++);
     return *((double*)&result);
   }
 
   JogInt64 pop_long()
   {
-    if (data_stack_ptr == data_stack_limit)
-    {
-      Ref<JogError> err = new JogError("[Internal] Data stack underflow.");
-      throw err;
-    }
+    JOG_STACK_CHECK( data_stack_ptr == data_stack_limit, "[Internal] Data stack underflow." );
     return *(data_stack_ptr++);
   }
 
   int pop_int()
   {
-    if (data_stack_ptr == data_stack_limit)
-    {
-      Ref<JogError> err = new JogError("[Internal] Data stack underflow.");
-      throw err;
-    }
+    JOG_STACK_CHECK( data_stack_ptr == data_stack_limit, "[Internal] Data stack underflow." );
     return (int) *(data_stack_ptr++);
   }
 
   double pop_double()
   {
-    if (data_stack_ptr == data_stack_limit)
-    {
-      Ref<JogError> err = new JogError("[Internal] Data stack underflow.");
-      throw err;
-    }
+    JOG_STACK_CHECK( data_stack_ptr == data_stack_limit, "[Internal] Data stack underflow." );
     JogInt64 result = *(data_stack_ptr++);
     return *((double*)&result);
   }
 
-  JogRef pop_ref()
+  JogStackRef pop_ref()
   {
-    if (ref_stack_ptr == ref_stack_limit)
-    {
-      Ref<JogError> err = new JogError("[Internal] Ref stack underflow.");
-      throw err;
-    }
-    JogRef result = *ref_stack_ptr;
-    *(ref_stack_ptr++) = NULL;
-    return result;
+    JOG_STACK_CHECK( ref_stack_ptr == ref_stack_limit, "[Internal] Ref stack underflow." );
+    return *(ref_stack_ptr++);
+  }
+
+  void discard( int data_count, int ref_count )
+  {
+    data_stack_ptr += data_count;
+    ref_stack_ptr += ref_count;
   }
 
   JogInt64 peek_data()
@@ -1166,73 +1788,431 @@ struct JogVM : RefCounted
     return *((double*)&result);
   }
 
-  JogRef peek_ref()
+  JogStackRef peek_ref()
   {
     return *ref_stack_ptr;
   }
 
 
-  int  execution_state()
+  int  execution_state()
+  {
+    // Returns and increments the execution state of the current
+    // instruction.  0 will be the first value returned.
+    return instruction_stack_ptr[-1].state++;
+  }
+
+  void run_this_again()
+  {
+    // The current instruction was just popped off the stack, so
+    // bumping up the stack position will run it again.
+    // CAUTION: run_this_again() must be called before any new
+    // commands are pushed on the stack.
+    --instruction_stack_ptr;
+  }
+
+  JogInt64 cur_time()
+  {
+    return time(0);
+  }
+
+  void interrupt()
+  {
+    // Safe to call from a watchdog thread or a signal handler: it only
+    // stores to an atomic flag.  poll() checks the flag, so the running
+    // program stops with a timeout error within JOG_POLL_INTERVAL loop
+    // iterations and calls.
+    interrupted.store( 1, std::memory_order_relaxed );
+  }
+
+  void start_limits();
+  void poll( JogCmd* next_cmd );
+
+  void charge( JogCmd* cmd )
+  {
+    // Called once per loop back-edge and per call, in every execution
+    // mode, so the budget means the same thing in each.
+    if (--poll_countdown < 0) poll( cmd );
+  }
+
+  void execute()
+  {
+    if (exact_stack_checks)
+    {
+      execute_checked_until( instruction_stack_limit );
+      return;
+    }
+
+    while (instruction_stack_ptr != instruction_stack_limit)
+    {
+      JogCmd* cmd = (instruction_stack_ptr++)->command;
+      cmd->execute(this);
+    }
+  }
+
+  void execute_until( JogInstruction* target_pos )
+  {
+    if (exact_stack_checks)
+    {
+      execute_checked_until( target_pos );
+      return;
+    }
+
+    // Compared as a depth since a call can relocate the instruction stack.
+    int target_depth = (int)(instruction_stack_limit - target_pos);
+    while (instruction_stack_limit - instruction_stack_ptr > target_depth)
+    {
+      JogCmd* cmd = (instruction_stack_ptr++)->command;
+      cmd->execute(this);
+    }
+  }
+
+  void execute_checked_until( JogInstruction* target_pos );
+    // execute_until() for frames that don't fit their stacks: checks the
+    // stacks before every command.
+
+  bool starts_exact_checks()
+  {
+    // True just after push_frame() for the frame that didn't fit.
+    return exact_stack_checks && frame_stack_limit - frame_ptr == exact_check_depth;
+  }
+
+  void execute_frame_checked( JogMethodInfo* m );
+    // Runs the frame just pushed for 'm' by the command being executed
+    // until it returns, with exact stack checks.
+
+  void check_stack_limits();
+    // Throws the recursion limit error of a stack pushed past its base.
+
+  void bind_native( JogMethodInfo* m );
+  void call_native( JogMethodInfo* m );
+  bool call_leaf_native( JogMethodInfo* m );
+    // internal use
+
+  void execute_code( JogCode* code );
+    // Runs 'code' for the frame on top of the frame stack until that
+    // frame returns.  Passing NULL initializes the dispatch table.
+
+  template <bool checked>
+  void run_code( JogCode* code );
+    // execute_code() checking the stacks before every op, or not at all.
+
+  void call_void_method( JogRef context, const char* signature );
+    // Runs under the limits armed by the last run() or start_limits().
+};
+
+
+//=============================================================================
+//  Native Binding
+//=============================================================================
+// JogNativeGlue<R(Args...)> is the handler JogVM::bind() registers for a
+// C++ function.  Each argument is read in place from an offset fixed at
+// compile time and the stacks are adjusted once after the call, so the
+// glue costs the same as a handwritten handler.
+//
+//   Jog type             C++ type
+//   boolean              bool
+//   byte, short, char    JogInt8, JogInt16, JogChar
+//   int, long            int, JogInt64
+//   float, double        float, double
+//   String               JogStringView (parameter only)
+//   T[]                  JogArrayView<T> (parameter only)
+//   any reference        JogRef or JogObject*
+//
+// Instance methods take their object context as the first C++ parameter.
+// Natives that allocate may take the running JogVM* before everything else.
+//
+// A String keeps its characters in a char[], or in a byte[] when every
+// character fits in Latin-1 and JogVM::compact_strings is set.
+struct JogStringView
+{
+  JogChar*  data;    // NULL for a null or a compact String
+  JogUInt8* latin1;  // characters of a compact String, else NULL
+  int       count;
+
+  bool is_null() { return !data && !latin1; }
+  JogChar operator[]( int index ) { return latin1 ? latin1[index] : data[index]; }
+};
+
+inline JogStringView jog_string_view( JogObject* str )
+{
+  JogStringView view = { NULL, NULL, 0 };
+  if (str)
+  {
+    JogObject* array = *((JogObject**)&(str->data[0]));
+    if (array)
+    {
+      view.data = (JogChar*) array->data;
+    }
+    else
+    {
+      array = *((JogObject**)&(str->data[2]));
+      if ( !array ) return view;
+      view.latin1 = (JogUInt8*) array->data;
+    }
+    view.count = array->count;
+  }
+  return view;
+}
+
+inline void jog_copy_chars( JogChar* dest, JogStringView src, int i1, int count )
+{
+  if (src.latin1)
+  {
+    JogUInt8* cur = src.latin1 + i1;
+    for (int i=0; i<count; ++i) dest[i] = cur[i];
+  }
+  else
+  {
+    memcpy( dest, src.data + i1, count*sizeof(JogChar) );
+  }
+}
+
+inline bool jog_chars_match( JogStringView a, int a_offset, JogStringView b, int b_offset,
+    int count )
+{
+  if (a.latin1 && b.latin1) return !memcmp( a.latin1+a_offset, b.latin1+b_offset, count );
+  if (a.data && b.data) return !memcmp( a.data+a_offset, b.data+b_offset, count*sizeof(JogChar) );
+
+  for (int i=0; i<count; ++i)
+  {
+    if (a[a_offset+i] != b[b_offset+i]) return false;
+  }
+  return true;
+}
+
+int jog_string_hash( JogStringView chars );
+int jog_string_hash_code( JogObject* st );
+  // Returns a String's hash_code, computing and caching it on first use.
+
+template <typename DataType>
+struct JogArrayView
+{
+  DataType* data;  // NULL for a null array
+  int       count;
+};
+
+template <typename DataType> struct JogNativeType;
+
+template <typename DataType>
+struct JogNativeIntegerType
+{
+  typedef DataType Result;
+  static const bool is_ref = false;
+  static DataType read( JogVM* vm, int offset ) { return (DataType) vm->data_stack_ptr[offset]; }
+  static void push( JogVM* vm, DataType value ) { vm->push( (int) value ); }
+};
+
+template <> struct JogNativeType<bool> : JogNativeIntegerType<bool>
+{
+  static bool read( JogVM* vm, int offset ) { return vm->data_stack_ptr[offset] != 0; }
+  static string name() { return "boolean"; }
+};
+
+template <> struct JogNativeType<JogInt8> : JogNativeIntegerType<JogInt8>
+{
+  static string name() { return "byte"; }
+};
+
+template <> struct JogNativeType<JogInt16> : JogNativeIntegerType<JogInt16>
+{
+  static string name() { return "short"; }
+};
+
+template <> struct JogNativeType<JogChar> : JogNativeIntegerType<JogChar>
+{
+  static string name() { return "char"; }
+};
+
+template <> struct JogNativeType<int> : JogNativeIntegerType<int>
+{
+  static string name() { return "int"; }
+};
+
+template <> struct JogNativeType<JogInt64>
+{
+  typedef JogInt64 Result;
+  static const bool is_ref = false;
+  static string name() { return "long"; }
+  static JogInt64 read( JogVM* vm, int offset ) { return vm->data_stack_ptr[offset]; }
+  static void push( JogVM* vm, JogInt64 value ) { vm->push( value ); }
+};
+
+template <> struct JogNativeType<double>
+{
+  typedef double Result;
+  static const bool is_ref = false;
+  static string name() { return "double"; }
+  static double read( JogVM* vm, int offset ) { return *((double*)(vm->data_stack_ptr+offset)); }
+  static void push( JogVM* vm, double value ) { vm->push( value ); }
+};
+
+template <> struct JogNativeType<float>
+{
+  typedef float Result;
+  static const bool is_ref = false;
+  static string name() { return "float"; }
+  static float read( JogVM* vm, int offset ) { return (float) *((double*)(vm->data_stack_ptr+offset)); }
+  static void push( JogVM* vm, float value ) { vm->push( (double) value ); }
+};
+
+template <> struct JogNativeType<JogRef>
+{
+  typedef JogRef Result;
+  static const bool is_ref = true;
+  static string name() { return ""; }  // any reference type
+  static JogRef read( JogVM* vm, int offset ) { return vm->ref_stack_ptr[offset]; }
+  static void push( JogVM* vm, JogRef value ) { vm->push( value ); }
+};
+
+template <> struct JogNativeType<JogObject*>
+{
+  typedef JogRef Result;  // keeps a returned argument alive until it's pushed
+  static const bool is_ref = true;
+  static string name() { return ""; }
+  static JogObject* read( JogVM* vm, int offset ) { return vm->ref_stack_ptr[offset].object; }
+  static void push( JogVM* vm, JogRef value ) { vm->push( value ); }
+};
+
+template <> struct JogNativeType<JogStringView>
+{
+  static const bool is_ref = true;
+  static string name() { return "String"; }
+  static JogStringView read( JogVM* vm, int offset )
+  {
+    return jog_string_view( vm->ref_stack_ptr[offset].object );
+  }
+};
+
+template <typename DataType>
+struct JogNativeType< JogArrayView<DataType> >
+{
+  static const bool is_ref = true;
+  static string name() { return JogNativeType<DataType>::name() + "[]"; }
+  static JogArrayView<DataType> read( JogVM* vm, int offset )
+  {
+    JogArrayView<DataType> view = { NULL, 0 };
+    JogObject* array = vm->ref_stack_ptr[offset].object;
+    if (array)
+    {
+      view.data = (DataType*) array->data;
+      view.count = array->count;
+    }
+    return view;
+  }
+};
+
+template <> struct JogNativeType<void>
+{
+  static string name() { return "void"; }
+};
+
+constexpr int jog_native_slots_after( const bool* is_ref, int count, int index, bool ref )
+{
+  // Number of arguments after 'index' that share its stack; arguments are
+  // pushed in order, so that is the argument's offset from the top.
+  int slots = 0;
+  for (int i=index+1; i<count; ++i) if (is_ref[i] == ref) ++slots;
+  return slots;
+}
+
+template <typename ResultType>
+struct JogNativeResult
+{
+  template <typename Function, typename... Args>
+  static void call( JogVM* vm, int data_count, int ref_count, Function fn, Args... args )
+  {
+    typename JogNativeType<ResultType>::Result result = fn( args... );
+    vm->discard( data_count, ref_count );
+    JogNativeType<ResultType>::push( vm, result );
+  }
+};
+
+template <>
+struct JogNativeResult<void>
+{
+  template <typename Function, typename... Args>
+  static void call( JogVM* vm, int data_count, int ref_count, Function fn, Args... args )
+  {
+    fn( args... );
+    vm->discard( data_count, ref_count );
+  }
+};
+
+template <typename ResultType, typename... Args>
+struct JogNativeGlue<ResultType(Args...)>
+{
+  typedef ResultType (*Function)(Args...);
+
+  static constexpr int  arg_count = sizeof...(Args);
+  static constexpr bool is_ref[arg_count+1] = { JogNativeType<Args>::is_ref..., false };
+  static constexpr int  data_count = jog_native_slots_after( is_ref, arg_count, -1, false );
+  static constexpr int  ref_count  = jog_native_slots_after( is_ref, arg_count, -1, true );
+
+  template <size_t index>
+  struct Offset
+  {
+    static constexpr int value = jog_native_slots_after( is_ref, arg_count, index, is_ref[index] );
+  };
+
+  template <size_t... indices>
+  static void call( JogVM* vm, Function fn, std::index_sequence<indices...> )
   {
-    // Returns and increments the execution state of the current
-    // instruction.  0 will be the first value returned.
-    return instruction_stack_ptr[-1].state++;
+    JogNativeResult<ResultType>::call( vm, data_count, ref_count, fn,
+        JogNativeType<Args>::read( vm, Offset<indices>::value )... );
   }
 
-  void run_this_again()
+  template <Function function>
+  static void handler( JogVM* vm )
   {
-    // The current instruction was just popped off the stack, so
-    // bumping up the stack position will run it again.
-    // CAUTION: run_this_again() must be called before any new
-    // commands are pushed on the stack.
-    --instruction_stack_ptr;
+    call( vm, function, std::index_sequence_for<Args...>() );
   }
 
-  JogInt64 cur_time()
+  static void bound_handler( JogVM* vm )
   {
-    return time(0);
+    call( vm, (Function) vm->native_function, std::index_sequence_for<Args...>() );
   }
 
-  void execute()
+  static string parameter_types()
   {
-    JogInt64 timeout_target = timeout_seconds;
-
-    if (timeout_target) timeout_target += cur_time();
-    while (instruction_stack_ptr != instruction_stack_limit)
+    string names[arg_count+1] = { JogNativeType<Args>::name()..., "" };
+    string result;
+    for (int i=0; i<arg_count; ++i)
     {
-      if (timeout_target && timeout_target <= cur_time())
-      {
-        throw instruction_stack_ptr->command->t->error(
-            "Timeout - your program is taking too long.  Do you have an infinite loop?" );
-      }
-
-      JogCmd* cmd = (instruction_stack_ptr++)->command;
-      cmd->execute(this);
+      if (i) result += ",";
+      result += names[i];
     }
+    return result;
   }
 
-  void execute_until( JogInstruction* target_pos )
+  static string return_type()
   {
-    JogInt64 timeout_target = timeout_seconds;
-    if (timeout_target) timeout_target += cur_time();
+    return JogNativeType<ResultType>::name();
+  }
+};
 
-    while (instruction_stack_ptr < target_pos)
-    {
-      if (timeout_target && timeout_target <= cur_time())
-      {
-        throw instruction_stack_ptr->command->t->error(
-            "Timeout - your program is taking too long.  Do you have an infinite loop?" );
-      }
+template <typename ResultType, typename... Args>
+struct JogNativeGlue<ResultType(JogVM*,Args...)> : JogNativeGlue<ResultType(Args...)>
+{
+  typedef JogNativeGlue<ResultType(Args...)> Glue;
+  typedef ResultType (*Function)(JogVM*,Args...);
 
-      JogCmd* cmd = (instruction_stack_ptr++)->command;
-      cmd->execute(this);
-    }
+  template <size_t... indices>
+  static void call( JogVM* vm, Function fn, std::index_sequence<indices...> )
+  {
+    JogNativeResult<ResultType>::call( vm, Glue::data_count, Glue::ref_count, fn, vm,
+        JogNativeType<Args>::read( vm, Glue::template Offset<indices>::value )... );
   }
 
-  void call_native( JogMethodInfo* m );
-    // internal use
+  template <Function function>
+  static void handler( JogVM* vm )
+  {
+    call( vm, function, std::index_sequence_for<Args...>() );
+  }
 
-  void call_void_method( JogRef context, const char* signature );
+  static void bound_handler( JogVM* vm )
+  {
+    call( vm, (Function) vm->native_function, std::index_sequence_for<Args...>() );
+  }
 };
 
 
@@ -1273,11 +2253,17 @@ struct JogCmdList : JogCmd
     return commands[index];
   }
 
+  bool pushes_operands_in_turn() { return true; }
+
   Ref<JogCmd> resolve();
 
   void on_push( JogVM* vm );
 
   void execute( JogVM* vm );
+  void compile( JogCodeBuilder* code );
+
+  void visit_operands( JogCmdVisitor* visitor );
+  Ref<JogCmd> inline_copy( JogInliner* inliner );
 };
 
 struct JogStatementList : JogCmdList
@@ -1352,9 +2338,234 @@ struct JogLocalVarInfo : RefCounted
 };
 
 
+//=============================================================================
+//  JogCode
+//=============================================================================
+// Linear bytecode produced from a resolved method body by
+// JogVM::compile_bytecode().  Each op names the JogCmd it was lowered from
+// for error reporting; ops without a dedicated handler fall back on the
+// node itself (NODE) or on the tree walker for the whole subtree (TREE).
+#define JOG_OPCODES(OP) \
+  OP(NOP) \
+  OP(TREE) \
+  OP(NODE) \
+  OP(JUMP) \
+  OP(JUMP_IF_FALSE) \
+  OP(JUMP_IF_TRUE) \
+  OP(PUSH_DATA) \
+  OP(PUSH_NULL) \
+  OP(PUSH_THIS) \
+  OP(PUSH_REF) \
+  OP(READ_LOCAL_DATA) \
+  OP(READ_LOCAL_REF) \
+  OP(WRITE_LOCAL_DATA) \
+  OP(WRITE_LOCAL_REF) \
+  OP(DISCARD_DATA) \
+  OP(DISCARD_REF) \
+  OP(ADD_INT32) \
+  OP(SUB_INT32) \
+  OP(MUL_INT32) \
+  OP(ADD_INT64) \
+  OP(SUB_INT64) \
+  OP(MUL_INT64) \
+  OP(ADD_REAL64) \
+  OP(SUB_REAL64) \
+  OP(MUL_REAL64) \
+  OP(DIV_REAL64) \
+  OP(EQ_INTEGER) \
+  OP(NE_INTEGER) \
+  OP(LT_INTEGER) \
+  OP(LE_INTEGER) \
+  OP(GT_INTEGER) \
+  OP(GE_INTEGER) \
+  OP(LT_REAL) \
+  OP(LE_REAL) \
+  OP(GT_REAL) \
+  OP(GE_REAL) \
+  OP(EQ_REF) \
+  OP(NE_REF) \
+  OP(ARRAY_SIZE) \
+  OP(READ_PROPERTY_DATA) \
+  OP(READ_PROPERTY_REF) \
+  OP(ARRAY_READ_INT32) \
+  OP(ARRAY_WRITE_INT32) \
+  OP(NEW_OBJECT) \
+  OP(CALL_STATIC) \
+  OP(CALL_DYNAMIC) \
+  OP(CALL_CLASS) \
+  OP(RETURN_VOID) \
+  OP(RETURN_DATA) \
+  OP(RETURN_REF) \
+  OP(MISSING_RETURN) \
+  OP(COUNTED_LOOP_TEST) \
+  OP(COUNTED_LOOP_NEXT) \
+  OP(LOAD_CONST) \
+  OP(MOVE) \
+  OP(POP_LOCAL_DATA) \
+  OP(JUMP_IF_FALSE_R) \
+  OP(RETURN_DATA_R) \
+  OP(ADD_INT32_R) \
+  OP(SUB_INT32_R) \
+  OP(MUL_INT32_R) \
+  OP(DIV_INT32_R) \
+  OP(MOD_INT32_R) \
+  OP(ADD_INT64_R) \
+  OP(SUB_INT64_R) \
+  OP(MUL_INT64_R) \
+  OP(ADD_REAL64_R) \
+  OP(SUB_REAL64_R) \
+  OP(MUL_REAL64_R) \
+  OP(DIV_REAL64_R) \
+  OP(EQ_INTEGER_R) \
+  OP(NE_INTEGER_R) \
+  OP(LT_INTEGER_R) \
+  OP(LE_INTEGER_R) \
+  OP(GT_INTEGER_R) \
+  OP(GE_INTEGER_R) \
+  OP(LT_REAL_R) \
+  OP(LE_REAL_R) \
+  OP(GT_REAL_R) \
+  OP(GE_REAL_R)
+
+#define JOG_OPCODE_ENUM(name) JOG_OP_##name,
+enum JogOpcode
+{
+  JOG_OPCODES(JOG_OPCODE_ENUM)
+  JOG_OP_COUNT
+};
+#undef JOG_OPCODE_ENUM
+
+#if defined(__GNUC__)
+#  define JOG_THREADED_DISPATCH
+#endif
+
+struct JogOp
+{
+  const void*    handler;   // dispatch address, set by JogCode::thread()
+  int            opcode;
+  int            operand;   // local offset, property index or relative jump
+  int            src_a;     // source registers (JOG_EXECUTION_REGISTER)
+  int            src_b;
+  JogInt64       value;     // literal data
+  JogCmd*        cmd;       // source node
+  JogMethodInfo* method_info;
+};
+
+struct JogCode : RefCounted
+{
+  static const void** dispatch_table;
+
+  JogMethodInfo*   method_info;
+  ArrayList<JogOp> ops;
+
+  JogCode( JogMethodInfo* method_info ) : method_info(method_info)
+  {
+  }
+
+  void thread();
+  void print();
+};
+
+// Register mode: a "register" is a data slot of the current frame given
+// as an offset from the frame's data_stack_ptr, the same addressing used by
+// JogLocalVarInfo::offset.  Parameters and locals are their own registers;
+// temporaries and constants get extra slots after the locals that are
+// added to the method's local_data_count by finish().  A register of 0
+// means "the value is on the data stack".
+#define JOG_CONSTANT_REGISTER_TAG (1<<24)
+
+struct JogCodeBuilder
+{
+  Ref<JogCode>   code;
+  ArrayList<int> break_jumps;
+  ArrayList<int> continue_jumps;
+  ArrayList<int> loop_marks;
+
+  bool                use_registers;
+  int                 temp_base;
+  int                 temp_count;
+  int                 max_temp_count;
+  ArrayList<JogInt64> constants;
+
+  JogCodeBuilder( JogMethodInfo* method_info, bool use_registers );
+
+  int position() { return code->ops.count; }
+
+  int add( int opcode, JogCmd* cmd, int operand=0 )
+  {
+    JogOp op;
+    memset( &op, 0, sizeof(JogOp) );
+    op.opcode = opcode;
+    op.operand = operand;
+    op.cmd = cmd;
+    code->ops.add( op );
+    return code->ops.count - 1;
+  }
+
+  int add_value( int opcode, JogCmd* cmd, JogInt64 value )
+  {
+    int index = add( opcode, cmd );
+    code->ops[index].value = value;
+    return index;
+  }
+
+  int add_call( int opcode, JogCmd* cmd, JogMethodInfo* m )
+  {
+    int index = add( opcode, cmd );
+    code->ops[index].method_info = m;
+    return index;
+  }
+
+  int add_jump( int opcode, JogCmd* cmd, int target=-1 )
+  {
+    int index = add( opcode, cmd );
+    if (target >= 0) patch( index, target );
+    return index;
+  }
+
+  void patch( int jump_index, int target )
+  {
+    code->ops[jump_index].operand = target - jump_index;
+  }
+
+  bool in_loop() { return loop_marks.count > 0; }
+
+  void begin_loop()
+  {
+    loop_marks.add( break_jumps.count );
+    loop_marks.add( continue_jumps.count );
+  }
+
+  void end_loop( int continue_target, int break_target )
+  {
+    int continue_mark = loop_marks.remove_last();
+    int break_mark = loop_marks.remove_last();
+    while (continue_jumps.count > continue_mark) patch( continue_jumps.remove_last(), continue_target );
+    while (break_jumps.count > break_mark) patch( break_jumps.remove_last(), break_target );
+  }
+
+  bool is_temp( int reg ) { return reg < 0 && reg <= -(temp_base+1); }
+  bool is_local( int reg ) { return reg < 0 && reg > -(temp_base+1); }
+
+  int  alloc_temp();
+  void release( int reg );
+  int  constant( JogInt64 value );
+  int  to_register( JogCmd* cmd, int reg, int target=0 );
+  void push_register( JogCmd* cmd, int reg );
+  int  add_register_op( int opcode, JogCmd* cmd, int dest, int src_a, int src_b=0 );
+  int  add_branch_if_false( JogCmd* condition, JogCmd* cmd );
+
+  void finish();
+};
+
+
 //=============================================================================
 //  JogMethodInfo
 //=============================================================================
+#define JOG_INLINING_PENDING  0
+#define JOG_INLINING_ACTIVE   1
+#define JOG_INLINING_DONE     2
+
 struct JogMethodInfo : RefCounted
 {
   static int next_method_id;
@@ -1371,10 +2582,13 @@ struct JogMethodInfo : RefCounted
   RefList<JogLocalVarInfo> parameters;
   RefList<JogLocalVarInfo> locals;  // Includes parameters
   Ref<JogStatementList> statements;
+  Ref<JogCode>          code;
 
   int  method_id;
   int  dispatch_id;
   JogNativeMethodHandler native_handler;
+  JogNativeFunction      native_function;  // see JogVM::bind()
+  bool leaf_native;  // native_handler runs without a frame; see add_leaf_native_handler()
 
   int  param_data_count;
   int  param_ref_count;   // includes object context
@@ -1382,6 +2596,14 @@ struct JogMethodInfo : RefCounted
   int  local_data_count;
   int  local_ref_count;
 
+  bool inlinable;       // false keeps calls to this method out of line
+  int  inlining_state;  // JOG_INLINING_X, used by JogVM::inline_calls()
+
+  // Maximum stack use by the method body, not counting locals or calls.
+  int  max_data_depth;
+  int  max_ref_depth;
+  int  max_instruction_depth;
+
   bool organized;
   bool resolved;
 
@@ -1400,6 +2622,8 @@ struct JogMethodInfo : RefCounted
 
   void organize();
   void resolve();
+  void compute_stack_depths();
+  void compile( int execution_mode );
 };
 
 
@@ -1488,6 +2712,8 @@ struct JogTypeInfo : RefCounted
 
   JogInt64* class_data;
 
+  JogHeapStats heap_stats;  // memory set aside for objects of exactly this type
+
   Ref<JogToken>             t;
   Ref<JogString>            name;
   RefList<JogPropertyInfo>  class_properties;
@@ -1543,13 +2769,7 @@ struct JogTypeInfo : RefCounted
 
   JogRef create_instance( JogVM* vm )
   {
-    JogObject* obj = (JogObject*) new char[object_size];
-    memset( obj, 0, object_size );
-    obj->type = this;
-
-    JogRef result(obj);
-    vm->register_object(obj,object_size);
-
+    JogRef result( vm->allocate_object(this,object_size) );
     return result;
   }
 
@@ -1640,6 +2860,7 @@ struct JogTypeManager
   JogTypeInfo* type_null;
   JogTypeInfo* type_string;
   JogTypeInfo* type_char_array;
+  JogTypeInfo* type_byte_array;
 
   JogTypeManager()
   {
@@ -1715,6 +2936,7 @@ struct JogTypeManager
     type_null = NULL;
     type_string = NULL;
     type_char_array = NULL;
+    type_byte_array = NULL;
   }
 
   JogTypeInfo* must_find_type( const char* name );
@@ -1754,6 +2976,9 @@ struct JogCmdLiteralReal64 : JogCmd
   void on_push( JogVM* vm );
 
   void execute( JogVM* vm );
+  void compile( JogCodeBuilder* code );
+  int  compile_register( JogCodeBuilder* code, int target );
+  bool is_pure() { return true; }
 };
 
 struct JogCmdLiteralReal32 : JogCmd
@@ -1784,6 +3009,9 @@ struct JogCmdLiteralReal32 : JogCmd
   void on_push( JogVM* vm );
 
   void execute( JogVM* vm );
+  void compile( JogCodeBuilder* code );
+  int  compile_register( JogCodeBuilder* code, int target );
+  bool is_pure() { return true; }
 };
 
 struct JogCmdLiteralInt64 : JogCmd
@@ -1813,6 +3041,9 @@ struct JogCmdLiteralInt64 : JogCmd
   void on_push( JogVM* vm );
 
   void execute( JogVM* vm );
+  void compile( JogCodeBuilder* code );
+  int  compile_register( JogCodeBuilder* code, int target );
+  bool is_pure() { return true; }
 };
 
 struct JogCmdLiteralInt32 : JogCmd
@@ -1843,6 +3074,10 @@ struct JogCmdLiteralInt32 : JogCmd
   void on_push( JogVM* vm );
 
   void execute( JogVM* vm );
+  void compile( JogCodeBuilder* code );
+  int  compile_register( JogCodeBuilder* code, int target );
+  bool is_pure() { return true; }
+  int  fusion_shape() { return JOG_SHAPE_LITERAL_INT32; }
 };
 
 struct JogCmdLiteralInt16 : JogCmd
@@ -1872,6 +3107,9 @@ struct JogCmdLiteralInt16 : JogCmd
   void on_push( JogVM* vm );
 
   void execute( JogVM* vm );
+  void compile( JogCodeBuilder* code );
+  int  compile_register( JogCodeBuilder* code, int target );
+  bool is_pure() { return true; }
 };
 
 struct JogCmdLiteralInt8 : JogCmd
@@ -1901,6 +3139,9 @@ struct JogCmdLiteralInt8 : JogCmd
   void on_push( JogVM* vm );
 
   void execute( JogVM* vm );
+  void compile( JogCodeBuilder* code );
+  int  compile_register( JogCodeBuilder* code, int target );
+  bool is_pure() { return true; }
 };
 
 struct JogCmdLiteralChar : JogCmd
@@ -1932,6 +3173,9 @@ struct JogCmdLiteralChar : JogCmd
   void on_push( JogVM* vm );
 
   void execute( JogVM* vm );
+  void compile( JogCodeBuilder* code );
+  int  compile_register( JogCodeBuilder* code, int target );
+  bool is_pure() { return true; }
 };
 
 struct JogCmdLiteralBoolean : JogCmd
@@ -1956,6 +3200,9 @@ struct JogCmdLiteralBoolean : JogCmd
   void on_push( JogVM* vm );
 
   void execute( JogVM* vm );
+  void compile( JogCodeBuilder* code );
+  int  compile_register( JogCodeBuilder* code, int target );
+  bool is_pure() { return true; }
 };
 
 struct JogCmdLiteralString : JogCmd
@@ -1963,9 +3210,10 @@ struct JogCmdLiteralString : JogCmd
   int node_type() { return __LINE__; }
 
   Ref<JogString> value;
-  JogRef         runtime_object;
+  JogObject*     runtime_object;  // interned
 
-  JogCmdLiteralString( Ref<JogToken> t, Ref<JogString> value ) : JogCmd(t), value(value) { }
+  JogCmdLiteralString( Ref<JogToken> t, Ref<JogString> value ) 
+    : JogCmd(t), value(value), runtime_object(NULL) { }
 
   JogTypeInfo* type() { return jog_type_manager.type_string; }
 
@@ -1978,6 +3226,10 @@ struct JogCmdLiteralString : JogCmd
 
   void on_push( JogVM* vm );
   void execute( JogVM* vm );
+  void compile( JogCodeBuilder* code );
+
+  int  fusion_shape() { return JOG_SHAPE_LITERAL_STRING; }
+  Ref<JogCmd> inline_copy( JogInliner* inliner ) { return this; }
 };
 
 struct JogCmdArgs : JogCmdList
@@ -2048,6 +3300,10 @@ struct JogCmdAssert : JogCmd
   void on_push( JogVM* vm );
 
   void execute( JogVM* vm );
+  void compile( JogCodeBuilder* code );
+
+  void visit_operands( JogCmdVisitor* visitor );
+  Ref<JogCmd> inline_copy( JogInliner* inliner );
 };
 
 
@@ -2079,9 +3335,17 @@ struct JogCmdBlock : JogCmd
 
   Ref<JogCmd> resolve();
 
+  bool is_block() { return true; }
+  bool pushes_operands_in_turn() { return true; }
+
   void on_push( JogVM* vm );
 
   void execute( JogVM* vm );
+  void compile( JogCodeBuilder* code );
+
+  void visit_operands( JogCmdVisitor* visitor );
+  Ref<JogCmd> fold( JogConstantFolder* folder );
+  Ref<JogCmd> inline_copy( JogInliner* inliner );
 };
 
 struct JogCmdControlStructure : JogCmd
@@ -2100,6 +3364,8 @@ struct JogCmdControlStructure : JogCmd
   {
     body->print();
   }
+
+  void visit_operands( JogCmdVisitor* visitor );
 };
 
 
@@ -2133,6 +3399,16 @@ struct JogCmdIf : JogCmdControlStructure
   void on_push( JogVM* vm  );
 
   void execute( JogVM* vm );
+  void compile( JogCodeBuilder* code );
+
+  JogCmd* jump_condition() 
+  { 
+    return (*body && !*else_body && body->is_jump()) ? *expression : NULL; 
+  }
+
+  void visit_operands( JogCmdVisitor* visitor );
+  Ref<JogCmd> fold( JogConstantFolder* folder );
+  Ref<JogCmd> inline_copy( JogInliner* inliner );
 };
 
 struct JogCmdLoop : JogCmdControlStructure
@@ -2173,6 +3449,11 @@ struct JogCmdWhile : JogCmdLoop
   void execute( JogVM* vm );
 
   void on_continue( JogVM* vm );
+  void compile( JogCodeBuilder* code );
+
+  void visit_operands( JogCmdVisitor* visitor );
+  Ref<JogCmd> fold( JogConstantFolder* folder );
+  Ref<JogCmd> inline_copy( JogInliner* inliner );
 };
 
 struct JogCmdFor : JogCmdLoop
@@ -2203,10 +3484,86 @@ struct JogCmdFor : JogCmdLoop
   }
 
   Ref<JogCmd> resolve();
+  Ref<JogCmd> resolve_counted_loop();
+
+  void on_push( JogVM* vm );
+
+  void execute( JogVM* vm );
+  void compile( JogCodeBuilder* code );
+
+  void visit_operands( JogCmdVisitor* visitor );
+  Ref<JogCmd> inline_copy( JogInliner* inliner );
+};
+
+struct JogCmdCountedLoop : JogCmdLoop
+{
+  // for (init; i < limit; ++i) where 'i' is an int local that the body
+  // doesn't write and 'limit' is an int literal, an int local or the
+  // length of an array local.  The counter is stepped and tested natively.
+  int node_type() { return __LINE__; }
+
+  Ref<JogCmd>      initialization;
+  JogLocalVarInfo* var_info;
+  Ref<JogCmd>      limit;
+  JogLocalVarInfo* limit_info;  // NULL for a literal limit
+  int              limit_value;
+  bool             limit_is_length;
+  bool             inclusive;   // i <= limit
+
+  JogCmdCountedLoop( Ref<JogToken> t, Ref<JogCmd> initialization, 
+      JogLocalVarInfo* var_info, Ref<JogCmd> limit, bool inclusive ) 
+    : JogCmdLoop(t), initialization(initialization), var_info(var_info), limit(limit),
+      limit_info(NULL), limit_value(0), limit_is_length(false), inclusive(inclusive)
+  {
+  }
+
+  void print()
+  {
+    printf("for (");
+    if (*initialization) initialization->print();
+    printf(";");
+    var_info->name->print();
+    printf( inclusive ? "<=" : "<" );
+    limit->print();
+    printf(";++");
+    var_info->name->print();
+    printf(")\n");
+    JogCmdControlStructure::print();
+  }
+
+  bool in_range( JogVM* vm )
+  {
+    JogInt64 counter = vm->frame_ptr->data_stack_ptr[var_info->offset];
+    JogInt64 limit_count = limit_value;
+    if (limit_info)
+    {
+      if (limit_is_length) 
+      {
+        limit_count = vm->frame_ptr->ref_stack_ptr[limit_info->offset].null_check(limit->t)->count;
+      }
+      else
+      {
+        limit_count = vm->frame_ptr->data_stack_ptr[limit_info->offset];
+      }
+    }
+    return inclusive ? (counter <= limit_count) : (counter < limit_count);
+  }
+
+  void step( JogVM* vm )
+  {
+    JogInt64& counter = vm->frame_ptr->data_stack_ptr[var_info->offset];
+    counter = (JogInt32)(counter + 1);
+  }
+
+  JogLocalVarInfo* written_local() { return var_info; }
 
   void on_push( JogVM* vm );
 
   void execute( JogVM* vm );
+  void compile( JogCodeBuilder* code );
+
+  void visit_operands( JogCmdVisitor* visitor );
+  Ref<JogCmd> fold( JogConstantFolder* folder );
 };
 
 struct JogCmdForEach : JogCmdLoop
@@ -2256,9 +3613,13 @@ struct JogCmdBreak : JogCmd
 
   Ref<JogCmd> resolve() { return this; }
 
+  bool is_jump() { return true; }
+
   void on_push( JogVM* vm ) { }
 
   void execute( JogVM* vm );
+  void compile( JogCodeBuilder* code );
+  Ref<JogCmd> inline_copy( JogInliner* inliner );
 };
 
 struct JogCmdContinue : JogCmd
@@ -2278,9 +3639,13 @@ struct JogCmdContinue : JogCmd
 
   Ref<JogCmd> resolve() { return this; }
 
+  bool is_jump() { return true; }
+
   void on_push( JogVM* vm ) { }
 
   void execute( JogVM* vm );
+  void compile( JogCodeBuilder* code );
+  Ref<JogCmd> inline_copy( JogInliner* inliner );
 };
 
 struct JogCmdUnary : JogCmd
@@ -2297,6 +3662,9 @@ struct JogCmdUnary : JogCmd
   JogTypeInfo* type() { return operand->type(); }
 
   void on_push( JogVM* vm );
+  void compile( JogCodeBuilder* code );
+
+  void visit_operands( JogCmdVisitor* visitor );
 };
 
 struct JogCmdCast : JogCmdUnary
@@ -2616,6 +3984,10 @@ struct JogCmdConditional : JogCmd
 
   void on_push( JogVM* vm );
   void execute( JogVM* vm );
+  void compile( JogCodeBuilder* code );
+
+  void visit_operands( JogCmdVisitor* visitor );
+  Ref<JogCmd> fold( JogConstantFolder* folder );
 };
 
 struct JogCmdBinary : JogCmd
@@ -2634,7 +4006,15 @@ struct JogCmdBinary : JogCmd
   void        validate();
 
   void on_push( JogVM* vm );
+  void compile( JogCodeBuilder* code );
 
+  virtual int register_opcode() { return 0; }
+  bool is_pure();
+  int  compile_register( JogCodeBuilder* code, int target );
+
+  void visit_operands( JogCmdVisitor* visitor );
+  JogCmd* fusion_operand( int index ) { return index ? *rhs : *lhs; }
+  Ref<JogCmd> fold( JogConstantFolder* folder );
 };
 
 struct JogCmdLogicalOp : JogCmdBinary
@@ -2666,6 +4046,8 @@ struct JogCmdLogicalOr : JogCmdLogicalOp
   Ref<JogCmd> resolve();
 
   void execute( JogVM* vm );
+  Ref<JogCmd> fold( JogConstantFolder* folder );
+  Ref<JogCmd> inline_copy( JogInliner* inliner );
 };
 
 struct JogCmdLogicalAnd : JogCmdLogicalOp
@@ -2690,6 +4072,8 @@ struct JogCmdLogicalAnd : JogCmdLogicalOp
   Ref<JogCmd> resolve();
 
   void execute( JogVM* vm );
+  Ref<JogCmd> fold( JogConstantFolder* folder );
+  Ref<JogCmd> inline_copy( JogInliner* inliner );
 };
 
 struct JogCmdBitwiseOr : JogCmdBinary
@@ -2872,6 +4256,8 @@ struct JogCmdInstanceOf : JogCmd
     printf(" instanceof ");
     of_type->print();
   }
+
+  void visit_operands( JogCmdVisitor* visitor );
 };
 
 struct JogCmdShift : JogCmd
@@ -2891,6 +4277,10 @@ struct JogCmdShift : JogCmd
   JogTypeInfo* type() { return operand->type(); }
 
   void on_push( JogVM* vm );
+  void compile( JogCodeBuilder* code );
+
+  void visit_operands( JogCmdVisitor* visitor );
+  Ref<JogCmd> fold( JogConstantFolder* folder );
 };
 
 struct JogCmdLeftShift : JogCmdShift
@@ -2966,6 +4356,45 @@ struct JogCmdAdd : JogCmdBinary
   Ref<JogCmd> resolve();
 };
 
+// A chain of String '+' operands, evaluated left to right and joined with a
+// single allocation.
+struct JogCmdConcatN : JogCmd
+{
+  int node_type() { return __LINE__; }
+
+  RefList<JogCmd> operands;  // all Strings
+
+  JogCmdConcatN( Ref<JogToken> t ) : JogCmd(t) { }
+
+  JogTypeInfo* type() { return jog_type_manager.type_string; }
+  bool calls_or_allocates() { return true; }
+
+  void print()
+  {
+    for (int i=0; i<operands.count; ++i)
+    {
+      if (i > 0) printf("+");
+      operands[i]->print();
+    }
+  }
+
+  void add( Ref<JogCmd> operand );
+
+  void on_push( JogVM* vm );
+  void execute( JogVM* vm );
+  void compile( JogCodeBuilder* code );
+
+  // String '+=' nodes evaluate the pieces of their operand separately so
+  // that the whole update is joined at once.
+  static int  piece_count( JogCmd* operand );
+  static void push_pieces( JogVM* vm, JogCmd* operand );
+  static void compile_pieces( JogCodeBuilder* code, JogCmd* operand );
+
+  void visit_operands( JogCmdVisitor* visitor );
+  int  fusion_shape() { return JOG_SHAPE_CONCAT; }
+  Ref<JogCmd> inline_copy( JogInliner* inliner );
+};
+
 struct JogCmdSub : JogCmdBinary
 {
   int node_type() { return __LINE__; }
@@ -3179,6 +4608,12 @@ struct JogCmdNewObject : JogCmd
   }
 
   JogTypeInfo* type() { return of_type; }
+  bool calls_or_allocates() { return true; }
+
+  // A copy of itself, then the init_object() call; three refs to the new
+  // object.
+  int  own_instruction_slots() { return 2; }
+  int  own_ref_slots() { return 3; }
 
   void print()
   {
@@ -3191,6 +4626,11 @@ struct JogCmdNewObject : JogCmd
 
   void on_push( JogVM* vm );
   void execute( JogVM* vm );
+  void compile( JogCodeBuilder* code );
+
+  void visit_operands( JogCmdVisitor* visitor );
+  int  fusion_shape() { return JOG_SHAPE_NEW_OBJECT; }
+  Ref<JogCmd> inline_copy( JogInliner* inliner );
 };
 
 struct JogCmdNewArray : JogCmd
@@ -3207,6 +4647,7 @@ struct JogCmdNewArray : JogCmd
   }
 
   JogTypeInfo* type() { return of_type; }
+  bool calls_or_allocates() { return true; }
 
   void print()
   {
@@ -3226,6 +4667,10 @@ struct JogCmdNewArray : JogCmd
 
   void on_push( JogVM* vm );
   void execute( JogVM* vm );
+  void compile( JogCodeBuilder* code );
+
+  void visit_operands( JogCmdVisitor* visitor );
+  Ref<JogCmd> inline_copy( JogInliner* inliner );
 };
 
 struct JogCmdLiteralArray : JogCmd
@@ -3240,6 +4685,8 @@ struct JogCmdLiteralArray : JogCmd
   }
 
   JogTypeInfo* type() { return of_type; }
+  bool calls_or_allocates() { return true; }
+  bool pushes_operands_in_turn() { return true; }
   
   void print()
   {
@@ -3255,6 +4702,8 @@ struct JogCmdLiteralArray : JogCmd
 
   void on_push( JogVM* vm );
   void execute( JogVM* vm );
+
+  void visit_operands( JogCmdVisitor* visitor );
 };
 
 template <typename DataType>
@@ -3375,6 +4824,8 @@ struct JogCmdNegate : JogCmdUnary
     printf("-");
     operand->print();
   }
+
+  Ref<JogCmd> fold( JogConstantFolder* folder );
 };
 
 struct JogCmdLogicalNot : JogCmdUnary
@@ -3395,6 +4846,8 @@ struct JogCmdLogicalNot : JogCmdUnary
   Ref<JogCmd> resolve();
 
   void execute( JogVM* vm );
+  Ref<JogCmd> fold( JogConstantFolder* folder );
+  Ref<JogCmd> inline_copy( JogInliner* inliner );
 };
 
 struct JogCmdBitwiseNot : JogCmdUnary
@@ -3415,6 +4868,8 @@ struct JogCmdBitwiseNot : JogCmdUnary
   Ref<JogCmd> resolve();
 
   void execute( JogVM* vm );
+  Ref<JogCmd> fold( JogConstantFolder* folder );
+  Ref<JogCmd> inline_copy( JogInliner* inliner );
 };
 
 struct JogCmdMemberAccess : JogCmd
@@ -3470,6 +4925,9 @@ struct JogCmdArrayAccess : JogCmd
   Ref<JogCmd> resolve_assignment( Ref<JogCmd> context, Ref<JogCmd> new_value );
   Ref<JogCmd> resolve_op_assign( int op_type, Ref<JogCmd> context, Ref<JogCmd> rhs );
   Ref<JogCmd> resolve_stepcount_access( int when, int modifier );
+
+  void visit_operands( JogCmdVisitor* visitor );
+  JogCmd* fusion_operand( int index ) { return index ? *index_expr : *context; }
 };
 
 struct JogCmdReturnVoid : JogCmd
@@ -3487,8 +4945,12 @@ struct JogCmdReturnVoid : JogCmd
     printf("return");
   }
 
+  bool is_jump() { return true; }
+
   void on_push( JogVM* vm );
   void execute( JogVM* vm );
+  void compile( JogCodeBuilder* code );
+  Ref<JogCmd> inline_copy( JogInliner* inliner );
 };
 
 struct JogCmdReturnValue : JogCmdUnary
@@ -3551,6 +5013,8 @@ struct JogCmdCastReal32ToReal64 : JogCmdUnary
   }
 
   void execute( JogVM* vm );
+  Ref<JogCmd> inline_copy( JogInliner* inliner );
+  Ref<JogCmd> fold( JogConstantFolder* folder );
 };
 
 
@@ -3572,6 +5036,8 @@ struct JogCmdCastIntegerToReal64 : JogCmdUnary
   }
 
   void execute( JogVM* vm );
+  Ref<JogCmd> inline_copy( JogInliner* inliner );
+  Ref<JogCmd> fold( JogConstantFolder* folder );
 };
 
 
@@ -3593,6 +5059,8 @@ struct JogCmdCastReal64ToReal32 : JogCmdUnary
   }
 
   void execute( JogVM* vm );
+  Ref<JogCmd> inline_copy( JogInliner* inliner );
+  Ref<JogCmd> fold( JogConstantFolder* folder );
 };
 
 struct JogCmdCastIntegerToReal32 : JogCmdUnary
@@ -3613,6 +5081,8 @@ struct JogCmdCastIntegerToReal32 : JogCmdUnary
   }
 
   void execute( JogVM* vm );
+  Ref<JogCmd> inline_copy( JogInliner* inliner );
+  Ref<JogCmd> fold( JogConstantFolder* folder );
 };
 
 struct JogCmdCastRealToInt64 : JogCmdUnary
@@ -3633,6 +5103,8 @@ struct JogCmdCastRealToInt64 : JogCmdUnary
   }
 
   void execute( JogVM* vm );
+  Ref<JogCmd> inline_copy( JogInliner* inliner );
+  Ref<JogCmd> fold( JogConstantFolder* folder );
 };
 
 struct JogCmdCastIntegerToInt64 : JogCmdUnary
@@ -3653,6 +5125,8 @@ struct JogCmdCastIntegerToInt64 : JogCmdUnary
   }
 
   void execute( JogVM* vm );
+  Ref<JogCmd> inline_copy( JogInliner* inliner );
+  Ref<JogCmd> fold( JogConstantFolder* folder );
 };
 
 
@@ -3674,6 +5148,8 @@ struct JogCmdCastRealToInt32 : JogCmdUnary
   }
 
   void execute( JogVM* vm );
+  Ref<JogCmd> inline_copy( JogInliner* inliner );
+  Ref<JogCmd> fold( JogConstantFolder* folder );
 };
 
 struct JogCmdCastIntegerToInt32 : JogCmdUnary
@@ -3694,6 +5170,8 @@ struct JogCmdCastIntegerToInt32 : JogCmdUnary
   }
 
   void execute( JogVM* vm );
+  Ref<JogCmd> inline_copy( JogInliner* inliner );
+  Ref<JogCmd> fold( JogConstantFolder* folder );
 };
 
 struct JogCmdCastIntegerToInt16 : JogCmdUnary
@@ -3714,6 +5192,8 @@ struct JogCmdCastIntegerToInt16 : JogCmdUnary
   }
 
   void execute( JogVM* vm );
+  Ref<JogCmd> inline_copy( JogInliner* inliner );
+  Ref<JogCmd> fold( JogConstantFolder* folder );
 };
 
 struct JogCmdCastIntegerToInt8 : JogCmdUnary
@@ -3734,6 +5214,8 @@ struct JogCmdCastIntegerToInt8 : JogCmdUnary
   }
 
   void execute( JogVM* vm );
+  Ref<JogCmd> inline_copy( JogInliner* inliner );
+  Ref<JogCmd> fold( JogConstantFolder* folder );
 };
 
 struct JogCmdCastIntegerToChar : JogCmdUnary
@@ -3754,6 +5236,8 @@ struct JogCmdCastIntegerToChar : JogCmdUnary
   }
 
   void execute( JogVM* vm );
+  Ref<JogCmd> inline_copy( JogInliner* inliner );
+  Ref<JogCmd> fold( JogConstantFolder* folder );
 };
 
 struct JogCmdWideningCast : JogCmdUnary
@@ -3819,6 +5303,9 @@ struct JogCmdAddReal64 : JogCmdAdd
   Ref<JogCmd> resolve() { return this; }
 
   void execute( JogVM* vm );
+  void compile( JogCodeBuilder* code );
+  int  register_opcode() { return JOG_OP_ADD_REAL64_R; }
+  Ref<JogCmd> inline_copy( JogInliner* inliner );
 };
 
 struct JogCmdAddReal32 : JogCmdAdd
@@ -3833,6 +5320,7 @@ struct JogCmdAddReal32 : JogCmdAdd
   Ref<JogCmd> resolve() { return this; }
 
   void execute( JogVM* vm );
+  Ref<JogCmd> inline_copy( JogInliner* inliner );
 };
 
 struct JogCmdAddInt64 : JogCmdAdd
@@ -3847,6 +5335,9 @@ struct JogCmdAddInt64 : JogCmdAdd
   Ref<JogCmd> resolve() { return this; }
 
   void execute( JogVM* vm );
+  void compile( JogCodeBuilder* code );
+  int  register_opcode() { return JOG_OP_ADD_INT64_R; }
+  Ref<JogCmd> inline_copy( JogInliner* inliner );
 };
 
 struct JogCmdAddInt32 : JogCmdAdd
@@ -3861,6 +5352,9 @@ struct JogCmdAddInt32 : JogCmdAdd
   Ref<JogCmd> resolve() { return this; }
 
   void execute( JogVM* vm );
+  void compile( JogCodeBuilder* code );
+  int  register_opcode() { return JOG_OP_ADD_INT32_R; }
+  Ref<JogCmd> inline_copy( JogInliner* inliner );
 };
 
 
@@ -3879,6 +5373,9 @@ struct JogCmdSubReal64 : JogCmdSub
   Ref<JogCmd> resolve() { return this; }
 
   void execute( JogVM* vm );
+  void compile( JogCodeBuilder* code );
+  int  register_opcode() { return JOG_OP_SUB_REAL64_R; }
+  Ref<JogCmd> inline_copy( JogInliner* inliner );
 };
 
 struct JogCmdSubReal32 : JogCmdSub
@@ -3893,6 +5390,7 @@ struct JogCmdSubReal32 : JogCmdSub
   Ref<JogCmd> resolve() { return this; }
 
   void execute( JogVM* vm );
+  Ref<JogCmd> inline_copy( JogInliner* inliner );
 };
 
 struct JogCmdSubInt64 : JogCmdSub
@@ -3907,6 +5405,9 @@ struct JogCmdSubInt64 : JogCmdSub
   Ref<JogCmd> resolve() { return this; }
 
   void execute( JogVM* vm );
+  void compile( JogCodeBuilder* code );
+  int  register_opcode() { return JOG_OP_SUB_INT64_R; }
+  Ref<JogCmd> inline_copy( JogInliner* inliner );
 };
 
 struct JogCmdSubInt32 : JogCmdSub
@@ -3921,6 +5422,9 @@ struct JogCmdSubInt32 : JogCmdSub
   Ref<JogCmd> resolve() { return this; }
 
   void execute( JogVM* vm );
+  void compile( JogCodeBuilder* code );
+  int  register_opcode() { return JOG_OP_SUB_INT32_R; }
+  Ref<JogCmd> inline_copy( JogInliner* inliner );
 };
 
 
@@ -3939,6 +5443,9 @@ struct JogCmdMulReal64 : JogCmdMul
   Ref<JogCmd> resolve() { return this; }
 
   void execute( JogVM* vm );
+  void compile( JogCodeBuilder* code );
+  int  register_opcode() { return JOG_OP_MUL_REAL64_R; }
+  Ref<JogCmd> inline_copy( JogInliner* inliner );
 };
 
 struct JogCmdMulReal32 : JogCmdMul
@@ -3953,6 +5460,7 @@ struct JogCmdMulReal32 : JogCmdMul
   Ref<JogCmd> resolve() { return this; }
 
   void execute( JogVM* vm );
+  Ref<JogCmd> inline_copy( JogInliner* inliner );
 };
 
 struct JogCmdMulInt64 : JogCmdMul
@@ -3967,6 +5475,9 @@ struct JogCmdMulInt64 : JogCmdMul
   Ref<JogCmd> resolve() { return this; }
 
   void execute( JogVM* vm );
+  void compile( JogCodeBuilder* code );
+  int  register_opcode() { return JOG_OP_MUL_INT64_R; }
+  Ref<JogCmd> inline_copy( JogInliner* inliner );
 };
 
 struct JogCmdMulInt32 : JogCmdMul
@@ -3981,6 +5492,9 @@ struct JogCmdMulInt32 : JogCmdMul
   Ref<JogCmd> resolve() { return this; }
 
   void execute( JogVM* vm );
+  void compile( JogCodeBuilder* code );
+  int  register_opcode() { return JOG_OP_MUL_INT32_R; }
+  Ref<JogCmd> inline_copy( JogInliner* inliner );
 };
 
 
@@ -3999,6 +5513,9 @@ struct JogCmdDivReal64 : JogCmdDiv
   Ref<JogCmd> resolve() { return this; }
 
   void execute( JogVM* vm );
+  void compile( JogCodeBuilder* code );
+  int  register_opcode() { return JOG_OP_DIV_REAL64_R; }
+  Ref<JogCmd> inline_copy( JogInliner* inliner );
 };
 
 struct JogCmdDivReal32 : JogCmdDiv
@@ -4013,6 +5530,7 @@ struct JogCmdDivReal32 : JogCmdDiv
   Ref<JogCmd> resolve() { return this; }
 
   void execute( JogVM* vm );
+  Ref<JogCmd> inline_copy( JogInliner* inliner );
 };
 
 struct JogCmdDivInt64 : JogCmdDiv
@@ -4027,6 +5545,7 @@ struct JogCmdDivInt64 : JogCmdDiv
   Ref<JogCmd> resolve() { return this; }
 
   void execute( JogVM* vm );
+  Ref<JogCmd> inline_copy( JogInliner* inliner );
 };
 
 struct JogCmdDivInt32 : JogCmdDiv
@@ -4041,6 +5560,8 @@ struct JogCmdDivInt32 : JogCmdDiv
   Ref<JogCmd> resolve() { return this; }
 
   void execute( JogVM* vm );
+  int  register_opcode() { return JOG_OP_DIV_INT32_R; }
+  Ref<JogCmd> inline_copy( JogInliner* inliner );
 };
 
 
@@ -4059,6 +5580,7 @@ struct JogCmdModInt64 : JogCmdMod
   Ref<JogCmd> resolve() { return this; }
 
   void execute( JogVM* vm );
+  Ref<JogCmd> inline_copy( JogInliner* inliner );
 };
 
 struct JogCmdModInt32 : JogCmdMod
@@ -4073,6 +5595,8 @@ struct JogCmdModInt32 : JogCmdMod
   Ref<JogCmd> resolve() { return this; }
 
   void execute( JogVM* vm );
+  int  register_opcode() { return JOG_OP_MOD_INT32_R; }
+  Ref<JogCmd> inline_copy( JogInliner* inliner );
 };
 
 //------------------------------------------------------------------------------
@@ -4090,6 +5614,7 @@ struct JogCmdAndInt64 : JogCmdBitwiseAnd
   Ref<JogCmd> resolve() { return this; }
 
   void execute( JogVM* vm );
+  Ref<JogCmd> inline_copy( JogInliner* inliner );
 };
 
 struct JogCmdAndInt32 : JogCmdBitwiseAnd
@@ -4104,6 +5629,7 @@ struct JogCmdAndInt32 : JogCmdBitwiseAnd
   Ref<JogCmd> resolve() { return this; }
 
   void execute( JogVM* vm );
+  Ref<JogCmd> inline_copy( JogInliner* inliner );
 };
 
 
@@ -4122,6 +5648,7 @@ struct JogCmdOrInt64 : JogCmdBitwiseOr
   Ref<JogCmd> resolve() { return this; }
 
   void execute( JogVM* vm );
+  Ref<JogCmd> inline_copy( JogInliner* inliner );
 };
 
 struct JogCmdOrInt32 : JogCmdBitwiseOr
@@ -4136,6 +5663,7 @@ struct JogCmdOrInt32 : JogCmdBitwiseOr
   Ref<JogCmd> resolve() { return this; }
 
   void execute( JogVM* vm );
+  Ref<JogCmd> inline_copy( JogInliner* inliner );
 };
 
 
@@ -4154,6 +5682,7 @@ struct JogCmdXorInt64 : JogCmdBitwiseXor
   Ref<JogCmd> resolve() { return this; }
 
   void execute( JogVM* vm );
+  Ref<JogCmd> inline_copy( JogInliner* inliner );
 };
 
 struct JogCmdXorInt32 : JogCmdBitwiseXor
@@ -4168,6 +5697,7 @@ struct JogCmdXorInt32 : JogCmdBitwiseXor
   Ref<JogCmd> resolve() { return this; }
 
   void execute( JogVM* vm );
+  Ref<JogCmd> inline_copy( JogInliner* inliner );
 };
 
 
@@ -4187,6 +5717,7 @@ struct JogCmdEQReal : JogCmdEQ
   Ref<JogCmd> resolve() { return this; }
 
   void execute( JogVM* vm );
+  Ref<JogCmd> inline_copy( JogInliner* inliner );
 };
 
 struct JogCmdEQInteger : JogCmdEQ
@@ -4201,6 +5732,9 @@ struct JogCmdEQInteger : JogCmdEQ
   Ref<JogCmd> resolve() { return this; }
 
   void execute( JogVM* vm );
+  void compile( JogCodeBuilder* code );
+  int  register_opcode() { return JOG_OP_EQ_INTEGER_R; }
+  Ref<JogCmd> inline_copy( JogInliner* inliner );
 };
 
 struct JogCmdEQRef : JogCmdEQ
@@ -4215,6 +5749,8 @@ struct JogCmdEQRef : JogCmdEQ
   Ref<JogCmd> resolve() { return this; }
 
   void execute( JogVM* vm );
+  void compile( JogCodeBuilder* code );
+  Ref<JogCmd> inline_copy( JogInliner* inliner );
 };
 
 
@@ -4233,6 +5769,7 @@ struct JogCmdNEReal : JogCmdNE
   Ref<JogCmd> resolve() { return this; }
 
   void execute( JogVM* vm );
+  Ref<JogCmd> inline_copy( JogInliner* inliner );
 };
 
 struct JogCmdNEInteger : JogCmdNE
@@ -4247,6 +5784,9 @@ struct JogCmdNEInteger : JogCmdNE
   Ref<JogCmd> resolve() { return this; }
 
   void execute( JogVM* vm );
+  void compile( JogCodeBuilder* code );
+  int  register_opcode() { return JOG_OP_NE_INTEGER_R; }
+  Ref<JogCmd> inline_copy( JogInliner* inliner );
 };
 
 struct JogCmdNERef : JogCmdNE
@@ -4261,6 +5801,8 @@ struct JogCmdNERef : JogCmdNE
   Ref<JogCmd> resolve() { return this; }
 
   void execute( JogVM* vm );
+  void compile( JogCodeBuilder* code );
+  Ref<JogCmd> inline_copy( JogInliner* inliner );
 };
 
 
@@ -4279,6 +5821,9 @@ struct JogCmdLTReal : JogCmdLT
   Ref<JogCmd> resolve() { return this; }
 
   void execute( JogVM* vm );
+  void compile( JogCodeBuilder* code );
+  int  register_opcode() { return JOG_OP_LT_REAL_R; }
+  Ref<JogCmd> inline_copy( JogInliner* inliner );
 };
 
 struct JogCmdLTInteger : JogCmdLT
@@ -4293,6 +5838,10 @@ struct JogCmdLTInteger : JogCmdLT
   Ref<JogCmd> resolve() { return this; }
 
   void execute( JogVM* vm );
+  void compile( JogCodeBuilder* code );
+  int  register_opcode() { return JOG_OP_LT_INTEGER_R; }
+  int  fusion_shape() { return JOG_SHAPE_LT_INTEGER; }
+  Ref<JogCmd> inline_copy( JogInliner* inliner );
 };
 
 
@@ -4311,6 +5860,9 @@ struct JogCmdLEReal : JogCmdLE
   Ref<JogCmd> resolve() { return this; }
 
   void execute( JogVM* vm );
+  void compile( JogCodeBuilder* code );
+  int  register_opcode() { return JOG_OP_LE_REAL_R; }
+  Ref<JogCmd> inline_copy( JogInliner* inliner );
 };
 
 struct JogCmdLEInteger : JogCmdLE
@@ -4325,6 +5877,10 @@ struct JogCmdLEInteger : JogCmdLE
   Ref<JogCmd> resolve() { return this; }
 
   void execute( JogVM* vm );
+  void compile( JogCodeBuilder* code );
+  int  register_opcode() { return JOG_OP_LE_INTEGER_R; }
+  int  fusion_shape() { return JOG_SHAPE_LE_INTEGER; }
+  Ref<JogCmd> inline_copy( JogInliner* inliner );
 };
 
 
@@ -4343,6 +5899,9 @@ struct JogCmdGTReal : JogCmdGT
   Ref<JogCmd> resolve() { return this; }
 
   void execute( JogVM* vm );
+  void compile( JogCodeBuilder* code );
+  int  register_opcode() { return JOG_OP_GT_REAL_R; }
+  Ref<JogCmd> inline_copy( JogInliner* inliner );
 };
 
 struct JogCmdGTInteger : JogCmdGT
@@ -4357,6 +5916,10 @@ struct JogCmdGTInteger : JogCmdGT
   Ref<JogCmd> resolve() { return this; }
 
   void execute( JogVM* vm );
+  void compile( JogCodeBuilder* code );
+  int  register_opcode() { return JOG_OP_GT_INTEGER_R; }
+  int  fusion_shape() { return JOG_SHAPE_GT_INTEGER; }
+  Ref<JogCmd> inline_copy( JogInliner* inliner );
 };
 
 
@@ -4375,6 +5938,9 @@ struct JogCmdGEReal : JogCmdGE
   Ref<JogCmd> resolve() { return this; }
 
   void execute( JogVM* vm );
+  void compile( JogCodeBuilder* code );
+  int  register_opcode() { return JOG_OP_GE_REAL_R; }
+  Ref<JogCmd> inline_copy( JogInliner* inliner );
 };
 
 struct JogCmdGEInteger : JogCmdGE
@@ -4389,6 +5955,10 @@ struct JogCmdGEInteger : JogCmdGE
   Ref<JogCmd> resolve() { return this; }
 
   void execute( JogVM* vm );
+  void compile( JogCodeBuilder* code );
+  int  register_opcode() { return JOG_OP_GE_INTEGER_R; }
+  int  fusion_shape() { return JOG_SHAPE_GE_INTEGER; }
+  Ref<JogCmd> inline_copy( JogInliner* inliner );
 };
 
 
@@ -4407,6 +5977,7 @@ struct JogCmdLeftShiftInt64 : JogCmdLeftShift
   Ref<JogCmd> resolve() { return this; }
 
   void execute( JogVM* vm );
+  Ref<JogCmd> inline_copy( JogInliner* inliner );
 };
 
 struct JogCmdLeftShiftInt32 : JogCmdLeftShift
@@ -4421,6 +5992,7 @@ struct JogCmdLeftShiftInt32 : JogCmdLeftShift
   Ref<JogCmd> resolve() { return this; }
 
   void execute( JogVM* vm );
+  Ref<JogCmd> inline_copy( JogInliner* inliner );
 };
 
 
@@ -4439,6 +6011,7 @@ struct JogCmdRightShiftInt64 : JogCmdRightShift
   Ref<JogCmd> resolve() { return this; }
 
   void execute( JogVM* vm );
+  Ref<JogCmd> inline_copy( JogInliner* inliner );
 };
 
 struct JogCmdRightShiftInt32 : JogCmdRightShift
@@ -4453,6 +6026,7 @@ struct JogCmdRightShiftInt32 : JogCmdRightShift
   Ref<JogCmd> resolve() { return this; }
 
   void execute( JogVM* vm );
+  Ref<JogCmd> inline_copy( JogInliner* inliner );
 };
 
 
@@ -4471,6 +6045,7 @@ struct JogCmdRightXShiftInt64 : JogCmdRightXShift
   Ref<JogCmd> resolve() { return this; }
 
   void execute( JogVM* vm );
+  Ref<JogCmd> inline_copy( JogInliner* inliner );
 };
 
 struct JogCmdRightXShiftInt32 : JogCmdRightXShift
@@ -4485,6 +6060,7 @@ struct JogCmdRightXShiftInt32 : JogCmdRightXShift
   Ref<JogCmd> resolve() { return this; }
 
   void execute( JogVM* vm );
+  Ref<JogCmd> inline_copy( JogInliner* inliner );
 };
 
 
@@ -4503,6 +6079,7 @@ struct JogCmdNegateReal64 : JogCmdNegate
   Ref<JogCmd> resolve() { return this; }
 
   void execute( JogVM* vm );
+  Ref<JogCmd> inline_copy( JogInliner* inliner );
 };
 
 struct JogCmdNegateReal32 : JogCmdNegate
@@ -4517,6 +6094,7 @@ struct JogCmdNegateReal32 : JogCmdNegate
   Ref<JogCmd> resolve() { return this; }
 
   void execute( JogVM* vm );
+  Ref<JogCmd> inline_copy( JogInliner* inliner );
 };
 
 struct JogCmdNegateInt64 : JogCmdNegate
@@ -4531,6 +6109,7 @@ struct JogCmdNegateInt64 : JogCmdNegate
   Ref<JogCmd> resolve() { return this; }
 
   void execute( JogVM* vm );
+  Ref<JogCmd> inline_copy( JogInliner* inliner );
 };
 
 struct JogCmdNegateInt32 : JogCmdNegate
@@ -4545,6 +6124,7 @@ struct JogCmdNegateInt32 : JogCmdNegate
   Ref<JogCmd> resolve() { return this; }
 
   void execute( JogVM* vm );
+  Ref<JogCmd> inline_copy( JogInliner* inliner );
 };
 
 struct JogCmdNegateInt16 : JogCmdNegate
@@ -4559,6 +6139,7 @@ struct JogCmdNegateInt16 : JogCmdNegate
   Ref<JogCmd> resolve() { return this; }
 
   void execute( JogVM* vm );
+  Ref<JogCmd> inline_copy( JogInliner* inliner );
 };
 
 struct JogCmdNegateInt8 : JogCmdNegate
@@ -4573,6 +6154,7 @@ struct JogCmdNegateInt8 : JogCmdNegate
   Ref<JogCmd> resolve() { return this; }
 
   void execute( JogVM* vm );
+  Ref<JogCmd> inline_copy( JogInliner* inliner );
 };
 
 struct JogCmdNegateChar : JogCmdNegate
@@ -4587,6 +6169,7 @@ struct JogCmdNegateChar : JogCmdNegate
   Ref<JogCmd> resolve() { return this; }
 
   void execute( JogVM* vm );
+  Ref<JogCmd> inline_copy( JogInliner* inliner );
 };
 
 
@@ -4606,6 +6189,7 @@ struct JogCmdThis : JogCmd
   JogCmdThis( Ref<JogToken> t, JogTypeInfo* this_type );
 
   JogTypeInfo* type() { return this_type; }
+  bool is_this() { return true; }
 
   void print()
   {
@@ -4615,6 +6199,8 @@ struct JogCmdThis : JogCmd
   void on_push( JogVM* vm );
 
   void execute( JogVM* vm );
+  void compile( JogCodeBuilder* code );
+  Ref<JogCmd> inline_copy( JogInliner* inliner );
 };
 
 struct JogCmdNullRef : JogCmd
@@ -4644,6 +6230,7 @@ struct JogCmdNullRef : JogCmd
   void on_push( JogVM* vm );
 
   void execute( JogVM* vm );
+  void compile( JogCodeBuilder* code );
 };
 
 struct JogCmdObjectRef : JogCmd
@@ -4666,6 +6253,7 @@ struct JogCmdObjectRef : JogCmd
   void on_push( JogVM* vm );
 
   void execute( JogVM* vm );
+  void compile( JogCodeBuilder* code );
 };
 
 struct JogCmdCallInitObject : JogCmd
@@ -4680,6 +6268,7 @@ struct JogCmdCallInitObject : JogCmd
   }
 
   JogTypeInfo* type() { return NULL; }
+  bool calls_or_allocates() { return true; }
 
   void print()
   {
@@ -4690,6 +6279,7 @@ struct JogCmdCallInitObject : JogCmd
   void on_push( JogVM* vm );
 
   void execute( JogVM* vm );
+  void compile( JogCodeBuilder* code );
 };
 
 
@@ -4709,6 +6299,7 @@ struct JogCmdStaticCall : JogCmd
   }
 
   JogTypeInfo* type() { return method_info->return_type; }
+  bool calls_or_allocates() { return true; }
 
   void print()
   {
@@ -4725,6 +6316,11 @@ struct JogCmdStaticCall : JogCmd
   void on_push( JogVM* vm );
 
   void execute( JogVM* vm );
+  void compile( JogCodeBuilder* code );
+
+  void visit_operands( JogCmdVisitor* visitor );
+  JogMethodInfo* bound_method() { return method_info->is_static() ? NULL : method_info; }
+  Ref<JogCmd> inline_copy( JogInliner* inliner );
 };
 
 
@@ -4738,7 +6334,12 @@ struct JogCmdDynamicCall : JogCmdStaticCall
   {
   }
 
+  bool is_dynamic_call() { return true; }
+  JogMethodInfo* bound_method() { return NULL; }
+
   void execute( JogVM* vm );
+  void compile( JogCodeBuilder* code );
+  Ref<JogCmd> inline_copy( JogInliner* inliner );
 };
 
 struct JogCmdClassCall : JogCmd
@@ -4757,6 +6358,7 @@ struct JogCmdClassCall : JogCmd
   }
 
   JogTypeInfo* type() { return method_info->return_type; }
+  bool calls_or_allocates() { return true; }
 
   void print()
   {
@@ -4768,6 +6370,12 @@ struct JogCmdClassCall : JogCmd
   void on_push( JogVM* vm );
 
   void execute( JogVM* vm );
+  void compile( JogCodeBuilder* code );
+
+  void visit_operands( JogCmdVisitor* visitor );
+  JogMethodInfo* bound_method() { return method_info->is_static() ? method_info : NULL; }
+  Ref<JogCmd> inline_copy( JogInliner* inliner );
+  Ref<JogCmd> fold( JogConstantFolder* folder );
 };
 
 struct JogCmdReturnData : JogCmdUnary
@@ -4786,9 +6394,13 @@ struct JogCmdReturnData : JogCmdUnary
     operand->print();
   }
 
+  bool is_jump() { return true; }
+
   void on_push( JogVM* vm );
 
   void execute( JogVM* vm );
+  void compile( JogCodeBuilder* code );
+  Ref<JogCmd> inline_copy( JogInliner* inliner );
 };
 
 struct JogCmdReturnRef : JogCmdUnary
@@ -4807,9 +6419,13 @@ struct JogCmdReturnRef : JogCmdUnary
     operand->print();
   }
 
+  bool is_jump() { return true; }
+
   void on_push( JogVM* vm );
 
   void execute( JogVM* vm );
+  void compile( JogCodeBuilder* code );
+  Ref<JogCmd> inline_copy( JogInliner* inliner );
 };
 
 
@@ -4836,6 +6452,11 @@ struct JogCmdDiscardDataResult : JogCmdUnary
   }
 
   void execute( JogVM* vm );
+  void compile( JogCodeBuilder* code );
+  int  fusion_shape() { return JOG_SHAPE_DISCARD_DATA; }
+  JogCmd* fusion_operand( int index ) { return index ? NULL : *operand; }
+  Ref<JogCmd> inline_copy( JogInliner* inliner );
+  Ref<JogCmd> fold( JogConstantFolder* folder );
 };
 
 struct JogCmdDiscardRefResult : JogCmdUnary
@@ -4861,6 +6482,11 @@ struct JogCmdDiscardRefResult : JogCmdUnary
   }
 
   void execute( JogVM* vm );
+  void compile( JogCodeBuilder* code );
+  int  fusion_shape() { return JOG_SHAPE_DISCARD_REF; }
+  JogCmd* fusion_operand( int index ) { return index ? NULL : *operand; }
+  Ref<JogCmd> inline_copy( JogInliner* inliner );
+  JogCmd* accessed_object() { return *operand; }  // discarding an object doesn't use it
 };
 
 //=============================================================================
@@ -4890,6 +6516,9 @@ struct JogCmdReadClassProperty : JogCmd
   }
 
   void on_push( JogVM* vm );
+  void compile( JogCodeBuilder* code );
+
+  void visit_operands( JogCmdVisitor* visitor );
 };
 
 struct JogCmdReadClassPropertyData : JogCmdReadClassProperty
@@ -4903,6 +6532,7 @@ struct JogCmdReadClassPropertyData : JogCmdReadClassProperty
   }
 
   void execute( JogVM* vm );
+  Ref<JogCmd> fold( JogConstantFolder* folder );
 };
 
 struct JogCmdReadClassPropertyRef : JogCmdReadClassProperty
@@ -4965,6 +6595,10 @@ struct JogCmdWriteClassProperty : JogCmd
   }
 
   void on_push( JogVM* vm );
+  void compile( JogCodeBuilder* code );
+
+  void visit_operands( JogCmdVisitor* visitor );
+  JogPropertyInfo* written_class_property() { return var_info; }
 };
 
 struct JogCmdWriteClassPropertyData : JogCmdWriteClassProperty
@@ -4979,6 +6613,7 @@ struct JogCmdWriteClassPropertyData : JogCmdWriteClassProperty
   }
 
   void execute( JogVM* vm );
+  Ref<JogCmd> fold( JogConstantFolder* folder );
 };
 
 struct JogCmdWriteClassPropertyRef : JogCmdWriteClassProperty
@@ -5022,6 +6657,13 @@ struct JogCmdReadProperty : JogCmd
   }
 
   void on_push( JogVM* vm );
+  void compile( JogCodeBuilder* code );
+
+  void visit_operands( JogCmdVisitor* visitor );
+  int  fusion_shape() { return JOG_SHAPE_READ_PROPERTY; }
+  JogCmd* fusion_operand( int index ) { return index ? NULL : *context; }
+  JogCmd* accessed_object() { return *context; }
+  Ref<JogCmd> localize( ArrayList<JogLocalVarInfo*>* property_locals );
 };
 
 struct JogCmdReadPropertyData : JogCmdReadProperty
@@ -5034,6 +6676,8 @@ struct JogCmdReadPropertyData : JogCmdReadProperty
   }
 
   void execute( JogVM* vm );
+  void compile( JogCodeBuilder* code );
+  Ref<JogCmd> inline_copy( JogInliner* inliner );
 };
 
 struct JogCmdReadPropertyRef : JogCmdReadProperty
@@ -5046,6 +6690,8 @@ struct JogCmdReadPropertyRef : JogCmdReadProperty
   }
 
   void execute( JogVM* vm );
+  void compile( JogCodeBuilder* code );
+  Ref<JogCmd> inline_copy( JogInliner* inliner );
 };
 
 
@@ -5077,6 +6723,13 @@ struct JogCmdWriteProperty : JogCmd
   }
 
   void on_push( JogVM* vm );
+  void compile( JogCodeBuilder* code );
+
+  void visit_operands( JogCmdVisitor* visitor );
+  int  fusion_shape() { return JOG_SHAPE_WRITE_PROPERTY; }
+  JogCmd* fusion_operand( int index ) { return index ? *new_value : *context; }
+  JogCmd* accessed_object() { return *context; }
+  Ref<JogCmd> localize( ArrayList<JogLocalVarInfo*>* property_locals );
 };
 
 struct JogCmdWritePropertyData : JogCmdWriteProperty
@@ -5090,6 +6743,7 @@ struct JogCmdWritePropertyData : JogCmdWriteProperty
   }
 
   void execute( JogVM* vm );
+  Ref<JogCmd> inline_copy( JogInliner* inliner );
 };
 
 struct JogCmdWritePropertyRef : JogCmdWriteProperty
@@ -5103,6 +6757,7 @@ struct JogCmdWritePropertyRef : JogCmdWriteProperty
   }
 
   void execute( JogVM* vm );
+  Ref<JogCmd> inline_copy( JogInliner* inliner );
 };
 
 
@@ -5131,6 +6786,7 @@ struct JogCmdReadLocal : JogCmd
   }
 
   void on_push( JogVM* vm );
+  JogLocalVarInfo* read_local() { return var_info; }
 };
 
 struct JogCmdReadLocalData : JogCmdReadLocal
@@ -5143,6 +6799,16 @@ struct JogCmdReadLocalData : JogCmdReadLocal
   }
 
   void execute( JogVM* vm );
+  void compile( JogCodeBuilder* code );
+  int  compile_register( JogCodeBuilder* code, int target );
+  bool is_pure() { return true; }
+  int  fusion_shape()
+  {
+    if (var_info->type == jog_type_manager.type_int32) return JOG_SHAPE_LOCAL_INT32;
+    return JOG_SHAPE_NONE;
+  }
+  Ref<JogCmd> inline_copy( JogInliner* inliner );
+  Ref<JogCmd> fold( JogConstantFolder* folder );
 };
 
 struct JogCmdReadLocalRef : JogCmdReadLocal
@@ -5155,6 +6821,9 @@ struct JogCmdReadLocalRef : JogCmdReadLocal
   }
 
   void execute( JogVM* vm );
+  void compile( JogCodeBuilder* code );
+  int  fusion_shape() { return JOG_SHAPE_LOCAL_REF; }
+  Ref<JogCmd> inline_copy( JogInliner* inliner );
 };
 
 
@@ -5184,6 +6853,9 @@ struct JogCmdWriteLocal : JogCmd
   }
 
   void on_push( JogVM* vm );
+
+  void visit_operands( JogCmdVisitor* visitor );
+  JogLocalVarInfo* written_local() { return var_info; }
 };
 
 struct JogCmdWriteLocalData : JogCmdWriteLocal
@@ -5196,6 +6868,10 @@ struct JogCmdWriteLocalData : JogCmdWriteLocal
   }
 
   void execute( JogVM* vm );
+  void compile( JogCodeBuilder* code );
+  int  compile_register( JogCodeBuilder* code, int target );
+  Ref<JogCmd> inline_copy( JogInliner* inliner );
+  Ref<JogCmd> fold( JogConstantFolder* folder );
 };
 
 struct JogCmdWriteLocalRef : JogCmdWriteLocal
@@ -5208,6 +6884,10 @@ struct JogCmdWriteLocalRef : JogCmdWriteLocal
   }
 
   void execute( JogVM* vm );
+  void compile( JogCodeBuilder* code );
+  int  fusion_shape() { return JOG_SHAPE_WRITE_LOCAL_REF; }
+  JogCmd* fusion_operand( int index ) { return index ? NULL : *new_value; }
+  Ref<JogCmd> inline_copy( JogInliner* inliner );
 };
 
 //====================================================================
@@ -5222,6 +6902,8 @@ struct JogCmdOpAssignLocal : JogCmd
 
   JogCmdOpAssignLocal() : JogCmd(NULL) { }
 
+  virtual JogCmdOpAssignLocal* create() = 0;  // an uninitialized node of the same kind
+
   Ref<JogCmd> init( Ref<JogToken> t, JogLocalVarInfo* var_info, Ref<JogCmd> operand )
   {
     this->t = t;
@@ -5236,6 +6918,13 @@ struct JogCmdOpAssignLocal : JogCmd
   {
     vm->push( *operand );
   }
+
+  void compile( JogCodeBuilder* code );
+
+  void visit_operands( JogCmdVisitor* visitor );
+  JogCmd* fusion_operand( int index ) { return index ? NULL : *operand; }
+  JogLocalVarInfo* written_local() { return var_info; }
+  Ref<JogCmd> inline_copy( JogInliner* inliner );
 };
 
 template <typename DataType>
@@ -5243,6 +6932,8 @@ struct JogCmdAddAssignLocalReal : JogCmdOpAssignLocal
 {
   int node_type() { return __LINE__; }
 
+  JogCmdOpAssignLocal* create() { return new JogCmdAddAssignLocalReal<DataType>(); }
+
   void print()
   {
     var_info->name->print();
@@ -5263,6 +6954,8 @@ struct JogCmdAddAssignLocalInteger : JogCmdOpAssignLocal
 {
   int node_type() { return __LINE__; }
 
+  JogCmdOpAssignLocal* create() { return new JogCmdAddAssignLocalInteger<DataType>(); }
+
   void print()
   {
     var_info->name->print();
@@ -5276,6 +6969,12 @@ struct JogCmdAddAssignLocalInteger : JogCmdOpAssignLocal
     local = (DataType)(local + vm->pop_data());
     vm->push( local );
   }
+
+  int fusion_shape()
+  {
+    if (sizeof(DataType) == sizeof(JogInt32)) return JOG_SHAPE_ADD_ASSIGN_LOCAL_INT32;
+    return JOG_SHAPE_NONE;
+  }
 };
 
 template <typename DataType>
@@ -5283,6 +6982,8 @@ struct JogCmdSubAssignLocalReal : JogCmdOpAssignLocal
 {
   int node_type() { return __LINE__; }
 
+  JogCmdOpAssignLocal* create() { return new JogCmdSubAssignLocalReal<DataType>(); }
+
   void print()
   {
     var_info->name->print();
@@ -5303,6 +7004,8 @@ struct JogCmdSubAssignLocalInteger : JogCmdOpAssignLocal
 {
   int node_type() { return __LINE__; }
 
+  JogCmdOpAssignLocal* create() { return new JogCmdSubAssignLocalInteger<DataType>(); }
+
   void print()
   {
     var_info->name->print();
@@ -5316,6 +7019,12 @@ struct JogCmdSubAssignLocalInteger : JogCmdOpAssignLocal
     local = (DataType)(local - vm->pop_data());
     vm->push( local );
   }
+
+  int fusion_shape()
+  {
+    if (sizeof(DataType) == sizeof(JogInt32)) return JOG_SHAPE_SUB_ASSIGN_LOCAL_INT32;
+    return JOG_SHAPE_NONE;
+  }
 };
 
 template <typename DataType>
@@ -5323,6 +7032,8 @@ struct JogCmdMulAssignLocalReal : JogCmdOpAssignLocal
 {
   int node_type() { return __LINE__; }
 
+  JogCmdOpAssignLocal* create() { return new JogCmdMulAssignLocalReal<DataType>(); }
+
   void print()
   {
     var_info->name->print();
@@ -5343,6 +7054,8 @@ struct JogCmdMulAssignLocalInteger : JogCmdOpAssignLocal
 {
   int node_type() { return __LINE__; }
 
+  JogCmdOpAssignLocal* create() { return new JogCmdMulAssignLocalInteger<DataType>(); }
+
   void print()
   {
     var_info->name->print();
@@ -5363,6 +7076,8 @@ struct JogCmdDivAssignLocalReal : JogCmdOpAssignLocal
 {
   int node_type() { return __LINE__; }
 
+  JogCmdOpAssignLocal* create() { return new JogCmdDivAssignLocalReal<DataType>(); }
+
   void print()
   {
     var_info->name->print();
@@ -5383,6 +7098,8 @@ struct JogCmdDivAssignLocalInteger : JogCmdOpAssignLocal
 {
   int node_type() { return __LINE__; }
 
+  JogCmdOpAssignLocal* create() { return new JogCmdDivAssignLocalInteger<DataType>(); }
+
   void print()
   {
     var_info->name->print();
@@ -5403,6 +7120,8 @@ struct JogCmdModAssignLocal : JogCmdOpAssignLocal
 {
   int node_type() { return __LINE__; }
 
+  JogCmdOpAssignLocal* create() { return new JogCmdModAssignLocal<DataType>(); }
+
   void print()
   {
     var_info->name->print();
@@ -5423,6 +7142,8 @@ struct JogCmdAndAssignLocal : JogCmdOpAssignLocal
 {
   int node_type() { return __LINE__; }
 
+  JogCmdOpAssignLocal* create() { return new JogCmdAndAssignLocal<DataType>(); }
+
   void print()
   {
     var_info->name->print();
@@ -5443,6 +7164,8 @@ struct JogCmdOrAssignLocal : JogCmdOpAssignLocal
 {
   int node_type() { return __LINE__; }
 
+  JogCmdOpAssignLocal* create() { return new JogCmdOrAssignLocal<DataType>(); }
+
   void print()
   {
     var_info->name->print();
@@ -5463,6 +7186,8 @@ struct JogCmdXorAssignLocal : JogCmdOpAssignLocal
 {
   int node_type() { return __LINE__; }
 
+  JogCmdOpAssignLocal* create() { return new JogCmdXorAssignLocal<DataType>(); }
+
   void print()
   {
     var_info->name->print();
@@ -5483,6 +7208,8 @@ struct JogCmdSHLAssignLocal : JogCmdOpAssignLocal
 {
   int node_type() { return __LINE__; }
 
+  JogCmdOpAssignLocal* create() { return new JogCmdSHLAssignLocal<DataType>(); }
+
   void print()
   {
     var_info->name->print();
@@ -5503,6 +7230,8 @@ struct JogCmdSHRXAssignLocal : JogCmdOpAssignLocal
 {
   int node_type() { return __LINE__; }
 
+  JogCmdOpAssignLocal* create() { return new JogCmdSHRXAssignLocal<DataType>(); }
+
   void print()
   {
     var_info->name->print();
@@ -5523,6 +7252,8 @@ struct JogCmdSHRAssignLocal : JogCmdOpAssignLocal
 {
   int node_type() { return __LINE__; }
 
+  JogCmdOpAssignLocal* create() { return new JogCmdSHRAssignLocal<DataType>(); }
+
   void print()
   {
     var_info->name->print();
@@ -5552,6 +7283,9 @@ struct JogCmdOpAssignProperty : JogCmd
 
   JogCmdOpAssignProperty() : JogCmd(NULL) { }
 
+  virtual JogCmdOpAssignProperty* create() = 0;  // an uninitialized node of the same kind
+  virtual JogCmdOpAssignLocal* create_local() { return NULL; }  // the same operation on a local
+
   Ref<JogCmd> init( Ref<JogToken> t, Ref<JogCmd> context, 
       JogPropertyInfo* var_info, Ref<JogCmd> operand )
   {
@@ -5569,12 +7303,24 @@ struct JogCmdOpAssignProperty : JogCmd
     vm->push( *operand );
     vm->push( *context );
   }
+
+  void compile( JogCodeBuilder* code );
+
+  void visit_operands( JogCmdVisitor* visitor );
+  Ref<JogCmd> inline_copy( JogInliner* inliner );
+  JogCmd* accessed_object() { return *context; }
+  Ref<JogCmd> localize( ArrayList<JogLocalVarInfo*>* property_locals );
 };
 
 struct JogCmdAddAssignPropertyString : JogCmdOpAssignProperty
 {
   int node_type() { return __LINE__; }
 
+  JogCmdOpAssignProperty* create() { return new JogCmdAddAssignPropertyString(); }
+  JogCmd* accessed_object() { return NULL; }  // no local form
+
+  bool calls_or_allocates() { return true; }
+
   void print()
   {
     context->print();
@@ -5584,53 +7330,29 @@ struct JogCmdAddAssignPropertyString : JogCmdOpAssignProperty
     operand->print();
   }
 
-  void execute( JogVM* vm )
+  void on_push( JogVM* vm )
   {
-    JogRef st2 = vm->pop_ref();
-    JogRef context = vm->pop_ref();
-    JogObject** location = (JogObject**)&(context.null_check(t)->data[var_info->index]);
-
-    if (*location == NULL)
-    {
-      throw error( "Null Pointer Exception." );
-    }
-
-    if (*st2 == NULL)
-    {
-      JogChar data[] = {'n','u','l','l'};
-      st2 = vm->create_string( data, 4 );
-    }
+    JogCmdConcatN::push_pieces( vm, *operand );
+    vm->push( *context );
+  }
 
-    JogObject* array1 = *((JogObject**)&((*location)->data[0]));
-    JogObject* array2 = *((JogObject**)&(st2->data[0]));
+  void compile( JogCodeBuilder* code );
 
-    int count1 = array1->count;
-    int count2 = array2->count;
+  void execute( JogVM* vm )
+  {
+    int count = JogCmdConcatN::piece_count( *operand );
+    JogObject* context = vm->ref_stack_ptr[count].null_check(t);
+    JogObject** location = (JogObject**)&(context->data[var_info->index]);
 
-    if (count2 == 0)
-    {
-      // original string is result
-      vm->push( *location );
-    }
-    else if (count1 == 0)
+    JogRef result = vm->concat_strings( vm->ref_stack_ptr, count, location );
+    vm->discard( 0, count+1 );
+    if (*result != *location)
     {
-      // right-hand string is result
-      (*location)->release();
-      *location = *st2;
-      st2->retain();
-      vm->push( st2 );
-    }
-    else
-    {
-      JogRef new_data = vm->create_array( jog_type_manager.type_char_array, count1+count2 );
-      memcpy( new_data->data, array1->data, count1*2 );
-      memcpy( ((JogChar*) new_data->data) + count1, array2->data, count2*2 );
-      JogRef new_string = vm->create_string( new_data );
-      (*location)->release();
-      *location = *new_string;
-      new_string->retain();
-      vm->push( new_string );
+      result->retain();
+      if (*location) (*location)->release();
+      *location = *result;
     }
+    vm->push( result );
   }
 };
 
@@ -5639,6 +7361,9 @@ struct JogCmdAddAssignPropertyReal : JogCmdOpAssignProperty
 {
   int node_type() { return __LINE__; }
 
+  JogCmdOpAssignProperty* create() { return new JogCmdAddAssignPropertyReal<DataType>(); }
+  JogCmdOpAssignLocal* create_local() { return new JogCmdAddAssignLocalReal<DataType>(); }
+
   void print()
   {
     context->print();
@@ -5651,7 +7376,7 @@ struct JogCmdAddAssignPropertyReal : JogCmdOpAssignProperty
   void execute( JogVM* vm )
   {
     double operand = vm->pop_double();
-    JogRef context = vm->pop_ref();
+    JogStackRef context = vm->pop_ref();
     double& local = ((double*)context.null_check(t)->data)[var_info->index];
     local = (DataType) (local + operand);
     vm->push( local );
@@ -5663,6 +7388,9 @@ struct JogCmdAddAssignPropertyInteger : JogCmdOpAssignProperty
 {
   int node_type() { return __LINE__; }
 
+  JogCmdOpAssignProperty* create() { return new JogCmdAddAssignPropertyInteger<DataType>(); }
+  JogCmdOpAssignLocal* create_local() { return new JogCmdAddAssignLocalInteger<DataType>(); }
+
   void print()
   {
     context->print();
@@ -5675,7 +7403,7 @@ struct JogCmdAddAssignPropertyInteger : JogCmdOpAssignProperty
   void execute( JogVM* vm )
   {
     JogInt64 operand = vm->pop_data();
-    JogRef context = vm->pop_ref();
+    JogStackRef context = vm->pop_ref();
     JogInt64& local = ((JogInt64*)context.null_check(t)->data)[var_info->index];
     local = (DataType) (local + operand);
     vm->push( local );
@@ -5687,6 +7415,9 @@ struct JogCmdSubAssignPropertyReal : JogCmdOpAssignProperty
 {
   int node_type() { return __LINE__; }
 
+  JogCmdOpAssignProperty* create() { return new JogCmdSubAssignPropertyReal<DataType>(); }
+  JogCmdOpAssignLocal* create_local() { return new JogCmdSubAssignLocalReal<DataType>(); }
+
   void print()
   {
     context->print();
@@ -5699,7 +7430,7 @@ struct JogCmdSubAssignPropertyReal : JogCmdOpAssignProperty
   void execute( JogVM* vm )
   {
     double operand = vm->pop_double();
-    JogRef context = vm->pop_ref();
+    JogStackRef context = vm->pop_ref();
     double& local = ((double*)context.null_check(t)->data)[var_info->index];
     local = (DataType) (local - operand);
     vm->push( local );
@@ -5711,6 +7442,9 @@ struct JogCmdSubAssignPropertyInteger : JogCmdOpAssignProperty
 {
   int node_type() { return __LINE__; }
 
+  JogCmdOpAssignProperty* create() { return new JogCmdSubAssignPropertyInteger<DataType>(); }
+  JogCmdOpAssignLocal* create_local() { return new JogCmdSubAssignLocalInteger<DataType>(); }
+
   void print()
   {
     context->print();
@@ -5723,7 +7457,7 @@ struct JogCmdSubAssignPropertyInteger : JogCmdOpAssignProperty
   void execute( JogVM* vm )
   {
     JogInt64 operand = vm->pop_data();
-    JogRef context = vm->pop_ref();
+    JogStackRef context = vm->pop_ref();
     JogInt64& local = ((JogInt64*)context.null_check(t)->data)[var_info->index];
     local = (DataType) (local - operand);
     vm->push( local );
@@ -5735,6 +7469,9 @@ struct JogCmdMulAssignPropertyReal : JogCmdOpAssignProperty
 {
   int node_type() { return __LINE__; }
 
+  JogCmdOpAssignProperty* create() { return new JogCmdMulAssignPropertyReal<DataType>(); }
+  JogCmdOpAssignLocal* create_local() { return new JogCmdMulAssignLocalReal<DataType>(); }
+
   void print()
   {
     context->print();
@@ -5747,7 +7484,7 @@ struct JogCmdMulAssignPropertyReal : JogCmdOpAssignProperty
   void execute( JogVM* vm )
   {
     double operand = vm->pop_double();
-    JogRef context = vm->pop_ref();
+    JogStackRef context = vm->pop_ref();
     double& local = ((double*)context.null_check(t)->data)[var_info->index];
     local = (DataType) (local * operand);
     vm->push( local );
@@ -5759,6 +7496,9 @@ struct JogCmdMulAssignPropertyInteger : JogCmdOpAssignProperty
 {
   int node_type() { return __LINE__; }
 
+  JogCmdOpAssignProperty* create() { return new JogCmdMulAssignPropertyInteger<DataType>(); }
+  JogCmdOpAssignLocal* create_local() { return new JogCmdMulAssignLocalInteger<DataType>(); }
+
   void print()
   {
     context->print();
@@ -5771,7 +7511,7 @@ struct JogCmdMulAssignPropertyInteger : JogCmdOpAssignProperty
   void execute( JogVM* vm )
   {
     JogInt64 operand = vm->pop_data();
-    JogRef context = vm->pop_ref();
+    JogStackRef context = vm->pop_ref();
     JogInt64& local = ((JogInt64*)context.null_check(t)->data)[var_info->index];
     local = (DataType) (local * operand);
     vm->push( local );
@@ -5783,6 +7523,9 @@ struct JogCmdDivAssignPropertyReal : JogCmdOpAssignProperty
 {
   int node_type() { return __LINE__; }
 
+  JogCmdOpAssignProperty* create() { return new JogCmdDivAssignPropertyReal<DataType>(); }
+  JogCmdOpAssignLocal* create_local() { return new JogCmdDivAssignLocalReal<DataType>(); }
+
   void print()
   {
     context->print();
@@ -5795,7 +7538,7 @@ struct JogCmdDivAssignPropertyReal : JogCmdOpAssignProperty
   void execute( JogVM* vm )
   {
     double operand = vm->pop_double();
-    JogRef context = vm->pop_ref();
+    JogStackRef context = vm->pop_ref();
     double& local = ((double*)context.null_check(t)->data)[var_info->index];
     local = (DataType) (local / operand);
     vm->push( local );
@@ -5807,6 +7550,9 @@ struct JogCmdDivAssignPropertyInteger : JogCmdOpAssignProperty
 {
   int node_type() { return __LINE__; }
 
+  JogCmdOpAssignProperty* create() { return new JogCmdDivAssignPropertyInteger<DataType>(); }
+  JogCmdOpAssignLocal* create_local() { return new JogCmdDivAssignLocalInteger<DataType>(); }
+
   void print()
   {
     context->print();
@@ -5819,7 +7565,7 @@ struct JogCmdDivAssignPropertyInteger : JogCmdOpAssignProperty
   void execute( JogVM* vm )
   {
     JogInt64 operand = vm->pop_data();
-    JogRef context = vm->pop_ref();
+    JogStackRef context = vm->pop_ref();
     JogInt64& local = ((JogInt64*)context.null_check(t)->data)[var_info->index];
     local = (DataType) (local / zero_check(operand));
     vm->push( local );
@@ -5831,6 +7577,9 @@ struct JogCmdModAssignProperty : JogCmdOpAssignProperty
 {
   int node_type() { return __LINE__; }
 
+  JogCmdOpAssignProperty* create() { return new JogCmdModAssignProperty<DataType>(); }
+  JogCmdOpAssignLocal* create_local() { return new JogCmdModAssignLocal<DataType>(); }
+
   void print()
   {
     context->print();
@@ -5843,7 +7592,7 @@ struct JogCmdModAssignProperty : JogCmdOpAssignProperty
   void execute( JogVM* vm )
   {
     JogInt64 operand = vm->pop_data();
-    JogRef context = vm->pop_ref();
+    JogStackRef context = vm->pop_ref();
     JogInt64& local = ((JogInt64*)context.null_check(t)->data)[var_info->index];
     local = (DataType) (local % zero_check(operand));
     vm->push( local );
@@ -5855,6 +7604,9 @@ struct JogCmdAndAssignProperty : JogCmdOpAssignProperty
 {
   int node_type() { return __LINE__; }
 
+  JogCmdOpAssignProperty* create() { return new JogCmdAndAssignProperty<DataType>(); }
+  JogCmdOpAssignLocal* create_local() { return new JogCmdAndAssignLocal<DataType>(); }
+
   void print()
   {
     context->print();
@@ -5867,7 +7619,7 @@ struct JogCmdAndAssignProperty : JogCmdOpAssignProperty
   void execute( JogVM* vm )
   {
     JogInt64 operand = vm->pop_data();
-    JogRef context = vm->pop_ref();
+    JogStackRef context = vm->pop_ref();
     JogInt64& local = ((JogInt64*)context.null_check(t)->data)[var_info->index];
     local = (DataType) (local & operand);
     vm->push( local );
@@ -5879,6 +7631,9 @@ struct JogCmdOrAssignProperty : JogCmdOpAssignProperty
 {
   int node_type() { return __LINE__; }
 
+  JogCmdOpAssignProperty* create() { return new JogCmdOrAssignProperty<DataType>(); }
+  JogCmdOpAssignLocal* create_local() { return new JogCmdOrAssignLocal<DataType>(); }
+
   void print()
   {
     context->print();
@@ -5891,7 +7646,7 @@ struct JogCmdOrAssignProperty : JogCmdOpAssignProperty
   void execute( JogVM* vm )
   {
     JogInt64 operand = vm->pop_data();
-    JogRef context = vm->pop_ref();
+    JogStackRef context = vm->pop_ref();
     JogInt64& local = ((JogInt64*)context.null_check(t)->data)[var_info->index];
     local = (DataType) (local | operand);
     vm->push( local );
@@ -5903,6 +7658,9 @@ struct JogCmdXorAssignProperty : JogCmdOpAssignProperty
 {
   int node_type() { return __LINE__; }
 
+  JogCmdOpAssignProperty* create() { return new JogCmdXorAssignProperty<DataType>(); }
+  JogCmdOpAssignLocal* create_local() { return new JogCmdXorAssignLocal<DataType>(); }
+
   void print()
   {
     context->print();
@@ -5915,7 +7673,7 @@ struct JogCmdXorAssignProperty : JogCmdOpAssignProperty
   void execute( JogVM* vm )
   {
     JogInt64 operand = vm->pop_data();
-    JogRef context = vm->pop_ref();
+    JogStackRef context = vm->pop_ref();
     JogInt64& local = ((JogInt64*)context.null_check(t)->data)[var_info->index];
     local = (DataType) (local ^ operand);
     vm->push( local );
@@ -5927,6 +7685,9 @@ struct JogCmdSHLAssignProperty : JogCmdOpAssignProperty
 {
   int node_type() { return __LINE__; }
 
+  JogCmdOpAssignProperty* create() { return new JogCmdSHLAssignProperty<DataType>(); }
+  JogCmdOpAssignLocal* create_local() { return new JogCmdSHLAssignLocal<DataType>(); }
+
   void print()
   {
     context->print();
@@ -5939,7 +7700,7 @@ struct JogCmdSHLAssignProperty : JogCmdOpAssignProperty
   void execute( JogVM* vm )
   {
     JogInt64 operand = vm->pop_data();
-    JogRef context = vm->pop_ref();
+    JogStackRef context = vm->pop_ref();
     JogInt64& local = ((JogInt64*)context.null_check(t)->data)[var_info->index];
     local = (DataType) (local << operand);
     vm->push( local );
@@ -5951,6 +7712,9 @@ struct JogCmdSHRXAssignProperty : JogCmdOpAssignProperty
 {
   int node_type() { return __LINE__; }
 
+  JogCmdOpAssignProperty* create() { return new JogCmdSHRXAssignProperty<DataType>(); }
+  JogCmdOpAssignLocal* create_local() { return new JogCmdSHRXAssignLocal<DataType>(); }
+
   void print()
   {
     context->print();
@@ -5963,7 +7727,7 @@ struct JogCmdSHRXAssignProperty : JogCmdOpAssignProperty
   void execute( JogVM* vm )
   {
     JogInt64 operand = vm->pop_data();
-    JogRef context = vm->pop_ref();
+    JogStackRef context = vm->pop_ref();
     JogInt64& local = ((JogInt64*)context.null_check(t)->data)[var_info->index];
     local = (DataType) (local >> operand);
     vm->push( local );
@@ -5975,6 +7739,9 @@ struct JogCmdSHRAssignProperty : JogCmdOpAssignProperty
 {
   int node_type() { return __LINE__; }
 
+  JogCmdOpAssignProperty* create() { return new JogCmdSHRAssignProperty<DataType>(); }
+  JogCmdOpAssignLocal* create_local() { return new JogCmdSHRAssignLocal<DataType>(); }
+
   void print()
   {
     context->print();
@@ -5987,7 +7754,7 @@ struct JogCmdSHRAssignProperty : JogCmdOpAssignProperty
   void execute( JogVM* vm )
   {
     JogInt64 operand = vm->pop_data();
-    JogRef context = vm->pop_ref();
+    JogStackRef context = vm->pop_ref();
     JogInt64& local = ((JogInt64*)context.null_check(t)->data)[var_info->index];
     local = JOG_SHR( DataType, local, operand );
     vm->push( local );
@@ -6025,12 +7792,19 @@ struct JogCmdOpAssignClassProperty : JogCmd
     vm->push( *operand );
     if (*context) vm->push( *context );
   }
+
+  void compile( JogCodeBuilder* code );
+
+  void visit_operands( JogCmdVisitor* visitor );
+  JogPropertyInfo* written_class_property() { return var_info; }
 };
 
 struct JogCmdAddAssignClassPropertyString : JogCmdOpAssignClassProperty
 {
   int node_type() { return __LINE__; }
 
+  bool calls_or_allocates() { return true; }
+
   void print()
   {
     if (*context)
@@ -6043,53 +7817,28 @@ struct JogCmdAddAssignClassPropertyString : JogCmdOpAssignClassProperty
     operand->print();
   }
 
-  void execute( JogVM* vm )
+  void on_push( JogVM* vm )
   {
-    JogRef st2 = vm->pop_ref();
-    JogRef context = vm->pop_ref();
-    JogObject** location = (JogObject**)&(context.null_check(t)->data[var_info->index]);
-
-    if (*location == NULL)
-    {
-      throw error( "Null Pointer Exception." );
-    }
-
-    if (*st2 == NULL)
-    {
-      JogChar data[] = {'n','u','l','l'};
-      st2 = vm->create_string( data, 4 );
-    }
+    JogCmdConcatN::push_pieces( vm, *operand );
+    if (*context) vm->push( *context );
+  }
 
-    JogObject* array1 = *((JogObject**)&((*location)->data[0]));
-    JogObject* array2 = *((JogObject**)&(st2->data[0]));
+  void compile( JogCodeBuilder* code );
 
-    int count1 = array1->count;
-    int count2 = array2->count;
+  void execute( JogVM* vm )
+  {
+    int count = JogCmdConcatN::piece_count( *operand );
+    JogObject** location = &((JogObject**)var_info->type_context->class_data)[var_info->index];
 
-    if (count2 == 0)
-    {
-      // original string is result
-      vm->push( *location );
-    }
-    else if (count1 == 0)
-    {
-      // right-hand string is result
-      (*location)->release();
-      *location = *st2;
-      st2->retain();
-      vm->push( st2 );
-    }
-    else
+    JogRef result = vm->concat_strings( vm->ref_stack_ptr, count, location );
+    vm->discard( 0, count );
+    if (*result != *location)
     {
-      JogRef new_data = vm->create_array( jog_type_manager.type_char_array, count1+count2 );
-      memcpy( new_data->data, array1->data, count1*2 );
-      memcpy( ((JogChar*) new_data->data) + count1, array2->data, count2*2 );
-      JogRef new_string = vm->create_string( new_data );
-      (*location)->release();
-      *location = *new_string;
-      new_string->retain();
-      vm->push( new_string );
+      result->retain();
+      if (*location) (*location)->release();
+      *location = *result;
     }
+    vm->push( result );
   }
 };
 
@@ -6113,8 +7862,7 @@ struct JogCmdAddAssignClassPropertyReal : JogCmdOpAssignClassProperty
   void execute( JogVM* vm )
   {
     double operand = vm->pop_double();
-    JogRef context = vm->pop_ref();
-    double& local = ((double*)context.null_check(t)->data)[var_info->index];
+    double& local = ((double*)var_info->type_context->class_data)[var_info->index];
     local = (DataType) (local + operand);
     vm->push( local );
   }
@@ -6140,8 +7888,7 @@ struct JogCmdAddAssignClassPropertyInteger : JogCmdOpAssignClassProperty
   void execute( JogVM* vm )
   {
     JogInt64 operand = vm->pop_data();
-    JogRef context = vm->pop_ref();
-    JogInt64& local = ((JogInt64*)context.null_check(t)->data)[var_info->index];
+    JogInt64& local = ((JogInt64*)var_info->type_context->class_data)[var_info->index];
     local = (DataType) (local + operand);
     vm->push( local );
   }
@@ -6167,8 +7914,7 @@ struct JogCmdSubAssignClassPropertyReal : JogCmdOpAssignClassProperty
   void execute( JogVM* vm )
   {
     double operand = vm->pop_double();
-    JogRef context = vm->pop_ref();
-    double& local = ((double*)context.null_check(t)->data)[var_info->index];
+    double& local = ((double*)var_info->type_context->class_data)[var_info->index];
     local = (DataType) (local - operand);
     vm->push( local );
   }
@@ -6194,8 +7940,7 @@ struct JogCmdSubAssignClassPropertyInteger : JogCmdOpAssignClassProperty
   void execute( JogVM* vm )
   {
     JogInt64 operand = vm->pop_data();
-    JogRef context = vm->pop_ref();
-    JogInt64& local = ((JogInt64*)context.null_check(t)->data)[var_info->index];
+    JogInt64& local = ((JogInt64*)var_info->type_context->class_data)[var_info->index];
     local = (DataType) (local - operand);
     vm->push( local );
   }
@@ -6221,8 +7966,7 @@ struct JogCmdMulAssignClassPropertyReal : JogCmdOpAssignClassProperty
   void execute( JogVM* vm )
   {
     double operand = vm->pop_double();
-    JogRef context = vm->pop_ref();
-    double& local = ((double*)context.null_check(t)->data)[var_info->index];
+    double& local = ((double*)var_info->type_context->class_data)[var_info->index];
     local = (DataType) (local * operand);
     vm->push( local );
   }
@@ -6248,8 +7992,7 @@ struct JogCmdMulAssignClassPropertyInteger : JogCmdOpAssignClassProperty
   void execute( JogVM* vm )
   {
     JogInt64 operand = vm->pop_data();
-    JogRef context = vm->pop_ref();
-    JogInt64& local = ((JogInt64*)context.null_check(t)->data)[var_info->index];
+    JogInt64& local = ((JogInt64*)var_info->type_context->class_data)[var_info->index];
     local = (DataType) (local * operand);
     vm->push( local );
   }
@@ -6275,8 +8018,7 @@ struct JogCmdDivAssignClassPropertyReal : JogCmdOpAssignClassProperty
   void execute( JogVM* vm )
   {
     double operand = vm->pop_double();
-    JogRef context = vm->pop_ref();
-    double& local = ((double*)context.null_check(t)->data)[var_info->index];
+    double& local = ((double*)var_info->type_context->class_data)[var_info->index];
     local = (DataType) (local / operand);
     vm->push( local );
   }
@@ -6302,8 +8044,7 @@ struct JogCmdDivAssignClassPropertyInteger : JogCmdOpAssignClassProperty
   void execute( JogVM* vm )
   {
     JogInt64 operand = vm->pop_data();
-    JogRef context = vm->pop_ref();
-    JogInt64& local = ((JogInt64*)context.null_check(t)->data)[var_info->index];
+    JogInt64& local = ((JogInt64*)var_info->type_context->class_data)[var_info->index];
     local = (DataType) (local / zero_check(operand));
     vm->push( local );
   }
@@ -6329,8 +8070,7 @@ struct JogCmdModAssignClassProperty : JogCmdOpAssignClassProperty
   void execute( JogVM* vm )
   {
     JogInt64 operand = vm->pop_data();
-    JogRef context = vm->pop_ref();
-    JogInt64& local = ((JogInt64*)context.null_check(t)->data)[var_info->index];
+    JogInt64& local = ((JogInt64*)var_info->type_context->class_data)[var_info->index];
     local = (DataType) (local % zero_check(operand));
     vm->push( local );
   }
@@ -6356,8 +8096,7 @@ struct JogCmdAndAssignClassProperty : JogCmdOpAssignClassProperty
   void execute( JogVM* vm )
   {
     JogInt64 operand = vm->pop_data();
-    JogRef context = vm->pop_ref();
-    JogInt64& local = ((JogInt64*)context.null_check(t)->data)[var_info->index];
+    JogInt64& local = ((JogInt64*)var_info->type_context->class_data)[var_info->index];
     local = (DataType) (local & operand);
     vm->push( local );
   }
@@ -6383,8 +8122,7 @@ struct JogCmdOrAssignClassProperty : JogCmdOpAssignClassProperty
   void execute( JogVM* vm )
   {
     JogInt64 operand = vm->pop_data();
-    JogRef context = vm->pop_ref();
-    JogInt64& local = ((JogInt64*)context.null_check(t)->data)[var_info->index];
+    JogInt64& local = ((JogInt64*)var_info->type_context->class_data)[var_info->index];
     local = (DataType) (local | operand);
     vm->push( local );
   }
@@ -6410,8 +8148,7 @@ struct JogCmdXorAssignClassProperty : JogCmdOpAssignClassProperty
   void execute( JogVM* vm )
   {
     JogInt64 operand = vm->pop_data();
-    JogRef context = vm->pop_ref();
-    JogInt64& local = ((JogInt64*)context.null_check(t)->data)[var_info->index];
+    JogInt64& local = ((JogInt64*)var_info->type_context->class_data)[var_info->index];
     local = (DataType) (local ^ operand);
     vm->push( local );
   }
@@ -6437,8 +8174,7 @@ struct JogCmdSHLAssignClassProperty : JogCmdOpAssignClassProperty
   void execute( JogVM* vm )
   {
     JogInt64 operand = vm->pop_data();
-    JogRef context = vm->pop_ref();
-    JogInt64& local = ((JogInt64*)context.null_check(t)->data)[var_info->index];
+    JogInt64& local = ((JogInt64*)var_info->type_context->class_data)[var_info->index];
     local = (DataType) (local << operand);
     vm->push( local );
   }
@@ -6464,8 +8200,7 @@ struct JogCmdSHRXAssignClassProperty : JogCmdOpAssignClassProperty
   void execute( JogVM* vm )
   {
     JogInt64 operand = vm->pop_data();
-    JogRef context = vm->pop_ref();
-    JogInt64& local = ((JogInt64*)context.null_check(t)->data)[var_info->index];
+    JogInt64& local = ((JogInt64*)var_info->type_context->class_data)[var_info->index];
     local = (DataType) (local >> operand);
     vm->push( local );
   }
@@ -6491,8 +8226,7 @@ struct JogCmdSHRAssignClassProperty : JogCmdOpAssignClassProperty
   void execute( JogVM* vm )
   {
     JogInt64 operand = vm->pop_data();
-    JogRef context = vm->pop_ref();
-    JogInt64& local = ((JogInt64*)context.null_check(t)->data)[var_info->index];
+    JogInt64& local = ((JogInt64*)var_info->type_context->class_data)[var_info->index];
     local = JOG_SHR( DataType, local, operand );
     vm->push( local );
   }
@@ -6538,12 +8272,18 @@ struct JogCmdOpAssignArray : JogCmd
     vm->push( *index_expr );
     vm->push( *context );
   }
+
+  void compile( JogCodeBuilder* code );
+
+  void visit_operands( JogCmdVisitor* visitor );
 };
 
 struct JogCmdAddAssignArrayString : JogCmdOpAssignArray
 {
   int node_type() { return __LINE__; }
 
+  bool calls_or_allocates() { return true; }
+
   void print()
   {
     JogCmdOpAssignArray::print();
@@ -6554,12 +8294,6 @@ struct JogCmdAddAssignArrayString : JogCmdOpAssignArray
   void execute( JogVM* vm )
   {
     JogRef st2 = vm->pop_ref();
-    if (*st2 == NULL)
-    {
-      JogChar data[] = {'n','u','l','l'};
-      st2 = vm->create_string( data, 4 );
-    }
-
     int index = vm->pop_int();
     JogRef obj = vm->pop_ref();
     JogObject* array = obj.null_check(t);
@@ -6569,36 +8303,15 @@ struct JogCmdAddAssignArrayString : JogCmdOpAssignArray
     JogRef st1 = *location;
     st1.null_check(t);
 
-    JogObject* array1 = *((JogObject**)&(st1->data[0]));
-    JogObject* array2 = *((JogObject**)&(st2->data[0]));
-
-    int count1 = array1->count;
-    int count2 = array2->count;
-
-    if (count2 == 0)
-    {
-      // original string is result
-      vm->push( st1 );
-    }
-    else if (count1 == 0)
+    JogStackRef operand( *st2 );
+    JogRef result = vm->concat_strings( &operand, 1, location );
+    if (*result != *location)
     {
-      // right-hand string is result
-      st1->release();
-      *location = *st2;
-      st2->retain();
-      vm->push( st2 );
-    }
-    else
-    {
-      JogRef new_data = vm->create_array( jog_type_manager.type_char_array, count1+count2 );
-      memcpy( new_data->data, array1->data, count1*2 );
-      memcpy( ((JogChar*) new_data->data) + count1, array2->data, count2*2 );
-      JogRef new_string = vm->create_string( new_data );
-      st1->release();
-      *location = *new_string;
-      new_string->retain();
-      vm->push( new_string );
+      result->retain();
+      (*location)->release();
+      *location = *result;
     }
+    vm->push( result );
   }
 };
 
@@ -7006,6 +8719,8 @@ struct JogCmdPreStepLocal : JogCmd
 
   JogCmdPreStepLocal() : JogCmd(NULL) { }
 
+  virtual JogCmdPreStepLocal* create() = 0;  // an uninitialized node of the same kind
+
   Ref<JogCmd> init( Ref<JogToken> t, JogLocalVarInfo* var_info, int modifier )
   {
     this->t = t;
@@ -7026,6 +8741,17 @@ struct JogCmdPreStepLocal : JogCmd
   Ref<JogCmd> resolve() { return this; }
 
   void on_push( JogVM* vm ) { }
+  void compile( JogCodeBuilder* code );
+  int  compile_register( JogCodeBuilder* code, int target );
+
+  int  fusion_shape()
+  {
+    if (var_info->type == jog_type_manager.type_int32) return JOG_SHAPE_PRE_STEP_LOCAL_INT32;
+    return JOG_SHAPE_NONE;
+  }
+
+  JogLocalVarInfo* written_local() { return var_info; }
+  Ref<JogCmd> inline_copy( JogInliner* inliner );
 };
 
 template <typename DataType>
@@ -7033,6 +8759,8 @@ struct JogCmdPreStepLocalReal : JogCmdPreStepLocal
 {
   int node_type() { return __LINE__; }
 
+  JogCmdPreStepLocal* create() { return new JogCmdPreStepLocalReal<DataType>(); }
+
   void execute( JogVM* vm )
   {
     double& local = ((double*)vm->frame_ptr->data_stack_ptr)[var_info->offset];
@@ -7046,6 +8774,8 @@ struct JogCmdPreStepLocalInteger : JogCmdPreStepLocal
 {
   int node_type() { return __LINE__; }
 
+  JogCmdPreStepLocal* create() { return new JogCmdPreStepLocalInteger<DataType>(); }
+
   void execute( JogVM* vm )
   {
     JogInt64& local = ((JogInt64*)vm->frame_ptr->data_stack_ptr)[var_info->offset];
@@ -7064,6 +8794,8 @@ struct JogCmdPostStepLocal : JogCmd
 
   JogCmdPostStepLocal() : JogCmd(NULL) { }
 
+  virtual JogCmdPostStepLocal* create() = 0;  // an uninitialized node of the same kind
+
   Ref<JogCmd> init( Ref<JogToken> t, JogLocalVarInfo* var_info, int modifier )
   {
     this->t = t;
@@ -7084,6 +8816,17 @@ struct JogCmdPostStepLocal : JogCmd
   Ref<JogCmd> resolve() { return this; }
 
   void on_push( JogVM* vm ) { }
+  void compile( JogCodeBuilder* code );
+  int  compile_register( JogCodeBuilder* code, int target );
+
+  int  fusion_shape()
+  {
+    if (var_info->type == jog_type_manager.type_int32) return JOG_SHAPE_POST_STEP_LOCAL_INT32;
+    return JOG_SHAPE_NONE;
+  }
+
+  JogLocalVarInfo* written_local() { return var_info; }
+  Ref<JogCmd> inline_copy( JogInliner* inliner );
 };
 
 template <typename DataType>
@@ -7091,6 +8834,8 @@ struct JogCmdPostStepLocalReal : JogCmdPostStepLocal
 {
   int node_type() { return __LINE__; }
 
+  JogCmdPostStepLocal* create() { return new JogCmdPostStepLocalReal<DataType>(); }
+
   void execute( JogVM* vm )
   {
     double& local = ((double*)vm->frame_ptr->data_stack_ptr)[var_info->offset];
@@ -7104,6 +8849,8 @@ struct JogCmdPostStepLocalInteger : JogCmdPostStepLocal
 {
   int node_type() { return __LINE__; }
 
+  JogCmdPostStepLocal* create() { return new JogCmdPostStepLocalInteger<DataType>(); }
+
   void execute( JogVM* vm )
   {
     JogInt64& local = ((JogInt64*)vm->frame_ptr->data_stack_ptr)[var_info->offset];
@@ -7124,6 +8871,9 @@ struct JogCmdPreStepProperty : JogCmd
 
   JogCmdPreStepProperty() : JogCmd(NULL) { }
 
+  virtual JogCmdPreStepProperty* create() = 0;  // an uninitialized node of the same kind
+  virtual JogCmdPreStepLocal* create_local() = 0;  // the same operation on a local
+
   Ref<JogCmd> init( Ref<JogToken> t, Ref<JogCmd> context, JogPropertyInfo* var_info,
       int modifier )
   {
@@ -7149,6 +8899,13 @@ struct JogCmdPreStepProperty : JogCmd
   { 
     vm->push( *context );
   }
+
+  void compile( JogCodeBuilder* code );
+
+  void visit_operands( JogCmdVisitor* visitor );
+  Ref<JogCmd> inline_copy( JogInliner* inliner );
+  JogCmd* accessed_object() { return *context; }
+  Ref<JogCmd> localize( ArrayList<JogLocalVarInfo*>* property_locals );
 };
 
 template <typename DataType>
@@ -7156,6 +8913,9 @@ struct JogCmdPreStepPropertyReal : JogCmdPreStepProperty
 {
   int node_type() { return __LINE__; }
 
+  JogCmdPreStepProperty* create() { return new JogCmdPreStepPropertyReal<DataType>(); }
+  JogCmdPreStepLocal* create_local() { return new JogCmdPreStepLocalReal<DataType>(); }
+
   void execute( JogVM* vm )
   {
     JogObject* context = vm->pop_ref().null_check(t);
@@ -7170,6 +8930,9 @@ struct JogCmdPreStepPropertyInteger : JogCmdPreStepProperty
 {
   int node_type() { return __LINE__; }
 
+  JogCmdPreStepProperty* create() { return new JogCmdPreStepPropertyInteger<DataType>(); }
+  JogCmdPreStepLocal* create_local() { return new JogCmdPreStepLocalInteger<DataType>(); }
+
   void execute( JogVM* vm )
   {
     JogObject* context = vm->pop_ref().null_check(t);
@@ -7189,6 +8952,9 @@ struct JogCmdPostStepProperty : JogCmd
 
   JogCmdPostStepProperty() : JogCmd(NULL) { }
 
+  virtual JogCmdPostStepProperty* create() = 0;  // an uninitialized node of the same kind
+  virtual JogCmdPostStepLocal* create_local() = 0;  // the same operation on a local
+
   Ref<JogCmd> init( Ref<JogToken> t, Ref<JogCmd> context, JogPropertyInfo* var_info,
       int modifier )
   {
@@ -7214,6 +8980,13 @@ struct JogCmdPostStepProperty : JogCmd
   { 
     vm->push( *context );
   }
+
+  void compile( JogCodeBuilder* code );
+
+  void visit_operands( JogCmdVisitor* visitor );
+  Ref<JogCmd> inline_copy( JogInliner* inliner );
+  JogCmd* accessed_object() { return *context; }
+  Ref<JogCmd> localize( ArrayList<JogLocalVarInfo*>* property_locals );
 };
 
 template <typename DataType>
@@ -7221,6 +8994,9 @@ struct JogCmdPostStepPropertyReal : JogCmdPostStepProperty
 {
   int node_type() { return __LINE__; }
 
+  JogCmdPostStepProperty* create() { return new JogCmdPostStepPropertyReal<DataType>(); }
+  JogCmdPostStepLocal* create_local() { return new JogCmdPostStepLocalReal<DataType>(); }
+
   void execute( JogVM* vm )
   {
     JogObject* context = vm->pop_ref().null_check(t);
@@ -7235,6 +9011,9 @@ struct JogCmdPostStepPropertyInteger : JogCmdPostStepProperty
 {
   int node_type() { return __LINE__; }
 
+  JogCmdPostStepProperty* create() { return new JogCmdPostStepPropertyInteger<DataType>(); }
+  JogCmdPostStepLocal* create_local() { return new JogCmdPostStepLocalInteger<DataType>(); }
+
   void execute( JogVM* vm )
   {
     JogObject* context = vm->pop_ref().null_check(t);
@@ -7282,6 +9061,11 @@ struct JogCmdPreStepClassProperty : JogCmd
   { 
     if (*context) vm->push( *context );
   }
+
+  void compile( JogCodeBuilder* code );
+
+  void visit_operands( JogCmdVisitor* visitor );
+  JogPropertyInfo* written_class_property() { return var_info; }
 };
 
 template <typename DataType>
@@ -7346,6 +9130,11 @@ struct JogCmdPostStepClassProperty : JogCmd
   { 
     if (*context) vm->push( *context );
   }
+
+  void compile( JogCodeBuilder* code );
+
+  void visit_operands( JogCmdVisitor* visitor );
+  JogPropertyInfo* written_class_property() { return var_info; }
 };
 
 template <typename DataType>
@@ -7400,6 +9189,12 @@ struct JogCmdArraySize : JogCmd
 
   void on_push( JogVM* vm );
   void execute( JogVM* vm );
+  void compile( JogCodeBuilder* code );
+
+  void visit_operands( JogCmdVisitor* visitor );
+  int  fusion_shape() { return JOG_SHAPE_ARRAY_SIZE; }
+  JogCmd* fusion_operand( int index ) { return index ? NULL : *context; }
+  Ref<JogCmd> inline_copy( JogInliner* inliner );
 };
 
 //-----------------------------------------------------------------------------
@@ -7416,6 +9211,7 @@ struct JogCmdArrayRead : JogCmdArrayAccess
   Ref<JogCmd> resolve() { return this; }
 
   void on_push( JogVM* vm );
+  void compile( JogCodeBuilder* code );
 };
 
 struct JogCmdArrayReadRef : JogCmdArrayRead
@@ -7430,6 +9226,7 @@ struct JogCmdArrayReadRef : JogCmdArrayRead
   JogTypeInfo* type() { return context->type()->element_type; }
 
   void execute( JogVM* vm );
+  Ref<JogCmd> inline_copy( JogInliner* inliner );
 };
 
 struct JogCmdArrayReadReal64 : JogCmdArrayRead
@@ -7444,6 +9241,7 @@ struct JogCmdArrayReadReal64 : JogCmdArrayRead
   JogTypeInfo* type() { return jog_type_manager.type_real64; }
 
   void execute( JogVM* vm );
+  Ref<JogCmd> inline_copy( JogInliner* inliner );
 };
 
 struct JogCmdArrayReadReal32 : JogCmdArrayRead
@@ -7458,6 +9256,7 @@ struct JogCmdArrayReadReal32 : JogCmdArrayRead
   JogTypeInfo* type() { return jog_type_manager.type_real32; }
 
   void execute( JogVM* vm );
+  Ref<JogCmd> inline_copy( JogInliner* inliner );
 };
 
 struct JogCmdArrayReadInt64 : JogCmdArrayRead
@@ -7472,6 +9271,7 @@ struct JogCmdArrayReadInt64 : JogCmdArrayRead
   JogTypeInfo* type() { return jog_type_manager.type_int64; }
 
   void execute( JogVM* vm );
+  Ref<JogCmd> inline_copy( JogInliner* inliner );
 };
 
 struct JogCmdArrayReadInt32 : JogCmdArrayRead
@@ -7486,6 +9286,9 @@ struct JogCmdArrayReadInt32 : JogCmdArrayRead
   JogTypeInfo* type() { return jog_type_manager.type_int32; }
 
   void execute( JogVM* vm );
+  void compile( JogCodeBuilder* code );
+  int  fusion_shape() { return JOG_SHAPE_ARRAY_READ_INT32; }
+  Ref<JogCmd> inline_copy( JogInliner* inliner );
 };
 
 struct JogCmdArrayReadInt16 : JogCmdArrayRead
@@ -7500,6 +9303,7 @@ struct JogCmdArrayReadInt16 : JogCmdArrayRead
   JogTypeInfo* type() { return jog_type_manager.type_int16; }
 
   void execute( JogVM* vm );
+  Ref<JogCmd> inline_copy( JogInliner* inliner );
 };
 
 struct JogCmdArrayReadInt8 : JogCmdArrayRead
@@ -7514,6 +9318,7 @@ struct JogCmdArrayReadInt8 : JogCmdArrayRead
   JogTypeInfo* type() { return jog_type_manager.type_int8; }
 
   void execute( JogVM* vm );
+  Ref<JogCmd> inline_copy( JogInliner* inliner );
 };
 
 struct JogCmdArrayReadChar : JogCmdArrayRead
@@ -7528,6 +9333,7 @@ struct JogCmdArrayReadChar : JogCmdArrayRead
   JogTypeInfo* type() { return jog_type_manager.type_char; }
 
   void execute( JogVM* vm );
+  Ref<JogCmd> inline_copy( JogInliner* inliner );
 };
 
 struct JogCmdArrayReadBoolean : JogCmdArrayRead
@@ -7542,6 +9348,7 @@ struct JogCmdArrayReadBoolean : JogCmdArrayRead
   JogTypeInfo* type() { return jog_type_manager.type_boolean; }
 
   void execute( JogVM* vm );
+  Ref<JogCmd> inline_copy( JogInliner* inliner );
 };
 
 //-----------------------------------------------------------------------------
@@ -7561,6 +9368,9 @@ struct JogCmdArrayWrite : JogCmdArrayAccess
   Ref<JogCmd> resolve() { return this; }
 
   void on_push( JogVM* vm );
+  void compile( JogCodeBuilder* code );
+
+  void visit_operands( JogCmdVisitor* visitor );
 };
 
 struct JogCmdArrayWriteRef : JogCmdArrayWrite
@@ -7576,6 +9386,7 @@ struct JogCmdArrayWriteRef : JogCmdArrayWrite
   JogTypeInfo* type() { return context->type()->element_type; }
 
   void execute( JogVM* vm );
+  Ref<JogCmd> inline_copy( JogInliner* inliner );
 };
 
 struct JogCmdArrayWriteReal64 : JogCmdArrayWrite
@@ -7591,6 +9402,7 @@ struct JogCmdArrayWriteReal64 : JogCmdArrayWrite
   JogTypeInfo* type() { return jog_type_manager.type_real64; }
 
   void execute( JogVM* vm );
+  Ref<JogCmd> inline_copy( JogInliner* inliner );
 };
 
 struct JogCmdArrayWriteReal32 : JogCmdArrayWrite
@@ -7606,6 +9418,7 @@ struct JogCmdArrayWriteReal32 : JogCmdArrayWrite
   JogTypeInfo* type() { return jog_type_manager.type_real32; }
 
   void execute( JogVM* vm );
+  Ref<JogCmd> inline_copy( JogInliner* inliner );
 };
 
 struct JogCmdArrayWriteInt64 : JogCmdArrayWrite
@@ -7621,6 +9434,7 @@ struct JogCmdArrayWriteInt64 : JogCmdArrayWrite
   JogTypeInfo* type() { return jog_type_manager.type_int64; }
 
   void execute( JogVM* vm );
+  Ref<JogCmd> inline_copy( JogInliner* inliner );
 };
 
 struct JogCmdArrayWriteInt32 : JogCmdArrayWrite
@@ -7636,6 +9450,8 @@ struct JogCmdArrayWriteInt32 : JogCmdArrayWrite
   JogTypeInfo* type() { return jog_type_manager.type_int32; }
 
   void execute( JogVM* vm );
+  void compile( JogCodeBuilder* code );
+  Ref<JogCmd> inline_copy( JogInliner* inliner );
 };
 
 struct JogCmdArrayWriteInt16 : JogCmdArrayWrite
@@ -7651,6 +9467,7 @@ struct JogCmdArrayWriteInt16 : JogCmdArrayWrite
   JogTypeInfo* type() { return jog_type_manager.type_int16; }
 
   void execute( JogVM* vm );
+  Ref<JogCmd> inline_copy( JogInliner* inliner );
 };
 
 struct JogCmdArrayWriteInt8 : JogCmdArrayWrite
@@ -7666,6 +9483,7 @@ struct JogCmdArrayWriteInt8 : JogCmdArrayWrite
   JogTypeInfo* type() { return jog_type_manager.type_int8; }
 
   void execute( JogVM* vm );
+  Ref<JogCmd> inline_copy( JogInliner* inliner );
 };
 
 struct JogCmdArrayWriteChar : JogCmdArrayWrite
@@ -7681,6 +9499,7 @@ struct JogCmdArrayWriteChar : JogCmdArrayWrite
   JogTypeInfo* type() { return jog_type_manager.type_char; }
 
   void execute( JogVM* vm );
+  Ref<JogCmd> inline_copy( JogInliner* inliner );
 };
 
 struct JogCmdArrayWriteBoolean : JogCmdArrayWrite
@@ -7696,6 +9515,7 @@ struct JogCmdArrayWriteBoolean : JogCmdArrayWrite
   JogTypeInfo* type() { return jog_type_manager.type_boolean; }
 
   void execute( JogVM* vm );
+  Ref<JogCmd> inline_copy( JogInliner* inliner );
 };
 
 //--------------------------------------------------------------------
@@ -7736,6 +9556,10 @@ struct JogCmdPreStepArray : JogCmd
     vm->push( *index_expr );
     vm->push( *context );
   }
+
+  void compile( JogCodeBuilder* code );
+
+  void visit_operands( JogCmdVisitor* visitor );
 };
 
 template <typename DataType>
@@ -7806,6 +9630,10 @@ struct JogCmdPostStepArray : JogCmd
     vm->push( *index_expr );
     vm->push( *context );
   }
+
+  void compile( JogCodeBuilder* code );
+
+  void visit_operands( JogCmdVisitor* visitor );
 };
 
 template <typename DataType>
@@ -7841,6 +9669,288 @@ struct JogCmdPostStepArrayInteger : JogCmdPostStepArray
 };
 
 
+//=============================================================================
+//  Fused Commands
+//=============================================================================
+// Superinstructions substituted for common node shapes by JogFusionPass.
+struct JogCmdCompareLocalInt32 : JogCmd
+{
+  int node_type() { return __LINE__; }
+
+  JogLocalVarInfo* lhs_info;
+  JogLocalVarInfo* rhs_info;  // NULL when comparing against 'value'
+  int              value;
+
+  JogCmdCompareLocalInt32( Ref<JogToken> t, JogLocalVarInfo* lhs_info, 
+      JogLocalVarInfo* rhs_info, int value ) 
+    : JogCmd(t), lhs_info(lhs_info), rhs_info(rhs_info), value(value)
+  {
+  }
+
+  JogTypeInfo* type() { return jog_type_manager.type_boolean; }
+
+  virtual const char* symbol() = 0;
+  virtual int  register_opcode() = 0;
+
+  void print()
+  {
+    lhs_info->name->print();
+    printf( " %s ", symbol() );
+    if (rhs_info) rhs_info->name->print();
+    else          printf( "%d", value );
+  }
+
+  void on_push( JogVM* vm );
+
+  void compile( JogCodeBuilder* code );
+  int  compile_register( JogCodeBuilder* code, int target );
+  bool is_pure() { return true; }
+};
+
+struct JogCmdLTLocalLocalInt32 : JogCmdCompareLocalInt32
+{
+  int node_type() { return __LINE__; }
+
+  JogCmdLTLocalLocalInt32( Ref<JogToken> t, JogLocalVarInfo* lhs_info, JogLocalVarInfo* rhs_info )
+    : JogCmdCompareLocalInt32(t,lhs_info,rhs_info,0)
+  {
+  }
+
+  const char* symbol() { return "<"; }
+  int  register_opcode() { return JOG_OP_LT_INTEGER_R; }
+
+  void execute( JogVM* vm );
+};
+
+struct JogCmdLTLocalConstInt32 : JogCmdCompareLocalInt32
+{
+  int node_type() { return __LINE__; }
+
+  JogCmdLTLocalConstInt32( Ref<JogToken> t, JogLocalVarInfo* lhs_info, int value )
+    : JogCmdCompareLocalInt32(t,lhs_info,NULL,value)
+  {
+  }
+
+  const char* symbol() { return "<"; }
+  int  register_opcode() { return JOG_OP_LT_INTEGER_R; }
+
+  void execute( JogVM* vm );
+};
+
+struct JogCmdLELocalLocalInt32 : JogCmdCompareLocalInt32
+{
+  int node_type() { return __LINE__; }
+
+  JogCmdLELocalLocalInt32( Ref<JogToken> t, JogLocalVarInfo* lhs_info, JogLocalVarInfo* rhs_info )
+    : JogCmdCompareLocalInt32(t,lhs_info,rhs_info,0)
+  {
+  }
+
+  const char* symbol() { return "<="; }
+  int  register_opcode() { return JOG_OP_LE_INTEGER_R; }
+
+  void execute( JogVM* vm );
+};
+
+struct JogCmdLELocalConstInt32 : JogCmdCompareLocalInt32
+{
+  int node_type() { return __LINE__; }
+
+  JogCmdLELocalConstInt32( Ref<JogToken> t, JogLocalVarInfo* lhs_info, int value )
+    : JogCmdCompareLocalInt32(t,lhs_info,NULL,value)
+  {
+  }
+
+  const char* symbol() { return "<="; }
+  int  register_opcode() { return JOG_OP_LE_INTEGER_R; }
+
+  void execute( JogVM* vm );
+};
+
+struct JogCmdGTLocalLocalInt32 : JogCmdCompareLocalInt32
+{
+  int node_type() { return __LINE__; }
+
+  JogCmdGTLocalLocalInt32( Ref<JogToken> t, JogLocalVarInfo* lhs_info, JogLocalVarInfo* rhs_info )
+    : JogCmdCompareLocalInt32(t,lhs_info,rhs_info,0)
+  {
+  }
+
+  const char* symbol() { return ">"; }
+  int  register_opcode() { return JOG_OP_GT_INTEGER_R; }
+
+  void execute( JogVM* vm );
+};
+
+struct JogCmdGTLocalConstInt32 : JogCmdCompareLocalInt32
+{
+  int node_type() { return __LINE__; }
+
+  JogCmdGTLocalConstInt32( Ref<JogToken> t, JogLocalVarInfo* lhs_info, int value )
+    : JogCmdCompareLocalInt32(t,lhs_info,NULL,value)
+  {
+  }
+
+  const char* symbol() { return ">"; }
+  int  register_opcode() { return JOG_OP_GT_INTEGER_R; }
+
+  void execute( JogVM* vm );
+};
+
+struct JogCmdGELocalLocalInt32 : JogCmdCompareLocalInt32
+{
+  int node_type() { return __LINE__; }
+
+  JogCmdGELocalLocalInt32( Ref<JogToken> t, JogLocalVarInfo* lhs_info, JogLocalVarInfo* rhs_info )
+    : JogCmdCompareLocalInt32(t,lhs_info,rhs_info,0)
+  {
+  }
+
+  const char* symbol() { return ">="; }
+  int  register_opcode() { return JOG_OP_GE_INTEGER_R; }
+
+  void execute( JogVM* vm );
+};
+
+struct JogCmdGELocalConstInt32 : JogCmdCompareLocalInt32
+{
+  int node_type() { return __LINE__; }
+
+  JogCmdGELocalConstInt32( Ref<JogToken> t, JogLocalVarInfo* lhs_info, int value )
+    : JogCmdCompareLocalInt32(t,lhs_info,NULL,value)
+  {
+  }
+
+  const char* symbol() { return ">="; }
+  int  register_opcode() { return JOG_OP_GE_INTEGER_R; }
+
+  void execute( JogVM* vm );
+};
+
+struct JogCmdArrayReadInt32LocalLocal : JogCmd
+{
+  int node_type() { return __LINE__; }
+
+  JogLocalVarInfo* array_info;
+  JogLocalVarInfo* index_info;
+
+  JogCmdArrayReadInt32LocalLocal( Ref<JogToken> t, JogLocalVarInfo* array_info, 
+      JogLocalVarInfo* index_info )
+    : JogCmd(t), array_info(array_info), index_info(index_info)
+  {
+  }
+
+  JogTypeInfo* type() { return jog_type_manager.type_int32; }
+
+  void print()
+  {
+    array_info->name->print();
+    printf("[");
+    index_info->name->print();
+    printf("]");
+  }
+
+  void on_push( JogVM* vm );
+
+  void execute( JogVM* vm );
+  void compile( JogCodeBuilder* code );
+};
+
+struct JogCmdAddAssignLocalConstInt32 : JogCmd
+{
+  int node_type() { return __LINE__; }
+
+  JogLocalVarInfo* var_info;
+  JogInt64         value;  // 'x -= c' is fused as 'x += -c'
+
+  JogCmdAddAssignLocalConstInt32( Ref<JogToken> t, JogLocalVarInfo* var_info, JogInt64 value )
+    : JogCmd(t), var_info(var_info), value(value)
+  {
+  }
+
+  JogTypeInfo* type() { return var_info->type; }
+
+  void print()
+  {
+    var_info->name->print();
+    printf(" += %lld", (long long int) value);
+  }
+
+  void on_push( JogVM* vm );
+
+  void execute( JogVM* vm );
+  void compile( JogCodeBuilder* code );
+  int  compile_register( JogCodeBuilder* code, int target );
+};
+
+
+//=============================================================================
+//  Inlined Calls
+//=============================================================================
+struct JogCmdNullCheck : JogCmdUnary
+{
+  int node_type() { return __LINE__; }
+
+  JogCmdNullCheck( Ref<JogToken> t, Ref<JogCmd> operand ) : JogCmdUnary(t,operand)
+  {
+  }
+
+  void print()
+  {
+    printf("nullCheck:");
+    operand->print();
+  }
+
+  void execute( JogVM* vm );
+  int  fusion_shape() { return JOG_SHAPE_NULL_CHECK; }
+  JogCmd* fusion_operand( int index ) { return index ? NULL : *operand; }
+  Ref<JogCmd> inline_copy( JogInliner* inliner );
+  JogCmd* accessed_object() { return *operand; }
+  Ref<JogCmd> localize( ArrayList<JogLocalVarInfo*>* property_locals );
+};
+
+struct JogCmdInlineCall : JogCmd
+{
+  int node_type() { return __LINE__; }
+
+  JogMethodInfo*  method_info;  // the inlined method
+  RefList<JogCmd> statements;   // argument stores and the body up to its return
+  Ref<JogCmd>     result;       // the returned expression
+
+  JogCmdInlineCall( Ref<JogToken> t, JogMethodInfo* method_info )
+    : JogCmd(t), method_info(method_info)
+  {
+  }
+
+  JogTypeInfo* type() { return result->type(); }
+
+  void print()
+  {
+    printf("inline:");
+    method_info->name->print();
+    printf("(");
+    for (int i=0; i<statements.count; ++i)
+    {
+      statements[i]->print();
+      printf("; ");
+    }
+    result->print();
+    printf(")");
+  }
+
+  void on_push( JogVM* vm );
+
+  void execute( JogVM* vm );
+  void compile( JogCodeBuilder* code );
+
+  void visit_operands( JogCmdVisitor* visitor );
+  int  fusion_shape() { return JOG_SHAPE_INLINE_CALL; }
+  JogCmd* fusion_operand( int index ) { return index ? NULL : *result; }
+  Ref<JogCmd> inline_copy( JogInliner* inliner );
+  Ref<JogCmd> fold( JogConstantFolder* folder );
+};
+
+
 //=============================================================================
 //  JogParser
 //=============================================================================
@@ -603,6 +603,66 @@ void JogMethodInfo::resolve()
         new JogString("<init>"), new JogCmdList(t) );
     statements->commands.insert( new JogCmdStaticCall( t, m, new JogCmdThis(t,type_context), NULL ) );
   }
+
+  compute_stack_depths();
+}
+
+// Pushing a command pushes all of its operands, and theirs, at once, so
+// its instruction depth is its own slots plus the sum of its operands'.
+// Lists and blocks push one operand at a time and need only the deepest.
+// Each operand leaves at most one value while the next one runs, so data
+// and ref depths are the command's own slots plus one per operand value
+// plus the deepest operand.  Build with JOG_CHECK_STACKS to verify these
+// bounds on every push.
+struct JogStackDepth : JogCmdVisitor
+{
+  int data, refs, instructions;        // for the command being measured
+  int data_operands, ref_operands;
+  int max_data, max_refs, max_instructions;  // deepest operand
+  int sum_instructions;                      // all operands
+
+  JogStackDepth() : data(0), refs(0), instructions(0), data_operands(0), ref_operands(0),
+      max_data(0), max_refs(0), max_instructions(0), sum_instructions(0)
+  {
+  }
+
+  void measure( JogCmd* cmd )
+  {
+    cmd->visit_operands( this );
+    data = cmd->own_data_slots() + data_operands + max_data;
+    refs = cmd->own_ref_slots() + ref_operands + max_refs;
+    instructions = cmd->own_instruction_slots() +
+        (cmd->pushes_operands_in_turn() ? max_instructions : sum_instructions);
+  }
+
+  Ref<JogCmd> visit( Ref<JogCmd> cmd )
+  {
+    if ( !*cmd ) return cmd;
+
+    JogStackDepth operand;
+    operand.measure( *cmd );
+    if (operand.data > max_data) max_data = operand.data;
+    if (operand.refs > max_refs) max_refs = operand.refs;
+    if (operand.instructions > max_instructions) max_instructions = operand.instructions;
+    sum_instructions += operand.instructions;
+
+    JogTypeInfo* result_type = cmd->type();
+    if (result_type)
+    {
+      if (result_type->is_primitive()) ++data_operands;
+      else                             ++ref_operands;
+    }
+    return cmd;
+  }
+};
+
+void JogMethodInfo::compute_stack_depths()
+{
+  JogStackDepth depth;
+  depth.measure( *statements );
+  max_data_depth = depth.data;
+  max_ref_depth = depth.refs;
+  max_instruction_depth = depth.instructions;
 }
 
 
@@ -1334,6 +1394,37 @@ Ref<JogCmd> JogCmdBitwiseAnd::resolve()
   }
 }
 
+void JogCmdConcatN::add( Ref<JogCmd> operand )
+{
+  if (operand->fusion_shape() == JOG_SHAPE_CONCAT)
+  {
+    RefList<JogCmd>& pieces = ((JogCmdConcatN*)*operand)->operands;
+    for (int i=0; i<pieces.count; ++i) add( pieces[i] );
+    return;
+  }
+
+  if (operand->fusion_shape() == JOG_SHAPE_LITERAL_STRING)
+  {
+    Ref<JogString> value = ((JogCmdLiteralString*)*operand)->value;
+    if (value->count == 0) return;
+
+    // Adjacent literals are joined now.
+    int last = operands.count - 1;
+    if (last >= 0 && operands[last]->fusion_shape() == JOG_SHAPE_LITERAL_STRING)
+    {
+      Ref<JogString> prior = ((JogCmdLiteralString*)*operands[last])->value;
+      ArrayList<short int> buffer( prior->count + value->count );
+      for (int i=0; i<prior->count; ++i) buffer.add( prior->data[i] );
+      for (int i=0; i<value->count; ++i) buffer.add( value->data[i] );
+      operands[last] = new JogCmdLiteralString( operands[last]->t, 
+          new JogString(buffer.data,buffer.count) );
+      return;
+    }
+  }
+
+  operands.add( operand );
+}
+
 Ref<JogCmd> JogCmdAdd::resolve()
 {
   lhs = lhs->resolve();
@@ -1354,17 +1445,24 @@ Ref<JogCmd> JogCmdAdd::resolve()
         }
         else if ( !rhs_type->instance_of(jog_type_manager.type_string) )
         {
-          rhs = new JogCmdMemberAccess( t,
+          rhs = (new JogCmdMemberAccess( t,
               rhs,
               new JogCmdMethodCall( t, new JogString("toString"), new JogCmdList(t) )
-              );
-        }
-        Ref<JogCmdList> args = new JogCmdList(t);
-        args->add(rhs);
-        return (new JogCmdMemberAccess( t, 
-              lhs,
-              new JogCmdMethodCall( t, new JogString("concat"), args )
               ))->resolve();
+        }
+
+        // Whole chains of '+' become one concatenation.
+        JogCmdConcatN* concat = new JogCmdConcatN( t );
+        Ref<JogCmd> result = concat;
+        concat->add( lhs );
+        concat->add( rhs );
+        if (concat->operands.count == 0) return new JogCmdLiteralString( t, new JogString("") );
+        if (concat->operands.count == 1 
+            && concat->operands[0]->fusion_shape() == JOG_SHAPE_LITERAL_STRING)
+        {
+          return concat->operands[0];
+        }
+        return result;
       }
       else
       {
@@ -2743,16 +2841,12 @@ Ref<JogCmd> JogCmdIdentifier::resolve_op_assign( int op_type, Ref<JogCmd> contex
       if (op_type == TOKEN_ADD_ASSIGN && var_info->type->is_reference())
       {
         // We've already established this as a String.
-        Ref<JogCmdList> args = new JogCmdList(t);
-        args->add(rhs);
+        JogCmdConcatN* concat = new JogCmdConcatN( t );
+        Ref<JogCmd> new_value = concat;
+        concat->add( (new JogCmdIdentifier(t,name))->resolve() );
+        concat->add( rhs );
 
-        Ref<JogCmd> result = new JogCmdAssign( t,
-            this,
-            new JogCmdMemberAccess( t,
-              new JogCmdIdentifier(t,name),
-              new JogCmdMethodCall(t,new JogString("concat"),args)
-            )
-          );
+        Ref<JogCmd> result = new JogCmdAssign( t, this, new_value );
         return result->resolve();
       }
 
@@ -3012,6 +3106,10 @@ Ref<JogCmd> JogCmdIdentifier::resolve_op_assign( int op_type, Ref<JogCmd> contex
               new JogString("toString"), *args, false );
           rhs = (new JogCmdClassCall( t, m, NULL, args ))->resolve();
         }
+        else
+        {
+          rhs = rhs->cast_to_type( var_info->type )->resolve();
+        }
         return (new JogCmdAddAssignPropertyString())->init( t, context, var_info, rhs );
       }
 
@@ -3272,6 +3370,10 @@ Ref<JogCmd> JogCmdIdentifier::resolve_op_assign( int op_type, JogTypeInfo* class
             new JogString("toString"), *args, false );
         rhs = (new JogCmdClassCall( t, m, NULL, args ))->resolve();
       }
+      else
+      {
+        rhs = rhs->cast_to_type( var_info->type )->resolve();
+      }
       return (new JogCmdAddAssignClassPropertyString())->init( t, context, var_info, rhs );
     }
 
@@ -3842,14 +3944,14 @@ Ref<JogCmd> JogCmdIf::resolve()
   if (*body)
   {
     int old_local_count = jog_context->locals.count;
-    body = body->resolve();
+    body = body->resolve()->discarding_result();
     jog_context->locals.discard_from(old_local_count);
   }
 
   if (*else_body)
   {
     int old_local_count = jog_context->locals.count;
-    else_body = else_body->resolve();
+    else_body = else_body->resolve()->discarding_result();
     jog_context->locals.discard_from(old_local_count);
   }
   return this;
@@ -3863,7 +3965,7 @@ Ref<JogCmd> JogCmdWhile::resolve()
   if (*body)
   {
     int old_local_count = jog_context->locals.count;
-    body = body->resolve();
+    body = body->resolve()->discarding_result();
     jog_context->locals.discard_from(old_local_count);
   }
 
@@ -3879,13 +3981,104 @@ Ref<JogCmd> JogCmdFor::resolve()
   condition->require_boolean();
   if (*var_mod) var_mod = var_mod->resolve()->discarding_result();
 
-  if (*body) body = body->resolve();
+  if (*body) body = body->resolve()->discarding_result();
 
   jog_context->locals.discard_from(old_local_count);
 
+  Ref<JogCmd> counted_loop = resolve_counted_loop();
+  if (*counted_loop) return counted_loop;
+
   return this;
 }
 
+struct JogLocalWriteFinder : JogCmdVisitor
+{
+  JogLocalVarInfo* var_info;
+  bool             found;
+
+  JogLocalWriteFinder( JogLocalVarInfo* var_info ) : var_info(var_info), found(false) { }
+
+  Ref<JogCmd> rewrite( Ref<JogCmd> cmd )
+  {
+    if (cmd->written_local() == var_info) found = true;
+    return cmd;
+  }
+};
+
+static JogLocalVarInfo* counted_loop_step( JogCmd* var_mod )
+{
+  // Returns the int local that 'var_mod' increments by one, if any.
+  if ( !var_mod || var_mod->fusion_shape() != JOG_SHAPE_DISCARD_DATA ) return NULL;
+  JogCmd* step = var_mod->fusion_operand(0);
+
+  switch (step->fusion_shape())
+  {
+    case JOG_SHAPE_PRE_STEP_LOCAL_INT32:
+      if (((JogCmdPreStepLocal*)step)->modifier == 1) return step->written_local();
+      break;
+
+    case JOG_SHAPE_POST_STEP_LOCAL_INT32:
+      if (((JogCmdPostStepLocal*)step)->modifier == 1) return step->written_local();
+      break;
+
+    case JOG_SHAPE_ADD_ASSIGN_LOCAL_INT32:
+      {
+        JogCmd* operand = step->fusion_operand(0);
+        if (operand->fusion_shape() == JOG_SHAPE_LITERAL_INT32
+            && ((JogCmdLiteralInt32*)operand)->value == 1)
+        {
+          return step->written_local();
+        }
+      }
+      break;
+  }
+  return NULL;
+}
+
+Ref<JogCmd> JogCmdFor::resolve_counted_loop()
+{
+  int shape = condition->fusion_shape();
+  if (shape != JOG_SHAPE_LT_INTEGER && shape != JOG_SHAPE_LE_INTEGER) return NULL;
+
+  JogCmd* counter = condition->fusion_operand(0);
+  if (counter->fusion_shape() != JOG_SHAPE_LOCAL_INT32) return NULL;
+  JogLocalVarInfo* var_info = ((JogCmdReadLocal*)counter)->var_info;
+  if (counted_loop_step(*var_mod) != var_info) return NULL;
+
+  JogLocalWriteFinder finder( var_info );
+  finder.visit( body );
+  if (finder.found) return NULL;
+
+  JogCmd* limit = condition->fusion_operand(1);
+  Ref<JogCmdCountedLoop> loop = new JogCmdCountedLoop( t, initialization, var_info, limit,
+      shape == JOG_SHAPE_LE_INTEGER );
+  switch (limit->fusion_shape())
+  {
+    case JOG_SHAPE_LITERAL_INT32:
+      loop->limit_value = ((JogCmdLiteralInt32*)limit)->value;
+      break;
+
+    case JOG_SHAPE_LOCAL_INT32:
+      loop->limit_info = ((JogCmdReadLocal*)limit)->var_info;
+      break;
+
+    case JOG_SHAPE_ARRAY_SIZE:
+      {
+        JogCmd* array = limit->fusion_operand(0);
+        if (array->fusion_shape() != JOG_SHAPE_LOCAL_REF) return NULL;
+        loop->limit_info = ((JogCmdReadLocal*)array)->var_info;
+        loop->limit_is_length = true;
+      }
+      break;
+
+    default:
+      return NULL;
+  }
+
+  loop->body = body;
+  return *loop;
+}
+
 Ref<JogCmd> JogCmdForEach::resolve()
 {
   Ref<JogString> iter_name = new JogString("_");
@@ -4278,7 +4471,7 @@ Ref<JogCmd> JogCmdMemberAccess::resolve_op_assign( int op_type,
   if (class_context) 
   {
     class_context->resolve();
-    return member->resolve_op_assign( op_type, class_context, context, rhs );
+    return member->resolve_op_assign( op_type, class_context, NULL, rhs );
   }
 
   return member->resolve_op_assign( op_type, context->resolve(), rhs );
@@ -4841,3 +5034,2376 @@ JogCmdThis::JogCmdThis( Ref<JogToken> t, JogTypeInfo* this_type )
   }
 }
 
+
+
+//=============================================================================
+//  visit_operands()
+//=============================================================================
+void JogCmdList::visit_operands( JogCmdVisitor* visitor )
+{
+  for (int i=0; i<commands.count; ++i)
+  {
+    commands[i] = visitor->visit( commands[i] );
+  }
+}
+
+void JogCmdBlock::visit_operands( JogCmdVisitor* visitor )
+{
+  statements->visit_operands( visitor );
+}
+
+void JogCmdAssert::visit_operands( JogCmdVisitor* visitor )
+{
+  expression = visitor->visit( expression );
+}
+
+void JogCmdControlStructure::visit_operands( JogCmdVisitor* visitor )
+{
+  body = visitor->visit( body );
+}
+
+void JogCmdIf::visit_operands( JogCmdVisitor* visitor )
+{
+  expression = visitor->visit( expression );
+  body = visitor->visit( body );
+  else_body = visitor->visit( else_body );
+}
+
+void JogCmdWhile::visit_operands( JogCmdVisitor* visitor )
+{
+  expression = visitor->visit( expression );
+  body = visitor->visit( body );
+}
+
+void JogCmdFor::visit_operands( JogCmdVisitor* visitor )
+{
+  initialization = visitor->visit( initialization );
+  condition = visitor->visit( condition );
+  var_mod = visitor->visit( var_mod );
+  body = visitor->visit( body );
+}
+
+void JogCmdCountedLoop::visit_operands( JogCmdVisitor* visitor )
+{
+  initialization = visitor->visit( initialization );
+  body = visitor->visit( body );
+}
+
+void JogCmdUnary::visit_operands( JogCmdVisitor* visitor )
+{
+  operand = visitor->visit( operand );
+}
+
+void JogCmdConditional::visit_operands( JogCmdVisitor* visitor )
+{
+  condition = visitor->visit( condition );
+  true_value = visitor->visit( true_value );
+  false_value = visitor->visit( false_value );
+}
+
+void JogCmdBinary::visit_operands( JogCmdVisitor* visitor )
+{
+  lhs = visitor->visit( lhs );
+  rhs = visitor->visit( rhs );
+}
+
+void JogCmdConcatN::visit_operands( JogCmdVisitor* visitor )
+{
+  for (int i=0; i<operands.count; ++i) operands[i] = visitor->visit( operands[i] );
+}
+
+void JogCmdInstanceOf::visit_operands( JogCmdVisitor* visitor )
+{
+  operand = visitor->visit( operand );
+}
+
+void JogCmdShift::visit_operands( JogCmdVisitor* visitor )
+{
+  operand = visitor->visit( operand );
+  shift_amount = visitor->visit( shift_amount );
+}
+
+void JogCmdNewObject::visit_operands( JogCmdVisitor* visitor )
+{
+  if (*args) args->visit_operands( visitor );
+}
+
+void JogCmdNewArray::visit_operands( JogCmdVisitor* visitor )
+{
+  size_expr = visitor->visit( size_expr );
+  element_expr = visitor->visit( element_expr );
+}
+
+void JogCmdLiteralArray::visit_operands( JogCmdVisitor* visitor )
+{
+  if (*terms) terms->visit_operands( visitor );
+}
+
+void JogCmdArrayAccess::visit_operands( JogCmdVisitor* visitor )
+{
+  context = visitor->visit( context );
+  index_expr = visitor->visit( index_expr );
+}
+
+void JogCmdArrayWrite::visit_operands( JogCmdVisitor* visitor )
+{
+  JogCmdArrayAccess::visit_operands( visitor );
+  new_value = visitor->visit( new_value );
+}
+
+void JogCmdArraySize::visit_operands( JogCmdVisitor* visitor )
+{
+  context = visitor->visit( context );
+}
+
+void JogCmdStaticCall::visit_operands( JogCmdVisitor* visitor )
+{
+  context = visitor->visit( context );
+  if (*args) args->visit_operands( visitor );
+}
+
+void JogCmdClassCall::visit_operands( JogCmdVisitor* visitor )
+{
+  context = visitor->visit( context );
+  if (*args) args->visit_operands( visitor );
+}
+
+void JogCmdReadClassProperty::visit_operands( JogCmdVisitor* visitor )
+{
+  context = visitor->visit( context );
+}
+
+void JogCmdWriteClassProperty::visit_operands( JogCmdVisitor* visitor )
+{
+  context = visitor->visit( context );
+  new_value = visitor->visit( new_value );
+}
+
+void JogCmdReadProperty::visit_operands( JogCmdVisitor* visitor )
+{
+  context = visitor->visit( context );
+}
+
+void JogCmdWriteProperty::visit_operands( JogCmdVisitor* visitor )
+{
+  context = visitor->visit( context );
+  new_value = visitor->visit( new_value );
+}
+
+void JogCmdWriteLocal::visit_operands( JogCmdVisitor* visitor )
+{
+  new_value = visitor->visit( new_value );
+}
+
+void JogCmdOpAssignLocal::visit_operands( JogCmdVisitor* visitor )
+{
+  operand = visitor->visit( operand );
+}
+
+void JogCmdOpAssignProperty::visit_operands( JogCmdVisitor* visitor )
+{
+  context = visitor->visit( context );
+  operand = visitor->visit( operand );
+}
+
+void JogCmdOpAssignClassProperty::visit_operands( JogCmdVisitor* visitor )
+{
+  context = visitor->visit( context );
+  operand = visitor->visit( operand );
+}
+
+void JogCmdOpAssignArray::visit_operands( JogCmdVisitor* visitor )
+{
+  context = visitor->visit( context );
+  index_expr = visitor->visit( index_expr );
+  operand = visitor->visit( operand );
+}
+
+void JogCmdPreStepProperty::visit_operands( JogCmdVisitor* visitor )
+{
+  context = visitor->visit( context );
+}
+
+void JogCmdPostStepProperty::visit_operands( JogCmdVisitor* visitor )
+{
+  context = visitor->visit( context );
+}
+
+void JogCmdPreStepClassProperty::visit_operands( JogCmdVisitor* visitor )
+{
+  context = visitor->visit( context );
+}
+
+void JogCmdPostStepClassProperty::visit_operands( JogCmdVisitor* visitor )
+{
+  context = visitor->visit( context );
+}
+
+void JogCmdPreStepArray::visit_operands( JogCmdVisitor* visitor )
+{
+  context = visitor->visit( context );
+  index_expr = visitor->visit( index_expr );
+}
+
+void JogCmdPostStepArray::visit_operands( JogCmdVisitor* visitor )
+{
+  context = visitor->visit( context );
+  index_expr = visitor->visit( index_expr );
+}
+
+
+//=============================================================================
+//  Fusion
+//=============================================================================
+// Each rule matches a root node shape and the shapes of its first two
+// operands; JOG_SHAPE_ANY matches any operand, including none.
+struct JogFusionRule
+{
+  int root_shape;
+  int operand_a_shape;
+  int operand_b_shape;
+  Ref<JogCmd> (*fuse)( JogCmd* root, JogCmd* a, JogCmd* b );
+};
+
+static JogLocalVarInfo* fused_local( JogCmd* cmd )
+{
+  return ((JogCmdReadLocal*)cmd)->var_info;
+}
+
+static int fused_int32( JogCmd* cmd )
+{
+  return ((JogCmdLiteralInt32*)cmd)->value;
+}
+
+static Ref<JogCmd> fuse_lt_local_local( JogCmd* root, JogCmd* a, JogCmd* b )
+{
+  return new JogCmdLTLocalLocalInt32( root->t, fused_local(a), fused_local(b) );
+}
+
+static Ref<JogCmd> fuse_le_local_local( JogCmd* root, JogCmd* a, JogCmd* b )
+{
+  return new JogCmdLELocalLocalInt32( root->t, fused_local(a), fused_local(b) );
+}
+
+static Ref<JogCmd> fuse_gt_local_local( JogCmd* root, JogCmd* a, JogCmd* b )
+{
+  return new JogCmdGTLocalLocalInt32( root->t, fused_local(a), fused_local(b) );
+}
+
+static Ref<JogCmd> fuse_ge_local_local( JogCmd* root, JogCmd* a, JogCmd* b )
+{
+  return new JogCmdGELocalLocalInt32( root->t, fused_local(a), fused_local(b) );
+}
+
+static Ref<JogCmd> fuse_lt_local_const( JogCmd* root, JogCmd* a, JogCmd* b )
+{
+  return new JogCmdLTLocalConstInt32( root->t, fused_local(a), fused_int32(b) );
+}
+
+static Ref<JogCmd> fuse_le_local_const( JogCmd* root, JogCmd* a, JogCmd* b )
+{
+  return new JogCmdLELocalConstInt32( root->t, fused_local(a), fused_int32(b) );
+}
+
+static Ref<JogCmd> fuse_gt_local_const( JogCmd* root, JogCmd* a, JogCmd* b )
+{
+  return new JogCmdGTLocalConstInt32( root->t, fused_local(a), fused_int32(b) );
+}
+
+static Ref<JogCmd> fuse_ge_local_const( JogCmd* root, JogCmd* a, JogCmd* b )
+{
+  return new JogCmdGELocalConstInt32( root->t, fused_local(a), fused_int32(b) );
+}
+
+static Ref<JogCmd> fuse_array_read_int32( JogCmd* root, JogCmd* a, JogCmd* b )
+{
+  return new JogCmdArrayReadInt32LocalLocal( root->t, fused_local(a), fused_local(b) );
+}
+
+static Ref<JogCmd> fuse_add_assign_const( JogCmd* root, JogCmd* a, JogCmd* b )
+{
+  JogLocalVarInfo* var_info = ((JogCmdOpAssignLocal*)root)->var_info;
+  return new JogCmdAddAssignLocalConstInt32( root->t, var_info, fused_int32(a) );
+}
+
+static Ref<JogCmd> fuse_sub_assign_const( JogCmd* root, JogCmd* a, JogCmd* b )
+{
+  JogLocalVarInfo* var_info = ((JogCmdOpAssignLocal*)root)->var_info;
+  return new JogCmdAddAssignLocalConstInt32( root->t, var_info, -(JogInt64)fused_int32(a) );
+}
+
+static JogFusionRule jog_fusion_rules[] =
+{
+  { JOG_SHAPE_LT_INTEGER, JOG_SHAPE_LOCAL_INT32, JOG_SHAPE_LOCAL_INT32,   fuse_lt_local_local },
+  { JOG_SHAPE_LE_INTEGER, JOG_SHAPE_LOCAL_INT32, JOG_SHAPE_LOCAL_INT32,   fuse_le_local_local },
+  { JOG_SHAPE_GT_INTEGER, JOG_SHAPE_LOCAL_INT32, JOG_SHAPE_LOCAL_INT32,   fuse_gt_local_local },
+  { JOG_SHAPE_GE_INTEGER, JOG_SHAPE_LOCAL_INT32, JOG_SHAPE_LOCAL_INT32,   fuse_ge_local_local },
+  { JOG_SHAPE_LT_INTEGER, JOG_SHAPE_LOCAL_INT32, JOG_SHAPE_LITERAL_INT32, fuse_lt_local_const },
+  { JOG_SHAPE_LE_INTEGER, JOG_SHAPE_LOCAL_INT32, JOG_SHAPE_LITERAL_INT32, fuse_le_local_const },
+  { JOG_SHAPE_GT_INTEGER, JOG_SHAPE_LOCAL_INT32, JOG_SHAPE_LITERAL_INT32, fuse_gt_local_const },
+  { JOG_SHAPE_GE_INTEGER, JOG_SHAPE_LOCAL_INT32, JOG_SHAPE_LITERAL_INT32, fuse_ge_local_const },
+  { JOG_SHAPE_ARRAY_READ_INT32, JOG_SHAPE_LOCAL_REF, JOG_SHAPE_LOCAL_INT32, fuse_array_read_int32 },
+  { JOG_SHAPE_ADD_ASSIGN_LOCAL_INT32, JOG_SHAPE_LITERAL_INT32, JOG_SHAPE_ANY, fuse_add_assign_const },
+  { JOG_SHAPE_SUB_ASSIGN_LOCAL_INT32, JOG_SHAPE_LITERAL_INT32, JOG_SHAPE_ANY, fuse_sub_assign_const },
+  { JOG_SHAPE_NONE, JOG_SHAPE_NONE, JOG_SHAPE_NONE, NULL }
+};
+
+static bool fusion_shape_matches( int shape, JogCmd* cmd )
+{
+  if (shape == JOG_SHAPE_ANY) return true;
+  return cmd && cmd->fusion_shape() == shape;
+}
+
+struct JogFusionPass : JogCmdVisitor
+{
+  Ref<JogCmd> rewrite( Ref<JogCmd> cmd )
+  {
+    int shape = cmd->fusion_shape();
+    if (shape == JOG_SHAPE_NONE) return cmd;
+
+    for (JogFusionRule* rule=jog_fusion_rules; rule->fuse; ++rule)
+    {
+      if (rule->root_shape != shape) continue;
+
+      JogCmd* a = cmd->fusion_operand(0);
+      JogCmd* b = cmd->fusion_operand(1);
+      if (fusion_shape_matches(rule->operand_a_shape,a) 
+          && fusion_shape_matches(rule->operand_b_shape,b))
+      {
+        return rule->fuse( *cmd, a, b );
+      }
+    }
+    return cmd;
+  }
+};
+
+static void fuse_method( JogMethodInfo* m, JogFusionPass& pass )
+{
+  if (*(m->statements)) m->statements->visit_operands( &pass );
+}
+
+static void fuse_methods( RefList<JogMethodInfo>& methods, JogFusionPass& pass )
+{
+  for (int i=0; i<methods.count; ++i) fuse_method( *(methods[i]), pass );
+}
+
+void JogVM::fuse_instructions()
+{
+  JogFusionPass pass;
+  for (JogTypeLookup::iterator cur=jog_type_manager.type_lookup.begin();
+      cur != jog_type_manager.type_lookup.end(); ++cur)
+  {
+    JogTypeInfo* type = *(cur->second);
+    if ( !type->resolved ) continue;
+
+    fuse_methods( type->class_methods, pass );
+    fuse_methods( type->methods, pass );
+    fuse_methods( type->static_initializers, pass );
+    if (*(type->m_init_object)) fuse_method( *(type->m_init_object), pass );
+  }
+}
+
+//=============================================================================
+//  Devirtualization
+//=============================================================================
+static JogMethodInfo* single_implementation( JogTypeInfo* receiver_type, int dispatch_id )
+{
+  // Returns the only method that an object of 'receiver_type' can dispatch
+  // to, or NULL if there could be more than one.
+  JogMethodInfo* result = NULL;
+  for (JogTypeLookup::iterator cur=jog_type_manager.type_lookup.begin();
+      cur != jog_type_manager.type_lookup.end(); ++cur)
+  {
+    JogTypeInfo* type = *(cur->second);
+    if ( !type->resolved || !type->is_class() || type->is_abstract() ) continue;
+    if (type == jog_type_manager.type_null) continue;
+    if ( !type->instance_of(receiver_type) ) continue;
+
+    if (dispatch_id >= type->dispatch_table.count) return NULL;
+    JogMethodInfo* m = type->dispatch_table[dispatch_id];
+    if ( !m || m->is_abstract() ) return NULL;
+    if (result && m != result) return NULL;
+    result = m;
+  }
+  return result;
+}
+
+struct JogDevirtualizationPass : JogCmdVisitor
+{
+  int call_count;
+  int devirtualized_count;
+
+  JogDevirtualizationPass() : call_count(0), devirtualized_count(0)
+  {
+  }
+
+  Ref<JogCmd> rewrite( Ref<JogCmd> cmd )
+  {
+    if ( !cmd->is_dynamic_call() ) return cmd;
+    ++call_count;
+
+    JogCmdDynamicCall* call = (JogCmdDynamicCall*) *cmd;
+    JogMethodInfo* m = single_implementation( call->context->type(), 
+        call->method_info->dispatch_id );
+    if ( !m ) return cmd;
+
+    ++devirtualized_count;
+    return new JogCmdStaticCall( call->t, m, call->context, call->args );
+  }
+};
+
+static void devirtualize_method( JogMethodInfo* m, JogDevirtualizationPass& pass )
+{
+  if (*(m->statements)) m->statements->visit_operands( &pass );
+}
+
+static void devirtualize_methods( JogTypeInfo* type, RefList<JogMethodInfo>& methods, 
+    JogDevirtualizationPass& pass )
+{
+  // Inherited methods are visited with the type that declares them.
+  for (int i=0; i<methods.count; ++i)
+  {
+    if (methods[i]->type_context == type) devirtualize_method( *(methods[i]), pass );
+  }
+}
+
+void JogVM::devirtualize_calls()
+{
+  // Whole-program class hierarchy analysis: every type is known once
+  // compile() has resolved them, so a dynamic call whose receiver type
+  // has a single implementation can call it directly.
+  JogDevirtualizationPass pass;
+  for (JogTypeLookup::iterator cur=jog_type_manager.type_lookup.begin();
+      cur != jog_type_manager.type_lookup.end(); ++cur)
+  {
+    JogTypeInfo* type = *(cur->second);
+    if ( !type->resolved ) continue;
+
+    devirtualize_methods( type, type->class_methods, pass );
+    devirtualize_methods( type, type->methods, pass );
+    devirtualize_methods( type, type->static_initializers, pass );
+    if (*(type->m_init_object)) devirtualize_method( *(type->m_init_object), pass );
+  }
+
+  if (report_optimizations)
+  {
+    printf( "Devirtualized %d of %d dynamic call sites.\n", 
+        pass.devirtualized_count, pass.call_count );
+  }
+}
+
+//=============================================================================
+//  Inlining
+//=============================================================================
+// Copies a callee's body into a caller.  Callee locals map to new caller
+// locals, or to the caller's own locals and literals for parameters whose
+// arguments are simple; 'this' maps to the call's context.  Copies fail on
+// nodes without an inline_copy(), and on branches and loops unless
+// 'control_flow' is set.  A void method's 'return' outside of its loops is
+// copied as a 'break' out of a loop run once around the body.
+struct JogInliner
+{
+  JogMethodInfo* caller;
+  Ref<JogToken>  call_t;
+  Ref<JogCmd>    context;  // JogCmdThis or a local read
+
+  ArrayList<JogLocalVarInfo*> callee_locals;
+  ArrayList<JogLocalVarInfo*> caller_locals;  // NULL where a literal is used
+  RefList<JogCmd>             literals;
+
+  RefList<JogLocalVarInfo>    new_locals;     // added to 'caller' on success
+  int  new_data_count, new_ref_count;
+  bool failed;
+  bool returned;
+  bool control_flow;
+  int  exits;       // copied 'return's of a void method
+  int  loop_depth;  // of the command being copied
+
+  // Copies are made in evaluation order.  'effects' is set once a copied
+  // command could throw or change state; if the body reads a property of
+  // 'this' before that, the read doubles as the call's null check.
+  bool effects;
+  bool context_checked;
+
+  JogInliner( JogMethodInfo* caller, Ref<JogToken> call_t ) : caller(caller), 
+      call_t(call_t), new_data_count(0), new_ref_count(0), failed(false), 
+      returned(false), control_flow(false), exits(0), loop_depth(0), effects(false),
+      context_checked(false)
+  {
+  }
+
+  Ref<JogCmd> copy( Ref<JogCmd> cmd )
+  {
+    if (failed) return NULL;
+    if ( !*cmd || cmd->is_literal() ) return cmd;
+
+    Ref<JogCmd> result = cmd->inline_copy( this );
+    if ( !*result ) failed = true;
+    return result;
+  }
+
+  Ref<JogCmdList> copy_args( Ref<JogCmdList> args )
+  {
+    if ( !*args ) return args;
+
+    Ref<JogCmdList> result = new JogCmdList( args->t );
+    for (int i=0; i<args->commands.count; ++i)
+    {
+      result->add( copy(args->commands[i]) );
+    }
+    return result;
+  }
+
+  Ref<JogToken> access_t( JogCmd* context, Ref<JogToken> t )
+  {
+    // Token for a property access whose copied context is 'context'; see
+    // 'effects'.
+    if (context->is_this() && !effects)
+    {
+      context_checked = true;
+      t = call_t;  // report a null context at the call
+    }
+    effects = true;
+    return t;
+  }
+
+  Ref<JogCmd> copy_this( Ref<JogToken> t )
+  {
+    if (context->is_this()) return new JogCmdThis( t, context->type() );
+    return new JogCmdReadLocalRef( t, context->read_local() );
+  }
+
+  void map( JogLocalVarInfo* callee_local, JogLocalVarInfo* caller_local, Ref<JogCmd> literal )
+  {
+    callee_locals.add( callee_local );
+    caller_locals.add( caller_local );
+    literals.add( literal );
+  }
+
+  JogLocalVarInfo* add_local( JogLocalVarInfo* callee_local )
+  {
+    Ref<JogLocalVarInfo> info = new JogLocalVarInfo( callee_local->t, 
+        callee_local->type, callee_local->name );
+    info->index = caller->locals.count + new_locals.count;
+    if (info->type->is_reference())
+    {
+      info->offset = -(caller->param_ref_count + caller->local_ref_count + ++new_ref_count);
+    }
+    else
+    {
+      info->offset = -(caller->param_data_count + caller->local_data_count + ++new_data_count);
+    }
+    new_locals.add( info );
+    map( callee_local, *info, NULL );
+    return *info;
+  }
+
+  int find( JogLocalVarInfo* callee_local )
+  {
+    for (int i=0; i<callee_locals.count; ++i)
+    {
+      if (callee_locals[i] == callee_local) return i;
+    }
+    return -1;
+  }
+
+  JogLocalVarInfo* local_for( JogLocalVarInfo* callee_local )
+  {
+    int i = find( callee_local );
+    if (i == -1) return add_local( callee_local );
+    if ( !caller_locals[i] ) failed = true;  // literal parameters are never written
+    return caller_locals[i];
+  }
+
+  Ref<JogCmd> read( Ref<JogToken> t, JogLocalVarInfo* callee_local )
+  {
+    int i = find( callee_local );
+    if (i >= 0 && *(literals[i])) return literals[i];
+
+    JogLocalVarInfo* info = local_for( callee_local );
+    if (info->type->is_reference()) return new JogCmdReadLocalRef( t, info );
+    return new JogCmdReadLocalData( t, info );
+  }
+
+  Ref<JogCmd> write( Ref<JogToken> t, JogLocalVarInfo* caller_local, Ref<JogCmd> new_value )
+  {
+    if (caller_local->type->is_reference())
+    {
+      return new JogCmdWriteLocalRef( t, caller_local, new_value );
+    }
+    return new JogCmdWriteLocalData( t, caller_local, new_value );
+  }
+
+  void commit()
+  {
+    for (int i=0; i<new_locals.count; ++i) caller->locals.add( new_locals[i] );
+    caller->local_data_count += new_data_count;
+    caller->local_ref_count += new_ref_count;
+  }
+};
+
+template <class CmdType>
+static Ref<JogCmd> inline_copy_unary( CmdType* cmd, JogInliner* inliner )
+{
+  Ref<JogCmd> operand = inliner->copy( cmd->operand );
+  if (inliner->failed) return NULL;
+  return new CmdType( cmd->t, operand );
+}
+
+template <class CmdType>
+static Ref<JogCmd> inline_copy_effect( CmdType* cmd, JogInliner* inliner )
+{
+  Ref<JogCmd> result = inline_copy_unary( cmd, inliner );
+  inliner->effects = true;
+  return result;
+}
+
+template <class CmdType>
+static Ref<JogCmd> inline_copy_binary( CmdType* cmd, JogInliner* inliner )
+{
+  Ref<JogCmd> lhs = inliner->copy( cmd->lhs );
+  Ref<JogCmd> rhs = inliner->copy( cmd->rhs );
+  if (inliner->failed) return NULL;
+  return new CmdType( cmd->t, lhs, rhs );
+}
+
+template <class CmdType>
+static Ref<JogCmd> inline_copy_division( CmdType* cmd, JogInliner* inliner )
+{
+  // Integer division throws on a zero divisor.
+  Ref<JogCmd> result = inline_copy_binary( cmd, inliner );
+  inliner->effects = true;
+  return result;
+}
+
+template <class CmdType>
+static Ref<JogCmd> inline_copy_logical( CmdType* cmd, JogInliner* inliner )
+{
+  // The rhs doesn't always run, so nothing in it can double as the call's
+  // null check.
+  Ref<JogCmd> lhs = inliner->copy( cmd->lhs );
+  inliner->effects = true;
+  Ref<JogCmd> rhs = inliner->copy( cmd->rhs );
+  if (inliner->failed) return NULL;
+  return new CmdType( cmd->t, lhs, rhs );
+}
+
+template <class CmdType>
+static Ref<JogCmd> inline_copy_shift( CmdType* cmd, JogInliner* inliner )
+{
+  Ref<JogCmd> operand = inliner->copy( cmd->operand );
+  Ref<JogCmd> shift_amount = inliner->copy( cmd->shift_amount );
+  if (inliner->failed) return NULL;
+  return new CmdType( cmd->t, operand, shift_amount );
+}
+
+template <class CmdType>
+static Ref<JogCmd> inline_copy_array_read( CmdType* cmd, JogInliner* inliner )
+{
+  Ref<JogCmd> context = inliner->copy( cmd->context );
+  Ref<JogCmd> index_expr = inliner->copy( cmd->index_expr );
+  inliner->effects = true;
+  if (inliner->failed) return NULL;
+  return new CmdType( cmd->t, context, index_expr );
+}
+
+template <class CmdType>
+static Ref<JogCmd> inline_copy_array_write( CmdType* cmd, JogInliner* inliner )
+{
+  Ref<JogCmd> context = inliner->copy( cmd->context );
+  Ref<JogCmd> index_expr = inliner->copy( cmd->index_expr );
+  Ref<JogCmd> new_value = inliner->copy( cmd->new_value );
+  inliner->effects = true;
+  if (inliner->failed) return NULL;
+  return new CmdType( cmd->t, context, index_expr, new_value );
+}
+
+template <class CmdType>
+static Ref<JogCmd> inline_copy_property_read( CmdType* cmd, JogInliner* inliner )
+{
+  Ref<JogCmd> context = inliner->copy( cmd->context );
+  if (inliner->failed) return NULL;
+
+  Ref<JogToken> t = inliner->access_t( *(cmd->context), cmd->t );
+  return new CmdType( t, context, cmd->var_info );
+}
+
+template <class CmdType>
+static Ref<JogCmd> inline_copy_property_write( CmdType* cmd, JogInliner* inliner )
+{
+  Ref<JogCmd> context = inliner->copy( cmd->context );
+  Ref<JogCmd> new_value = inliner->copy( cmd->new_value );
+  if (inliner->failed) return NULL;
+
+  // The write's null check follows the evaluation of its new value.
+  Ref<JogToken> t = inliner->access_t( *(cmd->context), cmd->t );
+  return new CmdType( t, context, cmd->var_info, new_value );
+}
+
+template <class CmdType>
+static Ref<JogCmd> inline_copy_call( CmdType* cmd, JogInliner* inliner )
+{
+  Ref<JogCmd> context = *(cmd->context) ? inliner->copy(cmd->context) : cmd->context;
+  Ref<JogCmdList> args = inliner->copy_args( cmd->args );
+  inliner->effects = true;
+  if (inliner->failed) return NULL;
+  return new CmdType( cmd->t, cmd->method_info, context, args );
+}
+
+Ref<JogCmd> JogCmd::inline_copy( JogInliner* inliner ) { return NULL; }
+
+Ref<JogCmd> JogCmdEQReal::inline_copy( JogInliner* inliner ) { return inline_copy_binary( this, inliner ); }
+Ref<JogCmd> JogCmdEQInteger::inline_copy( JogInliner* inliner ) { return inline_copy_binary( this, inliner ); }
+Ref<JogCmd> JogCmdEQRef::inline_copy( JogInliner* inliner ) { return inline_copy_binary( this, inliner ); }
+Ref<JogCmd> JogCmdNEReal::inline_copy( JogInliner* inliner ) { return inline_copy_binary( this, inliner ); }
+Ref<JogCmd> JogCmdNEInteger::inline_copy( JogInliner* inliner ) { return inline_copy_binary( this, inliner ); }
+Ref<JogCmd> JogCmdNERef::inline_copy( JogInliner* inliner ) { return inline_copy_binary( this, inliner ); }
+Ref<JogCmd> JogCmdLTReal::inline_copy( JogInliner* inliner ) { return inline_copy_binary( this, inliner ); }
+Ref<JogCmd> JogCmdLTInteger::inline_copy( JogInliner* inliner ) { return inline_copy_binary( this, inliner ); }
+Ref<JogCmd> JogCmdLEReal::inline_copy( JogInliner* inliner ) { return inline_copy_binary( this, inliner ); }
+Ref<JogCmd> JogCmdLEInteger::inline_copy( JogInliner* inliner ) { return inline_copy_binary( this, inliner ); }
+Ref<JogCmd> JogCmdGTReal::inline_copy( JogInliner* inliner ) { return inline_copy_binary( this, inliner ); }
+Ref<JogCmd> JogCmdGTInteger::inline_copy( JogInliner* inliner ) { return inline_copy_binary( this, inliner ); }
+Ref<JogCmd> JogCmdGEReal::inline_copy( JogInliner* inliner ) { return inline_copy_binary( this, inliner ); }
+Ref<JogCmd> JogCmdGEInteger::inline_copy( JogInliner* inliner ) { return inline_copy_binary( this, inliner ); }
+Ref<JogCmd> JogCmdAddReal64::inline_copy( JogInliner* inliner ) { return inline_copy_binary( this, inliner ); }
+Ref<JogCmd> JogCmdAddReal32::inline_copy( JogInliner* inliner ) { return inline_copy_binary( this, inliner ); }
+Ref<JogCmd> JogCmdAddInt64::inline_copy( JogInliner* inliner ) { return inline_copy_binary( this, inliner ); }
+Ref<JogCmd> JogCmdAddInt32::inline_copy( JogInliner* inliner ) { return inline_copy_binary( this, inliner ); }
+Ref<JogCmd> JogCmdSubReal64::inline_copy( JogInliner* inliner ) { return inline_copy_binary( this, inliner ); }
+Ref<JogCmd> JogCmdSubReal32::inline_copy( JogInliner* inliner ) { return inline_copy_binary( this, inliner ); }
+Ref<JogCmd> JogCmdSubInt64::inline_copy( JogInliner* inliner ) { return inline_copy_binary( this, inliner ); }
+Ref<JogCmd> JogCmdSubInt32::inline_copy( JogInliner* inliner ) { return inline_copy_binary( this, inliner ); }
+Ref<JogCmd> JogCmdMulReal64::inline_copy( JogInliner* inliner ) { return inline_copy_binary( this, inliner ); }
+Ref<JogCmd> JogCmdMulReal32::inline_copy( JogInliner* inliner ) { return inline_copy_binary( this, inliner ); }
+Ref<JogCmd> JogCmdMulInt64::inline_copy( JogInliner* inliner ) { return inline_copy_binary( this, inliner ); }
+Ref<JogCmd> JogCmdMulInt32::inline_copy( JogInliner* inliner ) { return inline_copy_binary( this, inliner ); }
+Ref<JogCmd> JogCmdDivReal64::inline_copy( JogInliner* inliner ) { return inline_copy_binary( this, inliner ); }
+Ref<JogCmd> JogCmdDivReal32::inline_copy( JogInliner* inliner ) { return inline_copy_binary( this, inliner ); }
+Ref<JogCmd> JogCmdDivInt64::inline_copy( JogInliner* inliner ) { return inline_copy_division( this, inliner ); }
+Ref<JogCmd> JogCmdDivInt32::inline_copy( JogInliner* inliner ) { return inline_copy_division( this, inliner ); }
+Ref<JogCmd> JogCmdModInt64::inline_copy( JogInliner* inliner ) { return inline_copy_division( this, inliner ); }
+Ref<JogCmd> JogCmdModInt32::inline_copy( JogInliner* inliner ) { return inline_copy_division( this, inliner ); }
+Ref<JogCmd> JogCmdAndInt64::inline_copy( JogInliner* inliner ) { return inline_copy_binary( this, inliner ); }
+Ref<JogCmd> JogCmdAndInt32::inline_copy( JogInliner* inliner ) { return inline_copy_binary( this, inliner ); }
+Ref<JogCmd> JogCmdOrInt64::inline_copy( JogInliner* inliner ) { return inline_copy_binary( this, inliner ); }
+Ref<JogCmd> JogCmdOrInt32::inline_copy( JogInliner* inliner ) { return inline_copy_binary( this, inliner ); }
+Ref<JogCmd> JogCmdXorInt64::inline_copy( JogInliner* inliner ) { return inline_copy_binary( this, inliner ); }
+Ref<JogCmd> JogCmdXorInt32::inline_copy( JogInliner* inliner ) { return inline_copy_binary( this, inliner ); }
+Ref<JogCmd> JogCmdLogicalAnd::inline_copy( JogInliner* inliner ) { return inline_copy_logical( this, inliner ); }
+Ref<JogCmd> JogCmdLogicalOr::inline_copy( JogInliner* inliner ) { return inline_copy_logical( this, inliner ); }
+Ref<JogCmd> JogCmdLeftShiftInt64::inline_copy( JogInliner* inliner ) { return inline_copy_shift( this, inliner ); }
+Ref<JogCmd> JogCmdLeftShiftInt32::inline_copy( JogInliner* inliner ) { return inline_copy_shift( this, inliner ); }
+Ref<JogCmd> JogCmdRightShiftInt64::inline_copy( JogInliner* inliner ) { return inline_copy_shift( this, inliner ); }
+Ref<JogCmd> JogCmdRightShiftInt32::inline_copy( JogInliner* inliner ) { return inline_copy_shift( this, inliner ); }
+Ref<JogCmd> JogCmdRightXShiftInt64::inline_copy( JogInliner* inliner ) { return inline_copy_shift( this, inliner ); }
+Ref<JogCmd> JogCmdRightXShiftInt32::inline_copy( JogInliner* inliner ) { return inline_copy_shift( this, inliner ); }
+
+Ref<JogCmd> JogCmdCastReal32ToReal64::inline_copy( JogInliner* inliner ) { return inline_copy_unary( this, inliner ); }
+Ref<JogCmd> JogCmdCastIntegerToReal64::inline_copy( JogInliner* inliner ) { return inline_copy_unary( this, inliner ); }
+Ref<JogCmd> JogCmdCastReal64ToReal32::inline_copy( JogInliner* inliner ) { return inline_copy_unary( this, inliner ); }
+Ref<JogCmd> JogCmdCastIntegerToReal32::inline_copy( JogInliner* inliner ) { return inline_copy_unary( this, inliner ); }
+Ref<JogCmd> JogCmdCastRealToInt64::inline_copy( JogInliner* inliner ) { return inline_copy_unary( this, inliner ); }
+Ref<JogCmd> JogCmdCastIntegerToInt64::inline_copy( JogInliner* inliner ) { return inline_copy_unary( this, inliner ); }
+Ref<JogCmd> JogCmdCastRealToInt32::inline_copy( JogInliner* inliner ) { return inline_copy_unary( this, inliner ); }
+Ref<JogCmd> JogCmdCastIntegerToInt32::inline_copy( JogInliner* inliner ) { return inline_copy_unary( this, inliner ); }
+Ref<JogCmd> JogCmdCastIntegerToInt16::inline_copy( JogInliner* inliner ) { return inline_copy_unary( this, inliner ); }
+Ref<JogCmd> JogCmdCastIntegerToInt8::inline_copy( JogInliner* inliner ) { return inline_copy_unary( this, inliner ); }
+Ref<JogCmd> JogCmdCastIntegerToChar::inline_copy( JogInliner* inliner ) { return inline_copy_unary( this, inliner ); }
+Ref<JogCmd> JogCmdDiscardDataResult::inline_copy( JogInliner* inliner ) { return inline_copy_unary( this, inliner ); }
+Ref<JogCmd> JogCmdDiscardRefResult::inline_copy( JogInliner* inliner ) { return inline_copy_unary( this, inliner ); }
+Ref<JogCmd> JogCmdNegateReal64::inline_copy( JogInliner* inliner ) { return inline_copy_unary( this, inliner ); }
+Ref<JogCmd> JogCmdNegateReal32::inline_copy( JogInliner* inliner ) { return inline_copy_unary( this, inliner ); }
+Ref<JogCmd> JogCmdNegateInt64::inline_copy( JogInliner* inliner ) { return inline_copy_unary( this, inliner ); }
+Ref<JogCmd> JogCmdNegateInt32::inline_copy( JogInliner* inliner ) { return inline_copy_unary( this, inliner ); }
+Ref<JogCmd> JogCmdNegateInt16::inline_copy( JogInliner* inliner ) { return inline_copy_unary( this, inliner ); }
+Ref<JogCmd> JogCmdNegateInt8::inline_copy( JogInliner* inliner ) { return inline_copy_unary( this, inliner ); }
+Ref<JogCmd> JogCmdNegateChar::inline_copy( JogInliner* inliner ) { return inline_copy_unary( this, inliner ); }
+Ref<JogCmd> JogCmdLogicalNot::inline_copy( JogInliner* inliner ) { return inline_copy_unary( this, inliner ); }
+Ref<JogCmd> JogCmdBitwiseNot::inline_copy( JogInliner* inliner ) { return inline_copy_unary( this, inliner ); }
+Ref<JogCmd> JogCmdNullCheck::inline_copy( JogInliner* inliner ) { return inline_copy_effect( this, inliner ); }
+
+Ref<JogCmd> JogCmdReturnData::inline_copy( JogInliner* inliner )
+{
+  inliner->returned = true;
+  return inliner->copy( operand );
+}
+
+Ref<JogCmd> JogCmdReturnRef::inline_copy( JogInliner* inliner )
+{
+  inliner->returned = true;
+  return inliner->copy( operand );
+}
+
+Ref<JogCmd> JogCmdArrayReadRef::inline_copy( JogInliner* inliner ) { return inline_copy_array_read( this, inliner ); }
+Ref<JogCmd> JogCmdArrayReadReal64::inline_copy( JogInliner* inliner ) { return inline_copy_array_read( this, inliner ); }
+Ref<JogCmd> JogCmdArrayReadReal32::inline_copy( JogInliner* inliner ) { return inline_copy_array_read( this, inliner ); }
+Ref<JogCmd> JogCmdArrayReadInt64::inline_copy( JogInliner* inliner ) { return inline_copy_array_read( this, inliner ); }
+Ref<JogCmd> JogCmdArrayReadInt32::inline_copy( JogInliner* inliner ) { return inline_copy_array_read( this, inliner ); }
+Ref<JogCmd> JogCmdArrayReadInt16::inline_copy( JogInliner* inliner ) { return inline_copy_array_read( this, inliner ); }
+Ref<JogCmd> JogCmdArrayReadInt8::inline_copy( JogInliner* inliner ) { return inline_copy_array_read( this, inliner ); }
+Ref<JogCmd> JogCmdArrayReadChar::inline_copy( JogInliner* inliner ) { return inline_copy_array_read( this, inliner ); }
+Ref<JogCmd> JogCmdArrayReadBoolean::inline_copy( JogInliner* inliner ) { return inline_copy_array_read( this, inliner ); }
+
+Ref<JogCmd> JogCmdArrayWriteRef::inline_copy( JogInliner* inliner ) { return inline_copy_array_write( this, inliner ); }
+Ref<JogCmd> JogCmdArrayWriteReal64::inline_copy( JogInliner* inliner ) { return inline_copy_array_write( this, inliner ); }
+Ref<JogCmd> JogCmdArrayWriteReal32::inline_copy( JogInliner* inliner ) { return inline_copy_array_write( this, inliner ); }
+Ref<JogCmd> JogCmdArrayWriteInt64::inline_copy( JogInliner* inliner ) { return inline_copy_array_write( this, inliner ); }
+Ref<JogCmd> JogCmdArrayWriteInt32::inline_copy( JogInliner* inliner ) { return inline_copy_array_write( this, inliner ); }
+Ref<JogCmd> JogCmdArrayWriteInt16::inline_copy( JogInliner* inliner ) { return inline_copy_array_write( this, inliner ); }
+Ref<JogCmd> JogCmdArrayWriteInt8::inline_copy( JogInliner* inliner ) { return inline_copy_array_write( this, inliner ); }
+Ref<JogCmd> JogCmdArrayWriteChar::inline_copy( JogInliner* inliner ) { return inline_copy_array_write( this, inliner ); }
+Ref<JogCmd> JogCmdArrayWriteBoolean::inline_copy( JogInliner* inliner ) { return inline_copy_array_write( this, inliner ); }
+
+Ref<JogCmd> JogCmdArraySize::inline_copy( JogInliner* inliner )
+{
+  Ref<JogCmd> new_context = inliner->copy( context );
+  inliner->effects = true;
+  if (inliner->failed) return NULL;
+  return new JogCmdArraySize( t, new_context );
+}
+
+Ref<JogCmd> JogCmdReadPropertyData::inline_copy( JogInliner* inliner ) { return inline_copy_property_read( this, inliner ); }
+Ref<JogCmd> JogCmdReadPropertyRef::inline_copy( JogInliner* inliner ) { return inline_copy_property_read( this, inliner ); }
+Ref<JogCmd> JogCmdWritePropertyData::inline_copy( JogInliner* inliner ) { return inline_copy_property_write( this, inliner ); }
+Ref<JogCmd> JogCmdWritePropertyRef::inline_copy( JogInliner* inliner ) { return inline_copy_property_write( this, inliner ); }
+
+Ref<JogCmd> JogCmdReadLocalData::inline_copy( JogInliner* inliner ) { return inliner->read( t, var_info ); }
+Ref<JogCmd> JogCmdReadLocalRef::inline_copy( JogInliner* inliner ) { return inliner->read( t, var_info ); }
+
+Ref<JogCmd> JogCmdWriteLocalData::inline_copy( JogInliner* inliner )
+{
+  Ref<JogCmd> value = inliner->copy( new_value );
+  JogLocalVarInfo* info = inliner->local_for( var_info );
+  inliner->effects = true;
+  if (inliner->failed) return NULL;
+  return new JogCmdWriteLocalData( t, info, value );
+}
+
+Ref<JogCmd> JogCmdWriteLocalRef::inline_copy( JogInliner* inliner )
+{
+  Ref<JogCmd> value = inliner->copy( new_value );
+  JogLocalVarInfo* info = inliner->local_for( var_info );
+  inliner->effects = true;
+  if (inliner->failed) return NULL;
+  return new JogCmdWriteLocalRef( t, info, value );
+}
+
+Ref<JogCmd> JogCmdOpAssignLocal::inline_copy( JogInliner* inliner )
+{
+  Ref<JogCmd> new_operand = inliner->copy( operand );
+  JogLocalVarInfo* info = inliner->local_for( var_info );
+  inliner->effects = true;
+  if (inliner->failed) return NULL;
+  return create()->init( t, info, new_operand );
+}
+
+Ref<JogCmd> JogCmdPreStepLocal::inline_copy( JogInliner* inliner )
+{
+  JogLocalVarInfo* info = inliner->local_for( var_info );
+  inliner->effects = true;
+  if (inliner->failed) return NULL;
+  return create()->init( t, info, modifier );
+}
+
+Ref<JogCmd> JogCmdPostStepLocal::inline_copy( JogInliner* inliner )
+{
+  JogLocalVarInfo* info = inliner->local_for( var_info );
+  inliner->effects = true;
+  if (inliner->failed) return NULL;
+  return create()->init( t, info, modifier );
+}
+
+Ref<JogCmd> JogCmdOpAssignProperty::inline_copy( JogInliner* inliner )
+{
+  Ref<JogCmd> new_context = inliner->copy( context );
+  Ref<JogCmd> new_operand = inliner->copy( operand );
+  if (inliner->failed) return NULL;
+
+  // As with a write, the null check follows the evaluation of the operand.
+  Ref<JogToken> check_t = inliner->access_t( *context, t );
+  return create()->init( check_t, new_context, var_info, new_operand );
+}
+
+Ref<JogCmd> JogCmdPreStepProperty::inline_copy( JogInliner* inliner )
+{
+  Ref<JogCmd> new_context = inliner->copy( context );
+  if (inliner->failed) return NULL;
+
+  Ref<JogToken> check_t = inliner->access_t( *context, t );
+  return create()->init( check_t, new_context, var_info, modifier );
+}
+
+Ref<JogCmd> JogCmdPostStepProperty::inline_copy( JogInliner* inliner )
+{
+  Ref<JogCmd> new_context = inliner->copy( context );
+  if (inliner->failed) return NULL;
+
+  Ref<JogToken> check_t = inliner->access_t( *context, t );
+  return create()->init( check_t, new_context, var_info, modifier );
+}
+
+Ref<JogCmd> JogCmdThis::inline_copy( JogInliner* inliner ) { return inliner->copy_this( t ); }
+
+Ref<JogCmd> JogCmdAssert::inline_copy( JogInliner* inliner )
+{
+  Ref<JogCmd> new_expression = inliner->copy( expression );
+  inliner->effects = true;
+  if (inliner->failed) return NULL;
+
+  JogCmdAssert* result = new JogCmdAssert( t, new_expression );
+  result->message = message;
+  result->resolved = true;
+  return result;
+}
+
+Ref<JogCmd> JogCmdStaticCall::inline_copy( JogInliner* inliner ) { return inline_copy_call( this, inliner ); }
+Ref<JogCmd> JogCmdDynamicCall::inline_copy( JogInliner* inliner ) { return inline_copy_call( this, inliner ); }
+Ref<JogCmd> JogCmdClassCall::inline_copy( JogInliner* inliner ) { return inline_copy_call( this, inliner ); }
+
+Ref<JogCmd> JogCmdNewObject::inline_copy( JogInliner* inliner )
+{
+  Ref<JogCmdList> new_args = inliner->copy_args( args );
+  inliner->effects = true;
+  if (inliner->failed) return NULL;
+
+  JogCmdNewObject* copy = new JogCmdNewObject( t, of_type, new_args );
+  copy->method_info = method_info;
+  return copy;
+}
+
+Ref<JogCmd> JogCmdNewArray::inline_copy( JogInliner* inliner )
+{
+  Ref<JogCmd> new_size_expr = inliner->copy( size_expr );
+  inliner->effects = true;
+  Ref<JogCmd> new_element_expr = inliner->copy( element_expr );
+  if (inliner->failed) return NULL;
+
+  JogCmdNewArray* copy = new JogCmdNewArray( t, of_type, new_size_expr, new_element_expr );
+  copy->resolved = true;
+  return copy;
+}
+
+Ref<JogCmd> JogCmdConcatN::inline_copy( JogInliner* inliner )
+{
+  JogCmdConcatN* copy = new JogCmdConcatN( t );
+  Ref<JogCmd> result = copy;
+  for (int i=0; i<operands.count; ++i) copy->operands.add( inliner->copy(operands[i]) );
+  if (inliner->failed) return NULL;
+  return result;
+}
+
+Ref<JogCmd> JogCmdInlineCall::inline_copy( JogInliner* inliner )
+{
+  JogCmdInlineCall* copy = new JogCmdInlineCall( t, method_info );
+  Ref<JogCmd> result_ref = copy;
+  for (int i=0; i<statements.count; ++i) copy->statements.add( inliner->copy(statements[i]) );
+  copy->result = inliner->copy( result );
+  inliner->effects = true;
+  if (inliner->failed) return NULL;
+  return result_ref;
+}
+
+// Statements inside a branch or loop may not run, so nothing in them can
+// double as the call's null check.  A copied 'break' or 'continue' is
+// inside a copied loop, since a method can't jump out of itself.
+Ref<JogCmd> JogCmdList::inline_copy( JogInliner* inliner )
+{
+  if ( !inliner->control_flow ) return NULL;
+
+  Ref<JogCmdList> copy = new JogCmdList( t );
+  for (int i=0; i<commands.count; ++i) copy->add( inliner->copy(commands[i]) );
+  if (inliner->failed || inliner->returned) return NULL;
+  return *copy;
+}
+
+Ref<JogCmd> JogCmdBlock::inline_copy( JogInliner* inliner )
+{
+  if ( !inliner->control_flow ) return NULL;
+
+  Ref<JogCmdBlock> copy = new JogCmdBlock( t );
+  RefList<JogCmd>& commands = statements->commands;
+  for (int i=0; i<commands.count; ++i) copy->add( inliner->copy(commands[i]) );
+  if (inliner->failed || inliner->returned) return NULL;
+  return *copy;
+}
+
+Ref<JogCmd> JogCmdIf::inline_copy( JogInliner* inliner )
+{
+  if ( !inliner->control_flow ) return NULL;
+
+  Ref<JogCmd> new_expression = inliner->copy( expression );
+  inliner->effects = true;
+  Ref<JogCmd> new_body = inliner->copy( body );
+  Ref<JogCmd> new_else_body = inliner->copy( else_body );
+  if (inliner->failed || inliner->returned) return NULL;
+
+  JogCmdIf* copy = new JogCmdIf( t, new_expression );
+  copy->body = new_body;
+  copy->else_body = new_else_body;
+  return copy;
+}
+
+Ref<JogCmd> JogCmdWhile::inline_copy( JogInliner* inliner )
+{
+  if ( !inliner->control_flow ) return NULL;
+
+  Ref<JogCmd> new_expression = inliner->copy( expression );
+  inliner->effects = true;
+  ++inliner->loop_depth;
+  Ref<JogCmd> new_body = inliner->copy( body );
+  --inliner->loop_depth;
+  if (inliner->failed || inliner->returned) return NULL;
+
+  JogCmdWhile* copy = new JogCmdWhile( t, new_expression );
+  copy->body = new_body;
+  return copy;
+}
+
+Ref<JogCmd> JogCmdFor::inline_copy( JogInliner* inliner )
+{
+  if ( !inliner->control_flow ) return NULL;
+
+  Ref<JogCmd> new_initialization = inliner->copy( initialization );
+  Ref<JogCmd> new_condition = inliner->copy( condition );
+  inliner->effects = true;
+  Ref<JogCmd> new_var_mod = inliner->copy( var_mod );
+  ++inliner->loop_depth;
+  Ref<JogCmd> new_body = inliner->copy( body );
+  --inliner->loop_depth;
+  if (inliner->failed || inliner->returned) return NULL;
+
+  JogCmdFor* copy = new JogCmdFor( t, new_initialization, new_condition, new_var_mod );
+  copy->body = new_body;
+  return copy;
+}
+
+Ref<JogCmd> JogCmdBreak::inline_copy( JogInliner* inliner )
+{
+  if ( !inliner->control_flow || !inliner->loop_depth ) return NULL;
+  return new JogCmdBreak( t );
+}
+
+Ref<JogCmd> JogCmdContinue::inline_copy( JogInliner* inliner )
+{
+  if ( !inliner->control_flow || !inliner->loop_depth ) return NULL;
+  return new JogCmdContinue( t );
+}
+
+Ref<JogCmd> JogCmdReturnVoid::inline_copy( JogInliner* inliner )
+{
+  if ( !inliner->control_flow || inliner->loop_depth ) return NULL;
+  ++inliner->exits;
+  return new JogCmdBreak( t );
+}
+
+void JogCmdInlineCall::visit_operands( JogCmdVisitor* visitor )
+{
+  for (int i=0; i<statements.count; ++i) statements[i] = visitor->visit( statements[i] );
+  result = visitor->visit( result );
+}
+
+struct JogNodeCounter : JogCmdVisitor
+{
+  int count;
+
+  JogNodeCounter() : count(0) { }
+
+  Ref<JogCmd> rewrite( Ref<JogCmd> cmd )
+  {
+    ++count;
+    return cmd;
+  }
+};
+
+static bool is_simple_operand( JogCmd* cmd )
+{
+  // Simple operands have no side effects and can be evaluated in any order.
+  return cmd->is_literal() || cmd->read_local() || cmd->is_this();
+}
+
+struct JogInliningPass : JogCmdVisitor
+{
+  JogVM*         vm;
+  JogMethodInfo* caller;
+  int*           inlined_count;
+  int            threshold;  // max nodes in an inlined body
+  bool           control_flow;  // void methods, branches and loops are inlined
+  bool           changed;
+
+  JogInliningPass( JogVM* vm, JogMethodInfo* caller, int* inlined_count )
+    : vm(vm), caller(caller), inlined_count(inlined_count), 
+      threshold(vm->inline_threshold), control_flow(false), changed(false)
+  {
+  }
+
+  Ref<JogCmd> rewrite( Ref<JogCmd> cmd );
+  bool can_inline( JogMethodInfo* m );
+  Ref<JogCmd> inline_call( Ref<JogCmd> call, JogMethodInfo* m );
+};
+
+static void inline_method( JogVM* vm, JogMethodInfo* m, int* inlined_count )
+{
+  if (m->inlining_state != JOG_INLINING_PENDING) return;
+  m->inlining_state = JOG_INLINING_ACTIVE;
+
+  JogInliningPass pass( vm, m, inlined_count );
+  if (*(m->statements)) m->statements->visit_operands( &pass );
+  if (pass.changed) m->compute_stack_depths();
+
+  m->inlining_state = JOG_INLINING_DONE;
+}
+
+Ref<JogCmd> JogInliningPass::rewrite( Ref<JogCmd> cmd )
+{
+  JogMethodInfo* m = cmd->bound_method();
+  if ( !m || !can_inline(m) ) return cmd;
+
+  Ref<JogCmd> result = inline_call( cmd, m );
+  if ( !*result ) return cmd;
+
+  changed = true;
+  ++(*inlined_count);
+  return result;
+}
+
+bool JogInliningPass::can_inline( JogMethodInfo* m )
+{
+  if ( !m->inlinable || !m->resolved ) return false;
+  if ( !m->return_type && !control_flow ) return false;
+  if (m->is_native() || m->is_abstract() || m->is_constructor()) return false;
+  if (m->statements->commands.count == 0) return false;
+
+  for (int i=0; i<vm->inlining_opt_outs.count; ++i)
+  {
+    if (vm->inlining_opt_outs[i]->equals(m->full_signature))
+    {
+      m->inlinable = false;
+      return false;
+    }
+  }
+
+  // Callee bodies are inlined into first; a method still being processed
+  // is part of a recursive cycle.
+  inline_method( vm, m, inlined_count );
+  if (m->inlining_state == JOG_INLINING_ACTIVE) return false;
+
+  JogNodeCounter counter;
+  m->statements->visit_operands( &counter );
+  return (counter.count <= threshold);
+}
+
+Ref<JogCmd> JogInliningPass::inline_call( Ref<JogCmd> call, JogMethodInfo* m )
+{
+  if ( !m->is_static() )
+  {
+    // A call on the result of an inlined call that returned a local
+    // ('sb.append(x).append(y)') is made on the local after its statements.
+    JogCmdStaticCall* static_call = (JogCmdStaticCall*) *call;
+    JogCmd* context = *(static_call->context);
+    if (context->fusion_shape() == JOG_SHAPE_INLINE_CALL && context->fusion_operand(0)->read_local())
+    {
+      Ref<JogCmdInlineCall> outer = (JogCmdInlineCall*) context;
+      static_call->context = outer->result;
+      Ref<JogCmd> result = inline_call( call, m );
+      if ( !*result )
+      {
+        static_call->context = *outer;
+        return NULL;
+      }
+
+      if (m->return_type)
+      {
+        outer->result = result;
+        return *outer;
+      }
+
+      Ref<JogCmdBlock> block = new JogCmdBlock( call->t );
+      for (int i=0; i<outer->statements.count; ++i) block->add( outer->statements[i] );
+      block->add( result );
+      return *block;
+    }
+  }
+
+  Ref<JogCmd>     context;
+  Ref<JogCmdList> args;
+  if (m->is_static())
+  {
+    JogCmdClassCall* class_call = (JogCmdClassCall*) *call;
+    context = class_call->context;
+    args = class_call->args;
+  }
+  else
+  {
+    JogCmdStaticCall* static_call = (JogCmdStaticCall*) *call;
+    context = static_call->context;
+    args = static_call->args;
+  }
+
+  bool all_simple = !*context || m->is_static() || is_simple_operand(*context);
+  int arg_count = *args ? args->commands.count : 0;
+  for (int i=0; i<arg_count; ++i)
+  {
+    if ( !is_simple_operand(*(args->commands[i])) ) all_simple = false;
+  }
+
+  JogInliner inliner( caller, call->t );
+  inliner.control_flow = control_flow;
+  Ref<JogCmdInlineCall> result = new JogCmdInlineCall( call->t, m );
+
+  // Operands are evaluated in order before the body runs.  A context that
+  // isn't a local the arguments leave alone goes through a temporary and is
+  // null-checked after the arguments, as a call would be.
+  Ref<JogCmd> null_check;
+  if ( !m->is_static() )
+  {
+    JogLocalWriteFinder context_writes( context->read_local() );
+    if (*args && context->read_local()) args->visit_operands( &context_writes );
+
+    if (context->is_this())
+    {
+      inliner.context = context;
+    }
+    else if (context->read_local() && !context_writes.found)
+    {
+      inliner.context = new JogCmdReadLocalRef( context->t, context->read_local() );
+      null_check = inliner.context;
+    }
+    else
+    {
+      Ref<JogLocalVarInfo> temp = new JogLocalVarInfo( call->t, m->type_context, m->name );
+      JogLocalVarInfo* info = inliner.add_local( *temp );
+      result->statements.add( inliner.write(context->t,info,context)->discarding_result() );
+      inliner.context = new JogCmdReadLocalRef( context->t, info );
+      null_check = inliner.context;
+    }
+  }
+  else if (*context)
+  {
+    result->statements.add( context );
+  }
+
+  for (int i=0; i<arg_count; ++i)
+  {
+    JogLocalVarInfo* param = *(m->parameters[i]);
+    Ref<JogCmd> arg = args->commands[i];
+
+    JogLocalWriteFinder writes( param );
+    m->statements->visit_operands( &writes );
+
+    if ( !writes.found && arg->is_literal() )
+    {
+      inliner.map( param, NULL, arg );
+    }
+    else if ( !writes.found && all_simple && arg->read_local() )
+    {
+      inliner.map( param, arg->read_local(), NULL );
+    }
+    else
+    {
+      JogLocalVarInfo* info = inliner.local_for( param );
+      result->statements.add( inliner.write(arg->t,info,arg)->discarding_result() );
+    }
+  }
+
+  // In a void method, the statements after 'if (c) return;' run under
+  // 'if (!c)' and a 'return' that ends the body is dropped.
+  RefList<JogCmd>& body = m->statements->commands;
+  RefList<JogCmd>  body_statements;
+  Ref<JogCmdBlock> rest;
+  for (int i=0; i<body.count; ++i)
+  {
+    JogCmd* guard = m->return_type ? NULL : body[i]->jump_condition();
+    if (guard && control_flow)
+    {
+      Ref<JogCmd> condition = inliner.copy( guard );
+      inliner.effects = true;
+      if (inliner.failed) return NULL;
+
+      JogCmdIf* skip = new JogCmdIf( body[i]->t, new JogCmdLogicalNot(body[i]->t,condition) );
+      if (*rest) rest->add( skip );
+      else       body_statements.add( skip );
+      rest = new JogCmdBlock( body[i]->t );
+      skip->body = *rest;
+      continue;
+    }
+
+    Ref<JogCmd> cmd = inliner.copy( body[i] );
+    if (inliner.failed) return NULL;
+
+    if ( !m->return_type && i == body.count-1 && body[i]->is_jump() )
+    {
+      --inliner.exits;
+    }
+    else if (inliner.returned)
+    {
+      if (i < body.count-1) return NULL;
+      result->result = cmd;
+    }
+    else if (*rest)
+    {
+      rest->add( cmd );
+    }
+    else
+    {
+      body_statements.add( cmd );
+    }
+  }
+  if ( !inliner.returned && m->return_type ) return NULL;
+
+  if (*null_check && !inliner.context_checked)
+  {
+    result->statements.add( (new JogCmdNullCheck(call->t,null_check))->discarding_result() );
+  }
+
+  if (inliner.exits)
+  {
+    // The copied 'return's break out of a loop that runs once.
+    Ref<JogCmdBlock> loop_body = new JogCmdBlock( call->t );
+    for (int i=0; i<body_statements.count; ++i) loop_body->add( body_statements[i] );
+    loop_body->add( new JogCmdBreak(call->t) );
+
+    JogCmdWhile* loop = new JogCmdWhile( call->t, new JogCmdLiteralBoolean(call->t,true) );
+    loop->body = *loop_body;
+    body_statements.clear();
+    body_statements.add( loop );
+  }
+  for (int i=0; i<body_statements.count; ++i) result->statements.add( body_statements[i] );
+
+  inliner.commit();
+  if (m->return_type) return *result;
+
+  Ref<JogCmdBlock> block = new JogCmdBlock( call->t );
+  for (int i=0; i<result->statements.count; ++i) block->add( result->statements[i] );
+  return *block;
+}
+
+void JogVM::prevent_inlining( const char* full_signature )
+{
+  inlining_opt_outs.add( new JogString(full_signature) );
+}
+
+void JogVM::inline_calls()
+{
+  // Bodies of small, statically bound methods (after devirtualization)
+  // replace calls to them; see JogInliner.
+  int inlined_count = 0;
+  for (JogTypeLookup::iterator cur=jog_type_manager.type_lookup.begin();
+      cur != jog_type_manager.type_lookup.end(); ++cur)
+  {
+    JogTypeInfo* type = *(cur->second);
+    if ( !type->resolved ) continue;
+
+    for (int i=0; i<type->class_methods.count; ++i)
+    {
+      inline_method( this, *(type->class_methods[i]), &inlined_count );
+    }
+    for (int i=0; i<type->methods.count; ++i)
+    {
+      inline_method( this, *(type->methods[i]), &inlined_count );
+    }
+    for (int i=0; i<type->static_initializers.count; ++i)
+    {
+      inline_method( this, *(type->static_initializers[i]), &inlined_count );
+    }
+    if (*(type->m_init_object)) inline_method( this, *(type->m_init_object), &inlined_count );
+  }
+
+  if (report_optimizations)
+  {
+    printf( "Inlined %d call sites.\n", inlined_count );
+  }
+}
+
+//=============================================================================
+//  Scalar Replacement
+//=============================================================================
+// An object that is created into a local and only ever used as the context
+// of property accesses through that local never escapes its method.  Its
+// allocation is replaced by copies of init_object() and the constructor
+// chain, and each of its properties by a new local.  Calls through the local
+// are bound to the object's exact type and inlined first, so methods like
+// ArrayListIterator.next() don't count as uses.
+struct JogLocalUseCounter : JogCmdVisitor
+{
+  JogLocalVarInfo* var_info;
+  int reads;
+  int accesses;  // reads that are the object of an accessed_object() node
+  int writes;
+
+  JogLocalUseCounter( JogLocalVarInfo* var_info ) : var_info(var_info), reads(0), 
+      accesses(0), writes(0)
+  {
+  }
+
+  bool escapes() { return accesses < reads; }
+
+  Ref<JogCmd> rewrite( Ref<JogCmd> cmd )
+  {
+    if (cmd->read_local() == var_info) ++reads;
+    if (cmd->written_local() == var_info) ++writes;
+
+    JogCmd* object = cmd->accessed_object();
+    if (object && object->read_local() == var_info) ++accesses;
+    return cmd;
+  }
+};
+
+static JogCmdNewObject* created_object( JogCmd* value )
+{
+  // 'new Type(...)', or an inlined call such as ArrayList.iterator() that
+  // results in one.
+  while (value->fusion_shape() == JOG_SHAPE_INLINE_CALL) value = value->fusion_operand(0);
+  if (value->fusion_shape() != JOG_SHAPE_NEW_OBJECT) return NULL;
+  return (JogCmdNewObject*) value;
+}
+
+struct JogNewObjectFinder : JogCmdVisitor
+{
+  RefList<JogCmd> statements;  // 'local = new Type(...)' statements
+  int new_object_count;
+
+  JogNewObjectFinder() : new_object_count(0) { }
+
+  Ref<JogCmd> rewrite( Ref<JogCmd> cmd )
+  {
+    int shape = cmd->fusion_shape();
+    if (shape == JOG_SHAPE_NEW_OBJECT) ++new_object_count;
+
+    if (shape == JOG_SHAPE_DISCARD_REF)
+    {
+      JogCmd* write = cmd->fusion_operand(0);
+      if (write->fusion_shape() == JOG_SHAPE_WRITE_LOCAL_REF 
+          && created_object(write->fusion_operand(0)))
+      {
+        statements.add( cmd );
+      }
+    }
+    return cmd;
+  }
+};
+
+struct JogStatementReplacer : JogCmdVisitor
+{
+  JogCmd*     statement;
+  Ref<JogCmd> replacement;
+
+  JogStatementReplacer( JogCmd* statement, Ref<JogCmd> replacement )
+    : statement(statement), replacement(replacement)
+  {
+  }
+
+  Ref<JogCmd> rewrite( Ref<JogCmd> cmd )
+  {
+    if (*cmd == statement) return replacement;
+    return cmd;
+  }
+};
+
+struct JogScalarReplacer : JogCmdVisitor
+{
+  JogLocalVarInfo* var_info;
+  ArrayList<JogLocalVarInfo*>* property_locals;  // by property index
+
+  JogScalarReplacer( JogLocalVarInfo* var_info, ArrayList<JogLocalVarInfo*>* property_locals )
+    : var_info(var_info), property_locals(property_locals)
+  {
+  }
+
+  Ref<JogCmd> rewrite( Ref<JogCmd> cmd )
+  {
+    JogCmd* object = cmd->accessed_object();
+    if ( !object || object->read_local() != var_info ) return cmd;
+    return cmd->localize( property_locals );
+  }
+};
+
+Ref<JogCmd> JogCmd::localize( ArrayList<JogLocalVarInfo*>* property_locals ) { return this; }
+
+Ref<JogCmd> JogCmdReadProperty::localize( ArrayList<JogLocalVarInfo*>* property_locals )
+{
+  JogLocalVarInfo* info = (*property_locals)[var_info->index];
+  if (info->type->is_reference()) return new JogCmdReadLocalRef( t, info );
+  return new JogCmdReadLocalData( t, info );
+}
+
+Ref<JogCmd> JogCmdWriteProperty::localize( ArrayList<JogLocalVarInfo*>* property_locals )
+{
+  JogLocalVarInfo* info = (*property_locals)[var_info->index];
+  if (info->type->is_reference()) return new JogCmdWriteLocalRef( t, info, new_value );
+  return new JogCmdWriteLocalData( t, info, new_value );
+}
+
+Ref<JogCmd> JogCmdOpAssignProperty::localize( ArrayList<JogLocalVarInfo*>* property_locals )
+{
+  return create_local()->init( t, (*property_locals)[var_info->index], operand );
+}
+
+Ref<JogCmd> JogCmdPreStepProperty::localize( ArrayList<JogLocalVarInfo*>* property_locals )
+{
+  return create_local()->init( t, (*property_locals)[var_info->index], modifier );
+}
+
+Ref<JogCmd> JogCmdPostStepProperty::localize( ArrayList<JogLocalVarInfo*>* property_locals )
+{
+  return create_local()->init( t, (*property_locals)[var_info->index], modifier );
+}
+
+Ref<JogCmd> JogCmdNullCheck::localize( ArrayList<JogLocalVarInfo*>* property_locals )
+{
+  // The object always exists; null checks of it are left as plain reads.
+  return operand;
+}
+
+struct JogObjectCallInliner : JogCmdVisitor
+{
+  JogInliningPass* pass;
+  JogLocalVarInfo* var_info;
+  JogTypeInfo*     of_type;  // exact type of the object in 'var_info'
+  bool             changed;
+  ArrayList<JogLocalVarInfo*> aliases;  // locals only ever holding the object
+
+  JogObjectCallInliner( JogInliningPass* pass, JogLocalVarInfo* var_info, JogTypeInfo* of_type )
+    : pass(pass), var_info(var_info), of_type(of_type), changed(false)
+  {
+  }
+
+  bool results_in_object( JogCmd* cmd )
+  {
+    return cmd && cmd->fusion_shape() == JOG_SHAPE_INLINE_CALL 
+      && cmd->fusion_operand(0)->read_local() == var_info;
+  }
+
+  bool is_alias( JogLocalVarInfo* info )
+  {
+    for (int i=0; i<aliases.count; ++i) if (aliases[i] == info) return true;
+    return false;
+  }
+
+  bool is_parameter( JogLocalVarInfo* info )
+  {
+    RefList<JogLocalVarInfo>& parameters = pass->caller->parameters;
+    for (int i=0; i<parameters.count; ++i) if (*(parameters[i]) == info) return true;
+    return false;
+  }
+
+  Ref<JogCmd> rewrite( Ref<JogCmd> cmd )
+  {
+    if (cmd->read_local() && is_alias(cmd->read_local()))
+    {
+      changed = true;
+      return new JogCmdReadLocalRef( cmd->t, var_info );
+    }
+
+    // A local of the same type declared with the object as its value, such
+    // as the temporary holding an inlined call's context, is read as the
+    // object.  Being written once, its declaration runs before its reads.
+    int shape = cmd->fusion_shape();
+    if (shape == JOG_SHAPE_DISCARD_REF 
+        && cmd->fusion_operand(0)->fusion_shape() == JOG_SHAPE_WRITE_LOCAL_REF)
+    {
+      JogCmdWriteLocal* write = (JogCmdWriteLocal*) cmd->fusion_operand(0);
+      JogCmd* value = *(write->new_value);
+      if (write->var_info->type == var_info->type && !is_parameter(write->var_info)
+          && (value->read_local() == var_info || results_in_object(value)))
+      {
+        JogLocalUseCounter uses( write->var_info );
+        pass->caller->statements->visit_operands( &uses );
+        if (uses.writes == 1)
+        {
+          aliases.add( write->var_info );
+          changed = true;
+          Ref<JogCmdBlock> block = new JogCmdBlock( cmd->t );
+          if (value->read_local() != var_info)
+          {
+            RefList<JogCmd>& statements = ((JogCmdInlineCall*) value)->statements;
+            for (int i=0; i<statements.count; ++i) block->add( statements[i] );
+          }
+          return *block;
+        }
+      }
+    }
+
+    // A discarded call that returned the object leaves its statements.
+    if ((shape == JOG_SHAPE_DISCARD_REF || shape == JOG_SHAPE_DISCARD_DATA)
+        && results_in_object(cmd->fusion_operand(0)))
+    {
+      JogCmdInlineCall* inlined = (JogCmdInlineCall*) cmd->fusion_operand(0);
+      Ref<JogCmdBlock> block = new JogCmdBlock( cmd->t );
+      for (int i=0; i<inlined->statements.count; ++i) block->add( inlined->statements[i] );
+      changed = true;
+      return *block;
+    }
+
+    JogMethodInfo* m = cmd->bound_method();
+    if (cmd->is_dynamic_call()) m = ((JogCmdDynamicCall*) *cmd)->method_info;
+    if ( !m || m->is_static() ) return cmd;
+
+    JogCmdStaticCall* call = (JogCmdStaticCall*) *cmd;
+    if ( !*(call->context) ) return cmd;
+    if (call->context->read_local() != var_info && !results_in_object(*(call->context)))
+    {
+      return cmd;
+    }
+    if (cmd->is_dynamic_call()) m = of_type->dispatch_table[m->dispatch_id];
+    if ( !pass->can_inline(m) ) return cmd;
+
+    Ref<JogCmd> result = pass->inline_call( cmd, m );
+    if ( !*result ) return cmd;
+
+    changed = true;
+    return result;
+  }
+};
+
+static Ref<JogCmd> zero_value( Ref<JogToken> t, JogTypeInfo* type )
+{
+  if (type->is_reference()) return new JogCmdNullRef( t );
+  if (type == jog_type_manager.type_boolean) return new JogCmdLiteralBoolean( t, false );
+
+  Ref<JogCmd> zero = new JogCmdLiteralInt32( t, 0 );
+  return zero->cast_to_type( type );
+}
+
+static bool expand_constructor( JogInliner& inliner, JogCmdBlock* block, JogMethodInfo* m,
+    Ref<JogCmdList> args, int depth )
+{
+  // Argument stores, then the body with this() and super() calls expanded
+  // in place.
+  if (m->is_native() || depth > 8) return false;
+
+  int arg_count = *args ? args->commands.count : 0;
+  bool all_simple = true;
+  for (int i=0; i<arg_count; ++i)
+  {
+    if ( !is_simple_operand(*(args->commands[i])) ) all_simple = false;
+  }
+
+  for (int i=0; i<arg_count; ++i)
+  {
+    JogLocalVarInfo* param = *(m->parameters[i]);
+    Ref<JogCmd> arg = args->commands[i];
+
+    JogLocalWriteFinder writes( param );
+    m->statements->visit_operands( &writes );
+
+    if ( !writes.found && arg->is_literal() )
+    {
+      inliner.map( param, NULL, arg );
+    }
+    else if ( !writes.found && all_simple && arg->read_local() )
+    {
+      inliner.map( param, arg->read_local(), NULL );
+    }
+    else
+    {
+      JogLocalVarInfo* info = inliner.local_for( param );
+      block->add( inliner.write(arg->t,info,arg)->discarding_result() );
+    }
+  }
+
+  RefList<JogCmd>& body = m->statements->commands;
+  for (int i=0; i<body.count; ++i)
+  {
+    JogMethodInfo* callee = body[i]->bound_method();
+    if (callee && callee->is_constructor())
+    {
+      JogCmdStaticCall* call = (JogCmdStaticCall*) *(body[i]);
+      if ( !call->context->is_this() ) return false;
+
+      Ref<JogCmdList> call_args = inliner.copy_args( call->args );
+      if (inliner.failed) return false;
+      if ( !expand_constructor(inliner,block,callee,call_args,depth+1) ) return false;
+    }
+    else
+    {
+      block->add( inliner.copy(body[i]) );
+    }
+    if (inliner.failed || inliner.returned) return false;
+  }
+  return true;
+}
+
+static bool replace_scalars( JogVM* vm, JogMethodInfo* m, JogCmd* statement, bool* changed )
+{
+  JogCmdWriteLocal* write = (JogCmdWriteLocal*) statement->fusion_operand(0);
+  JogCmdNewObject* new_object = created_object( *(write->new_value) );
+  JogLocalVarInfo* var_info = write->var_info;
+  JogTypeInfo* of_type = new_object->of_type;
+
+  for (int i=0; i<m->parameters.count; ++i)
+  {
+    if (*(m->parameters[i]) == var_info) return false;
+  }
+
+  // A local declared without an initial value is written null, so one that
+  // is written once is only read after its declaration has run.
+  JogLocalUseCounter uses( var_info );
+  m->statements->visit_operands( &uses );
+  if (uses.writes != 1) return false;
+
+  // So the local only ever holds an object of exactly 'of_type' and calls
+  // through it can be inlined.  Calls made through inlined bodies are
+  // reached in later rounds.  Larger bodies than usual are worth inlining
+  // when that saves an allocation.
+  int inlined_count = 0;
+  JogInliningPass pass( vm, m, &inlined_count );
+  pass.threshold *= 4;
+  pass.control_flow = true;
+  for (int round=0; round<8 && uses.escapes(); ++round)
+  {
+    JogObjectCallInliner calls( &pass, var_info, of_type );
+    m->statements->visit_operands( &calls );
+    if ( !calls.changed ) break;
+    *changed = true;
+
+    uses = JogLocalUseCounter( var_info );
+    m->statements->visit_operands( &uses );
+  }
+  if (uses.escapes()) return false;
+
+  JogInliner inliner( m, statement->t );
+  inliner.context = new JogCmdReadLocalRef( statement->t, var_info );
+  Ref<JogCmdBlock> block = new JogCmdBlock( statement->t );
+
+  // The statements of inlined calls that result in the object run first.
+  for (JogCmd* value = *(write->new_value); value != new_object; value = value->fusion_operand(0))
+  {
+    RefList<JogCmd>& statements = ((JogCmdInlineCall*) value)->statements;
+    for (int i=0; i<statements.count; ++i) block->add( statements[i] );
+  }
+
+  // Properties start out zeroed, as they are in a new object.
+  RefList<JogLocalVarInfo>    property_vars;
+  ArrayList<JogLocalVarInfo*> property_locals;
+  for (int i=0; i<of_type->properties.count; ++i)
+  {
+    JogPropertyInfo* p = *(of_type->properties[i]);
+    Ref<JogLocalVarInfo> property_var = new JogLocalVarInfo( p->t, p->type, p->name );
+    property_vars.add( property_var );
+
+    JogLocalVarInfo* info = inliner.add_local( *property_var );
+    property_locals.add( info );
+    block->add( inliner.write(p->t,info,zero_value(p->t,p->type))->discarding_result() );
+  }
+
+  if (*(of_type->m_init_object))
+  {
+    RefList<JogCmd>& init = of_type->m_init_object->statements->commands;
+    for (int i=0; i<init.count; ++i) block->add( inliner.copy(init[i]) );
+    if (inliner.failed || inliner.returned) return false;
+  }
+
+  if ( !expand_constructor(inliner,*block,new_object->method_info,new_object->args,0) )
+  {
+    return false;
+  }
+
+  // The copied bodies may only use the object for property accesses too.
+  JogLocalUseCounter copy_uses( var_info );
+  copy_uses.visit( *block );
+  if (copy_uses.escapes()) return false;
+
+  JogStatementReplacer statement_replacer( statement, *block );
+  m->statements->visit_operands( &statement_replacer );
+  inliner.commit();
+
+  JogScalarReplacer replacer( var_info, &property_locals );
+  m->statements->visit_operands( &replacer );
+  return true;
+}
+
+static void replace_scalars( JogVM* vm, JogMethodInfo* m, int* new_object_count, 
+    int* replaced_count )
+{
+  if ( !*(m->statements) ) return;
+
+  JogNewObjectFinder finder;
+  m->statements->visit_operands( &finder );
+  *new_object_count += finder.new_object_count;
+
+  bool changed = false;
+  for (int i=0; i<finder.statements.count; ++i)
+  {
+    if (replace_scalars(vm,m,*(finder.statements[i]),&changed))
+    {
+      changed = true;
+      ++(*replaced_count);
+    }
+  }
+  if (changed) m->compute_stack_depths();
+}
+
+static void replace_scalars( JogVM* vm, JogTypeInfo* type, RefList<JogMethodInfo>& methods, 
+    int* new_object_count, int* replaced_count )
+{
+  for (int i=0; i<methods.count; ++i)
+  {
+    if (methods[i]->type_context != type) continue;
+    replace_scalars( vm, *(methods[i]), new_object_count, replaced_count );
+  }
+}
+
+void JogVM::replace_scalars()
+{
+  int new_object_count = 0;
+  int replaced_count = 0;
+  for (JogTypeLookup::iterator cur=jog_type_manager.type_lookup.begin();
+      cur != jog_type_manager.type_lookup.end(); ++cur)
+  {
+    JogTypeInfo* type = *(cur->second);
+    if ( !type->resolved ) continue;
+
+    ::replace_scalars( this, type, type->class_methods, &new_object_count, &replaced_count );
+    ::replace_scalars( this, type, type->methods, &new_object_count, &replaced_count );
+    ::replace_scalars( this, type, type->static_initializers, &new_object_count, &replaced_count );
+    if (*(type->m_init_object))
+    {
+      ::replace_scalars( this, *(type->m_init_object), &new_object_count, &replaced_count );
+    }
+  }
+
+  if (report_optimizations)
+  {
+    printf( "Scalar-replaced %d of %d object allocations.\n", replaced_count, new_object_count );
+  }
+}
+
+//=============================================================================
+//  Constant Folding
+//=============================================================================
+// Locals assigned once and class properties that only a static initializer
+// writes become constants when that value is a literal.  Operators and pure
+// natives with constant operands are evaluated by running them on the VM's
+// (still empty) stacks, branches on constant conditions keep only the taken
+// side, and statements after a return, break or continue are dropped.
+//
+// Constant class properties are not substituted inside static initializers,
+// which may run before the property is assigned.  Elsewhere they are only
+// substituted when their class's static initializer stores them before it
+// calls a method or allocates an object, since until the store any code it
+// runs would see the default value.
+struct JogConstantFolder : JogCmdVisitor
+{
+  JogVM* vm;
+
+  map<JogLocalVarInfo*,int>          local_writes;
+  map<JogLocalVarInfo*,Ref<JogCmd> > local_values;
+  map<JogPropertyInfo*,int>          property_writes;
+  map<JogPropertyInfo*,Ref<JogCmd> > property_values;
+  map<JogPropertyInfo*,bool>         early_stores;  // made before any code can run
+
+  bool in_static_initializer;
+  bool changed;
+
+  int propagated_count;
+  int folded_count;
+  int branch_count;
+  int removed_count;
+
+  JogConstantFolder( JogVM* vm ) : vm(vm), in_static_initializer(false), changed(false),
+    propagated_count(0), folded_count(0), branch_count(0), removed_count(0)
+  {
+  }
+
+  Ref<JogCmd> rewrite( Ref<JogCmd> cmd ) { return cmd->fold( this ); }
+
+  bool is_constant( JogCmd* cmd )
+  {
+    if ( !cmd->is_literal() ) return false;
+    JogTypeInfo* type = cmd->type();
+    return type && type->is_primitive();
+  }
+
+  bool is_constant( JogLocalVarInfo* var_info )
+  {
+    return local_values.find(var_info) != local_values.end();
+  }
+
+  void count_writes( JogMethodInfo* m );
+  void find_early_stores( JogTypeInfo* type );
+  void assigned( JogLocalVarInfo* var_info, JogCmd* value );
+  void assigned( JogPropertyInfo* var_info, JogCmd* value );
+  Ref<JogCmd> constant( JogCmd* read, JogLocalVarInfo* var_info );
+  Ref<JogCmd> constant( JogCmd* read, JogPropertyInfo* var_info );
+
+  Ref<JogCmd> evaluate( JogCmd* cmd );
+  Ref<JogCmd> folded( Ref<JogCmd> result );
+  Ref<JogCmd> branch( Ref<JogToken> t, Ref<JogCmd> taken );
+  Ref<JogCmd> removed( Ref<JogToken> t );
+  void prune( RefList<JogCmd>& statements );
+};
+
+struct JogWriteCounter : JogCmdVisitor
+{
+  JogConstantFolder* folder;
+
+  JogWriteCounter( JogConstantFolder* folder ) : folder(folder) { }
+
+  Ref<JogCmd> rewrite( Ref<JogCmd> cmd )
+  {
+    JogLocalVarInfo* local = cmd->written_local();
+    if (local) ++folder->local_writes[local];
+
+    JogPropertyInfo* property = cmd->written_class_property();
+    if (property) ++folder->property_writes[property];
+
+    return cmd;
+  }
+};
+
+void JogConstantFolder::count_writes( JogMethodInfo* m )
+{
+  // The call counts as a parameter's first write, so parameters never
+  // qualify as assigned-once.
+  for (int i=0; i<m->parameters.count; ++i) ++local_writes[*(m->parameters[i])];
+
+  JogWriteCounter counter( this );
+  if (*(m->statements)) m->statements->visit_operands( &counter );
+}
+
+struct JogCodeFinder : JogCmdVisitor
+{
+  bool found;
+
+  JogCodeFinder() : found(false) { }
+
+  Ref<JogCmd> rewrite( Ref<JogCmd> cmd )
+  {
+    if (cmd->calls_or_allocates()) found = true;
+    return cmd;
+  }
+};
+
+void JogConstantFolder::find_early_stores( JogTypeInfo* type )
+{
+  // Only top-level stores count; one inside a branch or loop might not run.
+  for (int i=0; i<type->static_initializers.count; ++i)
+  {
+    JogMethodInfo* m = *(type->static_initializers[i]);
+    if (m->type_context != type || !*(m->statements)) continue;
+
+    RefList<JogCmd>& statements = m->statements->commands;
+    for (int j=0; j<statements.count; ++j)
+    {
+      JogCmd* cmd = *(statements[j]);
+      JogCodeFinder finder;
+      finder.visit( cmd );
+      if (finder.found) return;
+
+      if (cmd->fusion_shape() == JOG_SHAPE_DISCARD_DATA) cmd = cmd->fusion_operand(0);
+      JogPropertyInfo* property = cmd->written_class_property();
+      if (property) early_stores[property] = true;
+    }
+  }
+}
+
+void JogConstantFolder::assigned( JogLocalVarInfo* var_info, JogCmd* value )
+{
+  if (local_writes[var_info] != 1) return;
+  if ( !is_constant(value) || value->type() != var_info->type ) return;
+  local_values[var_info] = value;
+}
+
+void JogConstantFolder::assigned( JogPropertyInfo* var_info, JogCmd* value )
+{
+  if ( !in_static_initializer || property_writes[var_info] != 1 ) return;
+  if (early_stores.find(var_info) == early_stores.end()) return;
+  if ( !is_constant(value) || value->type() != var_info->type ) return;
+  property_values[var_info] = value;
+}
+
+Ref<JogCmd> JogConstantFolder::constant( JogCmd* read, JogLocalVarInfo* var_info )
+{
+  map<JogLocalVarInfo*,Ref<JogCmd> >::iterator entry = local_values.find( var_info );
+  if (entry == local_values.end()) return read;
+
+  ++propagated_count;
+  changed = true;
+  return entry->second;
+}
+
+Ref<JogCmd> JogConstantFolder::constant( JogCmd* read, JogPropertyInfo* var_info )
+{
+  if (in_static_initializer) return read;
+
+  map<JogPropertyInfo*,Ref<JogCmd> >::iterator entry = property_values.find( var_info );
+  if (entry == property_values.end()) return read;
+
+  ++propagated_count;
+  changed = true;
+  return entry->second;
+}
+
+Ref<JogCmd> JogConstantFolder::evaluate( JogCmd* cmd )
+{
+  JogTypeInfo* type = cmd->type();
+  if ( !type || !type->is_primitive() ) return cmd;
+
+  JogInstruction* instruction_stack_ptr = vm->instruction_stack_ptr;
+  JogInt64*       data_stack_ptr = vm->data_stack_ptr;
+  JogStackRef*    ref_stack_ptr = vm->ref_stack_ptr;
+  JogStackFrame*  frame_ptr = vm->frame_ptr;
+  try
+  {
+    vm->push( cmd );
+    vm->execute();
+  }
+  catch (Ref<JogError>)
+  {
+    // E.g. a division by zero, which is left to fail at run time.
+    vm->instruction_stack_ptr = instruction_stack_ptr;
+    vm->data_stack_ptr = data_stack_ptr;
+    vm->ref_stack_ptr = ref_stack_ptr;
+    vm->frame_ptr = frame_ptr;
+    return cmd;
+  }
+
+  Ref<JogToken> t = cmd->t;
+  Ref<JogCmd> result;
+  if      (type == jog_type_manager.type_real64)  result = new JogCmdLiteralReal64( t, vm->pop_double() );
+  else if (type == jog_type_manager.type_real32)  result = new JogCmdLiteralReal32( t, (float) vm->pop_double() );
+  else if (type == jog_type_manager.type_int64)   result = new JogCmdLiteralInt64( t, vm->pop_long() );
+  else if (type == jog_type_manager.type_int32)   result = new JogCmdLiteralInt32( t, vm->pop_int() );
+  else if (type == jog_type_manager.type_int16)   result = new JogCmdLiteralInt16( t, (JogInt16) vm->pop_int() );
+  else if (type == jog_type_manager.type_int8)    result = new JogCmdLiteralInt8( t, (JogInt8) vm->pop_int() );
+  else if (type == jog_type_manager.type_char)    result = new JogCmdLiteralChar( t, (JogChar) vm->pop_int() );
+  else if (type == jog_type_manager.type_boolean) result = new JogCmdLiteralBoolean( t, vm->pop_int() != 0 );
+  else
+  {
+    vm->data_stack_ptr = data_stack_ptr;
+    return cmd;
+  }
+  return folded( result );
+}
+
+Ref<JogCmd> JogConstantFolder::folded( Ref<JogCmd> result )
+{
+  ++folded_count;
+  changed = true;
+  return result;
+}
+
+Ref<JogCmd> JogConstantFolder::branch( Ref<JogToken> t, Ref<JogCmd> taken )
+{
+  ++branch_count;
+  changed = true;
+  if (*taken) return taken;
+  return new JogCmdBlock( t );
+}
+
+Ref<JogCmd> JogConstantFolder::removed( Ref<JogToken> t )
+{
+  ++removed_count;
+  changed = true;
+  return new JogCmdBlock( t );
+}
+
+void JogConstantFolder::prune( RefList<JogCmd>& statements )
+{
+  // Splices in the statements of nested blocks - dropping empty ones, 
+  // including those left by branch() and removed() - and drops any
+  // statements after a jump.  Nested blocks were pruned first.
+  bool pruned = false;
+  for (int i=0; i<statements.count; ++i) if (statements[i]->is_block()) pruned = true;
+
+  RefList<JogCmd> original;
+  for (int i=0; i<statements.count; ++i) original.add( statements[i] );
+  statements.clear();
+
+  for (int i=0; i<original.count; ++i)
+  {
+    JogCmd* cmd = *(original[i]);
+    if (cmd->is_block())
+    {
+      RefList<JogCmd>& commands = ((JogCmdBlock*)cmd)->statements->commands;
+      for (int j=0; j<commands.count; ++j) statements.add( commands[j] );
+    }
+    else
+    {
+      statements.add( cmd );
+    }
+
+    if (statements.count && statements.last()->is_jump())
+    {
+      removed_count += original.count - (i+1);
+      if (i+1 < original.count) pruned = true;
+      break;
+    }
+  }
+  if (pruned) changed = true;
+}
+
+static Ref<JogCmd> fold_unary( JogCmdUnary* cmd, JogConstantFolder* folder )
+{
+  if (folder->is_constant(*cmd->operand)) return folder->evaluate( cmd );
+  return cmd;
+}
+
+Ref<JogCmd> JogCmdBinary::fold( JogConstantFolder* folder )
+{
+  if (folder->is_constant(*lhs) && folder->is_constant(*rhs)) return folder->evaluate( this );
+  return this;
+}
+
+Ref<JogCmd> JogCmdShift::fold( JogConstantFolder* folder )
+{
+  if (folder->is_constant(*operand) && folder->is_constant(*shift_amount)) return folder->evaluate( this );
+  return this;
+}
+
+Ref<JogCmd> JogCmdLogicalOr::fold( JogConstantFolder* folder )
+{
+  if ( !lhs->is_literal() ) return this;
+  return folder->folded( ((JogCmdLiteralBoolean*)*lhs)->value ? lhs : rhs );
+}
+
+Ref<JogCmd> JogCmdLogicalAnd::fold( JogConstantFolder* folder )
+{
+  if ( !lhs->is_literal() ) return this;
+  return folder->folded( ((JogCmdLiteralBoolean*)*lhs)->value ? rhs : lhs );
+}
+
+Ref<JogCmd> JogCmdNegate::fold( JogConstantFolder* folder ) { return fold_unary( this, folder ); }
+Ref<JogCmd> JogCmdLogicalNot::fold( JogConstantFolder* folder ) { return fold_unary( this, folder ); }
+Ref<JogCmd> JogCmdBitwiseNot::fold( JogConstantFolder* folder ) { return fold_unary( this, folder ); }
+Ref<JogCmd> JogCmdCastReal32ToReal64::fold( JogConstantFolder* folder ) { return fold_unary( this, folder ); }
+Ref<JogCmd> JogCmdCastIntegerToReal64::fold( JogConstantFolder* folder ) { return fold_unary( this, folder ); }
+Ref<JogCmd> JogCmdCastReal64ToReal32::fold( JogConstantFolder* folder ) { return fold_unary( this, folder ); }
+Ref<JogCmd> JogCmdCastIntegerToReal32::fold( JogConstantFolder* folder ) { return fold_unary( this, folder ); }
+Ref<JogCmd> JogCmdCastRealToInt64::fold( JogConstantFolder* folder ) { return fold_unary( this, folder ); }
+Ref<JogCmd> JogCmdCastIntegerToInt64::fold( JogConstantFolder* folder ) { return fold_unary( this, folder ); }
+Ref<JogCmd> JogCmdCastRealToInt32::fold( JogConstantFolder* folder ) { return fold_unary( this, folder ); }
+Ref<JogCmd> JogCmdCastIntegerToInt32::fold( JogConstantFolder* folder ) { return fold_unary( this, folder ); }
+Ref<JogCmd> JogCmdCastIntegerToInt16::fold( JogConstantFolder* folder ) { return fold_unary( this, folder ); }
+Ref<JogCmd> JogCmdCastIntegerToInt8::fold( JogConstantFolder* folder ) { return fold_unary( this, folder ); }
+Ref<JogCmd> JogCmdCastIntegerToChar::fold( JogConstantFolder* folder ) { return fold_unary( this, folder ); }
+
+Ref<JogCmd> JogCmdClassCall::fold( JogConstantFolder* folder )
+{
+  if (*context || !method_info->is_native()) return this;
+  if ( !folder->vm->pure_native_methods.contains(method_info->full_signature) ) return this;
+
+  if (*args)
+  {
+    for (int i=0; i<args->commands.count; ++i)
+    {
+      if ( !folder->is_constant(*(args->commands[i])) ) return this;
+    }
+  }
+  return folder->evaluate( this );
+}
+
+Ref<JogCmd> JogCmdInlineCall::fold( JogConstantFolder* folder )
+{
+  folder->prune( statements );
+  if (statements.count || !*result || !result->is_literal()) return this;
+  return folder->folded( result );
+}
+
+Ref<JogCmd> JogCmdReadLocalData::fold( JogConstantFolder* folder )
+{
+  return folder->constant( this, var_info );
+}
+
+Ref<JogCmd> JogCmdWriteLocalData::fold( JogConstantFolder* folder )
+{
+  folder->assigned( var_info, *new_value );
+  return this;
+}
+
+Ref<JogCmd> JogCmdReadClassPropertyData::fold( JogConstantFolder* folder )
+{
+  if (*context) return this;
+  return folder->constant( this, var_info );
+}
+
+Ref<JogCmd> JogCmdWriteClassPropertyData::fold( JogConstantFolder* folder )
+{
+  folder->assigned( var_info, *new_value );
+  return this;
+}
+
+Ref<JogCmd> JogCmdDiscardDataResult::fold( JogConstantFolder* folder )
+{
+  // A store to a constant local is dead once its reads are replaced.
+  JogLocalVarInfo* var_info = operand->written_local();
+  if (operand->is_literal() || (var_info && folder->is_constant(var_info)))
+  {
+    return folder->removed( t );
+  }
+  return this;
+}
+
+Ref<JogCmd> JogCmdBlock::fold( JogConstantFolder* folder )
+{
+  folder->prune( statements->commands );
+  return this;
+}
+
+Ref<JogCmd> JogCmdIf::fold( JogConstantFolder* folder )
+{
+  if ( !expression->is_literal() ) return this;
+  return folder->branch( t, ((JogCmdLiteralBoolean*)*expression)->value ? body : else_body );
+}
+
+Ref<JogCmd> JogCmdWhile::fold( JogConstantFolder* folder )
+{
+  if ( !expression->is_literal() || ((JogCmdLiteralBoolean*)*expression)->value ) return this;
+  return folder->branch( t, NULL );
+}
+
+Ref<JogCmd> JogCmdConditional::fold( JogConstantFolder* folder )
+{
+  if ( !condition->is_literal() ) return this;
+  return folder->branch( t, ((JogCmdLiteralBoolean*)*condition)->value ? true_value : false_value );
+}
+
+Ref<JogCmd> JogCmdCountedLoop::fold( JogConstantFolder* folder )
+{
+  // The limit local is read directly rather than through a JogCmdReadLocal.
+  if ( !limit_info || limit_is_length ) return this;
+
+  Ref<JogCmd> value = folder->constant( *limit, limit_info );
+  if ( !value->is_literal() ) return this;
+
+  limit = value;
+  limit_value = ((JogCmdLiteralInt32*)*value)->value;
+  limit_info = NULL;
+  return this;
+}
+
+static void fold_method( JogMethodInfo* m, JogConstantFolder& folder )
+{
+  if ( !*(m->statements) ) return;
+
+  folder.changed = false;
+  m->statements->visit_operands( &folder );
+  folder.prune( m->statements->commands );
+  if (folder.changed) m->compute_stack_depths();
+}
+
+static void fold_methods( JogTypeInfo* type, RefList<JogMethodInfo>& methods, 
+    JogConstantFolder& folder )
+{
+  for (int i=0; i<methods.count; ++i)
+  {
+    if (methods[i]->type_context == type) fold_method( *(methods[i]), folder );
+  }
+}
+
+static void count_writes( JogTypeInfo* type, RefList<JogMethodInfo>& methods, 
+    JogConstantFolder& folder )
+{
+  for (int i=0; i<methods.count; ++i)
+  {
+    if (methods[i]->type_context == type) folder.count_writes( *(methods[i]) );
+  }
+}
+
+void JogVM::fold_constants()
+{
+  JogConstantFolder folder( this );
+  for (JogTypeLookup::iterator cur=jog_type_manager.type_lookup.begin();
+      cur != jog_type_manager.type_lookup.end(); ++cur)
+  {
+    JogTypeInfo* type = *(cur->second);
+    if ( !type->resolved ) continue;
+
+    count_writes( type, type->class_methods, folder );
+    count_writes( type, type->methods, folder );
+    count_writes( type, type->static_initializers, folder );
+    if (*(type->m_init_object)) folder.count_writes( *(type->m_init_object) );
+    folder.find_early_stores( type );
+  }
+
+  // Static initializers go first so that constant class properties are
+  // known before the methods that read them are folded.
+  folder.in_static_initializer = true;
+  for (JogTypeLookup::iterator cur=jog_type_manager.type_lookup.begin();
+      cur != jog_type_manager.type_lookup.end(); ++cur)
+  {
+    JogTypeInfo* type = *(cur->second);
+    if (type->resolved) fold_methods( type, type->static_initializers, folder );
+  }
+  folder.in_static_initializer = false;
+
+  for (JogTypeLookup::iterator cur=jog_type_manager.type_lookup.begin();
+      cur != jog_type_manager.type_lookup.end(); ++cur)
+  {
+    JogTypeInfo* type = *(cur->second);
+    if ( !type->resolved ) continue;
+
+    fold_methods( type, type->class_methods, folder );
+    fold_methods( type, type->methods, folder );
+    if (*(type->m_init_object)) fold_method( *(type->m_init_object), folder );
+  }
+
+  if (report_optimizations)
+  {
+    printf( "Propagated %d constants, folded %d expressions and %d branches, removed %d statements.\n",
+        folder.propagated_count, folder.folded_count, folder.branch_count, folder.removed_count );
+  }
+}
+
+//=============================================================================
+//  String Interning
+//=============================================================================
+// Every literal gets the VM's one immortal String for its content before
+// bytecode is compiled, so that bytecode pushes it directly.
+struct JogLiteralInterner : JogCmdVisitor
+{
+  JogVM* vm;
+  int    literal_count;
+
+  JogLiteralInterner( JogVM* vm ) : vm(vm), literal_count(0) { }
+
+  Ref<JogCmd> rewrite( Ref<JogCmd> cmd )
+  {
+    if (cmd->fusion_shape() == JOG_SHAPE_LITERAL_STRING)
+    {
+      JogCmdLiteralString* literal = (JogCmdLiteralString*) *cmd;
+      if ( !literal->runtime_object )
+      {
+        literal->runtime_object = vm->intern_string( (JogChar*) literal->value->data, 
+            literal->value->count );
+        ++literal_count;
+      }
+    }
+    return cmd;
+  }
+};
+
+static void intern_literals( RefList<JogMethodInfo>& methods, JogLiteralInterner& interner )
+{
+  for (int i=0; i<methods.count; ++i)
+  {
+    JogMethodInfo* m = *(methods[i]);
+    if (*(m->statements)) m->statements->visit_operands( &interner );
+  }
+}
+
+void JogVM::intern_literals()
+{
+  JogLiteralInterner interner( this );
+  for (JogTypeLookup::iterator cur=jog_type_manager.type_lookup.begin();
+      cur != jog_type_manager.type_lookup.end(); ++cur)
+  {
+    JogTypeInfo* type = *(cur->second);
+    if ( !type->resolved ) continue;
+
+    ::intern_literals( type->class_methods, interner );
+    ::intern_literals( type->methods, interner );
+    ::intern_literals( type->static_initializers, interner );
+    if (*(type->m_init_object) && *(type->m_init_object->statements))
+    {
+      type->m_init_object->statements->visit_operands( &interner );
+    }
+  }
+
+  if (report_optimizations)
+  {
+    printf( "Interned %d string literals as %d Strings.\n", interner.literal_count, 
+        (int) interned_strings.size() );
+  }
+}
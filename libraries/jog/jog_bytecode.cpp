@@ -0,0 +1,976 @@
+#include "jog.h"
+
+// Lowers resolved JogCmd trees into linear JogCode.  See JogVM::execute_code()
+// in jog_vm.cpp for the matching dispatch loop.
+
+const void** JogCode::dispatch_table = NULL;
+
+static const char* jog_opcode_names[] =
+{
+#define JOG_OPCODE_NAME(name) #name,
+  JOG_OPCODES(JOG_OPCODE_NAME)
+#undef JOG_OPCODE_NAME
+};
+
+//=============================================================================
+//  JogVM
+//=============================================================================
+static void compile_methods( RefList<JogMethodInfo>& methods, int execution_mode )
+{
+  for (int i=0; i<methods.count; ++i) methods[i]->compile( execution_mode );
+}
+
+void JogVM::compile_bytecode()
+{
+  if (execution_mode == JOG_EXECUTION_TREE) return;
+
+  execute_code(NULL);  // set up JogCode::dispatch_table
+
+  for (JogTypeLookup::iterator cur=jog_type_manager.type_lookup.begin();
+      cur != jog_type_manager.type_lookup.end(); ++cur)
+  {
+    JogTypeInfo* type = *(cur->second);
+    if ( !type->resolved ) continue;
+
+    compile_methods( type->class_methods, execution_mode );
+    compile_methods( type->methods, execution_mode );
+    compile_methods( type->static_initializers, execution_mode );
+    if (*(type->m_init_object)) type->m_init_object->compile( execution_mode );
+  }
+}
+
+
+//=============================================================================
+//  JogMethodInfo
+//=============================================================================
+void JogMethodInfo::compile( int execution_mode )
+{
+  if (*code || is_native() || is_abstract()) return;
+
+  JogCodeBuilder builder( this, execution_mode == JOG_EXECUTION_REGISTER );
+  statements->compile( &builder );
+
+  int last = builder.add( return_type ? JOG_OP_MISSING_RETURN : JOG_OP_RETURN_VOID, NULL );
+  builder.code->ops[last].method_info = this;
+  builder.finish();
+
+  code = builder.code;
+  code->thread();
+}
+
+
+//=============================================================================
+//  JogCode
+//=============================================================================
+void JogCode::thread()
+{
+  for (int i=0; i<ops.count; ++i)
+  {
+    ops[i].handler = dispatch_table ? dispatch_table[ops[i].opcode] : NULL;
+  }
+}
+
+void JogCode::print()
+{
+  method_info->type_context->name->print();
+  printf("::");
+  method_info->signature->print();
+  printf("\n");
+  for (int i=0; i<ops.count; ++i)
+  {
+    JogOp& op = ops[i];
+    printf( "  %4d  %-18s", i, jog_opcode_names[op.opcode] );
+    switch (op.opcode)
+    {
+      case JOG_OP_JUMP:
+      case JOG_OP_JUMP_IF_FALSE:
+      case JOG_OP_JUMP_IF_TRUE:
+        printf( " -> %d", i + op.operand );
+        break;
+      case JOG_OP_PUSH_DATA:
+        printf( " %lld", op.value );
+        break;
+      default:
+        if (op.opcode >= JOG_OP_LOAD_CONST)
+        {
+          printf( " r%d", -op.operand );
+          if (op.opcode == JOG_OP_LOAD_CONST) printf( " %lld", op.value );
+          else if (op.src_a) printf( " r%d", -op.src_a );
+          if (op.src_b) printf( " r%d", -op.src_b );
+        }
+        else if (op.operand)
+        {
+          printf( " %d", op.operand );
+        }
+    }
+    printf("\n");
+  }
+}
+
+
+//=============================================================================
+//  JogCodeBuilder
+//=============================================================================
+JogCodeBuilder::JogCodeBuilder( JogMethodInfo* method_info, bool use_registers )
+  : use_registers(use_registers), temp_count(0), max_temp_count(0)
+{
+  code = new JogCode( method_info );
+  temp_base = method_info->param_data_count + method_info->local_data_count;
+}
+
+int JogCodeBuilder::alloc_temp()
+{
+  if (++temp_count > max_temp_count) max_temp_count = temp_count;
+  return -(temp_base + temp_count);
+}
+
+void JogCodeBuilder::release( int reg )
+{
+  // Temporaries are released in the reverse order they were allocated.
+  if (is_temp(reg)) --temp_count;
+}
+
+int JogCodeBuilder::constant( JogInt64 value )
+{
+  for (int i=0; i<constants.count; ++i)
+  {
+    if (constants[i] == value) return JOG_CONSTANT_REGISTER_TAG + i;
+  }
+  constants.add( value );
+  return JOG_CONSTANT_REGISTER_TAG + constants.count - 1;
+}
+
+int JogCodeBuilder::to_register( JogCmd* cmd, int reg, int target )
+{
+  if (reg == 0)
+  {
+    if ( !target ) target = alloc_temp();
+    add( JOG_OP_POP_LOCAL_DATA, cmd, target );
+    return target;
+  }
+
+  if (target && reg != target)
+  {
+    add_register_op( JOG_OP_MOVE, cmd, target, reg );
+    release( reg );
+    return target;
+  }
+
+  return reg;
+}
+
+void JogCodeBuilder::push_register( JogCmd* cmd, int reg )
+{
+  if (reg == 0) return;
+  add( JOG_OP_READ_LOCAL_DATA, cmd, reg );
+  release( reg );
+}
+
+int JogCodeBuilder::add_register_op( int opcode, JogCmd* cmd, int dest, int src_a, int src_b )
+{
+  int index = add( opcode, cmd, dest );
+  code->ops[index].src_a = src_a;
+  code->ops[index].src_b = src_b;
+  return index;
+}
+
+int JogCodeBuilder::add_branch_if_false( JogCmd* condition, JogCmd* cmd )
+{
+  if (use_registers && condition->is_pure())
+  {
+    int reg = condition->compile_register( this, 0 );
+    release( reg );
+    return add_register_op( JOG_OP_JUMP_IF_FALSE_R, cmd, 0, reg );
+  }
+
+  condition->compile( this );
+  return add_jump( JOG_OP_JUMP_IF_FALSE, cmd );
+}
+
+void JogCodeBuilder::finish()
+{
+  if ( !use_registers ) return;
+
+  // Constants live after the temporaries; resolve their tags and load them
+  // on entry.
+  int constant_base = temp_base + max_temp_count + 1;
+  for (int i=0; i<code->ops.count; ++i)
+  {
+    JogOp& op = code->ops[i];
+    if (op.src_a >= JOG_CONSTANT_REGISTER_TAG) op.src_a = -(constant_base + op.src_a - JOG_CONSTANT_REGISTER_TAG);
+    if (op.src_b >= JOG_CONSTANT_REGISTER_TAG) op.src_b = -(constant_base + op.src_b - JOG_CONSTANT_REGISTER_TAG);
+    if (op.opcode == JOG_OP_READ_LOCAL_DATA && op.operand >= JOG_CONSTANT_REGISTER_TAG)
+    {
+      op.operand = -(constant_base + op.operand - JOG_CONSTANT_REGISTER_TAG);
+    }
+  }
+
+  for (int i=0; i<constants.count; ++i)
+  {
+    JogOp op;
+    memset( &op, 0, sizeof(JogOp) );
+    op.opcode = JOG_OP_LOAD_CONST;
+    op.operand = -(constant_base + i);
+    op.value = constants[i];
+    code->ops.insert( op );
+  }
+
+  code->method_info->local_data_count += max_temp_count + constants.count;
+}
+
+
+//=============================================================================
+//  Statements
+//=============================================================================
+void JogCmd::compile( JogCodeBuilder* code )
+{
+  // No dedicated lowering - let the tree walker evaluate this subtree.
+  code->add( JOG_OP_TREE, this );
+}
+
+int JogCmd::compile_register( JogCodeBuilder* code, int target )
+{
+  // Leaves the value on the data stack.
+  compile( code );
+  return 0;
+}
+
+void JogCmdList::compile( JogCodeBuilder* code )
+{
+  for (int i=0; i<commands.count; ++i) commands[i]->compile(code);
+}
+
+void JogCmdBlock::compile( JogCodeBuilder* code )
+{
+  statements->compile(code);
+}
+
+void JogCmdIf::compile( JogCodeBuilder* code )
+{
+  int skip_body = code->add_branch_if_false( *expression, this );
+  if (*body) body->compile(code);
+
+  if (*else_body)
+  {
+    int skip_else = code->add_jump( JOG_OP_JUMP, this );
+    code->patch( skip_body, code->position() );
+    else_body->compile(code);
+    code->patch( skip_else, code->position() );
+  }
+  else
+  {
+    code->patch( skip_body, code->position() );
+  }
+}
+
+void JogCmdWhile::compile( JogCodeBuilder* code )
+{
+  int top = code->position();
+  int exit = code->add_branch_if_false( *expression, this );
+
+  code->begin_loop();
+  if (*body) body->compile(code);
+  code->add_jump( JOG_OP_JUMP, this, top );
+  code->patch( exit, code->position() );
+  code->end_loop( top, code->position() );
+}
+
+void JogCmdFor::compile( JogCodeBuilder* code )
+{
+  if (*initialization) initialization->compile(code);
+
+  int top = code->position();
+  int exit = -1;
+  if (*condition)
+  {
+    exit = code->add_branch_if_false( *condition, this );
+  }
+
+  code->begin_loop();
+  if (*body) body->compile(code);
+  int next = code->position();
+  if (*var_mod) var_mod->compile(code);
+  code->add_jump( JOG_OP_JUMP, this, top );
+  if (exit >= 0) code->patch( exit, code->position() );
+  code->end_loop( next, code->position() );
+}
+
+void JogCmdCountedLoop::compile( JogCodeBuilder* code )
+{
+  if (*initialization) initialization->compile(code);
+
+  int exit = code->add_jump( JOG_OP_COUNTED_LOOP_TEST, this );
+  int top = code->position();
+
+  code->begin_loop();
+  if (*body) body->compile(code);
+  int next = code->add_jump( JOG_OP_COUNTED_LOOP_NEXT, this, top );
+  code->patch( exit, code->position() );
+  code->end_loop( next, code->position() );
+}
+
+void JogCmdBreak::compile( JogCodeBuilder* code )
+{
+  if ( !code->in_loop() )
+  {
+    // Reports the error if and when it's reached, same as the tree walker.
+    JogCmd::compile(code);
+    return;
+  }
+  code->break_jumps.add( code->add_jump(JOG_OP_JUMP,this) );
+}
+
+void JogCmdContinue::compile( JogCodeBuilder* code )
+{
+  if ( !code->in_loop() )
+  {
+    JogCmd::compile(code);
+    return;
+  }
+  code->continue_jumps.add( code->add_jump(JOG_OP_JUMP,this) );
+}
+
+void JogCmdReturnVoid::compile( JogCodeBuilder* code )
+{
+  code->add( JOG_OP_RETURN_VOID, this );
+}
+
+void JogCmdReturnData::compile( JogCodeBuilder* code )
+{
+  if (code->use_registers && operand->is_pure())
+  {
+    int reg = operand->compile_register( code, 0 );
+    code->release( reg );
+    code->add_register_op( JOG_OP_RETURN_DATA_R, this, 0, reg );
+    return;
+  }
+
+  operand->compile(code);
+  code->add( JOG_OP_RETURN_DATA, this );
+}
+
+void JogCmdReturnRef::compile( JogCodeBuilder* code )
+{
+  operand->compile(code);
+  code->add( JOG_OP_RETURN_REF, this );
+}
+
+void JogCmdDiscardDataResult::compile( JogCodeBuilder* code )
+{
+  if (code->use_registers)
+  {
+    int reg = operand->compile_register( code, 0 );
+    if (reg) code->release( reg );
+    else     code->add( JOG_OP_DISCARD_DATA, this );
+    return;
+  }
+
+  operand->compile(code);
+  code->add( JOG_OP_DISCARD_DATA, this );
+}
+
+void JogCmdDiscardRefResult::compile( JogCodeBuilder* code )
+{
+  operand->compile(code);
+  code->add( JOG_OP_DISCARD_REF, this );
+}
+
+void JogCmdAssert::compile( JogCodeBuilder* code )
+{
+  expression->compile(code);
+  code->add( JOG_OP_NODE, this );
+}
+
+
+//=============================================================================
+//  Literals
+//=============================================================================
+void JogCmdLiteralReal64::compile( JogCodeBuilder* code )
+{
+  code->add_value( JOG_OP_PUSH_DATA, this, *((JogInt64*)&value) );
+}
+
+int JogCmdLiteralReal64::compile_register( JogCodeBuilder* code, int target )
+{
+  return code->constant( *((JogInt64*)&value) );
+}
+
+void JogCmdLiteralReal32::compile( JogCodeBuilder* code )
+{
+  double d = value;
+  code->add_value( JOG_OP_PUSH_DATA, this, *((JogInt64*)&d) );
+}
+
+int JogCmdLiteralReal32::compile_register( JogCodeBuilder* code, int target )
+{
+  double d = value;
+  return code->constant( *((JogInt64*)&d) );
+}
+
+void JogCmdLiteralInt64::compile( JogCodeBuilder* code )
+{
+  code->add_value( JOG_OP_PUSH_DATA, this, value );
+}
+
+int JogCmdLiteralInt64::compile_register( JogCodeBuilder* code, int target )
+{
+  return code->constant( value );
+}
+
+void JogCmdLiteralInt32::compile( JogCodeBuilder* code )
+{
+  code->add_value( JOG_OP_PUSH_DATA, this, value );
+}
+
+int JogCmdLiteralInt32::compile_register( JogCodeBuilder* code, int target )
+{
+  return code->constant( value );
+}
+
+void JogCmdLiteralInt16::compile( JogCodeBuilder* code )
+{
+  code->add_value( JOG_OP_PUSH_DATA, this, value );
+}
+
+int JogCmdLiteralInt16::compile_register( JogCodeBuilder* code, int target )
+{
+  return code->constant( value );
+}
+
+void JogCmdLiteralInt8::compile( JogCodeBuilder* code )
+{
+  code->add_value( JOG_OP_PUSH_DATA, this, value );
+}
+
+int JogCmdLiteralInt8::compile_register( JogCodeBuilder* code, int target )
+{
+  return code->constant( value );
+}
+
+void JogCmdLiteralChar::compile( JogCodeBuilder* code )
+{
+  code->add_value( JOG_OP_PUSH_DATA, this, value );
+}
+
+int JogCmdLiteralChar::compile_register( JogCodeBuilder* code, int target )
+{
+  return code->constant( value );
+}
+
+void JogCmdLiteralBoolean::compile( JogCodeBuilder* code )
+{
+  code->add_value( JOG_OP_PUSH_DATA, this, value ? 1 : 0 );
+}
+
+int JogCmdLiteralBoolean::compile_register( JogCodeBuilder* code, int target )
+{
+  return code->constant( value ? 1 : 0 );
+}
+
+void JogCmdLiteralString::compile( JogCodeBuilder* code )
+{
+  if (runtime_object) code->add_value( JOG_OP_PUSH_REF, this, (JogInt64)(intptr_t) runtime_object );
+  else                code->add( JOG_OP_NODE, this );
+}
+
+void JogCmdNullRef::compile( JogCodeBuilder* code )
+{
+  code->add( JOG_OP_PUSH_NULL, this );
+}
+
+void JogCmdThis::compile( JogCodeBuilder* code )
+{
+  code->add( JOG_OP_PUSH_THIS, this );
+}
+
+void JogCmdObjectRef::compile( JogCodeBuilder* code )
+{
+  code->add( JOG_OP_NODE, this );
+}
+
+
+//=============================================================================
+//  Operators
+//=============================================================================
+void JogCmdUnary::compile( JogCodeBuilder* code )
+{
+  operand->compile(code);
+  code->add( JOG_OP_NODE, this );
+}
+
+static bool compile_pure_binary( JogCodeBuilder* code, JogCmdBinary* cmd )
+{
+  // In register mode an expression over locals and constants is cheaper to
+  // evaluate in registers and push once.
+  if ( !code->use_registers || !cmd->is_pure() ) return false;
+  code->push_register( cmd, cmd->compile_register(code,0) );
+  return true;
+}
+
+void JogCmdBinary::compile( JogCodeBuilder* code )
+{
+  if (compile_pure_binary(code,this)) return;
+  lhs->compile(code);
+  rhs->compile(code);
+  code->add( JOG_OP_NODE, this );
+}
+
+void JogCmdShift::compile( JogCodeBuilder* code )
+{
+  operand->compile(code);
+  shift_amount->compile(code);
+  code->add( JOG_OP_NODE, this );
+}
+
+void JogCmdConditional::compile( JogCodeBuilder* code )
+{
+  int skip_true = code->add_branch_if_false( *condition, this );
+  true_value->compile(code);
+  int skip_false = code->add_jump( JOG_OP_JUMP, this );
+  code->patch( skip_true, code->position() );
+  false_value->compile(code);
+  code->patch( skip_false, code->position() );
+}
+
+bool JogCmdBinary::is_pure()
+{
+  return register_opcode() && lhs->is_pure() && rhs->is_pure();
+}
+
+int JogCmdBinary::compile_register( JogCodeBuilder* code, int target )
+{
+  int opcode = register_opcode();
+  if ( !opcode || !code->use_registers ) return JogCmd::compile_register( code, target );
+
+  int a = code->to_register( *lhs, lhs->compile_register(code,0) );
+  if (code->is_local(a) && !rhs->is_pure())
+  {
+    // 'rhs' could assign to that local before we read it.
+    int temp = code->alloc_temp();
+    code->add_register_op( JOG_OP_MOVE, this, temp, a );
+    a = temp;
+  }
+  int b = code->to_register( *rhs, rhs->compile_register(code,0) );
+  code->release( b );
+  code->release( a );
+
+  if ( !target ) target = code->alloc_temp();
+  code->add_register_op( opcode, this, target, a, b );
+  return target;
+}
+
+static void compile_binary( JogCodeBuilder* code, JogCmdBinary* cmd, int opcode )
+{
+  if (compile_pure_binary(code,cmd)) return;
+  cmd->lhs->compile(code);
+  cmd->rhs->compile(code);
+  code->add( opcode, cmd );
+}
+
+void JogCmdAddInt32::compile( JogCodeBuilder* code ) { compile_binary( code, this, JOG_OP_ADD_INT32 ); }
+void JogCmdSubInt32::compile( JogCodeBuilder* code ) { compile_binary( code, this, JOG_OP_SUB_INT32 ); }
+void JogCmdMulInt32::compile( JogCodeBuilder* code ) { compile_binary( code, this, JOG_OP_MUL_INT32 ); }
+void JogCmdAddInt64::compile( JogCodeBuilder* code ) { compile_binary( code, this, JOG_OP_ADD_INT64 ); }
+void JogCmdSubInt64::compile( JogCodeBuilder* code ) { compile_binary( code, this, JOG_OP_SUB_INT64 ); }
+void JogCmdMulInt64::compile( JogCodeBuilder* code ) { compile_binary( code, this, JOG_OP_MUL_INT64 ); }
+void JogCmdAddReal64::compile( JogCodeBuilder* code ) { compile_binary( code, this, JOG_OP_ADD_REAL64 ); }
+void JogCmdSubReal64::compile( JogCodeBuilder* code ) { compile_binary( code, this, JOG_OP_SUB_REAL64 ); }
+void JogCmdMulReal64::compile( JogCodeBuilder* code ) { compile_binary( code, this, JOG_OP_MUL_REAL64 ); }
+void JogCmdDivReal64::compile( JogCodeBuilder* code ) { compile_binary( code, this, JOG_OP_DIV_REAL64 ); }
+
+void JogCmdEQInteger::compile( JogCodeBuilder* code ) { compile_binary( code, this, JOG_OP_EQ_INTEGER ); }
+void JogCmdNEInteger::compile( JogCodeBuilder* code ) { compile_binary( code, this, JOG_OP_NE_INTEGER ); }
+void JogCmdLTInteger::compile( JogCodeBuilder* code ) { compile_binary( code, this, JOG_OP_LT_INTEGER ); }
+void JogCmdLEInteger::compile( JogCodeBuilder* code ) { compile_binary( code, this, JOG_OP_LE_INTEGER ); }
+void JogCmdGTInteger::compile( JogCodeBuilder* code ) { compile_binary( code, this, JOG_OP_GT_INTEGER ); }
+void JogCmdGEInteger::compile( JogCodeBuilder* code ) { compile_binary( code, this, JOG_OP_GE_INTEGER ); }
+void JogCmdLTReal::compile( JogCodeBuilder* code ) { compile_binary( code, this, JOG_OP_LT_REAL ); }
+void JogCmdLEReal::compile( JogCodeBuilder* code ) { compile_binary( code, this, JOG_OP_LE_REAL ); }
+void JogCmdGTReal::compile( JogCodeBuilder* code ) { compile_binary( code, this, JOG_OP_GT_REAL ); }
+void JogCmdGEReal::compile( JogCodeBuilder* code ) { compile_binary( code, this, JOG_OP_GE_REAL ); }
+void JogCmdEQRef::compile( JogCodeBuilder* code ) { compile_binary( code, this, JOG_OP_EQ_REF ); }
+void JogCmdNERef::compile( JogCodeBuilder* code ) { compile_binary( code, this, JOG_OP_NE_REF ); }
+
+
+//=============================================================================
+//  Locals
+//=============================================================================
+void JogCmdReadLocalData::compile( JogCodeBuilder* code )
+{
+  code->add( JOG_OP_READ_LOCAL_DATA, this, var_info->offset );
+}
+
+int JogCmdReadLocalData::compile_register( JogCodeBuilder* code, int target )
+{
+  return var_info->offset;
+}
+
+void JogCmdReadLocalRef::compile( JogCodeBuilder* code )
+{
+  code->add( JOG_OP_READ_LOCAL_REF, this, var_info->offset );
+}
+
+void JogCmdWriteLocalData::compile( JogCodeBuilder* code )
+{
+  if (code->use_registers)
+  {
+    code->push_register( this, compile_register(code,0) );
+    return;
+  }
+
+  new_value->compile(code);
+  code->add( JOG_OP_WRITE_LOCAL_DATA, this, var_info->offset );
+}
+
+int JogCmdWriteLocalData::compile_register( JogCodeBuilder* code, int target )
+{
+  if ( !code->use_registers ) return JogCmd::compile_register( code, target );
+
+  int offset = var_info->offset;
+  code->to_register( this, new_value->compile_register(code,offset), offset );
+  return offset;
+}
+
+void JogCmdWriteLocalRef::compile( JogCodeBuilder* code )
+{
+  new_value->compile(code);
+  code->add( JOG_OP_WRITE_LOCAL_REF, this, var_info->offset );
+}
+
+void JogCmdOpAssignLocal::compile( JogCodeBuilder* code )
+{
+  operand->compile(code);
+  code->add( JOG_OP_NODE, this );
+}
+
+void JogCmdPreStepLocal::compile( JogCodeBuilder* code )
+{
+  code->add( JOG_OP_NODE, this );
+}
+
+int JogCmdPreStepLocal::compile_register( JogCodeBuilder* code, int target )
+{
+  if ( !code->use_registers || var_info->type != jog_type_manager.type_int32 )
+  {
+    return JogCmd::compile_register( code, target );
+  }
+
+  int offset = var_info->offset;
+  code->add_register_op( JOG_OP_ADD_INT32_R, this, offset, offset, code->constant(modifier) );
+  return offset;
+}
+
+void JogCmdPostStepLocal::compile( JogCodeBuilder* code )
+{
+  code->add( JOG_OP_NODE, this );
+}
+
+int JogCmdPostStepLocal::compile_register( JogCodeBuilder* code, int target )
+{
+  if ( !code->use_registers || var_info->type != jog_type_manager.type_int32 )
+  {
+    return JogCmd::compile_register( code, target );
+  }
+
+  int offset = var_info->offset;
+  int old_value = code->alloc_temp();
+  code->add_register_op( JOG_OP_MOVE, this, old_value, offset );
+  code->add_register_op( JOG_OP_ADD_INT32_R, this, offset, offset, code->constant(modifier) );
+  return old_value;
+}
+
+
+//=============================================================================
+//  Properties
+//=============================================================================
+// Operands are compiled in the order the tree walker evaluates them, which
+// is the reverse of the order on_push() pushes them.
+void JogCmdReadClassProperty::compile( JogCodeBuilder* code )
+{
+  if (*context) context->compile(code);
+  code->add( JOG_OP_NODE, this );
+}
+
+void JogCmdWriteClassProperty::compile( JogCodeBuilder* code )
+{
+  if (*context) context->compile(code);
+  new_value->compile(code);
+  code->add( JOG_OP_NODE, this );
+}
+
+void JogCmdReadProperty::compile( JogCodeBuilder* code )
+{
+  context->compile(code);
+  code->add( JOG_OP_NODE, this );
+}
+
+void JogCmdReadPropertyData::compile( JogCodeBuilder* code )
+{
+  context->compile(code);
+  code->add( JOG_OP_READ_PROPERTY_DATA, this, var_info->index );
+}
+
+void JogCmdReadPropertyRef::compile( JogCodeBuilder* code )
+{
+  context->compile(code);
+  code->add( JOG_OP_READ_PROPERTY_REF, this, var_info->index );
+}
+
+void JogCmdWriteProperty::compile( JogCodeBuilder* code )
+{
+  context->compile(code);
+  new_value->compile(code);
+  code->add( JOG_OP_NODE, this );
+}
+
+void JogCmdOpAssignProperty::compile( JogCodeBuilder* code )
+{
+  context->compile(code);
+  operand->compile(code);
+  code->add( JOG_OP_NODE, this );
+}
+
+void JogCmdOpAssignClassProperty::compile( JogCodeBuilder* code )
+{
+  if (*context) context->compile(code);
+  operand->compile(code);
+  code->add( JOG_OP_NODE, this );
+}
+
+void JogCmdPreStepProperty::compile( JogCodeBuilder* code )
+{
+  context->compile(code);
+  code->add( JOG_OP_NODE, this );
+}
+
+void JogCmdPostStepProperty::compile( JogCodeBuilder* code )
+{
+  context->compile(code);
+  code->add( JOG_OP_NODE, this );
+}
+
+void JogCmdPreStepClassProperty::compile( JogCodeBuilder* code )
+{
+  if (*context) context->compile(code);
+  code->add( JOG_OP_NODE, this );
+}
+
+void JogCmdPostStepClassProperty::compile( JogCodeBuilder* code )
+{
+  if (*context) context->compile(code);
+  code->add( JOG_OP_NODE, this );
+}
+
+
+//=============================================================================
+//  Arrays
+//=============================================================================
+void JogCmdArraySize::compile( JogCodeBuilder* code )
+{
+  context->compile(code);
+  code->add( JOG_OP_ARRAY_SIZE, this );
+}
+
+void JogCmdArrayRead::compile( JogCodeBuilder* code )
+{
+  context->compile(code);
+  index_expr->compile(code);
+  code->add( JOG_OP_NODE, this );
+}
+
+void JogCmdArrayReadInt32::compile( JogCodeBuilder* code )
+{
+  context->compile(code);
+  index_expr->compile(code);
+  code->add( JOG_OP_ARRAY_READ_INT32, this );
+}
+
+void JogCmdArrayWrite::compile( JogCodeBuilder* code )
+{
+  context->compile(code);
+  index_expr->compile(code);
+  new_value->compile(code);
+  code->add( JOG_OP_NODE, this );
+}
+
+void JogCmdArrayWriteInt32::compile( JogCodeBuilder* code )
+{
+  context->compile(code);
+  index_expr->compile(code);
+  new_value->compile(code);
+  code->add( JOG_OP_ARRAY_WRITE_INT32, this );
+}
+
+void JogCmdOpAssignArray::compile( JogCodeBuilder* code )
+{
+  context->compile(code);
+  index_expr->compile(code);
+  operand->compile(code);
+  code->add( JOG_OP_NODE, this );
+}
+
+void JogCmdPreStepArray::compile( JogCodeBuilder* code )
+{
+  context->compile(code);
+  index_expr->compile(code);
+  code->add( JOG_OP_NODE, this );
+}
+
+void JogCmdPostStepArray::compile( JogCodeBuilder* code )
+{
+  context->compile(code);
+  index_expr->compile(code);
+  code->add( JOG_OP_NODE, this );
+}
+
+void JogCmdNewArray::compile( JogCodeBuilder* code )
+{
+  // element_expr, if any, is still evaluated by the tree walker.
+  size_expr->compile(code);
+  code->add( JOG_OP_NODE, this );
+}
+
+
+//=============================================================================
+//  Calls
+//=============================================================================
+static void compile_args( JogCodeBuilder* code, Ref<JogCmdList> args )
+{
+  if ( !*args ) return;
+  for (int i=0; i<args->commands.count; ++i) args->commands[i]->compile(code);
+}
+
+void JogCmdStaticCall::compile( JogCodeBuilder* code )
+{
+  context->compile(code);
+  compile_args( code, args );
+  code->add_call( JOG_OP_CALL_STATIC, this, method_info );
+}
+
+void JogCmdDynamicCall::compile( JogCodeBuilder* code )
+{
+  context->compile(code);
+  compile_args( code, args );
+  code->add_call( JOG_OP_CALL_DYNAMIC, this, method_info );
+}
+
+void JogCmdClassCall::compile( JogCodeBuilder* code )
+{
+  if (*context) context->compile(code);
+  compile_args( code, args );
+  code->add_call( JOG_OP_CALL_CLASS, this, method_info );
+}
+
+void JogCmdCallInitObject::compile( JogCodeBuilder* code )
+{
+  // Object context is already on the stack.
+  code->add_call( JOG_OP_CALL_CLASS, this, method_info );
+}
+
+void JogCmdNewObject::compile( JogCodeBuilder* code )
+{
+  // NEW_OBJECT leaves the result and the constructor's context on the
+  // stack, plus a third copy for init_object() if the type has one.
+  code->add( JOG_OP_NEW_OBJECT, this );
+  if ( *(of_type->call_init_object) )
+  {
+    code->add_call( JOG_OP_CALL_CLASS, this, *(of_type->m_init_object) );
+  }
+  compile_args( code, args );
+  code->add_call( JOG_OP_CALL_CLASS, this, method_info );
+}
+
+
+
+//=============================================================================
+//  Fused Commands
+//=============================================================================
+void JogCmdCompareLocalInt32::compile( JogCodeBuilder* code )
+{
+  if (code->use_registers)
+  {
+    code->push_register( this, compile_register(code,0) );
+    return;
+  }
+  code->add( JOG_OP_NODE, this );
+}
+
+int JogCmdCompareLocalInt32::compile_register( JogCodeBuilder* code, int target )
+{
+  if ( !code->use_registers ) return JogCmd::compile_register( code, target );
+
+  int b = rhs_info ? rhs_info->offset : code->constant(value);
+  if ( !target ) target = code->alloc_temp();
+  code->add_register_op( register_opcode(), this, target, lhs_info->offset, b );
+  return target;
+}
+
+void JogCmdArrayReadInt32LocalLocal::compile( JogCodeBuilder* code )
+{
+  code->add( JOG_OP_NODE, this );
+}
+
+void JogCmdAddAssignLocalConstInt32::compile( JogCodeBuilder* code )
+{
+  if (code->use_registers)
+  {
+    code->push_register( this, compile_register(code,0) );
+    return;
+  }
+  code->add( JOG_OP_NODE, this );
+}
+
+int JogCmdAddAssignLocalConstInt32::compile_register( JogCodeBuilder* code, int target )
+{
+  if ( !code->use_registers ) return JogCmd::compile_register( code, target );
+
+  int offset = var_info->offset;
+  code->add_register_op( JOG_OP_ADD_INT32_R, this, offset, offset, code->constant(value) );
+  return code->to_register( this, offset, target );
+}
+
+
+//=============================================================================
+//  String Concatenation
+//=============================================================================
+void JogCmdConcatN::compile( JogCodeBuilder* code )
+{
+  for (int i=0; i<operands.count; ++i) operands[i]->compile(code);
+  code->add( JOG_OP_NODE, this );
+}
+
+void JogCmdConcatN::compile_pieces( JogCodeBuilder* code, JogCmd* operand )
+{
+  if (operand->fusion_shape() == JOG_SHAPE_CONCAT)
+  {
+    RefList<JogCmd>& operands = ((JogCmdConcatN*)operand)->operands;
+    for (int i=0; i<operands.count; ++i) operands[i]->compile(code);
+  }
+  else
+  {
+    operand->compile(code);
+  }
+}
+
+void JogCmdAddAssignPropertyString::compile( JogCodeBuilder* code )
+{
+  context->compile(code);
+  JogCmdConcatN::compile_pieces( code, *operand );
+  code->add( JOG_OP_NODE, this );
+}
+
+void JogCmdAddAssignClassPropertyString::compile( JogCodeBuilder* code )
+{
+  if (*context) context->compile(code);
+  JogCmdConcatN::compile_pieces( code, *operand );
+  code->add( JOG_OP_NODE, this );
+}
+
+//=============================================================================
+//  Inlined Calls
+//=============================================================================
+void JogCmdInlineCall::compile( JogCodeBuilder* code )
+{
+  for (int i=0; i<statements.count; ++i) statements[i]->compile(code);
+  result->compile(code);
+}
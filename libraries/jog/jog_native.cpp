@@ -10,227 +10,281 @@ using namespace std;
 
 #include "jog.h"
 
-// See add_native_handlers() at bottom.
+// See add_native_handlers() at bottom.  Natives are plain C++ functions
+// bound with JogVM::bind(), which generates their argument glue.
 
 //=============================================================================
 //  Math
 //=============================================================================
-static void Math__abs__double( JogVM* vm )
+template <typename DataType>
+static DataType Math__abs( DataType n )
 {
-  double n = vm->pop_double();
-  vm->pop_frame();
-  if (n >= 0) vm->push( n );
-  else        vm->push( -n );
+  if (n >= 0) return n;
+  else        return -n;
 }
 
-static void Math__abs__float( JogVM* vm )
+template <typename DataType>
+static DataType Math__min( DataType n, DataType m )
 {
-  float n = (float) vm->pop_double();
-  vm->pop_frame();
-  if (n >= 0) vm->push( n );
-  else        vm->push( -n );
+  return min(n,m);
 }
 
-static void Math__abs__int( JogVM* vm )
+template <typename DataType>
+static DataType Math__max( DataType n, DataType m )
 {
-  int n = vm->pop_int();
-  vm->pop_frame();
-  if (n >= 0) vm->push( n );
-  else        vm->push( -n );
+  return max(n,m);
 }
 
-static void Math__abs__long( JogVM* vm )
+//=============================================================================
+//  PrintWriter
+//=============================================================================
+static void PrintWriter__print__char( JogObject* writer, JogChar ch )
 {
-  double n = vm->pop_double();
-  vm->pop_frame();
-  if (n >= 0) vm->push( n );
-  else        vm->push( -n );
+  putchar( ch );
 }
 
-static void Math__cos__double( JogVM* vm )
+static void PrintWriter__print__String( JogObject* writer, JogStringView str )
 {
-  double rads = vm->pop_double();
-  vm->pop_frame();
-  vm->push( cos(rads) );
+  if (str.latin1)
+  {
+    fwrite( str.latin1, 1, str.count, stdout );
+  }
+  else if (str.data == NULL)
+  {
+    printf( "null" );
+  }
+  else
+  {
+    for (int i=0; i<str.count; ++i) putchar( str.data[i] );
+  }
 }
 
-static void Math__sin__double( JogVM* vm )
+//=============================================================================
+//  String
+//=============================================================================
+// The core of String works on whole Strings, compact or not.  The Jog side
+// checks for null and reports bad ranges; the natives clamp ranges so that
+// they never read outside an array.
+static void jog_clamp_range( int count, int& i1, int& i2 )
 {
-  double rads = vm->pop_double();
-  vm->pop_frame();
-  vm->push( sin(rads) );
+  if (i1 < 0) i1 = 0;
+  if (i2 > count) i2 = count;
+  if (i2 < i1) i2 = i1;
 }
 
-static void Math__tan__double( JogVM* vm )
+static inline JogChar jog_fold_case( JogChar ch )
 {
-  double rads = vm->pop_double();
-  vm->pop_frame();
-  vm->push( tan(rads) );
+  if (ch >= 'A' && ch <= 'Z') return ch + ('a'-'A');
+  return ch;
 }
 
-static void Math__acos__double( JogVM* vm )
+static bool jog_chars_equal( JogStringView a, int a_offset, JogStringView b, int b_offset,
+    int count, bool ignore_case )
 {
-  double n = vm->pop_double();
-  vm->pop_frame();
-  vm->push( acos(n) );
-}
+  if ( !ignore_case ) return jog_chars_match( a, a_offset, b, b_offset, count );
 
-static void Math__asin__double( JogVM* vm )
-{
-  double n = vm->pop_double();
-  vm->pop_frame();
-  vm->push( asin(n) );
+  for (int i=0; i<count; ++i)
+  {
+    JogChar ch1 = a[a_offset+i];
+    JogChar ch2 = b[b_offset+i];
+    if (ch1 != ch2 && jog_fold_case(ch1) != jog_fold_case(ch2)) return false;
+  }
+  return true;
 }
 
-static void Math__atan__double( JogVM* vm )
+static JogRef String__concat( JogVM* vm, JogObject* st, JogObject* other )
 {
-  double n = vm->pop_double();
-  vm->pop_frame();
-  vm->push( atan(n) );
-}
+  if (other && jog_string_view(other).count == 0) return st;
 
-static void Math__atan2__double_double( JogVM* vm )
-{
-  double x = vm->pop_double();
-  double y = vm->pop_double();
-  vm->pop_frame();
-  vm->push( atan2(y,x) );
+  // Joined on the ref stack, where the operands stay visible to the
+  // collector while the result is allocated.
+  JogStackRef operand( other );
+  return vm->concat_strings( &operand, 1, &st );
 }
 
-static void Math__ceil__double( JogVM* vm )
+static void String__setChars( JogVM* vm, JogObject* st, JogArrayView<JogChar> data, int count )
 {
-  double n = vm->pop_double();
-  vm->pop_frame();
-  vm->push( ceil(n) );
+  if (count > data.count) count = data.count;
+  vm->set_string_chars( st, data.data, count );
 }
 
-static void Math__floor__double( JogVM* vm )
+static int String__hashCode( JogObject* st )
 {
-  double n = vm->pop_double();
-  vm->pop_frame();
-  vm->push( floor(n) );
+  return jog_string_hash_code( st );
 }
 
-static void Math__pow__double_double( JogVM* vm )
+static JogRef String__intern( JogVM* vm, JogObject* st )
 {
-  double p = vm->pop_double();
-  double n = vm->pop_double();
-  vm->pop_frame();
-  vm->push( pow(n,p) );
+  return vm->intern_string( st );
 }
 
-static void Math__sqrt__double( JogVM* vm )
+static void String__copyChars( JogObject* st, int i1, int i2, JogArrayView<JogChar> dest,
+    int dest_i1 )
 {
-  double n = vm->pop_double();
-  vm->pop_frame();
-  vm->push( sqrt(n) );
+  JogStringView src = jog_string_view( st );
+  jog_clamp_range( src.count, i1, i2 );
+  if (dest_i1 < 0 || (JogInt64) dest_i1 + (i2-i1) > dest.count) return;
+  jog_copy_chars( dest.data + dest_i1, src, i1, i2 - i1 );
 }
 
-static void Math__min__double_double( JogVM* vm )
+static JogRef String__copyRange( JogVM* vm, JogObject* st, int i1, int i2 )
 {
-  double m = vm->pop_double();
-  double n = vm->pop_double();
-  vm->pop_frame();
-  vm->push( min(n,m) );
+  JogStringView src = jog_string_view( st );
+  jog_clamp_range( src.count, i1, i2 );
+  if (src.latin1)
+  {
+    JogRef bytes = vm->create_array( jog_type_manager.type_byte_array, i2 - i1 );
+    memcpy( bytes->data, src.latin1 + i1, i2 - i1 );
+    return vm->create_string( bytes );
+  }
+  return vm->create_string( src.data + i1, i2 - i1 );
 }
 
-static void Math__min__float_float( JogVM* vm )
+static bool String__charsMatch( JogObject* st, int offset, JogStringView other, 
+    int other_offset, int count, bool ignore_case )
 {
-  float m = (float) vm->pop_double();
-  float n = (float) vm->pop_double();
-  vm->pop_frame();
-  vm->push( min(n,m) );
+  JogStringView a = jog_string_view( st );
+  if (offset < 0 || other_offset < 0) return false;
+  if ((JogInt64) offset + count > a.count) return false;
+  if ((JogInt64) other_offset + count > other.count) return false;
+  if (count <= 0) return true;
+
+  return jog_chars_equal( a, offset, other, other_offset, count, ignore_case );
 }
 
-static void Math__min__int_int( JogVM* vm )
+static bool String__equalChars( JogObject* st, JogStringView other, bool ignore_case )
 {
-  int m = vm->pop_int();
-  int n = vm->pop_int();
-  vm->pop_frame();
-  vm->push( min(n,m) );
+  JogStringView a = jog_string_view( st );
+  if (a.count != other.count) return false;
+
+  return jog_chars_equal( a, 0, other, 0, a.count, ignore_case );
 }
 
-static void Math__min__long_long( JogVM* vm )
+static int String__compareChars( JogObject* st, JogStringView b, bool ignore_case )
 {
-  double m = vm->pop_double();
-  double n = vm->pop_double();
-  vm->pop_frame();
-  vm->push( min(n,m) );
+  JogStringView a = jog_string_view( st );
+  int count = min( a.count, b.count );
+  if (ignore_case || !jog_chars_match(a,0,b,0,count))
+  {
+    for (int i=0; i<count; ++i)
+    {
+      JogChar ch1 = a[i];
+      JogChar ch2 = b[i];
+      if (ignore_case)
+      {
+        ch1 = jog_fold_case( ch1 );
+        ch2 = jog_fold_case( ch2 );
+      }
+      if (ch1 != ch2) return (ch1 > ch2) ? 1 : -1;
+    }
+  }
+
+  if (a.count > b.count) return  1;
+  if (a.count < b.count) return -1;
+  return 0;
 }
 
-static void Math__max__double_double( JogVM* vm )
+static int String__indexOfChar( JogObject* st, int ch, int i1 )
 {
-  double m = vm->pop_double();
-  double n = vm->pop_double();
-  vm->pop_frame();
-  vm->push( max(n,m) );
+  JogStringView data = jog_string_view( st );
+  if (i1 < 0) i1 = 0;
+  if (data.latin1)
+  {
+    if (ch < 0 || ch > 0xff || i1 >= data.count) return -1;
+    void* found = memchr( data.latin1 + i1, ch, data.count - i1 );
+    return found ? (int) ((JogUInt8*) found - data.latin1) : -1;
+  }
+
+  for (int i=i1; i<data.count; ++i)
+  {
+    if (data.data[i] == ch) return i;
+  }
+  return -1;
 }
 
-static void Math__max__float_float( JogVM* vm )
+static int String__lastIndexOfChar( JogObject* st, int ch, int i2 )
 {
-  float m = (float) vm->pop_double();
-  float n = (float) vm->pop_double();
-  vm->pop_frame();
-  vm->push( max(n,m) );
+  JogStringView data = jog_string_view( st );
+  if (i2 >= data.count) i2 = data.count - 1;
+  for (int i=i2; i>=0; --i)
+  {
+    if (data[i] == ch) return i;
+  }
+  return -1;
 }
 
-static void Math__max__int_int( JogVM* vm )
+template <typename CharTypeA, typename CharTypeB>
+static int jog_find_chars( CharTypeA* data, int count, CharTypeB* st, int st_count, int i1 )
 {
-  int m = vm->pop_int();
-  int n = vm->pop_int();
-  vm->pop_frame();
-  vm->push( max(n,m) );
+  CharTypeB first = st[0];
+  int last = count - st_count;
+  for (int i=i1; i<=last; ++i)
+  {
+    if (data[i] != first) continue;
+
+    int j = 1;
+    while (j < st_count && data[i+j] == st[j]) ++j;
+    if (j == st_count) return i;
+  }
+  return -1;
 }
 
-static void Math__max__long_long( JogVM* vm )
+template <typename CharTypeA, typename CharTypeB>
+static int jog_find_last_chars( CharTypeA* data, CharTypeB* st, int st_count, int i2 )
 {
-  double m = vm->pop_double();
-  double n = vm->pop_double();
-  vm->pop_frame();
-  vm->push( max(n,m) );
+  CharTypeB first = st[0];
+  for (int i=i2; i>=0; --i)
+  {
+    if (data[i] != first) continue;
+
+    int j = 1;
+    while (j < st_count && data[i+j] == st[j]) ++j;
+    if (j == st_count) return i;
+  }
+  return -1;
 }
 
-//=============================================================================
-//  PrintWriter
-//=============================================================================
-static void PrintWriter__print__char( JogVM* vm )
+static int String__findIn( JogObject* target, JogStringView data, int i1 )
 {
-  putchar( vm->pop_int() );
+  JogStringView st = jog_string_view( target );
+  if (i1 < 0) i1 = 0;
+  if (st.count == 0) return min( i1, data.count );
+
+  if (data.latin1)
+  {
+    if (st.latin1) return jog_find_chars( data.latin1, data.count, st.latin1, st.count, i1 );
+    else           return jog_find_chars( data.latin1, data.count, st.data, st.count, i1 );
+  }
+  else
+  {
+    if (st.latin1) return jog_find_chars( data.data, data.count, st.latin1, st.count, i1 );
+    else           return jog_find_chars( data.data, data.count, st.data, st.count, i1 );
+  }
 }
 
-static void PrintWriter__print__String( JogVM* vm )
+static int String__findLastIn( JogObject* target, JogStringView data, int i2 )
 {
-  JogObject* str = *(vm->pop_ref());
-  if (str == NULL)
+  JogStringView st = jog_string_view( target );
+  if (i2 > data.count - st.count) i2 = data.count - st.count;
+  if (st.count == 0) return i2;
+
+  if (data.latin1)
   {
-    printf( "null" );
+    if (st.latin1) return jog_find_last_chars( data.latin1, st.latin1, st.count, i2 );
+    else           return jog_find_last_chars( data.latin1, st.data, st.count, i2 );
   }
   else
   {
-    JogObject* array = *((JogObject**)&(str->data[0]));
-    if (array)
-    {
-      int count = array->count + 1;
-      JogChar* cur  = ((JogChar*) array->data) - 1;
-      while (--count)
-      {
-        putchar( *(++cur) );
-      }
-    }
-    else
-    {
-      printf( "[Internal] null array on String print." );
-    }
+    if (st.latin1) return jog_find_last_chars( data.data, st.latin1, st.count, i2 );
+    else           return jog_find_last_chars( data.data, st.data, st.count, i2 );
   }
 }
 
 //=============================================================================
 //  System
 //=============================================================================
-static void System__currentTimeMillis( JogVM* vm )
+static JogInt64 System__currentTimeMillis()
 {
-  vm->pop_frame();
-
 #if defined(_WIN32)
   struct __timeb64 time_struct;
   JogInt64 time_ms;
@@ -247,43 +301,62 @@ static void System__currentTimeMillis( JogVM* vm )
   time_ms += (time_struct.tv_usec / 1000);
 #endif
 
-  vm->push( time_ms );
+  return time_ms;
 }
 
 
 void JogVM::add_native_handlers()
 {
-  add_native_handler( "Math::abs(double)", Math__abs__double );
-  add_native_handler( "Math::abs(float)", Math__abs__float );
-  add_native_handler( "Math::abs(int)", Math__abs__int );
-  add_native_handler( "Math::abs(long)", Math__abs__long );
-
-  add_native_handler( "Math::cos(double)", Math__cos__double );
-  add_native_handler( "Math::sin(double)", Math__sin__double );
-  add_native_handler( "Math::tan(double)", Math__tan__double );
-  add_native_handler( "Math::acos(double)", Math__acos__double );
-  add_native_handler( "Math::asin(double)", Math__asin__double );
-  add_native_handler( "Math::atan(double)", Math__atan__double );
-  add_native_handler( "Math::atan2(double,double)", Math__atan2__double_double );
-
-  add_native_handler( "Math::ceil(double)", Math__ceil__double );
-  add_native_handler( "Math::floor(double)", Math__floor__double );
-
-  add_native_handler( "Math::pow(double,double)", Math__pow__double_double );
-  add_native_handler( "Math::sqrt(double)", Math__sqrt__double );
-
-  add_native_handler( "Math::min(double,double)", Math__min__double_double );
-  add_native_handler( "Math::min(float,float)", Math__min__float_float );
-  add_native_handler( "Math::min(int,int)", Math__min__int_int );
-  add_native_handler( "Math::min(long,long)", Math__min__long_long );
-
-  add_native_handler( "Math::max(double,double)", Math__max__double_double );
-  add_native_handler( "Math::max(float,float)", Math__max__float_float );
-  add_native_handler( "Math::max(int,int)", Math__max__int_int );
-  add_native_handler( "Math::max(long,long)", Math__max__long_long );
-
-  add_native_handler( "PrintWriter::print(char)", PrintWriter__print__char );
-  add_native_handler( "PrintWriter::print(String)", PrintWriter__print__String );
-  add_native_handler( "System::currentTimeMillis()", System__currentTimeMillis );
+  bind_pure<double(double),Math__abs>( "Math::abs(double)" );
+  bind_pure<float(float),Math__abs>( "Math::abs(float)" );
+  bind_pure<int(int),Math__abs>( "Math::abs(int)" );
+  bind_pure<JogInt64(JogInt64),Math__abs>( "Math::abs(long)" );
+
+  bind_pure<double(double),cos>( "Math::cos(double)" );
+  bind_pure<double(double),sin>( "Math::sin(double)" );
+  bind_pure<double(double),tan>( "Math::tan(double)" );
+  bind_pure<double(double),acos>( "Math::acos(double)" );
+  bind_pure<double(double),asin>( "Math::asin(double)" );
+  bind_pure<double(double),atan>( "Math::atan(double)" );
+  bind_pure<double(double,double),atan2>( "Math::atan2(double,double)" );
+
+  bind_pure<double(double),ceil>( "Math::ceil(double)" );
+  bind_pure<double(double),floor>( "Math::floor(double)" );
+
+  bind_pure<double(double,double),pow>( "Math::pow(double,double)" );
+  bind_pure<double(double),sqrt>( "Math::sqrt(double)" );
+
+  bind_pure<double(double,double),Math__min>( "Math::min(double,double)" );
+  bind_pure<float(float,float),Math__min>( "Math::min(float,float)" );
+  bind_pure<int(int,int),Math__min>( "Math::min(int,int)" );
+  bind_pure<JogInt64(JogInt64,JogInt64),Math__min>( "Math::min(long,long)" );
+
+  bind_pure<double(double,double),Math__max>( "Math::max(double,double)" );
+  bind_pure<float(float,float),Math__max>( "Math::max(float,float)" );
+  bind_pure<int(int,int),Math__max>( "Math::max(int,int)" );
+  bind_pure<JogInt64(JogInt64,JogInt64),Math__max>( "Math::max(long,long)" );
+
+  bind<void(JogObject*,JogChar),PrintWriter__print__char>( "PrintWriter::print(char)" );
+  bind<void(JogObject*,JogStringView),PrintWriter__print__String>( "PrintWriter::print(String)" );
+  bind<JogInt64(),System__currentTimeMillis>( "System::currentTimeMillis()" );
+
+  bind<JogRef(JogVM*,JogObject*,JogObject*),String__concat>( "String::concat(String)" );
+  bind<void(JogVM*,JogObject*,JogArrayView<JogChar>,int),String__setChars>(
+      "String::setChars(char[],int)" );
+  bind<int(JogObject*),String__hashCode>( "String::hashCode()" );
+  bind<JogRef(JogVM*,JogObject*),String__intern>( "String::intern()" );
+  bind<void(JogObject*,int,int,JogArrayView<JogChar>,int),String__copyChars>(
+      "String::copyChars(int,int,char[],int)" );
+  bind<JogRef(JogVM*,JogObject*,int,int),String__copyRange>( "String::copyRange(int,int)" );
+  bind<bool(JogObject*,int,JogStringView,int,int,bool),String__charsMatch>(
+      "String::charsMatch(int,String,int,int,boolean)" );
+  bind<bool(JogObject*,JogStringView,bool),String__equalChars>(
+      "String::equalChars(String,boolean)" );
+  bind<int(JogObject*,JogStringView,bool),String__compareChars>(
+      "String::compareChars(String,boolean)" );
+  bind<int(JogObject*,int,int),String__indexOfChar>( "String::indexOfChar(int,int)" );
+  bind<int(JogObject*,int,int),String__lastIndexOfChar>( "String::lastIndexOfChar(int,int)" );
+  bind<int(JogObject*,JogStringView,int),String__findIn>( "String::findIn(String,int)" );
+  bind<int(JogObject*,JogStringView,int),String__findLastIn>( "String::findLastIn(String,int)" );
 }
 
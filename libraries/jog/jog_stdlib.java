@@ -478,9 +478,11 @@ class Object
 
 class String
 {
-  // Note: the native layer assumes these two properties are defined as they are.
+  // Note: the native layer assumes these properties are defined as they are.
+  // A compact String keeps its characters in latin1 and leaves data null.
   char[] data;
-  int    hash_code;
+  int    hash_code;  // 0 until hashCode() computes it
+  byte[] latin1;
 
   public String( char[] data )
   {
@@ -489,13 +491,8 @@ class String
 
   public String( char[] data, int count )
   {
-    this.data = new char[count];
-    for (int i=0; i<count; ++i)
-    {
-      char ch = data[i];
-      hash_code = (hash_code << 1) + ch;
-      this.data[i] = ch;
-    }
+    assert( count>=0 && count<=data.length, "String() count out of bounds." );
+    setChars( data, count );
   }
 
   public String toString()
@@ -505,38 +502,19 @@ class String
 
   public int length()
   {
-    return data.length;
+    return (latin1 != null) ? latin1.length : data.length;
   }
 
-  public String concat( String other )
-  {
-    if (other == null) return concat("null");
-
-    char[] new_data = new char[data.length + other.data.length];
-
-    int c = data.length;
-    for (int i=0; i<c; ++i) new_data[i] = data[i];
-
-    int c2 = other.data.length;
-    for (int i=0; i<c2; ++i) new_data[c++] = other.data[i];
-
-    return new String(new_data);
-  }
+  native public String concat( String other );
 
   public boolean equals( Object other_object )
   {
     if (this == other_object) return true;
 
     String other = other_object.toString();
-    if (other == null || this.data.length != other.data.length) return false;
-
-    int count = data.length;
-    for (int i=0; i<count; ++i)
-    {
-      if (data[i] != other.data[i]) return false;
-    }
+    if (other == null) return false;
 
-    return true;
+    return equalChars( other, false );
   }
 
   public boolean equalsIgnoreCase( Object other_object )
@@ -544,187 +522,84 @@ class String
     if (this == other_object) return true;
 
     String other = other_object.toString();
-    if (other == null || this.data.length != other.data.length) return false;
+    if (other == null) return false;
 
-    int count = data.length;
-    for (int i=0; i<count; ++i)
-    {
-      char ch1 = data[i];
-      char ch2 = other.data[i];
-      if (ch1 >= 'A' && ch1 <= 'Z') ch1 += ('a'-'A');
-      if (ch2 >= 'A' && ch2 <= 'Z') ch2 += ('a'-'A');
-      if (ch1 != ch2) return false;
-    }
-
-    return true;
+    return equalChars( other, true );
   }
 
-  char charAt(int index) { return data[index]; }
+  char charAt( int index )
+  {
+    return (latin1 != null) ? (char) (latin1[index] & 255) : data[index];
+  }
 
   int  compareTo( String other )
   {
     if (this == other) return 0;
-
-    int count = data.length;
-    if (count > other.data.length) count = other.data.length;
-
-    for (int i=0; i<count; ++i)
-    {
-      char ch1 = data[i];
-      char ch2 = other.data[i];
-      if (ch1 != ch2)
-      {
-        if (ch1 > ch2) return 1;
-        else return -1;
-      }
-    }
-
-    if (data.length > other.data.length) return  1;
-    if (data.length < other.data.length) return -1;
-
-    return 0;
+    return -other.compareChars( this, false );
   }
 
   int compareToIgnoreCase(String other)
   {
     if (this == other) return 0;
-
-    int count = data.length;
-    if (count > other.data.length) count = other.data.length;
-
-    for (int i=0; i<count; ++i)
-    {
-      char ch1 = data[i];
-      char ch2 = other.data[i];
-      if (ch1 >= 'A' && ch1 <= 'Z') ch1 += ('a'-'A');
-      if (ch2 >= 'A' && ch2 <= 'Z') ch2 += ('a'-'A');
-      if (ch1 != ch2)
-      {
-        if (ch1 > ch2) return 1;
-        else return -1;
-      }
-    }
-
-    if (data.length > other.data.length) return  1;
-    if (data.length < other.data.length) return -1;
-
-    return 0;
+    return -other.compareChars( this, true );
   }
 
   boolean endsWith( String suffix )
   {
-    int i = indexOf( suffix );
-    if (i == -1) return false;
+    int count = suffix.length();
+    return suffix.charsMatch( 0, this, length() - count, count, false );
+  }
 
-    return (i == data.length - suffix.data.length);
+  public void getChars( int i1, int i2_exclusive, char[] dest, int dest_i1 )
+  {
+    assert( i1>=0 && i1<=i2_exclusive && i2_exclusive<=length(),
+        "getChars() index out of bounds." );
+    assert( dest_i1>=0 && dest_i1+(i2_exclusive-i1)<=dest.length,
+        "getChars() destination index out of bounds." );
+    copyChars( i1, i2_exclusive, dest, dest_i1 );
   }
 
-  int hashCode() { return hash_code; }
+  native int hashCode();
 
-  int indexOf( int ch ) { return indexOf( ch, 0 ); }
+  int indexOf( int ch ) { return indexOfChar( ch, 0 ); }
 
-  int indexOf( int ch, int i1 )
-  {
-    int count = data.length;
-    for (int i=i1; i<count; ++i)
-    {
-      if (data[i] == ch) return i;
-    }
-    return -1;
-  }
+  int indexOf( int ch, int i1 ) { return indexOfChar( ch, i1 ); }
 
-  int indexOf( String st ) { return indexOf( st, 0 ); }
+  int indexOf( String st ) { return st.findIn( this, 0 ); }
 
-  int indexOf( String st, int i1 )
-  {
-    int count = data.length - (st.data.length - 1);
-    int ch1 = st.data[0];
-    for (int i=i1; i<count; ++i)
-    {
-      if (data[i] == ch1)
-      {
-        if (regionMatches( false, i, st, 0, st.data.length ))
-        {
-          return i;
-        }
-      }
-    }
-    return -1;
-  }
+  int indexOf( String st, int i1 ) { return st.findIn( this, i1 ); }
 
-  String intern() { return this; }  // dummy implementation
+  native String intern();
 
-  boolean isEmpty() { return data.length == 0; }
+  boolean isEmpty() { return length() == 0; }
 
-  int lastIndexOf(int ch) { return lastIndexOf(ch,data.length-1); }
+  int lastIndexOf(int ch) { return lastIndexOfChar( ch, length()-1 ); }
 
-  int lastIndexOf( int ch, int i2 )
-  {
-    for (int i=i2; i>=0; --i)
-    {
-      if (data[i] == ch) return i;
-    }
-    return -1;
-  }
+  int lastIndexOf( int ch, int i2 ) { return lastIndexOfChar( ch, i2 ); }
 
-  int lastIndexOf( String st ) { return lastIndexOf(st,data.length-1); }
+  int lastIndexOf( String st ) { return st.findLastIn( this, length() ); }
 
-  int lastIndexOf( String st, int i2 )
-  {
-    int ch1 = st.data[0];
-    for (int i=i2; i>=0; --i)
-    {
-      if (data[i] == ch1)
-      {
-        if (regionMatches(false, i, st, 0, st.data.length))
-        {
-          return i;
-        }
-      }
-    }
-    return -1;
-  }
+  int lastIndexOf( String st, int i2 ) { return st.findLastIn( this, i2 ); }
 
   boolean regionMatches( boolean ignoreCase, int this_offset,
       String other, int other_offset, int count )
   {
-    if (this_offset < 0 || other_offset < 0) return false;
-    if (this_offset + count > data.length) return false;
-    if (other_offset + count > other.data.length) return false;
-
-    for (int i=0; i<count; ++i)
-    {
-      char ch1 = data[this_offset+i];
-      char ch2 = other.data[other_offset+i];
-      if (ignoreCase)
-      {
-        if (ch1 >= 'A' && ch1 <= 'Z') ch1 += ('a'-'A');
-        if (ch2 >= 'A' && ch2 <= 'Z') ch2 += ('a'-'A');
-      }
-      if (ch1 != ch2) return false;
-    }
-
-    return true;
+    return other.charsMatch( other_offset, this, this_offset, count, ignoreCase );
   }
 
   boolean regionMatches( int this_offset, String other, int other_offset, int count )
   {
-    return regionMatches( false, this_offset, other, other_offset, count );
+    return other.charsMatch( other_offset, this, this_offset, count, false );
   }
 
   String   replace( char old_char, char new_char )
   {
-    StringBuilder buffer = new StringBuilder();
-
-    int count = data.length;
-    for (int i=0; i<count; ++i)
+    char[] chars = toCharArray();
+    for (int i=0; i<chars.length; ++i)
     {
-      char ch = data[i];
-      if (ch == old_char) ch = new_char;
-      buffer.append(ch);
+      if (chars[i] == old_char) chars[i] = new_char;
     }
-
-    return buffer.toString();
+    return new String(chars);
   }
 
   String replace( String target, String replacement )
@@ -733,14 +608,14 @@ class String
     StringBuilder buffer = new StringBuilder();
 
     String remaining = this;
-    while (remaining.data.length > 0)
+    while (remaining.length() > 0)
     {
       int i = remaining.indexOf(target);
       if (i >= 0)
       {
         buffer.append( remaining.substring(0,i) );
         buffer.append( replacement );
-        remaining = remaining.substring(i+target.data.length);
+        remaining = remaining.substring(i+target.length());
       }
       else
       {
@@ -763,7 +638,7 @@ class String
     int i = indexOf(target);
     if (i >= 0)
     {
-      return substring(0,i) + replacement + substring(i+target.data.length);
+      return substring(0,i) + replacement + substring(i+target.length());
     }
     else
     {
@@ -776,13 +651,13 @@ class String
     ArrayList<String> strings = new ArrayList<String>();
 
     String remaining = this;
-    while (remaining.data.length > 0)
+    while (remaining.length() > 0)
     {
       int i = remaining.indexOf(splitter);
       if (i >= 0)
       {
         strings.add( remaining.substring(0,i) );
-        remaining = remaining.substring( i + splitter.data.length );
+        remaining = remaining.substring( i + splitter.length() );
       }
       else
       {
@@ -802,89 +677,64 @@ class String
 
   boolean startsWith( String prefix )
   {
-    return indexOf(prefix) == 0;
+    return prefix.charsMatch( 0, this, 0, prefix.length(), false );
   }
 
   boolean startsWith( String prefix, int offset )
   {
-    return indexOf(prefix,offset) == offset;
+    return prefix.charsMatch( 0, this, offset, prefix.length(), false );
   }
 
   String substring( int i1 )
   {
-    return substring( i1, data.length );
+    return substring( i1, length() );
   }
 
   String substring( int i1, int i2_exclusive )
   {
-    StringBuilder buffer = new StringBuilder();
-
-    for (int i=i1; i<i2_exclusive; ++i)
-    {
-      buffer.append(data[i]);
-    }
-
-    return buffer.toString();
+    if (i1 >= i2_exclusive) return "";
+    assert( i1>=0 && i2_exclusive<=length(), "substring() index out of bounds." );
+    return copyRange( i1, i2_exclusive );
   }
 
   char[] toCharArray()
   {
-    int count = data.length;
-    char[] result = new char[count];
-
-    for (int i=0; i<count; ++i)
-    {
-      result[i] = data[i];
-    }
-
-    return result;
+    char[] chars = new char[ length() ];
+    copyChars( 0, chars.length, chars, 0 );
+    return chars;
   }
 
   String toLowerCase()
   {
-    StringBuilder buffer = new StringBuilder();
-    int count = data.length;
-
-    for (int i=0; i<count; ++i)
+    char[] chars = toCharArray();
+    for (int i=0; i<chars.length; ++i)
     {
-      char ch = data[i];
-      if (ch >= 'A' && ch <= 'Z') ch += ('a'-'A');
-      buffer.append(ch);
+      char ch = chars[i];
+      if (ch >= 'A' && ch <= 'Z') chars[i] = (char) (ch + ('a'-'A'));
     }
-
-    return buffer.toString();
+    return new String(chars);
   }
 
   String toUpperCase()
   {
-    StringBuilder buffer = new StringBuilder();
-    int count = data.length;
-
-    for (int i=0; i<count; ++i)
+    char[] chars = toCharArray();
+    for (int i=0; i<chars.length; ++i)
     {
-      char ch = data[i];
-      if (ch >= 'a' && ch <= 'z') ch += ('A'-'a');
-      buffer.append(ch);
+      char ch = chars[i];
+      if (ch >= 'a' && ch <= 'z') chars[i] = (char) (ch + ('A'-'a'));
     }
-
-    return buffer.toString();
+    return new String(chars);
   }
 
   String trim()
   {
-    String result = this;
-
-    while (result.data.length > 0 && result.data[0] == ' ')
-    {
-      result = result.substring(1);
-    }
+    int i1 = 0;
+    int i2 = length();
+    while (i1 < i2 && charAt(i1) == ' ') ++i1;
+    while (i2 > i1 && charAt(i2-1) == ' ') --i2;
 
-    while (result.data.length > 0 && result.data[result.data.length-1] == ' ')
-    {
-      result = result.substring(0,result.data.length-1);
-    }
-
-    return result;
+    if (i1 == 0 && i2 == length()) return this;
+    return substring( i1, i2 );
   }
 
   /*
@@ -925,6 +775,20 @@ class String
   }
   */
 
+  // The natives below work on compact and char[] Strings alike and clamp
+  // their ranges; the methods above check their arguments first.
+  native void    setChars( char[] data, int count );
+  native void    copyChars( int i1, int i2_exclusive, char[] dest, int dest_i1 );
+  native String  copyRange( int i1, int i2_exclusive );
+  native boolean charsMatch( int offset, String other, int other_offset, int count,
+      boolean ignore_case );
+  native boolean equalChars( String other, boolean ignore_case );
+  native int     compareChars( String other, boolean ignore_case );
+  native int     indexOfChar( int ch, int i1 );
+  native int     lastIndexOfChar( int ch, int i2 );
+  native int     findIn( String data, int i1 );
+  native int     findLastIn( String data, int i2 );
+
 }
 
 class StringBuilder
@@ -945,9 +809,7 @@ class StringBuilder
   public StringBuilder( String initial_contents )
   {
     this( initial_contents.length() );
-
-    size = initial_contents.length();
-    for (int i=0; i<size; ++i) data[i] = initial_contents.data[i];
+    append( initial_contents );
   }
 
   public String toString()
@@ -973,10 +835,8 @@ class StringBuilder
     int count = st.length();
     ensureCapacity( size + count );
 
-    for (int i=0; i<count; ++i)
-    {
-      data[size++] = st.data[i];
-    }
+    st.copyChars( 0, count, data, size );
+    size += count;
     return this;
   }
 
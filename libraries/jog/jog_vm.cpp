@@ -71,10 +71,7 @@ void JogCmdLiteralString::on_push( JogVM* vm ) { }
 
 void JogCmdLiteralString::execute( JogVM* vm )
 {
-  if ( !*runtime_object )
-  {
-    runtime_object = vm->create_string( (JogChar*) value->data, value->count );
-  }
+  if ( !runtime_object ) runtime_object = vm->intern_string( (JogChar*) value->data, value->count );
   vm->push( runtime_object );
 }
 
@@ -131,6 +128,7 @@ void JogCmdWhile::on_push( JogVM* vm )
 
 void JogCmdWhile::execute( JogVM* vm ) 
 {
+  if (vm->execution_state()) vm->charge( this );  // back-edge
   if (vm->pop_data())
   {
     vm->run_this_again();
@@ -156,6 +154,7 @@ void JogCmdFor::execute( JogVM* vm )
 
   if (state&1)
   {
+    vm->charge( this );  // back-edge
     vm->run_this_again();
     vm->push( *condition );
     if (*var_mod) vm->push( *var_mod );
@@ -170,6 +169,26 @@ void JogCmdFor::execute( JogVM* vm )
   }
 }
 
+void JogCmdCountedLoop::on_push( JogVM* vm ) 
+{ 
+  if (*initialization) vm->push( *initialization );
+}
+
+void JogCmdCountedLoop::execute( JogVM* vm ) 
+{
+  // State 0 follows the initialization, later states follow the body or
+  // a 'continue'.
+  int state = vm->execution_state();
+  if (state) step(vm);
+
+  if (in_range(vm))
+  {
+    if (state) vm->charge( this );  // back-edge
+    vm->run_this_again();
+    if (*body) vm->push( *body );
+  }
+}
+
 void JogCmdBreak::execute( JogVM* vm )
 {
   JogInstruction* cur   = vm->instruction_stack_ptr;
@@ -311,7 +330,18 @@ void JogCmdNewObject::execute( JogVM* vm )
 
   if (execution_state == 0)
   {
-    vm->push_frame( method_info );
+    vm->charge( this );
+    vm->push_frame( method_info, this );
+    if (vm->starts_exact_checks())
+    {
+      vm->execute_frame_checked( method_info );
+      return;
+    }
+    if (*(method_info->code))
+    {
+      vm->execute_code( *(method_info->code) );
+      return;
+    }
   }
 
   if (execution_state < count)
@@ -391,7 +421,7 @@ void JogCmdLiteralArray::execute( JogVM* vm )
   if (of_type->element_type->is_reference())
   {
     // reference type
-    JogRef element = vm->pop_ref();
+    JogStackRef element = vm->pop_ref();
     element->retain();
     ((JogObject**)(vm->peek_ref()->data))[execution_state-1] = *element;
   }
@@ -687,8 +717,8 @@ void JogCmdEQInteger::execute( JogVM* vm )
 
 void JogCmdEQRef::execute( JogVM* vm )
 {
-  JogRef b = vm->pop_ref();
-  JogRef a = vm->pop_ref();
+  JogStackRef b = vm->pop_ref();
+  JogStackRef a = vm->pop_ref();
   vm->push( (a==b)?1:0 );
 }
 
@@ -708,8 +738,8 @@ void JogCmdNEInteger::execute( JogVM* vm )
 
 void JogCmdNERef::execute( JogVM* vm )
 {
-  JogRef b = vm->pop_ref();
-  JogRef a = vm->pop_ref();
+  JogStackRef b = vm->pop_ref();
+  JogStackRef a = vm->pop_ref();
   vm->push( (a!=b)?1:0 );
 }
 
@@ -911,7 +941,18 @@ void JogCmdCallInitObject::execute( JogVM* vm )
   int  statement_index = vm->execution_state();
   if (statement_index == 0)
   {
-    vm->push_frame( method_info );
+    vm->charge( this );
+    vm->push_frame( method_info, this );
+    if (vm->starts_exact_checks())
+    {
+      vm->execute_frame_checked( method_info );
+      return;
+    }
+    if (*(method_info->code))
+    {
+      vm->execute_code( *(method_info->code) );
+      return;
+    }
   }
 
   RefList<JogCmd>* commands = &method_info->statements->commands;
@@ -948,14 +989,26 @@ void JogCmdStaticCall::execute( JogVM* vm )
   int  statement_index = vm->execution_state();
   if (statement_index == 0)
   {
+    vm->charge( this );
     ((vm->ref_stack_ptr + (method_info->param_ref_count))[-1]).null_check(t);
-    vm->push_frame( method_info );
+    if (method_info->is_native() && vm->call_leaf_native(method_info)) return;
+    vm->push_frame( method_info, this );
+    if (vm->starts_exact_checks())
+    {
+      vm->execute_frame_checked( method_info );
+      return;
+    }
     if (method_info->is_native())
     {
       vm->run_this_again();
       vm->call_native( method_info );
       return;
     }
+    if (*(method_info->code))
+    {
+      vm->execute_code( *(method_info->code) );
+      return;
+    }
   }
   else
   {
@@ -990,9 +1043,16 @@ void JogCmdDynamicCall::execute( JogVM* vm )
   int  statement_index = vm->execution_state();
   if (statement_index == 0)
   {
+    vm->charge( this );
     JogObject* obj = ((vm->ref_stack_ptr + (method_info->param_ref_count))[-1]).null_check(t);
     m = obj->type->dispatch_table[method_info->dispatch_id];
-    vm->push_frame( m );
+    if (m->is_native() && vm->call_leaf_native(m)) return;
+    vm->push_frame( m, this );
+    if (vm->starts_exact_checks())
+    {
+      vm->execute_frame_checked( m );
+      return;
+    }
 
     if (m->is_native())
     {
@@ -1000,6 +1060,11 @@ void JogCmdDynamicCall::execute( JogVM* vm )
       vm->call_native( m );
       return;
     }
+    if (*(m->code))
+    {
+      vm->execute_code( *(m->code) );
+      return;
+    }
   }
   else
   {
@@ -1048,13 +1113,25 @@ void JogCmdClassCall::execute( JogVM* vm )
   int  statement_index = vm->execution_state();
   if (statement_index == 0)
   {
-    vm->push_frame(method_info);
+    vm->charge( this );
+    if (method_info->is_native() && vm->call_leaf_native(method_info)) return;
+    vm->push_frame( method_info, this );
+    if (vm->starts_exact_checks())
+    {
+      vm->execute_frame_checked( method_info );
+      return;
+    }
     if (method_info->is_native())
     {
       vm->run_this_again();
       vm->call_native( method_info );
       return;
     }
+    if (*(method_info->code))
+    {
+      vm->execute_code( *(method_info->code) );
+      return;
+    }
   }
   else if (method_info->is_native())
   {
@@ -1099,7 +1176,7 @@ void JogCmdReturnRef::on_push( JogVM* vm )
 
 void JogCmdReturnRef::execute( JogVM* vm )
 {
-  JogRef result = vm->pop_ref();
+  JogStackRef result = vm->pop_ref();
   vm->pop_frame();
   vm->push( result );
 }
@@ -1156,13 +1233,13 @@ void JogCmdReadProperty::on_push( JogVM* vm )
 
 void JogCmdReadPropertyData::execute( JogVM* vm )
 {
-  JogRef context = vm->pop_ref();
+  JogStackRef context = vm->pop_ref();
   vm->push(context.null_check(t)->data[var_info->index]);
 }
 
 void JogCmdReadPropertyRef::execute( JogVM* vm )
 {
-  JogRef context = vm->pop_ref();
+  JogStackRef context = vm->pop_ref();
   vm->push( *((JogObject**)&(context.null_check(t)->data[var_info->index])) );
 }
 
@@ -1175,15 +1252,15 @@ void JogCmdWriteProperty::on_push( JogVM* vm )
 void JogCmdWritePropertyData::execute( JogVM* vm )
 {
   JogInt64 new_value = vm->pop_data();
-  JogRef context = vm->pop_ref();
+  JogStackRef context = vm->pop_ref();
   context.null_check(t)->data[var_info->index] = new_value;
   vm->push( new_value );
 }
 
 void JogCmdWritePropertyRef::execute( JogVM* vm )
 {
-  JogRef new_value = vm->pop_ref();
-  JogRef context   = vm->pop_ref();
+  JogStackRef new_value = vm->pop_ref();
+  JogStackRef context   = vm->pop_ref();
   JogObject** location = (JogObject**)&(context.null_check(t)->data[var_info->index]);
   if (*location) (*location)->release();
   *location = *new_value;
@@ -1231,7 +1308,7 @@ void JogCmdArrayRead::on_push( JogVM* vm )
 void JogCmdArrayReadRef::execute( JogVM* vm )
 {
   int index = vm->pop_int();
-  JogRef obj = vm->pop_ref();
+  JogStackRef obj = vm->pop_ref();
   JogObject* array = obj.null_check(t);
   array->index_check(t,index);
   vm->push( ((JogObject**)array->data)[index] );
@@ -1240,7 +1317,7 @@ void JogCmdArrayReadRef::execute( JogVM* vm )
 void JogCmdArrayReadReal64::execute( JogVM* vm )
 {
   int index = vm->pop_int();
-  JogRef obj = vm->pop_ref();
+  JogStackRef obj = vm->pop_ref();
   JogObject* array = obj.null_check(t);
   array->index_check(t,index);
   vm->push( ((double*)array->data)[index] );
@@ -1249,7 +1326,7 @@ void JogCmdArrayReadReal64::execute( JogVM* vm )
 void JogCmdArrayReadReal32::execute( JogVM* vm )
 {
   int index = vm->pop_int();
-  JogRef obj = vm->pop_ref();
+  JogStackRef obj = vm->pop_ref();
   JogObject* array = obj.null_check(t);
   array->index_check(t,index);
   vm->push( ((float*)array->data)[index] );
@@ -1258,7 +1335,7 @@ void JogCmdArrayReadReal32::execute( JogVM* vm )
 void JogCmdArrayReadInt64::execute( JogVM* vm )
 {
   int index = vm->pop_int();
-  JogRef obj = vm->pop_ref();
+  JogStackRef obj = vm->pop_ref();
   JogObject* array = obj.null_check(t);
   array->index_check(t,index);
   vm->push( ((JogInt64*)array->data)[index] );
@@ -1267,7 +1344,7 @@ void JogCmdArrayReadInt64::execute( JogVM* vm )
 void JogCmdArrayReadInt32::execute( JogVM* vm )
 {
   int index = vm->pop_int();
-  JogRef obj = vm->pop_ref();
+  JogStackRef obj = vm->pop_ref();
   JogObject* array = obj.null_check(t);
   array->index_check(t,index);
   vm->push( ((JogInt32*)array->data)[index] );
@@ -1276,7 +1353,7 @@ void JogCmdArrayReadInt32::execute( JogVM* vm )
 void JogCmdArrayReadInt16::execute( JogVM* vm )
 {
   int index = vm->pop_int();
-  JogRef obj = vm->pop_ref();
+  JogStackRef obj = vm->pop_ref();
   JogObject* array = obj.null_check(t);
   array->index_check(t,index);
   vm->push( ((JogInt16*)array->data)[index] );
@@ -1285,7 +1362,7 @@ void JogCmdArrayReadInt16::execute( JogVM* vm )
 void JogCmdArrayReadInt8::execute( JogVM* vm )
 {
   int index = vm->pop_int();
-  JogRef obj = vm->pop_ref();
+  JogStackRef obj = vm->pop_ref();
   JogObject* array = obj.null_check(t);
   array->index_check(t,index);
   vm->push( ((JogInt8*)array->data)[index] );
@@ -1294,7 +1371,7 @@ void JogCmdArrayReadInt8::execute( JogVM* vm )
 void JogCmdArrayReadChar::execute( JogVM* vm )
 {
   int index = vm->pop_int();
-  JogRef obj = vm->pop_ref();
+  JogStackRef obj = vm->pop_ref();
   JogObject* array = obj.null_check(t);
   array->index_check(t,index);
   vm->push( ((JogChar*)array->data)[index] );
@@ -1303,7 +1380,7 @@ void JogCmdArrayReadChar::execute( JogVM* vm )
 void JogCmdArrayReadBoolean::execute( JogVM* vm )
 {
   int index = vm->pop_int();
-  JogRef obj = vm->pop_ref();
+  JogStackRef obj = vm->pop_ref();
   JogObject* array = obj.null_check(t);
   array->index_check(t,index);
   vm->push( ((char*)array->data)[index] );
@@ -1320,9 +1397,9 @@ void JogCmdArrayWrite::on_push( JogVM* vm )
 
 void JogCmdArrayWriteRef::execute( JogVM* vm )
 {
-  JogRef value = vm->pop_ref();
+  JogStackRef value = vm->pop_ref();
   int index = vm->pop_int();
-  JogRef obj = vm->pop_ref();
+  JogStackRef obj = vm->pop_ref();
   JogObject* array = obj.null_check(t);
 
   array->index_check(t,index);
@@ -1339,7 +1416,7 @@ void JogCmdArrayWriteReal64::execute( JogVM* vm )
 {
   double value = vm->pop_double();
   int index = vm->pop_int();
-  JogRef obj = vm->pop_ref();
+  JogStackRef obj = vm->pop_ref();
   JogObject* array = obj.null_check(t);
   array->index_check(t,index);
   ((double*)array->data)[index] = value;
@@ -1350,7 +1427,7 @@ void JogCmdArrayWriteReal32::execute( JogVM* vm )
 {
   double value = vm->pop_double();
   int index = vm->pop_int();
-  JogRef obj = vm->pop_ref();
+  JogStackRef obj = vm->pop_ref();
   JogObject* array = obj.null_check(t);
   array->index_check(t,index);
   ((float*)array->data)[index] = (float) value;
@@ -1361,7 +1438,7 @@ void JogCmdArrayWriteInt64::execute( JogVM* vm )
 {
   JogInt64 value = vm->pop_data();
   int index = vm->pop_int();
-  JogRef obj = vm->pop_ref();
+  JogStackRef obj = vm->pop_ref();
   JogObject* array = obj.null_check(t);
   array->index_check(t,index);
   ((JogInt64*)array->data)[index] = value;
@@ -1372,7 +1449,7 @@ void JogCmdArrayWriteInt32::execute( JogVM* vm )
 {
   JogInt64 value = vm->pop_data();
   int index = vm->pop_int();
-  JogRef obj = vm->pop_ref();
+  JogStackRef obj = vm->pop_ref();
   JogObject* array = obj.null_check(t);
   array->index_check(t,index);
   ((JogInt32*)array->data)[index] = (JogInt32) value;
@@ -1383,7 +1460,7 @@ void JogCmdArrayWriteInt16::execute( JogVM* vm )
 {
   JogInt64 value = vm->pop_data();
   int index = vm->pop_int();
-  JogRef obj = vm->pop_ref();
+  JogStackRef obj = vm->pop_ref();
   JogObject* array = obj.null_check(t);
   array->index_check(t,index);
   ((JogInt16*)array->data)[index] = (JogInt16) value;
@@ -1394,7 +1471,7 @@ void JogCmdArrayWriteInt8::execute( JogVM* vm )
 {
   JogInt64 value = vm->pop_data();
   int index = vm->pop_int();
-  JogRef obj = vm->pop_ref();
+  JogStackRef obj = vm->pop_ref();
   JogObject* array = obj.null_check(t);
   array->index_check(t,index);
   ((JogInt8*)array->data)[index] = (JogInt8) value;
@@ -1405,7 +1482,7 @@ void JogCmdArrayWriteChar::execute( JogVM* vm )
 {
   JogInt64 value = vm->pop_data();
   int index = vm->pop_int();
-  JogRef obj = vm->pop_ref();
+  JogStackRef obj = vm->pop_ref();
   JogObject* array = obj.null_check(t);
   array->index_check(t,index);
   ((JogChar*)array->data)[index] = (JogChar) value;
@@ -1416,10 +1493,758 @@ void JogCmdArrayWriteBoolean::execute( JogVM* vm )
 {
   JogInt64 value = vm->pop_data();
   int index = vm->pop_int();
-  JogRef obj = vm->pop_ref();
+  JogStackRef obj = vm->pop_ref();
   JogObject* array = obj.null_check(t);
   array->index_check(t,index);
   ((char*)array->data)[index] = (char) value;
   vm->push( value );
 }
 
+
+//=============================================================================
+//  Fused Commands
+//=============================================================================
+void JogCmdCompareLocalInt32::on_push( JogVM* vm ) { }
+
+void JogCmdLTLocalLocalInt32::execute( JogVM* vm )
+{
+  JogInt64* locals = vm->frame_ptr->data_stack_ptr;
+  vm->push( (locals[lhs_info->offset] < locals[rhs_info->offset]) ? 1 : 0 );
+}
+
+void JogCmdLTLocalConstInt32::execute( JogVM* vm )
+{
+  JogInt64* locals = vm->frame_ptr->data_stack_ptr;
+  vm->push( (locals[lhs_info->offset] < value) ? 1 : 0 );
+}
+
+void JogCmdLELocalLocalInt32::execute( JogVM* vm )
+{
+  JogInt64* locals = vm->frame_ptr->data_stack_ptr;
+  vm->push( (locals[lhs_info->offset] <= locals[rhs_info->offset]) ? 1 : 0 );
+}
+
+void JogCmdLELocalConstInt32::execute( JogVM* vm )
+{
+  JogInt64* locals = vm->frame_ptr->data_stack_ptr;
+  vm->push( (locals[lhs_info->offset] <= value) ? 1 : 0 );
+}
+
+void JogCmdGTLocalLocalInt32::execute( JogVM* vm )
+{
+  JogInt64* locals = vm->frame_ptr->data_stack_ptr;
+  vm->push( (locals[lhs_info->offset] > locals[rhs_info->offset]) ? 1 : 0 );
+}
+
+void JogCmdGTLocalConstInt32::execute( JogVM* vm )
+{
+  JogInt64* locals = vm->frame_ptr->data_stack_ptr;
+  vm->push( (locals[lhs_info->offset] > value) ? 1 : 0 );
+}
+
+void JogCmdGELocalLocalInt32::execute( JogVM* vm )
+{
+  JogInt64* locals = vm->frame_ptr->data_stack_ptr;
+  vm->push( (locals[lhs_info->offset] >= locals[rhs_info->offset]) ? 1 : 0 );
+}
+
+void JogCmdGELocalConstInt32::execute( JogVM* vm )
+{
+  JogInt64* locals = vm->frame_ptr->data_stack_ptr;
+  vm->push( (locals[lhs_info->offset] >= value) ? 1 : 0 );
+}
+
+void JogCmdArrayReadInt32LocalLocal::on_push( JogVM* vm ) { }
+
+void JogCmdArrayReadInt32LocalLocal::execute( JogVM* vm )
+{
+  int index = (int) vm->frame_ptr->data_stack_ptr[index_info->offset];
+  JogObject* array = vm->frame_ptr->ref_stack_ptr[array_info->offset].null_check(t);
+  array->index_check(t,index);
+  vm->push( ((JogInt32*)array->data)[index] );
+}
+
+void JogCmdAddAssignLocalConstInt32::on_push( JogVM* vm ) { }
+
+void JogCmdAddAssignLocalConstInt32::execute( JogVM* vm )
+{
+  JogInt64& local = vm->frame_ptr->data_stack_ptr[var_info->offset];
+  local = (JogInt32)(local + value);
+  vm->push( local );
+}
+
+//=============================================================================
+//  String Concatenation
+//=============================================================================
+void JogCmdConcatN::on_push( JogVM* vm )
+{
+  for (int i=operands.count-1; i>=0; --i) vm->push( *(operands[i]) );
+}
+
+void JogCmdConcatN::execute( JogVM* vm )
+{
+  JogRef result = vm->concat_strings( vm->ref_stack_ptr, operands.count );
+  vm->discard( 0, operands.count );
+  vm->push( result );
+}
+
+int JogCmdConcatN::piece_count( JogCmd* operand )
+{
+  if (operand->fusion_shape() == JOG_SHAPE_CONCAT) return ((JogCmdConcatN*)operand)->operands.count;
+  return 1;
+}
+
+void JogCmdConcatN::push_pieces( JogVM* vm, JogCmd* operand )
+{
+  if (operand->fusion_shape() == JOG_SHAPE_CONCAT) operand->on_push( vm );
+  else vm->push( operand );
+}
+
+//=============================================================================
+//  Inlined Calls
+//=============================================================================
+void JogCmdNullCheck::execute( JogVM* vm )
+{
+  vm->ref_stack_ptr->null_check(t);
+}
+
+void JogCmdInlineCall::on_push( JogVM* vm )
+{
+  vm->push( *result );
+  for (int i=statements.count-1; i>=0; --i) vm->push( *(statements[i]) );
+}
+
+void JogCmdInlineCall::execute( JogVM* vm )
+{
+  // Result is already on the stack.
+}
+
+//=============================================================================
+//  JogVM::execute_code
+//=============================================================================
+// Ops carry the handlers of run_code<false>(); run_code<true>() looks
+// its own up and checks the stacks before each op.
+#if defined(JOG_THREADED_DISPATCH)
+#  define JOG_HANDLER(name) op_##name:
+#  define JOG_DISPATCH \
+     if (checked) { check_stack_limits(); goto *handlers[ip->opcode]; } \
+     goto *(ip->handler)
+#else
+#  define JOG_HANDLER(name) case JOG_OP_##name:
+#  define JOG_DISPATCH goto dispatch
+#endif
+
+// Charged on backward jumps and calls.
+#define JOG_POLL charge( ip->cmd )
+
+void JogVM::execute_code( JogCode* code )
+{
+  if (code && exact_stack_checks) run_code<true>( code );
+  else                            run_code<false>( code );
+}
+
+template <bool checked>
+void JogVM::run_code( JogCode* code )
+{
+#if defined(JOG_THREADED_DISPATCH)
+  static const void* handlers[] =
+  {
+#define JOG_OPCODE_LABEL(name) &&op_##name,
+    JOG_OPCODES(JOG_OPCODE_LABEL)
+#undef JOG_OPCODE_LABEL
+  };
+#endif
+
+  if ( !code )
+  {
+#if defined(JOG_THREADED_DISPATCH)
+    if ( !checked ) JogCode::dispatch_table = handlers;
+#endif
+    return;
+  }
+
+  JogMethodInfo* m;
+  JogOp* ip = code->ops.data;
+  frame_ptr->return_ip = NULL;
+
+#if defined(JOG_THREADED_DISPATCH)
+  JOG_DISPATCH;
+#else
+dispatch:
+  if (checked) check_stack_limits();
+  switch (ip->opcode)
+  {
+#endif
+
+  JOG_HANDLER(NOP)
+    ++ip;
+    JOG_DISPATCH;
+
+  JOG_HANDLER(TREE)
+    {
+      JogInstruction* original_pos = instruction_stack_ptr;
+      push( ip->cmd );
+      execute_until( original_pos );
+    }
+    ++ip;
+    JOG_DISPATCH;
+
+  JOG_HANDLER(NODE)
+    ip->cmd->execute(this);
+    ++ip;
+    JOG_DISPATCH;
+
+  JOG_HANDLER(JUMP)
+    if (ip->operand <= 0) JOG_POLL;
+    ip += ip->operand;
+    JOG_DISPATCH;
+
+  JOG_HANDLER(JUMP_IF_FALSE)
+    if (pop_data()) ++ip;
+    else            ip += ip->operand;
+    JOG_DISPATCH;
+
+  JOG_HANDLER(JUMP_IF_TRUE)
+    if (pop_data()) ip += ip->operand;
+    else            ++ip;
+    JOG_DISPATCH;
+
+  JOG_HANDLER(PUSH_DATA)
+    push( ip->value );
+    ++ip;
+    JOG_DISPATCH;
+
+  JOG_HANDLER(PUSH_NULL)
+    push( JogRef() );
+    ++ip;
+    JOG_DISPATCH;
+
+  JOG_HANDLER(PUSH_THIS)
+    push( frame_ptr->ref_stack_ptr[-1] );
+    ++ip;
+    JOG_DISPATCH;
+
+  JOG_HANDLER(PUSH_REF)
+    push( (JogObject*)(intptr_t) ip->value );
+    ++ip;
+    JOG_DISPATCH;
+
+  JOG_HANDLER(READ_LOCAL_DATA)
+    push( frame_ptr->data_stack_ptr[ip->operand] );
+    ++ip;
+    JOG_DISPATCH;
+
+  JOG_HANDLER(READ_LOCAL_REF)
+    push( frame_ptr->ref_stack_ptr[ip->operand] );
+    ++ip;
+    JOG_DISPATCH;
+
+  JOG_HANDLER(WRITE_LOCAL_DATA)
+    frame_ptr->data_stack_ptr[ip->operand] = peek_data();
+    ++ip;
+    JOG_DISPATCH;
+
+  JOG_HANDLER(WRITE_LOCAL_REF)
+    frame_ptr->ref_stack_ptr[ip->operand] = peek_ref();
+    ++ip;
+    JOG_DISPATCH;
+
+  JOG_HANDLER(DISCARD_DATA)
+    pop_data();
+    ++ip;
+    JOG_DISPATCH;
+
+  JOG_HANDLER(DISCARD_REF)
+    pop_ref();
+    ++ip;
+    JOG_DISPATCH;
+
+  JOG_HANDLER(ADD_INT32)
+    {
+      int b = (int) pop_data();
+      int a = (int) pop_data();
+      push( a+b );
+    }
+    ++ip;
+    JOG_DISPATCH;
+
+  JOG_HANDLER(SUB_INT32)
+    {
+      int b = (int) pop_data();
+      int a = (int) pop_data();
+      push( a-b );
+    }
+    ++ip;
+    JOG_DISPATCH;
+
+  JOG_HANDLER(MUL_INT32)
+    {
+      int b = (int) pop_data();
+      int a = (int) pop_data();
+      push( a*b );
+    }
+    ++ip;
+    JOG_DISPATCH;
+
+  JOG_HANDLER(ADD_INT64)
+    {
+      JogInt64 b = pop_data();
+      JogInt64 a = pop_data();
+      push( a+b );
+    }
+    ++ip;
+    JOG_DISPATCH;
+
+  JOG_HANDLER(SUB_INT64)
+    {
+      JogInt64 b = pop_data();
+      JogInt64 a = pop_data();
+      push( a-b );
+    }
+    ++ip;
+    JOG_DISPATCH;
+
+  JOG_HANDLER(MUL_INT64)
+    {
+      JogInt64 b = pop_data();
+      JogInt64 a = pop_data();
+      push( a*b );
+    }
+    ++ip;
+    JOG_DISPATCH;
+
+  JOG_HANDLER(ADD_REAL64)
+    {
+      double b = pop_data_as_Real64();
+      double a = pop_data_as_Real64();
+      push( a+b );
+    }
+    ++ip;
+    JOG_DISPATCH;
+
+  JOG_HANDLER(SUB_REAL64)
+    {
+      double b = pop_data_as_Real64();
+      double a = pop_data_as_Real64();
+      push( a-b );
+    }
+    ++ip;
+    JOG_DISPATCH;
+
+  JOG_HANDLER(MUL_REAL64)
+    {
+      double b = pop_data_as_Real64();
+      double a = pop_data_as_Real64();
+      push( a*b );
+    }
+    ++ip;
+    JOG_DISPATCH;
+
+  JOG_HANDLER(DIV_REAL64)
+    {
+      double b = pop_data_as_Real64();
+      double a = pop_data_as_Real64();
+      push( a/b );
+    }
+    ++ip;
+    JOG_DISPATCH;
+
+  JOG_HANDLER(EQ_INTEGER)
+    {
+      JogInt64 b = pop_data();
+      JogInt64 a = pop_data();
+      push( (a==b)?1:0 );
+    }
+    ++ip;
+    JOG_DISPATCH;
+
+  JOG_HANDLER(NE_INTEGER)
+    {
+      JogInt64 b = pop_data();
+      JogInt64 a = pop_data();
+      push( (a!=b)?1:0 );
+    }
+    ++ip;
+    JOG_DISPATCH;
+
+  JOG_HANDLER(LT_INTEGER)
+    {
+      JogInt64 b = pop_data();
+      JogInt64 a = pop_data();
+      push( (a<b)?1:0 );
+    }
+    ++ip;
+    JOG_DISPATCH;
+
+  JOG_HANDLER(LE_INTEGER)
+    {
+      JogInt64 b = pop_data();
+      JogInt64 a = pop_data();
+      push( (a<=b)?1:0 );
+    }
+    ++ip;
+    JOG_DISPATCH;
+
+  JOG_HANDLER(GT_INTEGER)
+    {
+      JogInt64 b = pop_data();
+      JogInt64 a = pop_data();
+      push( (a>b)?1:0 );
+    }
+    ++ip;
+    JOG_DISPATCH;
+
+  JOG_HANDLER(GE_INTEGER)
+    {
+      JogInt64 b = pop_data();
+      JogInt64 a = pop_data();
+      push( (a>=b)?1:0 );
+    }
+    ++ip;
+    JOG_DISPATCH;
+
+  JOG_HANDLER(LT_REAL)
+    {
+      double b = pop_data_as_Real64();
+      double a = pop_data_as_Real64();
+      push( (a<b)?1:0 );
+    }
+    ++ip;
+    JOG_DISPATCH;
+
+  JOG_HANDLER(LE_REAL)
+    {
+      double b = pop_data_as_Real64();
+      double a = pop_data_as_Real64();
+      push( (a<=b)?1:0 );
+    }
+    ++ip;
+    JOG_DISPATCH;
+
+  JOG_HANDLER(GT_REAL)
+    {
+      double b = pop_data_as_Real64();
+      double a = pop_data_as_Real64();
+      push( (a>b)?1:0 );
+    }
+    ++ip;
+    JOG_DISPATCH;
+
+  JOG_HANDLER(GE_REAL)
+    {
+      double b = pop_data_as_Real64();
+      double a = pop_data_as_Real64();
+      push( (a>=b)?1:0 );
+    }
+    ++ip;
+    JOG_DISPATCH;
+
+  JOG_HANDLER(EQ_REF)
+    {
+      JogStackRef b = pop_ref();
+      JogStackRef a = pop_ref();
+      push( (a==b)?1:0 );
+    }
+    ++ip;
+    JOG_DISPATCH;
+
+  JOG_HANDLER(NE_REF)
+    {
+      JogStackRef b = pop_ref();
+      JogStackRef a = pop_ref();
+      push( (a!=b)?1:0 );
+    }
+    ++ip;
+    JOG_DISPATCH;
+
+  JOG_HANDLER(ARRAY_SIZE)
+    {
+      JogObject* obj = pop_ref().null_check(ip->cmd->t);
+      push( obj->count );
+    }
+    ++ip;
+    JOG_DISPATCH;
+
+  JOG_HANDLER(READ_PROPERTY_DATA)
+    {
+      JogStackRef context = pop_ref();
+      push( context.null_check(ip->cmd->t)->data[ip->operand] );
+    }
+    ++ip;
+    JOG_DISPATCH;
+
+  JOG_HANDLER(READ_PROPERTY_REF)
+    {
+      JogStackRef context = pop_ref();
+      push( *((JogObject**)&(context.null_check(ip->cmd->t)->data[ip->operand])) );
+    }
+    ++ip;
+    JOG_DISPATCH;
+
+  JOG_HANDLER(ARRAY_READ_INT32)
+    {
+      int index = pop_int();
+      JogStackRef obj = pop_ref();
+      JogObject* array = obj.null_check(ip->cmd->t);
+      array->index_check(ip->cmd->t,index);
+      push( ((JogInt32*)array->data)[index] );
+    }
+    ++ip;
+    JOG_DISPATCH;
+
+  JOG_HANDLER(ARRAY_WRITE_INT32)
+    {
+      JogInt64 value = pop_data();
+      int index = pop_int();
+      JogStackRef obj = pop_ref();
+      JogObject* array = obj.null_check(ip->cmd->t);
+      array->index_check(ip->cmd->t,index);
+      ((JogInt32*)array->data)[index] = (JogInt32) value;
+      push( value );
+    }
+    ++ip;
+    JOG_DISPATCH;
+
+  JOG_HANDLER(NEW_OBJECT)
+    {
+      JogTypeInfo* of_type = ((JogCmdNewObject*)ip->cmd)->of_type;
+      JogRef new_obj = of_type->create_instance(this);
+      push( new_obj );  // final result
+      push( new_obj );  // consumed by constructor
+      if ( *(of_type->call_init_object) ) push( new_obj );  // consumed by init_object()
+    }
+    ++ip;
+    JOG_DISPATCH;
+
+  JOG_HANDLER(CALL_STATIC)
+    m = ip->method_info;
+    ((ref_stack_ptr + m->param_ref_count)[-1]).null_check(ip->cmd->t);
+    goto invoke;
+
+  JOG_HANDLER(CALL_DYNAMIC)
+    {
+      JogObject* obj = ((ref_stack_ptr + ip->method_info->param_ref_count)[-1]).null_check(ip->cmd->t);
+      m = obj->type->dispatch_table[ip->method_info->dispatch_id];
+    }
+    goto invoke;
+
+  JOG_HANDLER(CALL_CLASS)
+    m = ip->method_info;
+    goto invoke;
+
+  JOG_HANDLER(RETURN_VOID)
+    {
+      JogOp* return_ip = frame_ptr->return_ip;
+      pop_frame();
+      if ( !return_ip ) return;
+      ip = return_ip;
+    }
+    JOG_DISPATCH;
+
+  JOG_HANDLER(RETURN_DATA)
+    {
+      JogInt64 result = pop_data();
+      JogOp* return_ip = frame_ptr->return_ip;
+      pop_frame();
+      push( result );
+      if ( !return_ip ) return;
+      ip = return_ip;
+    }
+    JOG_DISPATCH;
+
+  JOG_HANDLER(RETURN_REF)
+    {
+      JogStackRef result = pop_ref();
+      JogOp* return_ip = frame_ptr->return_ip;
+      pop_frame();
+      push( result );
+      if ( !return_ip ) return;
+      ip = return_ip;
+    }
+    JOG_DISPATCH;
+
+  JOG_HANDLER(MISSING_RETURN)
+    throw ip->method_info->t->error( "Method does not return a value in all cases." );
+
+  JOG_HANDLER(COUNTED_LOOP_TEST)
+    if (((JogCmdCountedLoop*)ip->cmd)->in_range(this)) ++ip;
+    else                                               ip += ip->operand;
+    JOG_DISPATCH;
+
+  JOG_HANDLER(COUNTED_LOOP_NEXT)
+    {
+      JogCmdCountedLoop* loop = (JogCmdCountedLoop*) ip->cmd;
+      loop->step(this);
+      if (loop->in_range(this))
+      {
+        JOG_POLL;
+        ip += ip->operand;
+      }
+      else
+      {
+        ++ip;
+      }
+    }
+    JOG_DISPATCH;
+
+  // Register ops address slots of the current frame; see JogCodeBuilder.
+  JOG_HANDLER(LOAD_CONST)
+    frame_ptr->data_stack_ptr[ip->operand] = ip->value;
+    ++ip;
+    JOG_DISPATCH;
+
+  JOG_HANDLER(MOVE)
+    frame_ptr->data_stack_ptr[ip->operand] = frame_ptr->data_stack_ptr[ip->src_a];
+    ++ip;
+    JOG_DISPATCH;
+
+  JOG_HANDLER(POP_LOCAL_DATA)
+    frame_ptr->data_stack_ptr[ip->operand] = pop_data();
+    ++ip;
+    JOG_DISPATCH;
+
+  JOG_HANDLER(JUMP_IF_FALSE_R)
+    if (frame_ptr->data_stack_ptr[ip->src_a]) ++ip;
+    else                                      ip += ip->operand;
+    JOG_DISPATCH;
+
+  JOG_HANDLER(RETURN_DATA_R)
+    {
+      JogInt64 result = frame_ptr->data_stack_ptr[ip->src_a];
+      JogOp* return_ip = frame_ptr->return_ip;
+      pop_frame();
+      push( result );
+      if ( !return_ip ) return;
+      ip = return_ip;
+    }
+    JOG_DISPATCH;
+
+#define JOG_REGISTER_INT32_OP(name,op) \
+  JOG_HANDLER(name) \
+    { \
+      JogInt64* regs = frame_ptr->data_stack_ptr; \
+      regs[ip->operand] = (int) regs[ip->src_a] op (int) regs[ip->src_b]; \
+    } \
+    ++ip; \
+    JOG_DISPATCH;
+
+#define JOG_REGISTER_INT64_OP(name,op) \
+  JOG_HANDLER(name) \
+    { \
+      JogInt64* regs = frame_ptr->data_stack_ptr; \
+      regs[ip->operand] = regs[ip->src_a] op regs[ip->src_b]; \
+    } \
+    ++ip; \
+    JOG_DISPATCH;
+
+#define JOG_REGISTER_REAL64_OP(name,op) \
+  JOG_HANDLER(name) \
+    { \
+      JogInt64* regs = frame_ptr->data_stack_ptr; \
+      double result = *((double*)&regs[ip->src_a]) op *((double*)&regs[ip->src_b]); \
+      regs[ip->operand] = *((JogInt64*)&result); \
+    } \
+    ++ip; \
+    JOG_DISPATCH;
+
+#define JOG_REGISTER_COMPARE_REAL_OP(name,op) \
+  JOG_HANDLER(name) \
+    { \
+      JogInt64* regs = frame_ptr->data_stack_ptr; \
+      regs[ip->operand] = (*((double*)&regs[ip->src_a]) op *((double*)&regs[ip->src_b])) ? 1 : 0; \
+    } \
+    ++ip; \
+    JOG_DISPATCH;
+
+  JOG_REGISTER_INT32_OP(ADD_INT32_R,+)
+  JOG_REGISTER_INT32_OP(SUB_INT32_R,-)
+  JOG_REGISTER_INT32_OP(MUL_INT32_R,*)
+
+  JOG_HANDLER(DIV_INT32_R)
+    {
+      JogInt64* regs = frame_ptr->data_stack_ptr;
+      int b = (int) regs[ip->src_b];
+      if ( !b ) throw ip->cmd->error( "Integer divide by zero error during execution." );
+      regs[ip->operand] = (int) regs[ip->src_a] / b;
+    }
+    ++ip;
+    JOG_DISPATCH;
+
+  JOG_HANDLER(MOD_INT32_R)
+    {
+      JogInt64* regs = frame_ptr->data_stack_ptr;
+      int b = (int) regs[ip->src_b];
+      if ( !b ) throw ip->cmd->error( "Integer divide by zero error during execution." );
+      regs[ip->operand] = (int) regs[ip->src_a] % b;
+    }
+    ++ip;
+    JOG_DISPATCH;
+
+  JOG_REGISTER_INT64_OP(ADD_INT64_R,+)
+  JOG_REGISTER_INT64_OP(SUB_INT64_R,-)
+  JOG_REGISTER_INT64_OP(MUL_INT64_R,*)
+  JOG_REGISTER_REAL64_OP(ADD_REAL64_R,+)
+  JOG_REGISTER_REAL64_OP(SUB_REAL64_R,-)
+  JOG_REGISTER_REAL64_OP(MUL_REAL64_R,*)
+  JOG_REGISTER_REAL64_OP(DIV_REAL64_R,/)
+  JOG_REGISTER_INT64_OP(EQ_INTEGER_R,==)
+  JOG_REGISTER_INT64_OP(NE_INTEGER_R,!=)
+  JOG_REGISTER_INT64_OP(LT_INTEGER_R,<)
+  JOG_REGISTER_INT64_OP(LE_INTEGER_R,<=)
+  JOG_REGISTER_INT64_OP(GT_INTEGER_R,>)
+  JOG_REGISTER_INT64_OP(GE_INTEGER_R,>=)
+  JOG_REGISTER_COMPARE_REAL_OP(LT_REAL_R,<)
+  JOG_REGISTER_COMPARE_REAL_OP(LE_REAL_R,<=)
+  JOG_REGISTER_COMPARE_REAL_OP(GT_REAL_R,>)
+  JOG_REGISTER_COMPARE_REAL_OP(GE_REAL_R,>=)
+
+#undef JOG_REGISTER_INT32_OP
+#undef JOG_REGISTER_INT64_OP
+#undef JOG_REGISTER_REAL64_OP
+#undef JOG_REGISTER_COMPARE_REAL_OP
+
+#if !defined(JOG_THREADED_DISPATCH)
+    default:
+      throw ip->cmd->error( "[Internal] Unknown opcode." );
+  }
+#endif
+
+invoke:
+  JOG_POLL;
+  if ( !*(m->code) ) m->compile( execution_mode );
+  if (m->is_native() && call_leaf_native(m))
+  {
+    ++ip;
+    JOG_DISPATCH;
+  }
+  push_frame( m, ip->cmd );
+
+  if (m->is_native())
+  {
+    // Most native handlers pop their own frame.  Compared as a depth since
+    // a native that calls back into Jog can relocate the frame stack.
+    int native_depth = (int)(frame_stack_limit - frame_ptr);
+    bool checking = !checked && exact_stack_checks;
+    call_native( m );
+    if (frame_stack_limit - frame_ptr == native_depth) pop_frame();
+    if (checking) check_stack_limits();
+    ++ip;
+    JOG_DISPATCH;
+  }
+
+  if ( !checked && exact_stack_checks )
+  {
+    // The frame doesn't fit its stacks.
+    run_code<true>( *(m->code) );
+    ++ip;
+    JOG_DISPATCH;
+  }
+
+  frame_ptr->return_ip = ip + 1;
+  ip = m->code->ops.data;
+  JOG_DISPATCH;
+}
+
+#undef JOG_HANDLER
+#undef JOG_DISPATCH
+#undef JOG_POLL
@@ -1,16 +1,21 @@
 #include "jog.h"
 int num_objects = 0;
 
-int main()
+int main( int argc, char** argv )
 {
+  // Usage: jog [program.java [execution_mode [type_name ...]]]
+  // Allocation counts of the named types, e.g. "ArrayList<String>", are
+  // printed after the program runs.
+  const char* program = (argc > 1) ? argv[1] : "test.java";
   Ref<JogVM> vm = new JogVM();
+  if (argc > 2) vm->execution_mode = atoi( argv[2] );
   //Ref<JogScanner> scanner = new JogScanner(new JogReader("test.java"));
 
   try
   {
     vm->parse("libraries/jog/jog_stdlib.java");
 
-    vm->parse( "test.java" );
+    vm->parse( program );
     /*
     vm->parse( "hello.java",
         "public class Hello { Hello(){ println(\"Hello World!\\n\"); } }"
@@ -34,6 +39,11 @@ int main()
     fprintf( stderr, "[Internal compiler error]\n" );
   }
 
+  for (int i=3; i<argc; ++i)
+  {
+    printf( "%s allocated %lld\n", argv[i], (long long) vm->heap_stats(argv[i]).allocation_count );
+  }
+
   return 0;
 }
 
@@ -0,0 +1,91 @@
+// Objects that never leave the method that creates them aren't allocated:
+// a for-each loop's iterator, subclasses with property initializers,
+// constructors that update properties in place and objects whose methods
+// branch, loop and return early.  Only the iterator passed to print() is
+// allocated; see scalar_replacement.types.
+class Test
+{
+  Test()
+  {
+    ArrayList<String> list = new ArrayList<String>();
+    list.add( "a" );
+    list.add( "b" );
+    list.add( "c" );
+
+    for (String st : list)
+    {
+      for (String other : list) print( st + other + " " );
+    }
+    println();
+
+    Pt3 p = new Pt3( 1, 2 );
+    println( p.x + p.y + p.z );
+
+    Counter c = new Counter( 5 );
+    println( c.total );
+    println( c.count );
+
+    println( Integer.toString(-1234) + " " + Long.toString(56789L) );
+
+    Tally t = new Tally();
+    for (int i=0; i<10; ++i) t.add( i );
+    println( t.sum );
+
+    // An iterator passed to another method is still allocated.
+    print( list.iterator() );
+  }
+
+  static void print( Iterator<String> it )
+  {
+    while (it.hasNext()) print( it.next() );
+    println();
+  }
+}
+
+class Pt
+{
+  int x, y;
+
+  Pt( int x, int y )
+  {
+    this.x = x;
+    this.y = y;
+  }
+}
+
+class Pt3 extends Pt
+{
+  int z = 9;
+
+  Pt3( int x, int y ) { super( x, y ); }
+}
+
+class Counter
+{
+  int total = 1;
+  int count;
+
+  Counter( int n )
+  {
+    total += n;
+    total *= 2;
+    ++count;
+    count++;
+  }
+}
+
+class Tally
+{
+  int sum;
+
+  void add( int n )
+  {
+    if (n % 2 == 0)
+    {
+      if (n > 6) return;
+      sum += n;
+      return;
+    }
+    sum += n * 10;
+  }
+}
@@ -0,0 +1,54 @@
+// Pushing an expression pushes all of its commands at once, so a method's
+// instruction depth grows with the width of its expressions.  "make
+// check_stacks" checks each frame against its method's computed depths.
+class Test
+{
+  Test()
+  {
+    println( wide(30, 1, 2, 3, 4) );
+    println( chain(25, "") );
+    println( nested(30).total() );
+  }
+
+  static int wide( int n, int a, int b, int c, int d )
+  {
+    if (n == 0) return ((a+b)*(c+d) + (a-b)*(c-d)) * ((a*b)+(c*d));
+    return ((a+b)*(c+d) - (a-b)*(c-d)) % 7
+      + wide( n-1, (a+1)%5, ((b+2)+(c+3))%7, ((a+b)+(c+d))%11, ((a-b)-(c-d))%13 )
+      - ((a+b)+(c+d))*((a-b)+(c-d)) % 3;
+  }
+
+  static String chain( int n, String s )
+  {
+    if (n == 0) return s;
+    int[] digits = { n/100, (n/10)%10, n%10 };
+    return chain( n-1, digits[0] + "" + digits[1] + digits[2] + "," ) + s;
+  }
+
+  static Node nested( int n )
+  {
+    if (n == 0) return null;
+    return new Node( n, new Node( n*2, nested(n-1), null ), new Node( n+1, null, null ) );
+  }
+}
+
+class Node
+{
+  int value;
+  Node left, right;
+
+  Node( int value, Node left, Node right )
+  {
+    this.value = value;
+    this.left = left;
+    this.right = right;
+  }
+
+  int total()
+  {
+    int result = value;
+    if (left != null) result += left.total();
+    if (right != null) result += right.total();
+    return result;
+  }
+}
@@ -0,0 +1,28 @@
+// A class property set by a static initializer is only replaced by its
+// value if nothing can read it before it's stored.
+class Test
+{
+  Test()
+  {
+    println( A.X );
+    println( A.Y );
+    println( B.P );
+    println( B.Q );
+  }
+}
+
+class A
+{
+  static int X = compute();
+  static int Y = 5;
+
+  static int compute() { return Y + 1; }
+}
+
+class B
+{
+  static int P = 7;
+  static int Q = twice();
+
+  static int twice() { return P * 2; }
+}
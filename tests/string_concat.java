@@ -0,0 +1,25 @@
+// A '+' that isn't a compile-time constant makes a new String, even when
+// all but one operand is empty.
+class Test
+{
+  static String S = "x";
+
+  Test()
+  {
+    String s = "ab" + 1;
+    String e = "";
+    println( (s + "") == s );
+    println( ("" + s) == s );
+    println( (e + s + e) == s );
+    println( (s + "").equals(s) );
+    println( (S + "") == S );
+    println( (e + e) == e );
+
+    String lit = "lit";
+    println( (lit + "") == lit );
+    println( ("li" + "t") == lit );
+
+    println( s.concat("") == s );
+    println( "".concat(s) == s );
+  }
+}
@@ -0,0 +1,26 @@
+// String.intern() returns one String per content.  Strings interned at run
+// time are ordinary heap objects: freed when dropped and charged to the
+// object budget while kept.
+class Test
+{
+  Test()
+  {
+    String a = "ab" + 1;
+    String b = "ab" + 1;
+    println( a == b );
+    println( a.intern() == a );
+    println( b.intern() == a );
+
+    String lit = "lit";
+    String li = "li";
+    println( (li + "t").intern() == lit );
+    println( lit.intern() == lit );
+
+    for (int i=0; i<200000; ++i) ("k" + i).intern();
+    println( "Dropped 200000 interned Strings." );
+
+    ArrayList<String> kept = new ArrayList<String>();
+    for (int i=0; i<300000; ++i) kept.add( ("k" + i).intern() );
+    println( "Kept 300000 interned Strings." );
+  }
+}